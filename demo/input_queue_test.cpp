@@ -0,0 +1,105 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// InputQueue 出队顺序自检（不注入任何输入，不需要显示器）：
+// 按住的键不会被其它设备的运动"超车"、拖拽前的移动不会因过期被丢弃等。
+// 全部通过返回 0，否则打印失败项并返回 1。
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "input_queue.hpp"
+
+using namespace autoalg;
+
+namespace {
+
+int g_failed = 0;
+
+void Check(bool ok, const char* what) {
+  std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) ++g_failed;
+}
+
+std::vector<InputCommand> Drain(InputQueue& q) {
+  std::vector<InputCommand> out;
+  InputCommand cmd;
+  while (q.Pop(cmd)) out.push_back(cmd);
+  return out;
+}
+
+bool Types(const std::vector<InputCommand>& cmds, const std::vector<InputCommand::Type>& want) {
+  if (cmds.size() != want.size()) return false;
+  for (size_t i = 0; i < cmds.size(); ++i) {
+    if (cmds[i].type != want[i]) return false;
+  }
+  return true;
+}
+
+constexpr int kCtrl = 17;
+constexpr int kShift = 16;
+constexpr int kKeyA = 65;
+
+}  // namespace
+
+int main() {
+  using T = InputCommand;
+  {
+    // Ctrl+滚轮：KeyUp 不能越过按住 Ctrl 时入队的滚动
+    InputQueue q;
+    q.Push(T::Key(T::kKeyDown, kCtrl));
+    q.Push(T::Scroll(0, -3));
+    q.Push(T::Key(T::kKeyUp, kCtrl));
+    Check(Types(Drain(q), {T::kKeyDown, T::kScroll, T::kKeyUp}), "KeyDown, Scroll, KeyUp keeps Ctrl+scroll");
+  }
+  {
+    // Shift+移动同理
+    InputQueue q;
+    q.Push(T::Key(T::kKeyDown, kShift));
+    q.Push(T::MoveTo(10, 10));
+    q.Push(T::MoveBy(5, 0));
+    q.Push(T::Key(T::kKeyUp, kShift));
+    Check(Types(Drain(q), {T::kKeyDown, T::kMouseMove, T::kMouseMoveRelative, T::kKeyUp}), "Shift+move keeps Shift");
+  }
+  {
+    // 没有按键按住时，按键仍然插到长拖动的运动之前
+    InputQueue q;
+    q.Push(T::Button(T::kMouseDown, 0, 0, SystemInput::kLeft));
+    q.Push(T::MoveTo(100, 100));
+    q.Push(T::Key(T::kKeyDown, kKeyA));
+    Check(Types(Drain(q), {T::kMouseDown, T::kKeyDown, T::kMouseMove}), "key press overtakes free motion");
+  }
+  {
+    // 按住 Ctrl 前后的滚动不能合并
+    InputQueue q;
+    q.Push(T::Scroll(0, 1));
+    q.Push(T::Key(T::kKeyDown, kCtrl));
+    q.Push(T::Scroll(0, 1));
+    const std::vector<InputCommand> out = Drain(q);
+    Check(out.size() == 3 && q.CoalescedCount() == 0, "scrolls across a modifier change are not merged");
+  }
+  {
+    // 过期的 MoveTo 在拖拽前必须保留（拖拽从当前光标开始）
+    InputQueue q;
+    q.Push(T::MoveTo(10, 20).WithTimeout(std::chrono::milliseconds(0)));
+    q.Push(T::Button(T::kMouseDrag, 300, 400, SystemInput::kLeft));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    const std::vector<InputCommand> out = Drain(q);
+    Check(Types(out, {T::kMouseMove, T::kMouseDrag}) && out[0].x == 10 && out[0].y == 20,
+          "stale MoveTo before a drag is kept");
+  }
+  {
+    // 过期的 MoveTo 后面跟着带坐标的点击，可以丢弃
+    InputQueue q;
+    q.Push(T::MoveTo(10, 20).WithTimeout(std::chrono::milliseconds(0)));
+    q.Push(T::Button(T::kMouseClick, 300, 400, SystemInput::kLeft));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    Check(Types(Drain(q), {T::kMouseClick}) && q.DroppedCount() == 1, "stale MoveTo before a click is dropped");
+  }
+
+  std::printf("%s\n", g_failed ? "FAILED" : "all passed");
+  return g_failed ? 1 : 0;
+}
@@ -17,13 +17,14 @@
 #include <chrono>
 #include <cstdint>
 #include <cstdio>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "image_writer.hpp"
 #include "system_input.hpp"
 #include "system_output.hpp"
 
@@ -31,52 +32,14 @@
 
 using namespace autoalg;
 
-// ---------- Simple BMP writer (BGRA, 32-bit, top-down) ----------
-#pragma pack(push, 1)
-struct BMPFileHeader {
-  uint16_t bfType{0x4D42};  // 'BM'
-  uint32_t bfSize{};
-  uint16_t bfReserved1{};
-  uint16_t bfReserved2{};
-  uint32_t bfOffBits{54};  // 14 + 40
-};
-struct BMPInfoHeader {
-  uint32_t biSize{40};
-  int32_t biWidth{};
-  int32_t biHeight{};  // negative => top-down
-  uint16_t biPlanes{1};
-  uint16_t biBitCount{32};    // 32-bit
-  uint32_t biCompression{0};  // BI_RGB
-  uint32_t biSizeImage{};
-  int32_t biXPelsPerMeter{2835};
-  int32_t biYPelsPerMeter{2835};
-  uint32_t biClrUsed{};
-  uint32_t biClrImportant{};
-};
-#pragma pack(pop)
-
-static bool SaveBMP_BGRA_TopDown(const std::string& path, int w, int h, const std::vector<uint8_t>& rgba) {
-  if (w <= 0 || h <= 0) return false;
-  const size_t need = static_cast<size_t>(w) * h * 4;
-  if (rgba.size() < need) return false;
-
-  // RGBA -> BGRA
-  std::vector<uint8_t> bgra(rgba);
-  for (size_t i = 0; i < need; i += 4) std::swap(bgra[i + 0], bgra[i + 2]);
-
-  BMPFileHeader fh;
-  BMPInfoHeader ih;
-  ih.biWidth = w;
-  ih.biHeight = -h;  // top-down
-  ih.biSizeImage = static_cast<uint32_t>(need);
-  fh.bfSize = fh.bfOffBits + ih.biSizeImage;
-
-  std::ofstream f(path, std::ios::binary);
-  if (!f) return false;
-  f.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
-  f.write(reinterpret_cast<const char*>(&ih), sizeof(ih));
-  f.write(reinterpret_cast<const char*>(bgra.data()), (std::streamsize)bgra.size());
-  return f.good();
+// ---------- Screenshots: PNG, encoded and written off the test thread ----------
+static AsyncImageWriter& ShotWriter() {
+  static AsyncImageWriter writer([] {
+    AsyncImageWriter::Options o;
+    o.drop_when_full = false;  // every step's screenshot matters; wait instead of dropping
+    return o;
+  }());
+  return writer;
 }
 
 // Sanitize filename segment (keep [A-Za-z0-9_-.])
@@ -102,16 +65,17 @@ static bool CaptureStep(int display_index, const std::string& prefix, int step_n
     return false;
   }
   std::ostringstream oss;
-  oss << prefix << "_" << step_no << "_" << Sanitize(label) << ".bmp";
-  if (!SaveBMP_BGRA_TopDown(oss.str(), img.width, img.height, img.pixels)) {
-    std::fprintf(stderr, "[%02d] Save BMP failed: %s\n", step_no, oss.str().c_str());
+  oss << prefix << "_" << step_no << "_" << Sanitize(label) << ".png";
+  const int w = img.width, h = img.height;
+  if (!ShotWriter().Save(oss.str(), std::make_shared<const ImageRGBA>(std::move(img)))) {
+    std::fprintf(stderr, "[%02d] Queue screenshot failed: %s\n", step_no, oss.str().c_str());
     return false;
   }
 
   int cx_px = 0, cy_px = 0;
   // query pixel cursor (best-effort on Wayland/uinput)
   const_cast<SystemInput&>(in).GetCursorPixel(cx_px, cy_px);
-  std::printf("[%02d] %-28s => captured %dx%d -> %s ; cursor(px)=(%d,%d)\n", step_no, label.c_str(), img.width, img.height,
+  std::printf("[%02d] %-28s => captured %dx%d -> %s ; cursor(px)=(%d,%d)\n", step_no, label.c_str(), w, h,
               oss.str().c_str(), cx_px, cy_px);
   return true;
 }
@@ -283,6 +247,9 @@ int main(int argc, char** argv) {
   PauseMs(delay_ms);
   CaptureStep(display_index, prefix, ++step, "final", in);
 
-  std::printf("== Done. %d steps executed. Screenshots under prefix '%s_*.bmp'. ==\n", step, prefix.c_str());
+  ShotWriter().Flush();
+  const AsyncImageWriter::Stats shots = ShotWriter().GetStats();
+  std::printf("== Done. %d steps executed. %llu screenshots (%.1f MB) under prefix '%s_*.png'. ==\n", step,
+              static_cast<unsigned long long>(shots.written), shots.bytes / 1e6, prefix.c_str());
   return 0;
 }
@@ -0,0 +1,186 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// 回放缓冲内存预算测量（离线，不需要显示器）：
+// 按 1080p30 合成 30 秒画面推入 ReplayBuffer，打印保留的秒数、压缩字节数与预算、
+// 平均每帧编码耗时（同步编码测得）及实时 30 fps 大约需要的核数，
+// 并解码最后一帧与输入逐字节比对（无损校验）。
+// 场景：
+//   desktop  静止桌面 + 周期性滚动的文本窗口 + 移动光标
+//   game     每帧平移几个像素的纹理地图 + 移动的精灵 + 静止的 HUD
+//   noise    每帧全屏随机像素（最坏情况，无损压缩无法放进预算，仅作对照）
+//
+// Usage:
+//   ./replay_budget_demo [desktop|game|noise|all] [budget_mb] [seconds]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "replay_buffer.hpp"
+
+using namespace autoalg;
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr int kFps = 30;
+constexpr uint64_t kFrameNs = 1000000000ull / kFps;
+
+void FillRect(ImageRGBA& img, int x0, int y0, int w, int h, uint8_t r, uint8_t g, uint8_t b) {
+  for (int y = std::max(0, y0); y < std::min(img.height, y0 + h); ++y) {
+    for (int x = std::max(0, x0); x < std::min(img.width, x0 + w); ++x) {
+      uint8_t* p = &img.pixels[(static_cast<size_t>(y) * img.width + x) * 4];
+      p[0] = r;
+      p[1] = g;
+      p[2] = b;
+      p[3] = 255;
+    }
+  }
+}
+
+uint32_t Hash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+// 每 4 秒一个周期：前 1 秒文本窗口滚动，前 2 秒光标移动，之后静止
+void DrawDesktop(int i, ImageRGBA& img) {
+  for (int y = 0; y < kHeight; ++y) FillRect(img, 0, y, kWidth, 1, 40, 70, static_cast<uint8_t>(100 + y / 12));
+  FillRect(img, 0, kHeight - 40, kWidth, 40, 30, 30, 40);  // 任务栏
+
+  const int cycle = i / (4 * kFps);
+  const int phase = i % (4 * kFps);
+  const int scroll = (cycle * kFps + std::min(phase, kFps)) * 3;
+  const int wx = 300, wy = 150, ww = 1000, wh = 700;
+  FillRect(img, wx, wy, ww, wh, 250, 250, 250);
+  FillRect(img, wx, wy - 28, ww, 28, 60, 60, 80);  // 标题栏
+  for (int y = 0; y < wh; ++y) {
+    const int doc_y = y + scroll;
+    const int line = doc_y / 20;
+    if (doc_y % 20 >= 14) continue;  // 行间距
+    for (int col = 0; col < 110; ++col) {
+      const uint32_t h = Hash(static_cast<uint32_t>(line * 131 + col * 71));
+      if ((h >> 28) < 4) continue;  // 空格
+      FillRect(img, wx + 10 + col * 9, wy + y, 7, 1, static_cast<uint8_t>(h >> 24), 30, 30);
+    }
+  }
+
+  const int t = std::min(phase, 2 * kFps);
+  FillRect(img, 1400 + t * 4, 800 - t * 5, 12, 18, 255, 255, 255);  // 光标
+}
+
+// 地图纹理固定在世界坐标上（草地/道路/建筑块），镜头每帧向右下平移
+void DrawGame(int i, ImageRGBA& img) {
+  const int cam_x = i * 4, cam_y = i * 2;
+  for (int y = 0; y < kHeight; ++y) {
+    const int wy = y + cam_y;
+    uint8_t* row = &img.pixels[static_cast<size_t>(y) * kWidth * 4];
+    for (int x = 0; x < kWidth; ++x) {
+      const int wx = x + cam_x;
+      const uint32_t cell = Hash(static_cast<uint32_t>((wx >> 6) * 7919 + (wy >> 6) * 104729));
+      const uint32_t grain = Hash(static_cast<uint32_t>(wx * 2654435761u ^ wy * 40503u)) & 15;
+      uint8_t* p = row + static_cast<size_t>(x) * 4;
+      if ((wx & 63) < 6 || (wy & 63) < 6) {  // 道路
+        p[0] = p[1] = p[2] = static_cast<uint8_t>(110 + (grain >> 1));
+      } else if ((cell & 7) == 0) {  // 建筑
+        p[0] = static_cast<uint8_t>(140 + (cell >> 8 & 63));
+        p[1] = static_cast<uint8_t>(90 + (cell >> 16 & 31));
+        p[2] = 70;
+      } else {  // 草地
+        p[0] = static_cast<uint8_t>(40 + grain);
+        p[1] = static_cast<uint8_t>(120 + (cell >> 8 & 15) + grain);
+        p[2] = static_cast<uint8_t>(30 + grain);
+      }
+      p[3] = 255;
+    }
+  }
+  for (int s = 0; s < 24; ++s) {  // 单位
+    const uint32_t h = Hash(static_cast<uint32_t>(s) + 1);
+    const int x = static_cast<int>((h % kWidth + i * (1 + s % 5)) % kWidth);
+    const int y = static_cast<int>((h / kWidth % kHeight + i * (s % 3)) % kHeight);
+    FillRect(img, x, y, 20, 20, static_cast<uint8_t>(h >> 8), static_cast<uint8_t>(h >> 16), 200);
+  }
+  FillRect(img, 0, 0, kWidth, 48, 20, 20, 24);                   // 顶部资源栏
+  FillRect(img, 0, kHeight - 220, 420, 220, 15, 15, 20);         // 小地图
+  FillRect(img, 24 + i % 360, kHeight - 200, 36, 20, 255, 255, 255);  // 小地图视野框
+}
+
+void DrawNoise(int i, ImageRGBA& img) {
+  uint32_t s = Hash(static_cast<uint32_t>(i) + 12345);
+  for (size_t k = 0; k < img.pixels.size(); k += 4) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    std::memcpy(&img.pixels[k], &s, 3);
+    img.pixels[k + 3] = 255;
+  }
+}
+
+bool RunScene(const std::string& scene, size_t budget, int seconds) {
+  void (*draw)(int, ImageRGBA&) = scene == "desktop" ? DrawDesktop : scene == "game" ? DrawGame : DrawNoise;
+
+  ReplayBuffer::Options opt;
+  opt.memory_budget = budget;
+  opt.max_seconds = seconds;
+  opt.max_pending = 0;  // 在 Push() 内同步编码，才能测到每帧耗时且不丢帧
+  ReplayBuffer replay(opt);
+
+  ImageRGBA img;
+  img.width = kWidth;
+  img.height = kHeight;
+  img.pixels.assign(static_cast<size_t>(kWidth) * kHeight * 4, 255);
+  const int frames = seconds * kFps;
+  double push_ms = 0.0, max_ms = 0.0;
+  for (int i = 0; i < frames; ++i) {
+    draw(i, img);
+    img.grab_begin_ns = img.grab_end_ns = 1000000000ull + i * kFrameNs;
+    const auto t0 = std::chrono::steady_clock::now();
+    replay.Push(img);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    push_ms += ms;
+    max_ms = std::max(max_ms, ms);
+  }
+
+  // 解码全部保留帧，最后一帧必须与最后输入完全一致
+  ImageRGBA last;
+  const size_t decoded = replay.ForEachFrame([&](const ImageRGBA& f) { last = f; });
+  const bool exact = last.width == img.width && last.height == img.height && last.pixels == img.pixels;
+
+  const ReplayBuffer::Stats st = replay.GetStats();
+  // 帧间隔按 1/fps 计：保留 N 帧覆盖 N/fps 秒
+  const double kept = static_cast<double>(st.frames) / kFps;
+  // 编码按线程池线程数近似线性扩展：实时需要的核数 ≈ 单核 CPU 时间 / 帧间隔
+  const double cpu_ms = push_ms / frames * ThreadPool::Shared().Concurrency();
+  std::printf("%-8s %6.1f / %d s  %4zu frames %3zu gops  %7.1f / %.0f MB  ratio %6.1fx  push avg %6.2f ms max %6.2f ms"
+              "  ~%.1f cores for %d fps  decoded %zu %s\n",
+              scene.c_str(), kept, seconds, st.frames, st.gops, st.bytes / 1048576.0, budget / 1048576.0,
+              st.bytes ? static_cast<double>(st.raw_bytes) / st.bytes : 0.0, push_ms / frames, max_ms,
+              cpu_ms / (1000.0 / kFps), kFps, decoded, exact ? "lossless" : "MISMATCH");
+  return exact && st.bytes <= budget;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string which = argc > 1 ? argv[1] : "all";
+  const size_t budget = (argc > 2 ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 256) << 20;
+  const int seconds = argc > 3 ? std::max(1, std::atoi(argv[3])) : 30;
+
+  std::printf("%dx%d @ %d fps, %d s, budget %zu MB (raw RGBA would be %.0f MB)\n", kWidth, kHeight, kFps, seconds,
+              budget >> 20, static_cast<double>(kWidth) * kHeight * 4 * kFps * seconds / 1048576.0);
+  bool ok = true;
+  for (const char* scene : {"desktop", "game", "noise"}) {
+    if (which == "all" || which == scene) ok = RunScene(scene, budget, seconds) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -20,14 +20,17 @@
 //     0 = 仅截图 (安全模式)
 //     1 = 模拟操作 (会实际控制鼠标键盘!)
 
+#include <array>
 #include <chrono>
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
-#include <fstream>
 
+#include "image_writer.hpp"
+#include "input_macro.hpp"
 #include "system_input.hpp"
 #include "system_output.hpp"
 
@@ -56,6 +59,23 @@ class RTSController {
     game_area_y_ = 0;
     game_area_w_ = screen_w_;
     game_area_h_ = screen_h_ - 150;  // 底部UI
+
+    // X11: 宏内的 Delay 与拖拽路径交给 X server 按 XTest 延迟排程（其他后端忽略）
+    input_.SetServerSideTiming(true);
+
+    // 预编译高频热键宏（回放时一次提交，不再逐键走各平台分支）
+    for (int g = 0; g <= 9; ++g) {
+      int key = input_.CharToKeyCode(static_cast<char>('0' + g));
+      if (key < 0) continue;
+      create_group_[g] = input_.CompileMacro(InputMacro().KeyClick(key, SystemInput::kControl));
+      select_group_[g] = input_.CompileMacro(InputMacro().KeyClick(key));
+    }
+    shift_command_ = input_.CompileMacro(InputMacro()
+                                             .KeyDown(42)  // Shift (Linux keycode, 可能需要调整)
+                                             .Delay(20)
+                                             .ClickAt(InputMacro::Param(0), InputMacro::Param(1), SystemInput::kRight)
+                                             .Delay(20)
+                                             .KeyUp(42));
   }
 
   // ========== 单位选择 ==========
@@ -158,9 +178,8 @@ class RTSController {
   // 创建编队 (Ctrl + 数字)
   void createGroup(int group_num) {
     std::cout << "  [编队] 创建编队 " << group_num << " (Ctrl+" << group_num << ")\n";
-    int key = input_.CharToKeyCode('0' + group_num);
-    if (key >= 0) {
-      input_.KeyboardClickWithMods(key, SystemInput::kControl);
+    if (group_num >= 0 && group_num <= 9 && !create_group_[group_num].events.empty()) {
+      input_.ReplayMacro(create_group_[group_num]);
       sleepMs(50);
     }
   }
@@ -168,9 +187,8 @@ class RTSController {
   // 选择编队 (数字键)
   void selectGroup(int group_num) {
     std::cout << "  [编队] 选择编队 " << group_num << "\n";
-    int key = input_.CharToKeyCode('0' + group_num);
-    if (key >= 0) {
-      input_.KeyboardClick(key);
+    if (group_num >= 0 && group_num <= 9 && !select_group_[group_num].events.empty()) {
+      input_.ReplayMacro(select_group_[group_num]);
       sleepMs(50);
     }
   }
@@ -226,11 +244,7 @@ class RTSController {
   // Shift队列命令
   void shiftCommand(int x, int y) {
     std::cout << "  [队列] Shift+右键 @ (" << x << ", " << y << ")\n";
-    input_.KeyboardDown(42);  // Shift (Linux keycode, 可能需要调整)
-    sleepMs(20);
-    input_.MouseClickAt(x, y, SystemInput::kRight);
-    sleepMs(20);
-    input_.KeyboardUp(42);
+    input_.ReplayMacro(shift_command_, {x, y});
     sleepMs(30);
   }
 
@@ -240,32 +254,17 @@ class RTSController {
     return SystemOutput::CaptureScreenWithCursor(0, out);
   }
 
-  // 保存截图
+  // 保存截图：只在当前线程采集，编码（PNG）与写盘交给后台线程，不拖慢操作节奏
   bool saveScreenshot(const std::string& filename) {
-    ImageRGBA img;
-    if (!captureScreen(img)) return false;
-    
-    // 转为BMP
-    std::vector<uint8_t> bgra(img.pixels);
-    for (size_t i = 0; i < bgra.size(); i += 4) {
-      std::swap(bgra[i], bgra[i + 2]);
-    }
+    auto img = std::make_shared<ImageRGBA>();
+    if (!captureScreen(*img)) return false;
+    return shots_.Save(filename, std::shared_ptr<const ImageRGBA>(std::move(img)));
+  }
 
-#pragma pack(push, 1)
-    struct BMPFileHeader { uint16_t t{0x4D42}; uint32_t s{}; uint16_t r1{}, r2{}; uint32_t o{54}; };
-    struct BMPInfoHeader { uint32_t s{40}; int32_t w{}, h{}; uint16_t p{1}, b{32}; uint32_t c{}, i{}; int32_t x{2835}, y{2835}; uint32_t u{}, m{}; };
-#pragma pack(pop)
-
-    BMPFileHeader fh; BMPInfoHeader ih;
-    ih.w = img.width; ih.h = -img.height; ih.i = static_cast<uint32_t>(bgra.size());
-    fh.s = fh.o + ih.i;
-
-    std::ofstream f(filename, std::ios::binary);
-    if (!f) return false;
-    f.write((const char*)&fh, sizeof(fh));
-    f.write((const char*)&ih, sizeof(ih));
-    f.write((const char*)bgra.data(), bgra.size());
-    return f.good();
+  // 等待排队中的截图全部写完
+  AsyncImageWriter::Stats flushScreenshots() {
+    shots_.Flush();
+    return shots_.GetStats();
   }
 
   int screenWidth() const { return screen_w_; }
@@ -273,10 +272,16 @@ class RTSController {
 
  private:
   SystemInput input_;
+  AsyncImageWriter shots_;
   int screen_w_, screen_h_;
   int minimap_x_, minimap_y_, minimap_w_, minimap_h_;
   int game_area_x_, game_area_y_, game_area_w_, game_area_h_;
 
+  // 预编译宏
+  std::array<SystemInput::CompiledMacro, 10> create_group_;
+  std::array<SystemInput::CompiledMacro, 10> select_group_;
+  SystemInput::CompiledMacro shift_command_;
+
   void sleepMs(int ms) {
     std::this_thread::sleep_for(milliseconds(ms));
   }
@@ -387,15 +392,17 @@ void demoScreenCapture(RTSController& rts) {
 
   // 捕获并保存截图
   for (int i = 0; i < 3; ++i) {
-    std::string filename = "rts_screenshot_" + std::to_string(i) + ".bmp";
+    std::string filename = "rts_screenshot_" + std::to_string(i) + ".png";
     auto start = steady_clock::now();
     if (rts.saveScreenshot(filename)) {
       auto end = steady_clock::now();
       auto ms = duration_cast<milliseconds>(end - start).count();
-      std::cout << "  [截图] 保存 " << filename << " (" << ms << "ms)\n";
+      std::cout << "  [截图] 排队 " << filename << " (" << ms << "ms)\n";
     }
     std::this_thread::sleep_for(milliseconds(200));
   }
+  const AsyncImageWriter::Stats st = rts.flushScreenshots();
+  std::cout << "  [截图] 已写入 " << st.written << " 张, 共 " << st.bytes / 1024 << " KB\n";
 }
 
 // ============================================================================
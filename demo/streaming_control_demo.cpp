@@ -14,15 +14,16 @@
 //   g++ -std=c++17 streaming_control_demo.cpp -o streaming_demo -lX11 -lXtst -lXrandr -lXfixes -lpthread
 //
 // 使用:
-//   ./streaming_demo [目标FPS] [运行时长秒]
+//   ./streaming_demo [目标FPS] [运行时长秒] [显示器索引] [--capture-cpus=列表] [--input-cpus=列表]
+//                    [--consumer-cpus=列表] [--rt=优先级]
 //   例如: ./streaming_demo 30 10   # 30fps运行10秒
+//   例如: ./streaming_demo 60 10 0 --capture-cpus=2 --input-cpus=3 --consumer-cpus=4-15 --rt=10
 
 #include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
-#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -31,8 +32,11 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#include "image_writer.hpp"
+#include "input_queue.hpp"
 #include "system_input.hpp"
 #include "system_output.hpp"
 
@@ -46,6 +50,7 @@ using Clock = steady_clock;
 struct Frame {
   uint64_t frame_id{0};
   int64_t timestamp_ms{0};  // 捕获时间戳
+  uint64_t input_seq{0};    // 截图开始前最后注入的输入序号（用于帧-输入对齐）
   int width{0};
   int height{0};
   std::vector<uint8_t> rgba_data;  // RGBA像素数据
@@ -53,30 +58,6 @@ struct Frame {
   size_t data_size() const { return rgba_data.size(); }
 };
 
-// ============================================================================
-// 输入事件结构（模拟网络传输的输入指令）
-// ============================================================================
-// 注意：避免使用 KeyPress/KeyRelease，它们是 X11 的宏定义
-enum class InputEventType { 
-  MouseMove, 
-  MouseClick, 
-  MouseDrag, 
-  KeyDown,      // 键按下
-  KeyUp,        // 键抬起
-  MouseScroll,  // 滚轮
-  TextInput     // 文本输入
-};
-
-struct InputEvent {
-  InputEventType type;
-  int x{0}, y{0};              // 鼠标坐标
-  int button{0};               // 鼠标按钮 0=左 1=右 2=中
-  int key_code{0};             // 键盘码
-  int scroll_dx{0}, scroll_dy{0};  // 滚动量
-  std::string text;            // 输入文本
-  uint64_t mods{0};            // 修饰键
-};
-
 // ============================================================================
 // 性能统计
 // ============================================================================
@@ -84,6 +65,8 @@ struct StreamStats {
   std::atomic<uint64_t> frames_captured{0};
   std::atomic<uint64_t> total_bytes{0};
   std::atomic<uint64_t> input_events_processed{0};
+  std::atomic<uint64_t> input_events_coalesced{0};  // 队列积压时被合并的移动/滚轮事件
+  std::atomic<uint64_t> input_events_dropped{0};    // 过期且已被后续指令覆盖的移动
   std::atomic<double> avg_capture_time_ms{0};
   std::atomic<double> actual_fps{0};
 
@@ -93,6 +76,8 @@ struct StreamStats {
     frames_captured = 0;
     total_bytes = 0;
     input_events_processed = 0;
+    input_events_coalesced = 0;
+    input_events_dropped = 0;
     avg_capture_time_ms = 0;
     actual_fps = 0;
     start_time = Clock::now();
@@ -109,6 +94,8 @@ struct StreamStats {
     std::cout << "平均捕获耗时: " << std::fixed << std::setprecision(2) << avg_capture_time_ms.load() << " ms\n";
     std::cout << "传输数据量: " << std::fixed << std::setprecision(2) << (total_bytes.load() / 1024.0 / 1024.0) << " MB\n";
     std::cout << "输入事件处理: " << input_events_processed.load() << " 次\n";
+    std::cout << "输入事件合并: " << input_events_coalesced.load() << " 次\n";
+    std::cout << "过期移动丢弃: " << input_events_dropped.load() << " 次\n";
     std::cout << "==================================\n";
   }
 };
@@ -149,35 +136,25 @@ class FrameBuffer {
 };
 
 // ============================================================================
-// 输入事件队列
+// 流式控制器
 // ============================================================================
-class InputQueue {
- public:
-  void push(const InputEvent& event) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    events_.push(event);
-  }
-
-  bool pop(InputEvent& event) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (events_.empty()) return false;
-    event = events_.front();
-    events_.pop();
-    return true;
+// 各线程的放置配置（CPU 亲和、实时优先级、线程名）
+struct StreamingThreads {
+  ThreadConfig capture;
+  ThreadConfig input;
+  ThreadConfig consumer;
+
+  StreamingThreads() {
+    capture.name = "ec-capture";
+    input.name = "ec-inject";
+    consumer.name = "ec-consumer";
   }
-
- private:
-  std::mutex mutex_;
-  std::queue<InputEvent> events_;
 };
 
-// ============================================================================
-// 流式控制器
-// ============================================================================
 class StreamingController {
  public:
-  StreamingController(int target_fps = 30, int display_index = 0)
-      : target_fps_(target_fps), display_index_(display_index), running_(false) {
+  StreamingController(int target_fps = 30, int display_index = 0, StreamingThreads threads = {})
+      : target_fps_(target_fps), display_index_(display_index), threads_(std::move(threads)), running_(false) {
     frame_interval_us_ = 1000000 / target_fps_;
   }
 
@@ -215,7 +192,7 @@ class StreamingController {
   bool isRunning() const { return running_; }
 
   // 提交输入事件（模拟从网络接收）
-  void submitInput(const InputEvent& event) { input_queue_.push(event); }
+  void submitInput(const InputCommand& cmd) { input_queue_.Push(cmd); }
 
   // 获取统计信息
   const StreamStats& getStats() const { return stats_; }
@@ -226,6 +203,7 @@ class StreamingController {
  private:
   // 帧捕获循环
   void captureLoop() {
+    if (!ApplyThreadConfig(threads_.capture)) std::cerr << "[capture] 线程配置未完全生效\n";
     uint64_t frame_id = 0;
     double total_capture_time = 0;
 
@@ -246,6 +224,7 @@ class StreamingController {
         Frame frame;
         frame.frame_id = ++frame_id;
         frame.timestamp_ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        frame.input_seq = image.input_seq;
         frame.width = image.width;
         frame.height = image.height;
         frame.rgba_data = std::move(image.pixels);
@@ -274,67 +253,30 @@ class StreamingController {
     }
   }
 
-  // 输入事件处理循环
+  // 输入事件处理循环（积压时队列已将连续移动/滚轮合并，按键/点击优先于移动）
   void inputLoop() {
+    if (!ApplyThreadConfig(threads_.input)) std::cerr << "[input] 线程配置未完全生效\n";
+    const uint64_t coalesced_base = input_queue_.CoalescedCount();
+    const uint64_t dropped_base = input_queue_.DroppedCount();
     while (running_) {
-      InputEvent event;
-      if (input_queue_.pop(event)) {
-        processInput(event);
+      InputCommand cmd;
+      if (input_queue_.WaitPop(cmd, milliseconds(5))) {
+        ApplyInputCommand(input_, cmd);
         stats_.input_events_processed++;
-      } else {
-        std::this_thread::sleep_for(milliseconds(1));
+        stats_.input_events_coalesced = input_queue_.CoalescedCount() - coalesced_base;
+        stats_.input_events_dropped = input_queue_.DroppedCount() - dropped_base;
       }
     }
   }
 
-  // 处理单个输入事件
-  void processInput(const InputEvent& event) {
-    switch (event.type) {
-      case InputEventType::MouseMove:
-        input_.MouseMoveTo(event.x, event.y);
-        break;
-
-      case InputEventType::MouseClick:
-        input_.MouseClickAt(event.x, event.y, event.button);
-        break;
-
-      case InputEventType::MouseDrag:
-        input_.MouseDragTo(event.x, event.y, event.button);
-        break;
-
-      case InputEventType::KeyDown:
-        if (event.mods != 0) {
-          input_.KeyboardDownWithMods(event.key_code, event.mods);
-        } else {
-          input_.KeyboardDown(event.key_code);
-        }
-        break;
-
-      case InputEventType::KeyUp:
-        if (event.mods != 0) {
-          input_.KeyboardUpWithMods(event.key_code, event.mods);
-        } else {
-          input_.KeyboardUp(event.key_code);
-        }
-        break;
-
-      case InputEventType::MouseScroll:
-        input_.ScrollLines(event.scroll_dx, event.scroll_dy);
-        break;
-
-      case InputEventType::TextInput:
-        input_.TypeUTF8(event.text);
-        break;
-    }
-  }
-
   // 模拟消费者（网络传输/编码）
   void consumerLoop() {
+    if (!ApplyThreadConfig(threads_.consumer)) std::cerr << "[consumer] 线程配置未完全生效\n";
     while (running_) {
       Frame frame;
       if (frame_buffer_.pop(frame)) {
         // 这里可以进行：
-        // 1. 视频编码（H.264/H.265）
+        // 1. 视频编码（H.264：见 h264_encoder.hpp 的 H264EncodeStage 与 h264_encode_demo）
         // 2. 网络传输
         // 3. 写入文件
         // 目前只是模拟消费
@@ -342,7 +284,8 @@ class StreamingController {
         // 每100帧打印一次进度
         if (frame.frame_id % 100 == 0) {
           std::cout << "[Frame " << frame.frame_id << "] " << frame.width << "x" << frame.height << " @ "
-                    << std::fixed << std::setprecision(1) << stats_.actual_fps.load() << " fps\n";
+                    << std::fixed << std::setprecision(1) << stats_.actual_fps.load() << " fps, input_seq "
+                    << frame.input_seq << "\n";
         }
       } else {
         std::this_thread::sleep_for(milliseconds(1));
@@ -352,12 +295,13 @@ class StreamingController {
 
   int target_fps_;
   int display_index_;
+  StreamingThreads threads_;
   int64_t frame_interval_us_;
   std::atomic<bool> running_;
 
   SystemInput input_;
   FrameBuffer frame_buffer_;
-  InputQueue input_queue_;
+  InputQueue input_queue_{InputQueue::Options{milliseconds(50)}};  // 超过 50ms 未注入的移动视为过期
   StreamStats stats_;
 
   std::thread capture_thread_;
@@ -384,10 +328,7 @@ void runGameSimulation(StreamingController& controller, int duration_sec) {
     switch (action) {
       case 0: {
         // 鼠标移动到屏幕中心
-        InputEvent e;
-        e.type = InputEventType::MouseMove;
-        e.x = screen_w / 2;
-        e.y = screen_h / 2;
+        InputCommand e = InputCommand::MoveTo(screen_w / 2, screen_h / 2);
         controller.submitInput(e);
         std::cout << "  [动作] 鼠标移动到中心 (" << e.x << ", " << e.y << ")\n";
         break;
@@ -395,11 +336,8 @@ void runGameSimulation(StreamingController& controller, int duration_sec) {
 
       case 1: {
         // 鼠标左键点击
-        InputEvent e;
-        e.type = InputEventType::MouseClick;
-        e.x = screen_w / 2 + 100;
-        e.y = screen_h / 2;
-        e.button = 0;  // 左键
+        InputCommand e = InputCommand::Button(InputCommand::kMouseClick, screen_w / 2 + 100, screen_h / 2,
+                                              SystemInput::kLeft);
         controller.submitInput(e);
         std::cout << "  [动作] 左键点击 (" << e.x << ", " << e.y << ")\n";
         break;
@@ -407,11 +345,8 @@ void runGameSimulation(StreamingController& controller, int duration_sec) {
 
       case 2: {
         // 鼠标右键点击
-        InputEvent e;
-        e.type = InputEventType::MouseClick;
-        e.x = screen_w / 2 - 100;
-        e.y = screen_h / 2;
-        e.button = 1;  // 右键
+        InputCommand e = InputCommand::Button(InputCommand::kMouseClick, screen_w / 2 - 100, screen_h / 2,
+                                              SystemInput::kRight);
         controller.submitInput(e);
         std::cout << "  [动作] 右键点击 (" << e.x << ", " << e.y << ")\n";
         break;
@@ -419,70 +354,49 @@ void runGameSimulation(StreamingController& controller, int duration_sec) {
 
       case 3: {
         // 滚轮滚动
-        InputEvent e;
-        e.type = InputEventType::MouseScroll;
-        e.scroll_dx = 0;
-        e.scroll_dy = 3;
-        controller.submitInput(e);
+        controller.submitInput(InputCommand::Scroll(0, 3));
         std::cout << "  [动作] 滚轮向上滚动\n";
         break;
       }
 
       case 4: {
         // 模拟 WASD 移动 - W键
-        InputEvent down, up;
-        down.type = InputEventType::KeyDown;
-        up.type = InputEventType::KeyUp;
         // 注意：这里的 key_code 是平台相关的
         // Linux X11: 使用 XKeysymToKeycode 转换
         // 这里使用通用的 ASCII 方式演示
-        down.key_code = 25;  // Linux X11 'W' 的 keycode (可能因系统不同而异)
-        up.key_code = 25;
-        controller.submitInput(down);
+        const int key_w = 25;  // Linux X11 'W' 的 keycode (可能因系统不同而异)
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyDown, key_w));
         std::this_thread::sleep_for(milliseconds(100));
-        controller.submitInput(up);
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyUp, key_w));
         std::cout << "  [动作] 按键 W (前进)\n";
         break;
       }
 
       case 5: {
         // 模拟空格跳跃
-        InputEvent down, up;
-        down.type = InputEventType::KeyDown;
-        up.type = InputEventType::KeyUp;
-        down.key_code = 65;  // Linux X11 Space keycode
-        up.key_code = 65;
-        controller.submitInput(down);
+        const int key_space = 65;  // Linux X11 Space keycode
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyDown, key_space));
         std::this_thread::sleep_for(milliseconds(50));
-        controller.submitInput(up);
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyUp, key_space));
         std::cout << "  [动作] 按键 Space (跳跃)\n";
         break;
       }
 
       case 6: {
         // 鼠标拖拽（模拟视角转动）
-        InputEvent e;
-        e.type = InputEventType::MouseMove;
-        e.x = screen_w / 2 + (action_count % 200) - 100;
-        e.y = screen_h / 2;
-        controller.submitInput(e);
+        // 一次提交多个采样点（模拟网络突发），积压时队列只保留最后位置
+        for (int i = 0; i < 10; ++i) {
+          controller.submitInput(InputCommand::MoveTo(screen_w / 2 + (action_count % 200) - 100 + i, screen_h / 2));
+        }
         std::cout << "  [动作] 鼠标视角移动\n";
         break;
       }
 
       case 7: {
         // 组合键 Ctrl+S (保存)
-        InputEvent e;
-        e.type = InputEventType::KeyDown;
-        e.key_code = 39;  // 's' on Linux X11
-        e.mods = SystemInput::kControl;
-        controller.submitInput(e);
-
-        InputEvent up;
-        up.type = InputEventType::KeyUp;
-        up.key_code = 39;
-        up.mods = SystemInput::kControl;
-        controller.submitInput(up);
+        const int key_s = 39;  // 's' on Linux X11
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyDown, key_s, SystemInput::kControl));
+        controller.submitInput(InputCommand::Key(InputCommand::kKeyUp, key_s, SystemInput::kControl));
         std::cout << "  [动作] 组合键 Ctrl+S\n";
         break;
       }
@@ -501,62 +415,32 @@ void runGameSimulation(StreamingController& controller, int duration_sec) {
 bool saveSnapshot(const Frame& frame, const std::string& filename) {
   if (frame.rgba_data.empty()) return false;
 
-  // 简单的 BMP 保存
-#pragma pack(push, 1)
-  struct BMPFileHeader {
-    uint16_t bfType{0x4D42};
-    uint32_t bfSize{};
-    uint16_t bfReserved1{};
-    uint16_t bfReserved2{};
-    uint32_t bfOffBits{54};
-  };
-  struct BMPInfoHeader {
-    uint32_t biSize{40};
-    int32_t biWidth{};
-    int32_t biHeight{};
-    uint16_t biPlanes{1};
-    uint16_t biBitCount{32};
-    uint32_t biCompression{0};
-    uint32_t biSizeImage{};
-    int32_t biXPelsPerMeter{2835};
-    int32_t biYPelsPerMeter{2835};
-    uint32_t biClrUsed{};
-    uint32_t biClrImportant{};
-  };
-#pragma pack(pop)
-
-  std::vector<uint8_t> bgra(frame.rgba_data);
-  for (size_t i = 0; i < bgra.size(); i += 4) {
-    std::swap(bgra[i], bgra[i + 2]);  // RGBA -> BGRA
-  }
-
-  BMPFileHeader fh;
-  BMPInfoHeader ih;
-  ih.biWidth = frame.width;
-  ih.biHeight = -frame.height;  // top-down
-  ih.biSizeImage = static_cast<uint32_t>(bgra.size());
-  fh.bfSize = fh.bfOffBits + ih.biSizeImage;
-
-  std::ofstream f(filename, std::ios::binary);
-  if (!f) return false;
-  f.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
-  f.write(reinterpret_cast<const char*>(&ih), sizeof(ih));
-  f.write(reinterpret_cast<const char*>(bgra.data()), static_cast<std::streamsize>(bgra.size()));
-  return f.good();
+  // 格式由扩展名决定（.png / .qoi / .jpg），比原始 BMP 小一个数量级
+  ImageRGBA img;
+  img.width = frame.width;
+  img.height = frame.height;
+  img.pixels = frame.rgba_data;
+  return WriteImage(filename, img);
 }
 
 // ============================================================================
 // 主程序
 // ============================================================================
 void printUsage(const char* prog) {
-  std::cout << "用法: " << prog << " [目标FPS] [运行时长秒] [显示器索引]\n\n";
+  std::cout << "用法: " << prog << " [目标FPS] [运行时长秒] [显示器索引] [选项]\n\n";
   std::cout << "参数:\n";
   std::cout << "  目标FPS      : 目标帧率，默认 30\n";
   std::cout << "  运行时长秒   : 运行多少秒，默认 10\n";
   std::cout << "  显示器索引   : 捕获哪个显示器，默认 0\n\n";
+  std::cout << "选项:\n";
+  std::cout << "  --capture-cpus=列表   : 捕获线程绑定的 CPU，如 2 或 0-3,8\n";
+  std::cout << "  --input-cpus=列表     : 输入注入线程绑定的 CPU\n";
+  std::cout << "  --consumer-cpus=列表  : 消费（编码/传输）线程绑定的 CPU\n";
+  std::cout << "  --rt=优先级           : 捕获与输入线程使用 SCHED_FIFO（1-99，需要权限）\n\n";
   std::cout << "示例:\n";
   std::cout << "  " << prog << " 60 30 0   # 60fps运行30秒，捕获主显示器\n";
   std::cout << "  " << prog << " 30 10     # 30fps运行10秒\n";
+  std::cout << "  " << prog << " 60 30 0 --capture-cpus=2 --consumer-cpus=4-15 --rt=10\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -564,10 +448,35 @@ int main(int argc, char* argv[]) {
   std::cout << "   easy_control 流式控制演示 (云游戏模拟)\n";
   std::cout << "==============================================\n\n";
 
-  // 解析参数
+  // 解析参数：先取出 --xxx 选项，剩下的按位置解析
   int target_fps = 30;
   int duration_sec = 10;
   int display_index = 0;
+  StreamingThreads threads;
+
+  std::vector<char*> positional{argv[0]};
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+    if (key == "--capture-cpus") {
+      threads.capture.cpus = ParseCpuList(value);
+    } else if (key == "--input-cpus") {
+      threads.input.cpus = ParseCpuList(value);
+    } else if (key == "--consumer-cpus") {
+      threads.consumer.cpus = ParseCpuList(value);
+    } else if (key == "--rt") {
+      threads.capture.realtime_priority = threads.input.realtime_priority = std::atoi(value.c_str());
+    } else if (arg.rfind("--", 0) == 0 && arg != "--help") {
+      std::cerr << "错误: 未知选项 " << arg << "\n";
+      return 1;
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  argc = static_cast<int>(positional.size());
+  argv = positional.data();
 
   if (argc > 1) {
     if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
@@ -605,7 +514,7 @@ int main(int argc, char* argv[]) {
   }
 
   // 创建控制器
-  StreamingController controller(target_fps, display_index);
+  StreamingController controller(target_fps, display_index, threads);
 
   // 启动流式控制
   controller.start();
@@ -640,8 +549,8 @@ int main(int argc, char* argv[]) {
   // 可选：保存最后一帧作为快照
   // Frame last_frame;
   // if (controller.getCurrentFrame(last_frame)) {
-  //   saveSnapshot(last_frame, "last_frame.bmp");
-  //   std::cout << "已保存最后一帧: last_frame.bmp\n";
+  //   saveSnapshot(last_frame, "last_frame.png");
+  //   std::cout << "已保存最后一帧: last_frame.png\n";
   // }
 
   std::cout << "\n演示结束!\n";
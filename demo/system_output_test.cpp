@@ -2,7 +2,6 @@
 // Author: Chunzhi Qu.
 // SPDX-License-Identifier: MIT.
 
-#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
@@ -11,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "image_writer.hpp"
 #include "system_output.hpp"
 
 static bool SaveRAW_RGBA(const std::string& path, const std::vector<uint8_t>& rgba) {
@@ -20,63 +20,15 @@ static bool SaveRAW_RGBA(const std::string& path, const std::vector<uint8_t>& rg
   return f.good();
 }
 
-#pragma pack(push, 1)
-struct BMPFileHeader {
-  uint16_t bfType{0x4D42};  // 'BM'
-  uint32_t bfSize{};
-  uint16_t bfReserved1{};
-  uint16_t bfReserved2{};
-  uint32_t bfOffBits{54};  // 14 (file) + 40 (info)
-};
-struct BMPInfoHeader {
-  uint32_t biSize{40};
-  int32_t biWidth{};
-  int32_t biHeight{};  // 负值 = top-down（上到下）
-  uint16_t biPlanes{1};
-  uint16_t biBitCount{32};    // 32-bit
-  uint32_t biCompression{0};  // BI_RGB
-  uint32_t biSizeImage{};
-  int32_t biXPelsPerMeter{2835};
-  int32_t biYPelsPerMeter{2835};
-  uint32_t biClrUsed{};
-  uint32_t biClrImportant{};
-};
-#pragma pack(pop)
-
-// 将 RGBA 保存为 32-bit BMP（BGRA 顺序，top-down，不需逐行倒置）
-static bool SaveBMP_BGRA_TopDown(const std::string& path, int w, int h, const std::vector<uint8_t>& rgba) {
-  if (w <= 0 || h <= 0) return false;
-  const size_t need = static_cast<size_t>(w) * h * 4;
-  if (rgba.size() < need) return false;
-
-  // 拷贝一份并把 RGBA -> BGRA
-  std::vector<uint8_t> bgra(rgba);
-  for (size_t i = 0; i < need; i += 4) std::swap(bgra[i + 0], bgra[i + 2]);
-
-  BMPFileHeader fh;
-  BMPInfoHeader ih;
-  ih.biWidth = w;
-  ih.biHeight = -h;  // top-down 布局
-  ih.biSizeImage = static_cast<uint32_t>(need);
-  fh.bfSize = fh.bfOffBits + ih.biSizeImage;
-
-  std::ofstream f(path, std::ios::binary);
-  if (!f) return false;
-  f.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
-  f.write(reinterpret_cast<const char*>(&ih), sizeof(ih));
-  f.write(reinterpret_cast<const char*>(bgra.data()), static_cast<std::streamsize>(bgra.size()));
-  return f.good();
-}
-
 static void PrintUsage(const char* argv0) {
   std::printf(
       "Usage:\n"
       "  %s [display_index] [output_prefix]\n\n"
       "Args:\n"
       "  display_index  : Optional, default 0. Index in [0, GetDisplayCount()).\n"
-      "  output_prefix  : Optional, default 'capture'. Files like capture_0.bmp.\n\n"
+      "  output_prefix  : Optional, default 'capture'. Files like capture_0.png.\n\n"
       "Notes:\n"
-      "  Writes 32-bit BMP (top-down). If BMP fails, writes RGBA raw as fallback.\n",
+      "  Writes PNG (RGB). If PNG fails, writes RGBA raw as fallback.\n",
       argv0);
 }
 
@@ -104,6 +56,9 @@ int main(int argc, char** argv) {
 
   const int count = autoalg::SystemOutput::GetDisplayCount();
   std::printf("Display count reported: %d\n", count);
+  for (int i = 0; i < count; ++i) {
+    std::printf("  [%d] %s\n", i, autoalg::SystemOutput::GetDisplayInfo(i).c_str());
+  }
   if (count > 0 && (display_index < 0 || display_index >= count)) {
     std::fprintf(stderr, "display_index %d out of range [0, %d)\n", display_index, count);
     return 1;
@@ -121,19 +76,19 @@ int main(int argc, char** argv) {
   std::printf("Captured %dx%d, %zu bytes RGBA\n", img.width, img.height, img.pixels.size());
 
   // 生成输出文件名
-  std::ostringstream oss_bmp, oss_raw;
-  oss_bmp << prefix << "_" << target_index << ".bmp";
+  std::ostringstream oss_png, oss_raw;
+  oss_png << prefix << "_" << target_index << ".png";
   oss_raw << prefix << "_" << target_index << ".raw";
 
-  // 先尝试 BMP（最方便查看）
-  if (SaveBMP_BGRA_TopDown(oss_bmp.str(), img.width, img.height, img.pixels)) {
-    std::printf("Wrote %s (32-bit BGRA, top-down)\n", oss_bmp.str().c_str());
+  // 先尝试 PNG（最方便查看，比 BMP 小一个数量级）
+  if (autoalg::WriteImage(oss_png.str(), img)) {
+    std::printf("Wrote %s (PNG, RGB)\n", oss_png.str().c_str());
     return 0;
   }
 
   // 兜底 RAW
   if (SaveRAW_RGBA(oss_raw.str(), img.pixels)) {
-    std::printf("BMP failed; wrote %s (RGBA8 dump, stride=width*4)\n", oss_raw.str().c_str());
+    std::printf("PNG failed; wrote %s (RGBA8 dump, stride=width*4)\n", oss_raw.str().c_str());
     return 0;
   }
 
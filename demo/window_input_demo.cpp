@@ -0,0 +1,78 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// 后台窗口定向输入演示（X11 XSendEvent）：
+// 不带参数时列出所有顶层窗口；给出标题/WM_CLASS 子串时，对每个匹配窗口各起一个线程
+// （每线程一个 WindowInput / X 连接），在窗口中心点击并输入文本。真实光标与焦点保持不动。
+//
+// Usage:
+//   ./window_input_demo                        # 列出窗口
+//   ./window_input_demo Mousepad "hello\n" 5   # 向所有 Mousepad 窗口各输入 5 轮
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "window_input.hpp"
+
+using namespace autoalg;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+  WindowInput wi;
+  if (!wi.IsOpen()) {
+    std::fprintf(stderr, "cannot open X display\n");
+    return 1;
+  }
+
+  const std::vector<WindowInput::WindowInfo> windows = wi.ListWindows();
+  if (argc < 2) {
+    for (const auto& w : windows)
+      std::printf("0x%08llx  %5u  %-20s %dx%d%+d%+d%s  %s\n", static_cast<unsigned long long>(w.id), w.pid,
+                  w.wm_class.c_str(), w.width, w.height, w.x, w.y, w.viewable ? "" : " (hidden)", w.title.c_str());
+    return 0;
+  }
+
+  const std::string match = argv[1];
+  std::string text = argc > 2 ? argv[2] : "hello from easy_control\\n";
+  const int rounds = argc > 3 ? std::max(1, std::atoi(argv[3])) : 3;
+  // 命令行里的 "\n" 转成换行
+  for (size_t pos; (pos = text.find("\\n")) != std::string::npos;) text.replace(pos, 2, "\n");
+
+  std::vector<WindowInput::WindowInfo> targets;
+  for (const auto& w : windows)
+    if (w.title.find(match) != std::string::npos || w.wm_class.find(match) != std::string::npos) targets.push_back(w);
+  if (targets.empty()) {
+    std::fprintf(stderr, "no window matches '%s'\n", match.c_str());
+    return 1;
+  }
+
+  // 每个目标窗口一个线程，互不抢占光标与焦点
+  const auto t0 = Clock::now();
+  std::vector<std::thread> threads;
+  for (const auto& target : targets) {
+    threads.emplace_back([&, target] {
+      WindowInput input;
+      ThreadConfig tc;
+      tc.name = "ec-win-input";
+      ApplyThreadConfig(tc);
+      bool ok = input.IsOpen();
+      for (int r = 0; r < rounds && ok; ++r) {
+        ok = input.MouseClick(target.id, target.width / 2, target.height / 2, WindowInput::kLeft);
+        ok = ok && input.TypeText(target.id, text);
+      }
+      input.Sync();
+      std::printf("0x%08llx %-20s %s\n", static_cast<unsigned long long>(target.id), target.wm_class.c_str(),
+                  ok ? "ok" : "failed (window gone or unmapped key)");
+    });
+  }
+  for (auto& t : threads) t.join();
+  const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+  std::printf("%zu windows x %d rounds in %.1f ms\n", targets.size(), rounds, ms);
+  return 0;
+}
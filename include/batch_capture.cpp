@@ -0,0 +1,96 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "batch_capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "common.hpp"
+#include "image_util.hpp"
+
+namespace autoalg {
+
+BatchCapture::BatchCapture(std::vector<Item> items, ThreadPool *pool)
+    : items_(std::move(items)), pool_(pool ? pool : &ThreadPool::Shared()), staging_(items_.size()) {}
+
+template <class WriteSlot>
+bool BatchCapture::Run_(std::vector<ItemStatus> &status, WriteSlot write_slot) {
+  status.assign(items_.size(), ItemStatus{});
+  const uint64_t t0 = NowSteadyNanos();
+  // grain 1: every item is its own task so the grabs overlap. Conversions
+  // inside write_slot that use the same pool run inline on the item's thread.
+  pool_->ParallelFor(0, static_cast<int64_t>(items_.size()), 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      const Item &item = items_[i];
+      ImageRGBA &img = staging_[i];
+      ItemStatus &st = status[i];
+      st.ok = RectEmpty(item.region) ? SystemOutput::CaptureScreenWithCursor(item.display_index, img)
+                                     : SystemOutput::CaptureRegionWithCursor(item.display_index, item.region, img);
+      if (st.ok) {
+        st.input_seq = img.input_seq;
+        st.grab_begin_ns = img.grab_begin_ns;
+        st.grab_end_ns = img.grab_end_ns;
+      }
+      st.ok = write_slot(static_cast<size_t>(i), st.ok ? &img : nullptr, st);
+    }
+  });
+
+  uint64_t lo = UINT64_MAX, hi = 0, failed = 0;
+  for (const ItemStatus &st : status) {
+    if (!st.ok) {
+      ++failed;
+      continue;
+    }
+    lo = std::min(lo, st.grab_begin_ns);
+    hi = std::max(hi, st.grab_begin_ns);
+  }
+  stats_.batches += 1;
+  stats_.failed_items += failed;
+  stats_.last_skew_ns = hi >= lo ? hi - lo : 0;
+  stats_.last_batch_ns = NowSteadyNanos() - t0;
+  return failed == 0;
+}
+
+bool BatchCapture::CaptureRGBA(uint8_t *batch, int slot_width, int slot_height, std::vector<ItemStatus> &status) {
+  if (!batch || slot_width <= 0 || slot_height <= 0) return false;
+  const size_t slot_stride = static_cast<size_t>(slot_width) * 4;
+  const size_t slot_bytes = slot_stride * slot_height;
+  return Run_(status, [&](size_t i, const ImageRGBA *img, ItemStatus &st) {
+    uint8_t *slot = batch + i * slot_bytes;
+    if (!img) {
+      std::memset(slot, 0, slot_bytes);
+      return false;
+    }
+    const int w = std::min(img->width, slot_width);
+    const int h = std::min(img->height, slot_height);
+    const size_t src_stride = static_cast<size_t>(img->width) * 4;
+    const size_t row_bytes = static_cast<size_t>(w) * 4;
+    for (int y = 0; y < h; ++y) {
+      uint8_t *dp = slot + y * slot_stride;
+      std::memcpy(dp, img->pixels.data() + y * src_stride, row_bytes);
+      if (row_bytes < slot_stride) std::memset(dp + row_bytes, 0, slot_stride - row_bytes);
+    }
+    if (h < slot_height) std::memset(slot + h * slot_stride, 0, (slot_height - h) * slot_stride);
+    st.width = w;
+    st.height = h;
+    return true;
+  });
+}
+
+bool BatchCapture::CaptureTensors(const TensorSink &sink, void *batch, std::vector<ItemStatus> &status) {
+  if (!batch) return false;
+  return Run_(status, [&](size_t i, const ImageRGBA *img, ItemStatus &st) {
+    if (img && sink.ConvertInto(*img, batch, i)) {
+      st.width = img->width;
+      st.height = img->height;
+      return true;
+    }
+    std::memset(static_cast<uint8_t *>(batch) + i * sink.ItemBytes(), 0, sink.ItemBytes());
+    return false;
+  });
+}
+
+}  // namespace autoalg
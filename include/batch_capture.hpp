@@ -0,0 +1,88 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Batched multi-display capture for inference servers.
+//
+// A BatchCapture holds a fixed list of (display, region) items. Each call
+// grabs all items concurrently on a ThreadPool (one item per task, so the
+// grabs start as close together as the pool allows) and lays the results
+// out contiguously in one caller-provided buffer: either raw RGBA slots or
+// model tensors through a TensorSink. Every item reports its own status and
+// grab timestamps; the spread of the grab start times is reported as skew.
+//
+// Per-item staging images are kept between calls, so a steady-state batch
+// does no allocation. A BatchCapture is driven from one thread at a time.
+//
+// Usage:
+//   BatchCapture batch({{0, {}}, {1, {}}});
+//   std::vector<float> tensors(sink.ItemElements() * batch.Size());
+//   std::vector<BatchCapture::ItemStatus> status;
+//   batch.CaptureTensors(sink, tensors.data(), status);
+
+#ifndef EASY_CONTROL_INCLUDE_BATCH_CAPTURE_HPP
+#define EASY_CONTROL_INCLUDE_BATCH_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "system_output.hpp"
+#include "tensor_sink.hpp"
+#include "thread_pool.hpp"
+
+namespace autoalg {
+
+class BatchCapture {
+ public:
+  struct Item {
+    int display_index = 0;
+    ScreenRect region;  // display-local; empty = whole display
+  };
+
+  struct ItemStatus {
+    bool ok = false;
+    int width = 0;   // captured size (RGBA: clipped to the slot)
+    int height = 0;
+    uint64_t input_seq = 0;
+    uint64_t grab_begin_ns = 0;
+    uint64_t grab_end_ns = 0;
+  };
+
+  struct Stats {
+    uint64_t batches = 0;
+    uint64_t failed_items = 0;
+    uint64_t last_skew_ns = 0;  // max - min grab_begin_ns of the last batch
+    uint64_t last_batch_ns = 0;  // wall time of the last batch
+  };
+
+  // pool == nullptr uses ThreadPool::Shared().
+  explicit BatchCapture(std::vector<Item> items, ThreadPool* pool = nullptr);
+
+  size_t Size() const { return items_.size(); }
+  const std::vector<Item>& Items() const { return items_; }
+
+  // Slot i = batch + i * slot_width * slot_height * 4 bytes, RGBA rows of
+  // slot_width pixels. A capture larger than the slot is cropped to its
+  // top-left part; a smaller one is placed top-left and the rest zeroed.
+  // Returns true if every item succeeded.
+  bool CaptureRGBA(uint8_t* batch, int slot_width, int slot_height, std::vector<ItemStatus>& status);
+
+  // Slot i = batch + i * sink.ItemBytes(); failed items are zero-filled.
+  bool CaptureTensors(const TensorSink& sink, void* batch, std::vector<ItemStatus>& status);
+
+  Stats GetStats() const { return stats_; }
+
+ private:
+  template <class WriteSlot>
+  bool Run_(std::vector<ItemStatus>& status, WriteSlot write_slot);
+
+  std::vector<Item> items_;
+  ThreadPool* pool_;
+  std::vector<ImageRGBA> staging_;
+  Stats stats_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_BATCH_CAPTURE_HPP
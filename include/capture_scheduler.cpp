@@ -0,0 +1,250 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "capture_scheduler.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <utility>
+
+#include "image_util.hpp"
+#include "vblank_clock.hpp"
+
+namespace autoalg {
+
+namespace {
+// Stand-in for "whole display" before the display size is known; backends clip it.
+constexpr int kFullExtent = INT_MAX / 4;
+
+ScreenRect NormalizeRegion(const ScreenRect &r) {
+  if (RectEmpty(r)) return {0, 0, kFullExtent, kFullExtent};
+  // Backends clip at the display origin, so keep read origins non-negative.
+  return IntersectRect(r, ScreenRect{0, 0, kFullExtent, kFullExtent});
+}
+}  // namespace
+
+CaptureScheduler::CaptureScheduler() : CaptureScheduler(Options{}) {}
+
+CaptureScheduler::CaptureScheduler(const Options &options) : options_(options) {}
+
+CaptureScheduler::~CaptureScheduler() { Stop(); }
+
+int CaptureScheduler::Subscribe(int display_index, const ScreenRect &region, double hz, Callback callback) {
+  if (!callback) return -1;
+  Subscription s;
+  s.display_index = display_index;
+  s.region = region;
+  s.callback = std::make_shared<const Callback>(std::move(callback));
+  return Add_(std::move(s), hz);
+}
+
+int CaptureScheduler::Subscribe(int display_index, const ScreenRect &region, double hz, FramePool &pool,
+                                FrameCallback callback) {
+  if (!callback) return -1;
+  Subscription s;
+  s.display_index = display_index;
+  s.region = region;
+  s.frame_callback = std::make_shared<const FrameCallback>(std::move(callback));
+  s.pool = &pool;
+  return Add_(std::move(s), hz);
+}
+
+int CaptureScheduler::Add_(Subscription s, double hz) {
+  if (!(hz > 0.0)) return -1;
+  s.region = NormalizeRegion(s.region);
+  s.period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+  s.next_due = Clock::now();
+  int id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = s.id = next_id_++;
+    subs_.push_back(std::move(s));
+  }
+  cv_.notify_all();
+  return id;
+}
+
+bool CaptureScheduler::Unsubscribe(int subscription_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = std::find_if(subs_.begin(), subs_.end(), [&](const Subscription &s) { return s.id == subscription_id; });
+  if (it == subs_.end()) return false;
+  subs_.erase(it);
+  // Wait out deliveries on other threads; one on this thread is our caller.
+  const std::thread::id self = std::this_thread::get_id();
+  delivered_cv_.wait(lock, [&] {
+    return std::none_of(in_flight_.begin(), in_flight_.end(),
+                        [&](const InFlight &f) { return f.id == subscription_id && f.thread != self; });
+  });
+  return true;
+}
+
+void CaptureScheduler::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread(&CaptureScheduler::Loop_, this);
+}
+
+void CaptureScheduler::Stop() {
+  if (!running_.exchange(false)) return;
+  cv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+CaptureScheduler::Stats CaptureScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::vector<CaptureScheduler::Read> CaptureScheduler::PlanReads_(const std::vector<Due> &due) const {
+  std::vector<Read> reads;
+  reads.reserve(due.size());
+  for (size_t i = 0; i < due.size(); ++i) {
+    reads.push_back(Read{due[i].display_index, due[i].region, {i}});
+  }
+
+  // Greedy pairwise merge until no pair of reads on the same display is worth combining.
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < reads.size() && !merged; ++i) {
+      for (size_t j = i + 1; j < reads.size() && !merged; ++j) {
+        if (reads[i].display_index != reads[j].display_index) continue;
+        const ScreenRect &a = reads[i].rect;
+        const ScreenRect &b = reads[j].rect;
+        const ScreenRect u = UnionRect(a, b);
+        const int64_t separate = RectArea(a) + RectArea(b) - RectArea(IntersectRect(a, b));
+        if (RectArea(u) > separate + options_.merge_slack_px) continue;
+        reads[i].rect = u;
+        reads[i].users.insert(reads[i].users.end(), reads[j].users.begin(), reads[j].users.end());
+        reads.erase(reads.begin() + static_cast<std::ptrdiff_t>(j));
+        merged = true;
+      }
+    }
+  }
+  return reads;
+}
+
+bool CaptureScheduler::Deliver_(int id, const ImageRGBA *image, FramePool::Frame *frame) {
+  std::shared_ptr<const Callback> callback;
+  std::shared_ptr<const FrameCallback> frame_callback;
+  const std::thread::id self = std::this_thread::get_id();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(subs_.begin(), subs_.end(), [&](const Subscription &s) { return s.id == id; });
+    if (it == subs_.end()) return false;  // unsubscribed since the tick was planned
+    callback = it->callback;
+    frame_callback = it->frame_callback;
+    in_flight_.push_back(InFlight{id, self});
+  }
+  // Cleared even if the callback throws, or Unsubscribe(id) would wait forever.
+  struct Done {
+    CaptureScheduler *owner;
+    int id;
+    std::thread::id thread;
+    ~Done() {
+      {
+        std::lock_guard<std::mutex> lock(owner->mutex_);
+        auto &v = owner->in_flight_;
+        v.erase(std::find_if(v.begin(), v.end(), [&](const InFlight &f) { return f.id == id && f.thread == thread; }));
+      }
+      owner->delivered_cv_.notify_all();
+    }
+  } done{this, id, self};
+  if (frame) {
+    (*frame_callback)(id, std::move(*frame));
+  } else {
+    (*callback)(id, *image);
+  }
+  return true;
+}
+
+int CaptureScheduler::RunDue(Clock::time_point now) {
+  std::vector<Due> due;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Clock::time_point horizon = now + options_.coalesce_window;
+    for (auto &s : subs_) {
+      if (s.next_due > horizon) continue;
+      due.push_back(Due{s.id, s.display_index, s.region, s.pool});
+      s.next_due += s.period;
+      if (s.next_due <= now) s.next_due = now + s.period;  // fell behind: resync instead of bursting
+    }
+  }
+  if (due.empty()) return 0;
+
+  uint64_t reads_done = 0, failed = 0;
+  int delivered = 0;
+  ImageRGBA grabbed, cropped;
+  for (const Read &rd : PlanReads_(due)) {
+    ++reads_done;
+    // A read for a single pooled subscription goes straight into its frame.
+    FramePool::Frame direct;
+    if (rd.users.size() == 1 && due[rd.users[0]].pool) direct = due[rd.users[0]].pool->Acquire();
+    ImageRGBA &src = direct ? *direct : grabbed;
+    if (!SystemOutput::CaptureRegionWithCursor(rd.display_index, rd.rect, src)) {
+      ++failed;
+      continue;
+    }
+    for (size_t idx : rd.users) {
+      const Due &s = due[idx];
+      const ScreenRect local{s.region.x - rd.rect.x, s.region.y - rd.rect.y, s.region.w, s.region.h};
+      const bool whole = local.x == 0 && local.y == 0 && local.w >= src.width && local.h >= src.height;
+      if (!s.pool) {
+        if (!whole && !CropImage(src, local, cropped)) continue;
+        if (Deliver_(s.id, whole ? &src : &cropped, nullptr)) ++delivered;
+        continue;
+      }
+      FramePool::Frame frame;
+      if (direct) {
+        frame = std::move(direct);  // the read is exactly this region
+      } else {
+        frame = s.pool->Acquire();
+        if (whole) {
+          *frame = src;  // region shared with other subscriptions
+        } else if (!CropImage(src, local, *frame)) {
+          continue;
+        }
+      }
+      if (Deliver_(s.id, nullptr, &frame)) ++delivered;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.ticks += 1;
+  stats_.server_reads += reads_done;
+  stats_.failed_reads += failed;
+  stats_.deliveries += static_cast<uint64_t>(delivered);
+  return delivered;
+}
+
+void CaptureScheduler::Loop_() {
+  ThreadConfig thread = options_.thread;
+  if (thread.name.empty()) thread.name = "ec-capture";
+  ApplyThreadConfig(thread);
+  std::unique_ptr<VblankClock> vsync;
+  if (options_.vsync_display >= 0) vsync.reset(new VblankClock(options_.vsync_display));
+  while (running_.load()) {
+    if (vsync) {
+      VblankClock::Tick tick;
+      if (!vsync->WaitNext(tick, 100)) continue;  // bounded so Stop() is seen
+      const Clock::time_point vblank{std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(tick.vblank_ns))};
+      std::this_thread::sleep_until(vblank + options_.vsync_offset);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.vsync_ticks += 1;
+      }
+      RunDue(Clock::now());
+      continue;
+    }
+
+    RunDue(Clock::now());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    Clock::time_point wake = Clock::now() + std::chrono::milliseconds(100);
+    for (const auto &s : subs_) wake = std::min(wake, s.next_due);
+    if (running_.load()) cv_.wait_until(lock, wake);  // Subscribe()/Stop() notify to re-plan early
+  }
+}
+
+}  // namespace autoalg
@@ -0,0 +1,155 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Multi-rate region capture.
+//
+// Clients subscribe display regions with their own rate (e.g. minimap @30Hz,
+// resource bar @5Hz, full screen @1Hz). On every tick the scheduler collects
+// the subscriptions that are due, merges overlapping regions of the same
+// display into the smallest set of server reads, grabs each merged region
+// once and fans the cropped results out to the subscribers.
+//
+// Subscribers that keep frames beyond the callback subscribe with a
+// FramePool: the scheduler then grabs (or crops) straight into a pooled
+// frame and hands it over, instead of the caller copying a borrowed image.
+
+#ifndef EASY_CONTROL_INCLUDE_CAPTURE_SCHEDULER_HPP
+#define EASY_CONTROL_INCLUDE_CAPTURE_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "frame_pool.hpp"
+#include "system_output.hpp"
+
+namespace autoalg {
+
+class CaptureScheduler {
+ public:
+  // Called on the scheduler thread. image is only valid during the call.
+  using Callback = std::function<void(int subscription_id, const ImageRGBA& image)>;
+  // Called on the scheduler thread with a frame the callback now owns.
+  using FrameCallback = std::function<void(int subscription_id, FramePool::Frame frame)>;
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    // Subscriptions due within this window of each other share one tick.
+    std::chrono::microseconds coalesce_window{2000};
+    // Merge two overlapping regions when the union reads at most this many
+    // pixels more than reading both separately (accounts for per-read cost).
+    int64_t merge_slack_px{64 * 64};
+    // >= 0: tick once per refresh of this display (VblankClock: Present MSC on
+    // X11, a refresh-rate timer elsewhere) instead of sleeping to the next due
+    // time. A subscription at or above the refresh rate then sees every new
+    // frame exactly once.
+    int vsync_display{-1};
+    // Grab this long after the refresh so the new frame is complete.
+    std::chrono::microseconds vsync_offset{1000};
+    // Applied by the scheduler thread when it starts (name defaults to
+    // "ec-capture"). Pinning it away from encoder threads keeps grabs on time.
+    ThreadConfig thread;
+  };
+
+  struct Stats {
+    uint64_t ticks = 0;
+    uint64_t server_reads = 0;  // actual CaptureRegionWithCursor calls
+    uint64_t deliveries = 0;    // callbacks invoked
+    uint64_t failed_reads = 0;
+    uint64_t vsync_ticks = 0;   // refreshes waited on (vsync_display >= 0)
+  };
+
+  CaptureScheduler();
+  explicit CaptureScheduler(const Options& options);
+  ~CaptureScheduler();
+
+  CaptureScheduler(const CaptureScheduler&) = delete;
+  CaptureScheduler& operator=(const CaptureScheduler&) = delete;
+
+  // region is display-local; an empty region (w or h <= 0) means the whole display.
+  // Returns a subscription id (> 0), or -1 if hz is not positive.
+  int Subscribe(int display_index, const ScreenRect& region, double hz, Callback callback);
+  // Deliver frames from pool (which must outlive the subscription). A read
+  // that serves only this subscription is grabbed directly into the frame.
+  int Subscribe(int display_index, const ScreenRect& region, double hz, FramePool& pool, FrameCallback callback);
+  // Once this returns the callback is not running and won't be called again:
+  // a delivery in progress on another thread is waited for. Called from the
+  // subscription's own callback it returns at once (that call still finishes).
+  bool Unsubscribe(int subscription_id);
+
+  // Runs ticks on an internal thread until Stop().
+  void Start();
+  void Stop();
+  bool IsRunning() const { return running_.load(); }
+
+  // Run the subscriptions that are due at `now` synchronously (no thread needed).
+  // Returns the number of deliveries.
+  int RunDue(Clock::time_point now = Clock::now());
+
+  Stats GetStats() const;
+
+ private:
+  struct Subscription {
+    int id = 0;
+    int display_index = 0;
+    ScreenRect region;
+    Clock::duration period{};
+    Clock::time_point next_due{};
+    // One of the two is set; shared, so a delivery never copies the std::function.
+    std::shared_ptr<const Callback> callback;
+    std::shared_ptr<const FrameCallback> frame_callback;
+    FramePool* pool = nullptr;  // with frame_callback
+  };
+
+  // What a tick needs to plan reads; the callback is looked up by id at delivery.
+  struct Due {
+    int id = 0;
+    int display_index = 0;
+    ScreenRect region;
+    FramePool* pool = nullptr;
+  };
+
+  // One server read and the subscriptions it serves.
+  struct Read {
+    int display_index = 0;
+    ScreenRect rect;
+    std::vector<size_t> users;  // indices into the due list
+  };
+
+  // A callback running outside the lock.
+  struct InFlight {
+    int id = 0;
+    std::thread::id thread;
+  };
+
+  int Add_(Subscription s, double hz);
+  void Loop_();
+  std::vector<Read> PlanReads_(const std::vector<Due>& due) const;
+  // Invoke subscription id's callback with image (or, for pooled
+  // subscriptions, frame) unless it was unsubscribed meanwhile.
+  bool Deliver_(int id, const ImageRGBA* image, FramePool::Frame* frame);
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable delivered_cv_;  // an in-flight callback returned
+  std::vector<Subscription> subs_;
+  std::vector<InFlight> in_flight_;
+  int next_id_{1};
+  Stats stats_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_CAPTURE_SCHEDULER_HPP
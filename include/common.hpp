@@ -5,8 +5,10 @@
 #ifndef EASY_CONTROL_INCLUDE_COMMON_H
 #define EASY_CONTROL_INCLUDE_COMMON_H
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
@@ -32,6 +34,10 @@
 #include <windows.h>
 #elif defined(__APPLE__) || defined(__linux__)
 #include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -39,6 +45,8 @@
 #include <cerrno>
 #if defined(__APPLE__)
 #include <mach-o/dyld.h>
+#else
+#include <sys/syscall.h>
 #endif
 #else
 #error "Unsupported platform"
@@ -65,6 +73,27 @@ EC_INLINE uint64_t NowSteadyMillis() {
   return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
+EC_INLINE uint64_t NowSteadyNanos() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// =====================
+// Input sequence
+// =====================
+// Process-wide counter shared by SystemInput (bumped after every injected
+// event) and the capture backends (sampled when a grab begins), so a frame
+// can be matched against the inputs it may already reflect.
+
+EC_INLINE std::atomic<uint64_t> &InputSeqCounter() {
+  static std::atomic<uint64_t> counter{0};
+  return counter;
+}
+
+EC_INLINE uint64_t NextInputSeq() { return InputSeqCounter().fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+EC_INLINE uint64_t CurrentInputSeq() { return InputSeqCounter().load(std::memory_order_acquire); }
+
 EC_INLINE uint64_t ThisThreadId() { return std::hash<std::thread::id>{}(std::this_thread::get_id()); }
 
 EC_INLINE unsigned NumHWThreads() {
@@ -223,6 +252,281 @@ EC_INLINE bool UnsetEnv(std::string_view key) {
 #endif
 }
 
+// =====================
+// Thread placement
+// =====================
+// Where and how the calling thread runs. Each setter returns false when the
+// platform lacks the feature or the OS refuses (on Linux SCHED_FIFO and a
+// negative nice need CAP_SYS_NICE or an RLIMIT_RTPRIO / RLIMIT_NICE
+// allowance); the thread then keeps its previous setting.
+
+struct ThreadConfig {
+  std::string name;           // shown by top -H and debuggers (Linux keeps 15 bytes); empty: unchanged
+  std::vector<int> cpus;      // logical CPUs the thread may run on; empty: unchanged
+  int realtime_priority = 0;  // 1..99: SCHED_FIFO (Windows: TIME_CRITICAL); 0: normal scheduling
+  int nice = 0;               // -20..19 under normal scheduling (Windows: mapped to a thread priority); 0: unchanged
+  int numa_node = -1;         // >= 0: allocate from this node, and run on its CPUs when cpus is empty
+};
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11} (the Linux cpulist format). Malformed
+// pieces and reversed ranges are skipped; on Linux ranges stop at
+// CPU_SETSIZE - 1, the highest CPU an affinity mask can hold.
+EC_INLINE std::vector<int> ParseCpuList(std::string_view s) {
+  std::vector<int> out;
+  while (!s.empty()) {
+    const size_t comma = s.find(',');
+    const std::string piece(s.substr(0, comma));
+    s = comma == std::string_view::npos ? std::string_view() : s.substr(comma + 1);
+    int lo = 0, hi = 0;
+    const int n = std::sscanf(piece.c_str(), "%d-%d", &lo, &hi);
+    if (n < 1 || lo < 0) continue;
+    if (n == 1) hi = lo;
+#if defined(CPU_SETSIZE)
+    if (hi > CPU_SETSIZE - 1) hi = CPU_SETSIZE - 1;  // "0-2147483647" must not loop for billions of CPUs
+#endif
+    if (lo > hi) continue;
+    for (int c = lo; c <= hi; ++c) out.push_back(c);
+  }
+  return out;
+}
+
+#if defined(_WIN32)
+namespace detail {
+// Global CPU index -> (processor group, bit). Groups need not hold 64 CPUs each.
+EC_INLINE bool WinCpuToGroup(int cpu, WORD &group, int &bit) {
+  const WORD groups = GetActiveProcessorGroupCount();
+  for (WORD g = 0; g < groups; ++g) {
+    const int n = static_cast<int>(GetActiveProcessorCount(g));
+    if (cpu < n) {
+      group = g;
+      bit = cpu;
+      return true;
+    }
+    cpu -= n;
+  }
+  return false;
+}
+
+EC_INLINE int WinGroupToCpu(WORD group, int bit) {
+  int base = 0;
+  for (WORD g = 0; g < group; ++g) base += static_cast<int>(GetActiveProcessorCount(g));
+  return base + bit;
+}
+}  // namespace detail
+#endif
+
+EC_INLINE bool SetThisThreadName(std::string_view name) {
+#if defined(_WIN32)
+  // Windows 10 1607+; looked up at runtime so older systems just return false.
+  using SetDescriptionFn = HRESULT(WINAPI *)(HANDLE, PCWSTR);
+  const auto fn = reinterpret_cast<SetDescriptionFn>(
+      reinterpret_cast<void *>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription")));
+  return fn && SUCCEEDED(fn(GetCurrentThread(), detail::Utf8ToW(name).c_str()));
+#elif defined(__APPLE__)
+  return pthread_setname_np(std::string(name.substr(0, 63)).c_str()) == 0;
+#else
+  return pthread_setname_np(pthread_self(), std::string(name.substr(0, 15)).c_str()) == 0;
+#endif
+}
+
+EC_INLINE bool SetThisThreadAffinity(const std::vector<int> &cpus) {
+  if (cpus.empty()) return false;
+#if defined(_WIN32)
+  // A thread runs in one processor group; every CPU must be in the same one.
+  GROUP_AFFINITY ga{};
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    WORD group = 0;
+    int bit = 0;
+    if (!detail::WinCpuToGroup(cpus[i], group, bit)) return false;
+    if (i > 0 && group != ga.Group) return false;
+    ga.Group = group;
+    ga.Mask |= KAFFINITY(1) << bit;
+  }
+  return SetThreadGroupAffinity(GetCurrentThread(), &ga, nullptr) != 0;
+#elif defined(__APPLE__)
+  return false;  // only affinity tags (hints) exist
+#else
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus) {
+    if (c < 0 || c >= CPU_SETSIZE) return false;
+    CPU_SET(c, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+// priority > 0: real-time FIFO scheduling, clamped to the platform's range.
+// priority <= 0: back to normal scheduling.
+EC_INLINE bool SetThisThreadRealtime(int priority) {
+#if defined(_WIN32)
+  return SetThreadPriority(GetCurrentThread(), priority > 0 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL) != 0;
+#else
+  sched_param sp{};
+  int policy = SCHED_OTHER;
+  if (priority > 0) {
+    policy = SCHED_FIFO;
+    const int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = priority < lo ? lo : (priority > hi ? hi : priority);
+  }
+  return pthread_setschedparam(pthread_self(), policy, &sp) == 0;
+#endif
+}
+
+EC_INLINE bool SetThisThreadNice(int nice) {
+#if defined(_WIN32)
+  int prio = THREAD_PRIORITY_NORMAL;
+  if (nice <= -10) {
+    prio = THREAD_PRIORITY_HIGHEST;
+  } else if (nice < 0) {
+    prio = THREAD_PRIORITY_ABOVE_NORMAL;
+  } else if (nice >= 10) {
+    prio = THREAD_PRIORITY_LOWEST;
+  } else if (nice > 0) {
+    prio = THREAD_PRIORITY_BELOW_NORMAL;
+  }
+  return SetThreadPriority(GetCurrentThread(), prio) != 0;
+#elif defined(__APPLE__)
+  (void)nice;
+  return false;  // nice is per process there
+#else
+  // Linux keeps nice per thread (task), addressed by tid.
+  return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0;
+#endif
+}
+
+EC_INLINE int NumaNodeCount() {
+#if defined(_WIN32)
+  ULONG highest = 0;
+  return GetNumaHighestNodeNumber(&highest) ? static_cast<int>(highest) + 1 : 1;
+#elif defined(__APPLE__)
+  return 1;
+#else
+  int n = 0;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.size() > 4 && name.compare(0, 4, "node") == 0 && name[4] >= '0' && name[4] <= '9') ++n;
+  }
+  return n ? n : 1;
+#endif
+}
+
+// Logical CPUs of a NUMA node; empty if the node does not exist.
+EC_INLINE std::vector<int> NumaNodeCpus(int node) {
+  std::vector<int> out;
+  if (node < 0) return out;
+#if defined(_WIN32)
+  GROUP_AFFINITY ga{};
+  if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &ga)) return out;
+  for (int bit = 0; bit < static_cast<int>(sizeof(KAFFINITY) * 8); ++bit)
+    if (ga.Mask & (KAFFINITY(1) << bit)) out.push_back(detail::WinGroupToCpu(ga.Group, bit));
+#elif defined(__APPLE__)
+  if (node == 0)
+    for (unsigned c = 0; c < NumHWThreads(); ++c) out.push_back(static_cast<int>(c));
+#else
+  const std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+  if (FILE *f = std::fopen(path.c_str(), "r")) {
+    char line[4096];
+    if (std::fgets(line, sizeof(line), f)) {
+      std::string_view s(line);
+      while (!s.empty() && (s.back() == '\n' || s.back() == ' ')) s.remove_suffix(1);
+      out = ParseCpuList(s);
+    }
+    std::fclose(f);
+  }
+#endif
+  return out;
+}
+
+#if defined(__linux__)
+namespace detail {
+constexpr int kMpolPreferred = 1;  // MPOL_PREFERRED from <numaif.h>, without needing libnuma
+
+struct NodeMask {
+  std::vector<unsigned long> words;
+  unsigned long max_node = 0;  // as the syscalls expect it: mask bits + 1
+
+  explicit NodeMask(int node) : words(static_cast<size_t>(node) / (8 * sizeof(unsigned long)) + 1, 0ul) {
+    words[static_cast<size_t>(node) / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    max_node = words.size() * 8 * sizeof(unsigned long) + 1;
+  }
+};
+}  // namespace detail
+#endif
+
+// Prefer memory from `node` for the calling thread's future allocations
+// (Linux set_mempolicy). Elsewhere allocations already come from the node
+// the thread runs on, so this only checks the node exists; pin the thread
+// with SetThisThreadAffinity(NumaNodeCpus(node)).
+EC_INLINE bool SetThisThreadNumaNode(int node) {
+  if (node < 0) return false;
+#if defined(__linux__)
+  // Node ids can be sparse (e.g. node0 and node2 only), so look the node up instead of comparing to the count.
+  std::error_code ec;
+  if (!std::filesystem::exists("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", ec)) return false;
+  const detail::NodeMask mask(node);
+  return syscall(SYS_set_mempolicy, detail::kMpolPreferred, mask.words.data(), mask.max_node) == 0;
+#else
+  return node < NumaNodeCount();
+#endif
+}
+
+// Page-aligned, zeroed memory placed on `node` where the OS allows it (falls
+// back to any node). Release with NumaFree(p, size).
+EC_INLINE void *NumaAlloc(size_t size, int node) {
+  if (size == 0) return nullptr;
+#if defined(_WIN32)
+  if (node >= 0)
+    if (void *p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+                                     static_cast<DWORD>(node)))
+      return p;
+  return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+  void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return nullptr;
+#if defined(__linux__)
+  // Pages are placed on first touch, so binding before use is enough.
+  if (node >= 0) {
+    const detail::NodeMask mask(node);
+    (void)syscall(SYS_mbind, p, size, detail::kMpolPreferred, mask.words.data(), mask.max_node, 0u);
+  }
+#else
+  (void)node;
+#endif
+  return p;
+#endif
+}
+
+EC_INLINE void NumaFree(void *p, size_t size) {
+  if (!p) return;
+#if defined(_WIN32)
+  (void)size;
+  VirtualFree(p, 0, MEM_RELEASE);
+#else
+  ::munmap(p, size);
+#endif
+}
+
+// Apply every field that is set. Returns false if any of them failed; the
+// others are still applied.
+EC_INLINE bool ApplyThreadConfig(const ThreadConfig &config) {
+  bool ok = true;
+  if (!config.name.empty()) ok = SetThisThreadName(config.name) && ok;
+  std::vector<int> cpus = config.cpus;
+  if (config.numa_node >= 0) {
+    ok = SetThisThreadNumaNode(config.numa_node) && ok;
+    if (cpus.empty()) cpus = NumaNodeCpus(config.numa_node);
+  }
+  if (!cpus.empty()) ok = SetThisThreadAffinity(cpus) && ok;
+  if (config.realtime_priority > 0) {
+    ok = SetThisThreadRealtime(config.realtime_priority) && ok;
+  } else if (config.nice != 0) {
+    ok = SetThisThreadNice(config.nice) && ok;
+  }
+  return ok;
+}
+
 // =====================
 // Memory
 // =====================
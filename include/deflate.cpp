@@ -0,0 +1,521 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace autoalg {
+namespace {
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+  // LSB first, as deflate packs everything but Huffman codes.
+  void Put(uint32_t value, int bits) {
+    acc_ |= static_cast<uint64_t>(value) << count_;
+    count_ += bits;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<uint8_t>(acc_));
+      acc_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  void AlignToByte() {
+    if (count_ > 0) Put(0, 8 - count_);
+  }
+
+ private:
+  std::vector<uint8_t> &out_;
+  uint64_t acc_ = 0;
+  int count_ = 0;
+};
+
+struct DeflateTables {
+  // Length 3..258 -> symbol 257..285 and extra bits.
+  std::array<uint16_t, 259> len_sym{};
+  std::array<uint8_t, 259> len_extra{};
+  std::array<uint16_t, 259> len_base{};
+  std::array<uint16_t, 29> sym_len_base{};  // symbol 257.. -> shortest length
+  // Distance code for dist-1 < 256 directly, else by (dist-1) >> 7.
+  std::array<uint8_t, 512> dist_code{};
+  std::array<uint8_t, 30> dist_extra{};
+  std::array<uint16_t, 30> dist_base{};
+
+  DeflateTables() {
+    static const uint16_t kLenBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    for (int s = 0; s < 29; ++s) {
+      sym_len_base[s] = kLenBase[s];
+      const int end = s == 28 ? 259 : kLenBase[s + 1];
+      for (int len = kLenBase[s]; len < end; ++len) {
+        len_sym[len] = static_cast<uint16_t>(257 + s);
+        len_extra[len] = kLenExtra[s];
+        len_base[len] = kLenBase[s];
+      }
+    }
+    uint32_t base = 1;
+    for (int c = 0; c < 30; ++c) {
+      const int extra = c < 4 ? 0 : (c - 2) / 2;
+      dist_extra[c] = static_cast<uint8_t>(extra);
+      dist_base[c] = static_cast<uint16_t>(base);
+      for (uint32_t d = base; d < base + (1u << extra); ++d) {
+        const uint32_t i = d - 1;
+        if (i < 256) dist_code[i] = static_cast<uint8_t>(c);
+        else dist_code[256 + (i >> 7)] = static_cast<uint8_t>(c);
+      }
+      base += 1u << extra;
+    }
+  }
+
+  int DistCode(uint32_t dist) const {
+    const uint32_t i = dist - 1;
+    return i < 256 ? dist_code[i] : dist_code[256 + (i >> 7)];
+  }
+};
+
+const DeflateTables &Tables() {
+  static const DeflateTables tables;
+  return tables;
+}
+
+// Huffman code lengths for freq, none longer than max_bits. At least two
+// symbols always get a code, so every tree is complete.
+void BuildLengths(std::vector<uint32_t> freq, int max_bits, std::vector<uint8_t> &lengths) {
+  const size_t n = freq.size();
+  lengths.assign(n, 0);
+  int used = 0;
+  for (uint32_t f : freq) used += f != 0;
+  for (size_t i = 0; used < 2 && i < n; ++i) {
+    if (freq[i] == 0) {
+      freq[i] = 1;
+      ++used;
+    }
+  }
+
+  struct Node {
+    uint32_t freq;
+    int left, right;  // -1: leaf
+    int symbol;
+  };
+  std::vector<Node> nodes;
+  std::vector<int> heap;
+  std::vector<int> depth;
+  for (;;) {
+    nodes.clear();
+    heap.clear();
+    for (size_t i = 0; i < n; ++i) {
+      if (freq[i] == 0) continue;
+      nodes.push_back({freq[i], -1, -1, static_cast<int>(i)});
+      heap.push_back(static_cast<int>(nodes.size()) - 1);
+    }
+    const auto greater = [&](int a, int b) {
+      return nodes[a].freq != nodes[b].freq ? nodes[a].freq > nodes[b].freq : a > b;
+    };
+    std::make_heap(heap.begin(), heap.end(), greater);
+    while (heap.size() > 1) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      const int a = heap.back();
+      heap.pop_back();
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      const int b = heap.back();
+      heap.pop_back();
+      nodes.push_back({nodes[a].freq + nodes[b].freq, a, b, -1});
+      heap.push_back(static_cast<int>(nodes.size()) - 1);
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+    // Children always precede their parent, so walk from the root down.
+    depth.assign(nodes.size(), 0);
+    int longest = 0;
+    for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; --i) {
+      if (nodes[i].left < 0) {
+        lengths[nodes[i].symbol] = static_cast<uint8_t>(depth[i]);
+        longest = std::max(longest, depth[i]);
+      } else {
+        depth[nodes[i].left] = depth[nodes[i].right] = depth[i] + 1;
+      }
+    }
+    if (longest <= max_bits) return;
+    // Too deep: flatten the distribution and retry.
+    for (uint32_t &f : freq) {
+      if (f) f = (f + 1) / 2;
+    }
+  }
+}
+
+// Canonical codes (RFC 1951 3.2.2), bit-reversed for the LSB-first writer.
+void BuildCodes(const std::vector<uint8_t> &lengths, std::vector<uint16_t> &codes) {
+  int count[16] = {0};
+  for (uint8_t l : lengths) ++count[l];
+  count[0] = 0;
+  int next[16] = {0};
+  int code = 0;
+  for (int bits = 1; bits < 16; ++bits) {
+    code = (code + count[bits - 1]) << 1;
+    next[bits] = code;
+  }
+  codes.assign(lengths.size(), 0);
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    const int len = lengths[i];
+    if (len == 0) continue;
+    int c = next[len]++;
+    int rev = 0;
+    for (int b = 0; b < len; ++b) {
+      rev = (rev << 1) | (c & 1);
+      c >>= 1;
+    }
+    codes[i] = static_cast<uint16_t>(rev);
+  }
+}
+
+struct Token {
+  uint16_t lit_or_len;  // literal byte when dist == 0
+  uint16_t dist;
+};
+
+// One dynamic-Huffman block.
+void WriteBlock(const std::vector<Token> &tokens, bool final_block, BitWriter &bw) {
+  const DeflateTables &t = Tables();
+  std::vector<uint32_t> lit_freq(286, 0), dist_freq(30, 0);
+  for (const Token &tk : tokens) {
+    if (tk.dist == 0) {
+      ++lit_freq[tk.lit_or_len];
+    } else {
+      ++lit_freq[t.len_sym[tk.lit_or_len]];
+      ++dist_freq[t.DistCode(tk.dist)];
+    }
+  }
+  lit_freq[256] = 1;
+
+  std::vector<uint8_t> lit_len, dist_len;
+  BuildLengths(lit_freq, 15, lit_len);
+  BuildLengths(dist_freq, 15, dist_len);
+  int hlit = 286, hdist = 30;
+  while (hlit > 257 && lit_len[hlit - 1] == 0) --hlit;
+  while (hdist > 1 && dist_len[hdist - 1] == 0) --hdist;
+
+  // Run-length encode both length tables as one sequence (symbols 16/17/18).
+  std::vector<uint8_t> all(lit_len.begin(), lit_len.begin() + hlit);
+  all.insert(all.end(), dist_len.begin(), dist_len.begin() + hdist);
+  std::vector<std::pair<uint8_t, uint8_t>> rle;  // symbol, extra value
+  for (size_t i = 0; i < all.size();) {
+    const uint8_t v = all[i];
+    size_t run = 1;
+    while (i + run < all.size() && all[i + run] == v) ++run;
+    size_t left = run;
+    if (v == 0) {
+      while (left >= 11) {
+        const size_t r = std::min<size_t>(left, 138);
+        rle.emplace_back(18, static_cast<uint8_t>(r - 11));
+        left -= r;
+      }
+      if (left >= 3) {
+        rle.emplace_back(17, static_cast<uint8_t>(left - 3));
+        left = 0;
+      }
+    } else if (left >= 4) {
+      rle.emplace_back(v, 0);
+      --left;
+      while (left >= 3) {
+        const size_t r = std::min<size_t>(left, 6);
+        rle.emplace_back(16, static_cast<uint8_t>(r - 3));
+        left -= r;
+      }
+    }
+    for (; left > 0; --left) rle.emplace_back(v, 0);
+    i += run;
+  }
+
+  std::vector<uint32_t> cl_freq(19, 0);
+  for (const auto &p : rle) ++cl_freq[p.first];
+  std::vector<uint8_t> cl_len;
+  BuildLengths(cl_freq, 7, cl_len);
+  static const uint8_t kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  int hclen = 19;
+  while (hclen > 4 && cl_len[kOrder[hclen - 1]] == 0) --hclen;
+
+  std::vector<uint16_t> lit_code, dist_code, cl_code;
+  BuildCodes(lit_len, lit_code);
+  BuildCodes(dist_len, dist_code);
+  BuildCodes(cl_len, cl_code);
+
+  bw.Put(final_block ? 1 : 0, 1);
+  bw.Put(2, 2);  // dynamic Huffman
+  bw.Put(static_cast<uint32_t>(hlit - 257), 5);
+  bw.Put(static_cast<uint32_t>(hdist - 1), 5);
+  bw.Put(static_cast<uint32_t>(hclen - 4), 4);
+  for (int i = 0; i < hclen; ++i) bw.Put(cl_len[kOrder[i]], 3);
+  for (const auto &p : rle) {
+    bw.Put(cl_code[p.first], cl_len[p.first]);
+    if (p.first == 16) bw.Put(p.second, 2);
+    else if (p.first == 17) bw.Put(p.second, 3);
+    else if (p.first == 18) bw.Put(p.second, 7);
+  }
+
+  for (const Token &tk : tokens) {
+    if (tk.dist == 0) {
+      bw.Put(lit_code[tk.lit_or_len], lit_len[tk.lit_or_len]);
+      continue;
+    }
+    const int len = tk.lit_or_len;
+    const int sym = t.len_sym[len];
+    bw.Put(lit_code[sym], lit_len[sym]);
+    if (t.len_extra[len]) bw.Put(static_cast<uint32_t>(len - t.len_base[len]), t.len_extra[len]);
+    const int dc = t.DistCode(tk.dist);
+    bw.Put(dist_code[dc], dist_len[dc]);
+    if (t.dist_extra[dc]) bw.Put(static_cast<uint32_t>(tk.dist - t.dist_base[dc]), t.dist_extra[dc]);
+  }
+  bw.Put(lit_code[256], lit_len[256]);
+}
+
+}  // namespace
+
+void DeflateRaw(const uint8_t *data, size_t size, int level, bool final_stream, std::vector<uint8_t> &out) {
+  constexpr int kWindow = 32768;
+  constexpr int kHashBits = 15;
+  constexpr int kMinMatch = 3;
+  constexpr int kMaxMatch = 258;
+  constexpr size_t kBlockTokens = 1 << 16;
+  level = std::max(1, std::min(9, level));
+  const int max_chain = level <= 1 ? 4 : level <= 3 ? 16 : level <= 6 ? 64 : level <= 8 ? 256 : 1024;
+  const int nice = level <= 3 ? 32 : level <= 6 ? 128 : kMaxMatch;
+
+  std::vector<int32_t> head(size_t{1} << kHashBits, -1);
+  std::vector<int32_t> prev(kWindow, -1);
+  const auto hash = [&](size_t i) {
+    const uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+    return (v * 2654435761u) >> (32 - kHashBits);
+  };
+  const auto insert = [&](size_t i) {
+    const uint32_t h = hash(i);
+    prev[i & (kWindow - 1)] = head[h];
+    head[h] = static_cast<int32_t>(i);
+    return h;
+  };
+
+  BitWriter bw(out);
+  std::vector<Token> tokens;
+  tokens.reserve(kBlockTokens);
+  size_t i = 0;
+  while (i < size) {
+    int best_len = 0, best_dist = 0;
+    if (i + kMinMatch <= size) {
+      const int max_len = static_cast<int>(std::min<size_t>(kMaxMatch, size - i));
+      int32_t cand = head[hash(i)];
+      insert(i);
+      for (int chain = max_chain; cand >= 0 && chain > 0 && best_len < max_len; --chain) {
+        const size_t dist = i - static_cast<size_t>(cand);
+        if (dist > kWindow) break;
+        const uint8_t *a = data + cand;
+        const uint8_t *b = data + i;
+        if (a[best_len] == b[best_len]) {
+          int len = 0;
+          while (len < max_len && a[len] == b[len]) ++len;
+          if (len > best_len) {
+            best_len = len;
+            best_dist = static_cast<int>(dist);
+            if (len >= nice) break;
+          }
+        }
+        const int32_t next = prev[cand & (kWindow - 1)];
+        if (next >= cand) break;  // slot reused by a newer position
+        cand = next;
+      }
+    }
+    if (best_len >= kMinMatch) {
+      tokens.push_back({static_cast<uint16_t>(best_len), static_cast<uint16_t>(best_dist)});
+      for (size_t k = i + 1; k < i + best_len && k + kMinMatch <= size; ++k) insert(k);
+      i += best_len;
+    } else {
+      tokens.push_back({data[i], 0});
+      ++i;
+    }
+    if (tokens.size() >= kBlockTokens && i < size) {
+      WriteBlock(tokens, false, bw);
+      tokens.clear();
+    }
+  }
+  WriteBlock(tokens, final_stream, bw);
+  if (!final_stream) {
+    bw.Put(0, 3);  // stored, not final
+    bw.AlignToByte();
+    bw.Put(0x0000, 16);
+    bw.Put(0xFFFF, 16);
+  }
+  bw.AlignToByte();
+}
+
+namespace {
+
+// LSB-first bit reader over a byte range; reading past the end yields zeros
+// and sets overrun.
+class BitReader {
+ public:
+  BitReader(const uint8_t *p, size_t n) : p_(p), end_(p + n) {}
+
+  uint32_t Peek(int bits) {
+    while (count_ < bits) {
+      if (p_ < end_) {
+        acc_ |= static_cast<uint64_t>(*p_++) << count_;
+      } else {
+        overrun_bits_ += 8;
+      }
+      count_ += 8;
+    }
+    return static_cast<uint32_t>(acc_ & ((uint64_t{1} << bits) - 1));
+  }
+  void Skip(int bits) {
+    acc_ >>= bits;
+    count_ -= bits;
+  }
+  uint32_t Get(int bits) {
+    if (bits == 0) return 0;
+    const uint32_t v = Peek(bits);
+    Skip(bits);
+    return v;
+  }
+  void AlignToByte() { Skip(count_ & 7); }
+  // True once bits that were never in the input have been consumed.
+  bool Overrun() const { return overrun_bits_ > count_; }
+
+ private:
+  const uint8_t *p_;
+  const uint8_t *end_;
+  uint64_t acc_ = 0;
+  int count_ = 0;
+  int overrun_bits_ = 0;
+};
+
+// Decoding table indexed by the next bits_ input bits (the longest code):
+// symbol << 4 | length, 0 for bit patterns no code starts with.
+class HuffmanDecoder {
+ public:
+  bool Build(const uint8_t *lengths, int n) {
+    std::vector<uint8_t> len(lengths, lengths + n);
+    bits_ = std::max(1, static_cast<int>(*std::max_element(len.begin(), len.end())));
+    table_.assign(size_t{1} << bits_, 0);
+    std::vector<uint16_t> codes;
+    BuildCodes(len, codes);
+    // Reject over-subscribed codes (they would overwrite each other).
+    int64_t left = 1;
+    int count[16] = {0};
+    for (uint8_t l : len) ++count[l];
+    for (int bits = 1; bits < 16; ++bits) {
+      left = (left << 1) - count[bits];
+      if (left < 0) return false;
+    }
+    for (int s = 0; s < n; ++s) {
+      const int l = len[s];
+      if (l == 0) continue;
+      for (uint32_t i = codes[s]; i < table_.size(); i += 1u << l) table_[i] = static_cast<uint32_t>(s << 4 | l);
+    }
+    return true;
+  }
+  // -1 on a code that is not in the table.
+  int Decode(BitReader &br) const {
+    const uint32_t e = table_[br.Peek(bits_)];
+    if (e == 0) return -1;
+    br.Skip(static_cast<int>(e & 15));
+    return static_cast<int>(e >> 4);
+  }
+
+ private:
+  int bits_ = 1;
+  std::vector<uint32_t> table_;
+};
+
+}  // namespace
+
+bool InflateRaw(const uint8_t *data, size_t size, uint8_t *out, size_t out_size) {
+  const DeflateTables &t = Tables();
+  static const uint8_t kOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  BitReader br(data, size);
+  HuffmanDecoder lit, dist;
+  size_t pos = 0;
+  bool final_block = false;
+  while (!final_block) {
+    final_block = br.Get(1) != 0;
+    const uint32_t type = br.Get(2);
+    if (type == 0) {
+      br.AlignToByte();
+      const uint32_t len = br.Get(16);
+      if ((br.Get(16) ^ 0xFFFF) != len || len > out_size - pos) return false;
+      for (uint32_t i = 0; i < len; ++i) out[pos++] = static_cast<uint8_t>(br.Get(8));
+      if (br.Overrun()) return false;
+      continue;
+    }
+    if (type == 1) {  // fixed codes (RFC 1951 3.2.6)
+      uint8_t fixed[288 + 32];
+      for (int i = 0; i < 288; ++i) fixed[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+      std::fill(fixed + 288, fixed + 320, 5);
+      if (!lit.Build(fixed, 288) || !dist.Build(fixed + 288, 32)) return false;
+    } else if (type == 2) {
+      uint8_t lengths[286 + 30] = {0};
+      const int hlit = static_cast<int>(br.Get(5)) + 257;
+      const int hdist = static_cast<int>(br.Get(5)) + 1;
+      const int hclen = static_cast<int>(br.Get(4)) + 4;
+      if (hlit > 286 || hdist > 30) return false;
+      uint8_t cl_len[19] = {0};
+      for (int i = 0; i < hclen; ++i) cl_len[kOrder[i]] = static_cast<uint8_t>(br.Get(3));
+      HuffmanDecoder cl;
+      if (!cl.Build(cl_len, 19)) return false;
+      for (int i = 0; i < hlit + hdist;) {
+        const int sym = cl.Decode(br);
+        if (sym < 0) return false;
+        if (sym < 16) {
+          lengths[i++] = static_cast<uint8_t>(sym);
+          continue;
+        }
+        int repeat = 0;
+        uint8_t value = 0;
+        if (sym == 16) {
+          if (i == 0) return false;
+          value = lengths[i - 1];
+          repeat = 3 + static_cast<int>(br.Get(2));
+        } else if (sym == 17) {
+          repeat = 3 + static_cast<int>(br.Get(3));
+        } else {
+          repeat = 11 + static_cast<int>(br.Get(7));
+        }
+        if (i + repeat > hlit + hdist) return false;
+        std::fill(lengths + i, lengths + i + repeat, value);
+        i += repeat;
+      }
+      if (!lit.Build(lengths, hlit) || !dist.Build(lengths + hlit, hdist)) return false;
+    } else {
+      return false;
+    }
+
+    for (;;) {
+      const int sym = lit.Decode(br);
+      if (sym < 0 || br.Overrun()) return false;
+      if (sym < 256) {
+        if (pos >= out_size) return false;
+        out[pos++] = static_cast<uint8_t>(sym);
+        continue;
+      }
+      if (sym == 256) break;
+      if (sym > 285) return false;
+      const int base = t.sym_len_base[sym - 257];
+      const size_t len = static_cast<size_t>(base) + br.Get(t.len_extra[base]);
+      const int dc = dist.Decode(br);
+      if (dc < 0 || dc >= 30) return false;
+      const size_t d = t.dist_base[dc] + br.Get(t.dist_extra[dc]);
+      if (br.Overrun() || d > pos || len > out_size - pos) return false;
+      const uint8_t *src = out + pos - d;
+      uint8_t *dst = out + pos;
+      for (size_t i = 0; i < len; ++i) dst[i] = src[i];  // may overlap forwards
+      pos += len;
+    }
+  }
+  return pos == out_size;
+}
+
+}  // namespace autoalg
@@ -0,0 +1,31 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Raw deflate (RFC 1951) encoder and decoder, no zlib dependency. Used for
+// PNG (image_writer.hpp) and the replay buffer tiles (replay_buffer.hpp).
+//
+// The encoder is greedy LZ77 over hash chains with dynamic Huffman blocks;
+// level trades search effort for size. Independently compressed pieces can
+// be concatenated into one stream: every piece but the last is written with
+// final = false, which ends it byte-aligned.
+
+#ifndef EASY_CONTROL_INCLUDE_DEFLATE_HPP
+#define EASY_CONTROL_INCLUDE_DEFLATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace autoalg {
+
+// Compress data and append the stream to out. level 1 (fast) .. 9 (small).
+void DeflateRaw(const uint8_t* data, size_t size, int level, bool final_stream, std::vector<uint8_t>& out);
+
+// Decompress one raw deflate stream that must expand to exactly out_size
+// bytes. False on corrupt or truncated input, or a size mismatch.
+bool InflateRaw(const uint8_t* data, size_t size, uint8_t* out, size_t out_size);
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_DEFLATE_HPP
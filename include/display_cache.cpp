@@ -0,0 +1,142 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "display_cache.hpp"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "common.hpp"
+
+namespace autoalg {
+
+namespace {
+
+constexpr uint64_t kUnwatchedTtlNs = 1000000000ull;
+
+bool SameDisplay(const DisplayInfo &a, const DisplayInfo &b) {
+  return a.index == b.index && a.id == b.id && a.name == b.name && a.bounds.x == b.bounds.x &&
+         a.bounds.y == b.bounds.y && a.bounds.w == b.bounds.w && a.bounds.h == b.bounds.h &&
+         a.refresh_hz == b.refresh_hz && a.scale == b.scale && a.rotation == b.rotation && a.primary == b.primary;
+}
+
+bool SameDisplays(const std::vector<DisplayInfo> &a, const std::vector<DisplayInfo> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i)
+    if (!SameDisplay(a[i], b[i])) return false;
+  return true;
+}
+
+class DisplayCache {
+ public:
+  static DisplayCache &Instance() {
+    static DisplayCache cache;
+    return cache;
+  }
+
+  std::vector<DisplayInfo> Get() {
+    bool start_watch = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      start_watch = !watch_started_;
+      watch_started_ = true;
+    }
+    // Outside the lock: a watcher may report a change straight away.
+    if (start_watch) {
+      const bool ok = detail::StartDisplayWatch([this] { Update_(detail::QueryDisplays()); });
+      std::lock_guard<std::mutex> lk(mutex_);
+      watching_ = ok;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (valid_ && (watching_ || NowSteadyNanos() - queried_ns_ < kUnwatchedTtlNs)) return displays_;
+    }
+    return Update_(detail::QueryDisplays());
+  }
+
+  int AddCallback(SystemOutput::DisplayChangeCallback cb) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    const int id = next_id_++;
+    callbacks_.emplace(id, std::move(cb));
+    return id;
+  }
+
+  void RemoveCallback(int id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    callbacks_.erase(id);
+  }
+
+ private:
+  DisplayCache() = default;
+
+  // Store list; if it differs from an earlier one, tell the callbacks. They
+  // run without the lock so they may query again.
+  std::vector<DisplayInfo> Update_(std::vector<DisplayInfo> list) {
+    std::vector<SystemOutput::DisplayChangeCallback> notify;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (valid_ && !SameDisplays(list, displays_)) {
+        for (const auto &kv : callbacks_) notify.push_back(kv.second);
+      }
+      displays_ = std::move(list);
+      valid_ = true;
+      queried_ns_ = NowSteadyNanos();
+      list = displays_;
+    }
+    for (const auto &cb : notify) cb(list);
+    return list;
+  }
+
+  std::mutex mutex_;
+  std::vector<DisplayInfo> displays_;
+  bool valid_ = false;
+  bool watch_started_ = false;
+  bool watching_ = false;
+  uint64_t queried_ns_ = 0;
+  int next_id_ = 1;
+  std::map<int, SystemOutput::DisplayChangeCallback> callbacks_;
+};
+
+}  // namespace
+
+std::vector<DisplayInfo> SystemOutput::GetDisplays() { return DisplayCache::Instance().Get(); }
+
+bool SystemOutput::GetDisplay(int display_index, DisplayInfo &out) {
+  const std::vector<DisplayInfo> displays = GetDisplays();
+  if (display_index < 0 || display_index >= (int)displays.size()) return false;
+  out = displays[(size_t)display_index];
+  return true;
+}
+
+int SystemOutput::GetDisplayCount() { return (int)GetDisplays().size(); }
+
+std::string SystemOutput::GetDisplayInfo(int display_index) {
+  DisplayInfo d;
+  if (!GetDisplay(display_index, d)) return "Display " + std::to_string(display_index) + " (unavailable)";
+  char geom[96];
+  std::snprintf(geom, sizeof(geom), " %dx%d%+d%+d", d.bounds.w, d.bounds.h, d.bounds.x, d.bounds.y);
+  std::string s = d.name + geom;
+  char extra[64];
+  if (d.refresh_hz > 0) {
+    std::snprintf(extra, sizeof(extra), " @%.2fHz", d.refresh_hz);
+    s += extra;
+  }
+  if (d.scale != 1.0) {
+    std::snprintf(extra, sizeof(extra), " x%.2f", d.scale);
+    s += extra;
+  }
+  if (d.rotation) s += " rot" + std::to_string(d.rotation);
+  if (d.primary) s += " primary";
+  return s;
+}
+
+int SystemOutput::AddDisplayChangeCallback(DisplayChangeCallback callback) {
+  return DisplayCache::Instance().AddCallback(std::move(callback));
+}
+
+void SystemOutput::RemoveDisplayChangeCallback(int id) { DisplayCache::Instance().RemoveCallback(id); }
+
+}  // namespace autoalg
@@ -0,0 +1,31 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Internal: backend hooks behind SystemOutput::GetDisplays(). Each
+// system_output_*.cpp implements both; display_cache.cpp owns the cache and
+// the change callbacks.
+
+#ifndef EASY_CONTROL_INCLUDE_DISPLAY_CACHE_HPP
+#define EASY_CONTROL_INCLUDE_DISPLAY_CACHE_HPP
+
+#include <functional>
+#include <vector>
+
+#include "system_output.hpp"
+
+namespace autoalg {
+namespace detail {
+
+// Current displays in capture-index order (DisplayInfo::index filled in).
+std::vector<DisplayInfo> QueryDisplays();
+
+// Start watching for display changes and call on_change (from any thread)
+// after each one. Called once; the backend stops watching at exit. Returns
+// false if the backend cannot watch.
+bool StartDisplayWatch(std::function<void()> on_change);
+
+}  // namespace detail
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_DISPLAY_CACHE_HPP
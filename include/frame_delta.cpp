@@ -0,0 +1,360 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "frame_delta.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <utility>
+
+#include "image_util.hpp"
+
+namespace autoalg {
+
+namespace {
+
+struct Shift {
+  int dx = 0;
+  int dy = 0;
+};
+
+EC_INLINE const uint8_t *PixelPtr(const ImageRGBA &im, int x, int y) {
+  return im.pixels.data() + (static_cast<size_t>(y) * im.width + x) * 4;
+}
+
+EC_INLINE uint64_t Mix(uint64_t h, uint64_t v) {
+  h ^= v;
+  h *= 0x100000001B3ull;
+  return h ^ (h >> 29);
+}
+
+// Hash n pixels starting at p.
+uint64_t HashPixels(const uint8_t *p, int n) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    uint64_t v;
+    std::memcpy(&v, p + i * 4, 8);
+    h = Mix(h, v);
+  }
+  if (i < n) {
+    uint32_t v;
+    std::memcpy(&v, p + i * 4, 4);
+    h = Mix(h, v);
+  }
+  return h;
+}
+
+bool RectEqual(const ImageRGBA &prev, const ImageRGBA &cur, const ScreenRect &r, const Shift &s) {
+  const ScreenRect src{r.x - s.dx, r.y - s.dy, r.w, r.h};
+  if (!RectContains(ScreenRect{0, 0, prev.width, prev.height}, src)) return false;
+  const size_t bytes = static_cast<size_t>(r.w) * 4;
+  for (int y = 0; y < r.h; ++y) {
+    if (std::memcmp(PixelPtr(cur, r.x, r.y + y), PixelPtr(prev, src.x, src.y + y), bytes) != 0) return false;
+  }
+  return true;
+}
+
+bool SegmentFlat(const uint8_t *p, int n) {
+  for (int i = 1; i < n; ++i) {
+    if (std::memcmp(p, p + i * 4, 4) != 0) return false;
+  }
+  return true;
+}
+
+// Sorted (band, hash) -> line index table used for offset voting.
+struct LineKey {
+  int band;
+  uint64_t hash;
+  int line;
+  bool operator<(const LineKey &o) const { return band != o.band ? band < o.band : hash < o.hash; }
+};
+
+// Vote offsets between cur lines and prev lines with identical hashes in the same band.
+// Buckets holding many lines (flat / repetitive content) carry no information and are skipped.
+void VoteOffsets(std::vector<LineKey> &prev_keys, const std::vector<LineKey> &cur_keys, int max_offset,
+                 std::vector<int> &votes) {
+  constexpr size_t kMaxBucket = 4;
+  std::sort(prev_keys.begin(), prev_keys.end());
+  votes.assign(static_cast<size_t>(2 * max_offset + 1), 0);
+  for (const LineKey &k : cur_keys) {
+    auto range = std::equal_range(prev_keys.begin(), prev_keys.end(), k);
+    if (range.first == range.second || static_cast<size_t>(range.second - range.first) > kMaxBucket) continue;
+    for (auto it = range.first; it != range.second; ++it) {
+      const int off = k.line - it->line;
+      if (off == 0 || off < -max_offset || off > max_offset) continue;
+      ++votes[static_cast<size_t>(off + max_offset)];
+    }
+  }
+}
+
+void TopOffsets(const std::vector<int> &votes, int max_offset, int min_votes, bool vertical, std::vector<Shift> &out) {
+  // Keep the two strongest offsets (e.g. a scroll plus a smaller scrolled pane).
+  int best[2] = {0, 0}, best_off[2] = {0, 0};
+  for (size_t i = 0; i < votes.size(); ++i) {
+    const int v = votes[i];
+    const int off = static_cast<int>(i) - max_offset;
+    if (v > best[0]) {
+      best[1] = best[0];
+      best_off[1] = best_off[0];
+      best[0] = v;
+      best_off[0] = off;
+    } else if (v > best[1]) {
+      best[1] = v;
+      best_off[1] = off;
+    }
+  }
+  for (int k = 0; k < 2; ++k) {
+    if (best[k] < min_votes) continue;
+    out.push_back(vertical ? Shift{0, best_off[k]} : Shift{best_off[k], 0});
+  }
+}
+
+// Vertical scrolls: per tile-column band, hash each row and vote dy.
+void VerticalCandidates(const ImageRGBA &prev, const ImageRGBA &cur, const ScreenRect &box, const MotionOptions &opt,
+                        std::vector<Shift> &out) {
+  const int ts = opt.tile_size;
+  const int s = std::min(opt.max_scroll, cur.height - 1);
+  if (s <= 0) return;
+  const int y0 = std::max(0, box.y - s), y1 = std::min(cur.height, box.y + box.h + s);
+  std::vector<LineKey> pk, ck;
+  for (int bx = box.x; bx < box.x + box.w; bx += ts) {
+    const int band = bx / ts;
+    const int w = std::min(ts, box.x + box.w - bx);
+    for (int y = y0; y < y1; ++y) pk.push_back({band, HashPixels(PixelPtr(prev, bx, y), w), y});
+    for (int y = box.y; y < box.y + box.h; ++y) ck.push_back({band, HashPixels(PixelPtr(cur, bx, y), w), y});
+  }
+  std::vector<int> votes;
+  VoteOffsets(pk, ck, s, votes);
+  TopOffsets(votes, s, opt.min_match_lines, true, out);
+}
+
+// Horizontal scrolls: per tile-row band, hash each column and vote dx.
+void HorizontalCandidates(const ImageRGBA &prev, const ImageRGBA &cur, const ScreenRect &box, const MotionOptions &opt,
+                          std::vector<Shift> &out) {
+  const int ts = opt.tile_size;
+  const int s = std::min(opt.max_scroll, cur.width - 1);
+  if (s <= 0) return;
+  const int x0 = std::max(0, box.x - s), x1 = std::min(cur.width, box.x + box.w + s);
+  std::vector<LineKey> pk, ck;
+  std::vector<uint64_t> ph, chs;
+  for (int by = box.y; by < box.y + box.h; by += ts) {
+    const int band = by / ts;
+    const int h = std::min(ts, box.y + box.h - by);
+    ph.assign(static_cast<size_t>(x1 - x0), 0xcbf29ce484222325ull);
+    chs.assign(static_cast<size_t>(box.w), 0xcbf29ce484222325ull);
+    for (int y = by; y < by + h; ++y) {
+      const uint8_t *pr = PixelPtr(prev, x0, y);
+      for (int x = 0; x < x1 - x0; ++x) {
+        uint32_t v;
+        std::memcpy(&v, pr + x * 4, 4);
+        ph[static_cast<size_t>(x)] = Mix(ph[static_cast<size_t>(x)], v);
+      }
+      const uint8_t *cr = PixelPtr(cur, box.x, y);
+      for (int x = 0; x < box.w; ++x) {
+        uint32_t v;
+        std::memcpy(&v, cr + x * 4, 4);
+        chs[static_cast<size_t>(x)] = Mix(chs[static_cast<size_t>(x)], v);
+      }
+    }
+    for (int x = x0; x < x1; ++x) pk.push_back({band, ph[static_cast<size_t>(x - x0)], x});
+    for (int x = box.x; x < box.x + box.w; ++x) ck.push_back({band, chs[static_cast<size_t>(x - box.x)], x});
+  }
+  std::vector<int> votes;
+  VoteOffsets(pk, ck, s, votes);
+  TopOffsets(votes, s, opt.min_match_lines, false, out);
+}
+
+// Window moves: take short non-flat pixel segments inside dirty tiles of cur and
+// search them in prev within +-max_move on both axes with a rolling hash.
+void MoveCandidates(const ImageRGBA &prev, const ImageRGBA &cur, const std::vector<ScreenRect> &tiles,
+                    const MotionOptions &opt, std::vector<Shift> &out) {
+  constexpr int kMaxAnchors = 12;
+  constexpr uint64_t kBase = 0x9E3779B97F4A7C15ull;
+  const int m = opt.max_move;
+  const int len = std::min(32, opt.tile_size);
+  if (m <= 0 || tiles.empty() || prev.width < len) return;
+
+  uint64_t base_pow = 1;  // kBase^(len-1)
+  for (int i = 1; i < len; ++i) base_pow *= kBase;
+  auto poly = [&](const uint8_t *p) {
+    uint64_t h = 0;
+    for (int i = 0; i < len; ++i) {
+      uint32_t v;
+      std::memcpy(&v, p + i * 4, 4);
+      h = h * kBase + v;
+    }
+    return h;
+  };
+
+  std::map<std::pair<int, int>, int> votes;
+  const size_t step = std::max<size_t>(1, tiles.size() / kMaxAnchors);
+  for (size_t ti = 0; ti < tiles.size(); ti += step) {
+    const ScreenRect &t = tiles[ti];
+    if (t.w < len) continue;
+    int ay = -1;
+    for (int off : {t.h / 2, t.h / 4, 3 * t.h / 4, 0}) {
+      const int y = t.y + off;
+      if (!SegmentFlat(PixelPtr(cur, t.x, y), len)) {
+        ay = y;
+        break;
+      }
+    }
+    if (ay < 0) continue;
+    const int ax = t.x;
+    const uint8_t *seg = PixelPtr(cur, ax, ay);
+    const uint64_t target = poly(seg);
+
+    std::vector<std::pair<int, int>> seen;
+    const int px0 = std::max(0, ax - m), px1 = std::min(prev.width - len, ax + m);
+    for (int y = std::max(0, ay - m); y <= std::min(prev.height - 1, ay + m) && px0 <= px1; ++y) {
+      const uint8_t *row = PixelPtr(prev, 0, y);
+      uint64_t h = poly(row + px0 * 4);
+      for (int x = px0;; ++x) {
+        if (h == target && (x != ax || y != ay) && std::memcmp(row + x * 4, seg, static_cast<size_t>(len) * 4) == 0) {
+          seen.emplace_back(ax - x, ay - y);
+        }
+        if (x == px1) break;
+        uint32_t out_v, in_v;
+        std::memcpy(&out_v, row + x * 4, 4);
+        std::memcpy(&in_v, row + (x + len) * 4, 4);
+        h = (h - out_v * base_pow) * kBase + in_v;
+      }
+    }
+    // Repetitive content matches everywhere; such anchors are useless.
+    if (seen.empty() || seen.size() > 4) continue;
+    for (const auto &s : seen) ++votes[s];
+  }
+
+  std::vector<std::pair<int, std::pair<int, int>>> ranked;
+  for (const auto &kv : votes) {
+    if (kv.second >= 2) ranked.emplace_back(kv.second, kv.first);
+  }
+  std::sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (const auto &r : ranked) out.push_back(Shift{r.second.first, r.second.second});
+}
+
+// Merge grid tiles into larger rectangles: horizontal runs first, then stack equal runs vertically.
+std::vector<ScreenRect> MergeTiles(std::vector<ScreenRect> tiles) {
+  std::sort(tiles.begin(), tiles.end(),
+            [](const ScreenRect &a, const ScreenRect &b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+  std::vector<ScreenRect> runs;
+  for (const ScreenRect &t : tiles) {
+    if (!runs.empty()) {
+      ScreenRect &r = runs.back();
+      if (r.y == t.y && r.h == t.h && r.x + r.w == t.x) {
+        r.w += t.w;
+        continue;
+      }
+    }
+    runs.push_back(t);
+  }
+  std::vector<ScreenRect> out;
+  for (const ScreenRect &r : runs) {
+    bool merged = false;
+    for (ScreenRect &o : out) {
+      if (o.x == r.x && o.w == r.w && o.y + o.h == r.y) {
+        o.h += r.h;
+        merged = true;
+        break;
+      }
+    }
+    if (!merged) out.push_back(r);
+  }
+  return out;
+}
+
+}  // namespace
+
+std::vector<ScreenRect> DiffTiles(const ImageRGBA &prev, const ImageRGBA &cur, int tile_size) {
+  std::vector<ScreenRect> out;
+  if (tile_size <= 0) return out;
+  const bool same = prev.width == cur.width && prev.height == cur.height;
+  for (int ty = 0; ty < cur.height; ty += tile_size) {
+    const int th = std::min(tile_size, cur.height - ty);
+    for (int tx = 0; tx < cur.width; tx += tile_size) {
+      const ScreenRect t{tx, ty, std::min(tile_size, cur.width - tx), th};
+      if (!same || !RectEqual(prev, cur, t, Shift{})) out.push_back(t);
+    }
+  }
+  return out;
+}
+
+FrameDelta ComputeFrameDelta(const ImageRGBA &prev, const ImageRGBA &cur, const MotionOptions &options) {
+  FrameDelta d;
+  MotionOptions opt = options;
+  if (opt.tile_size <= 0) opt.tile_size = 64;
+  if (prev.width != cur.width || prev.height != cur.height) {
+    d.size_changed = true;
+    d.dirty_tiles = DiffTiles(prev, cur, opt.tile_size);
+    return d;
+  }
+
+  std::vector<ScreenRect> dirty = DiffTiles(prev, cur, opt.tile_size);
+  if (dirty.empty()) return d;
+  ScreenRect box;
+  for (const ScreenRect &t : dirty) box = UnionRect(box, t);
+
+  std::vector<Shift> cands;
+  VerticalCandidates(prev, cur, box, opt, cands);
+  HorizontalCandidates(prev, cur, box, opt, cands);
+
+  std::vector<char> claimed(dirty.size(), 0);
+  std::vector<Shift> tried;
+  auto claim = [&](const Shift &s) {
+    for (const Shift &t : tried) {
+      if (t.dx == s.dx && t.dy == s.dy) return;
+    }
+    tried.push_back(s);
+    std::vector<ScreenRect> matched;
+    for (size_t i = 0; i < dirty.size(); ++i) {
+      if (claimed[i] || !RectEqual(prev, cur, dirty[i], s)) continue;
+      claimed[i] = 1;
+      matched.push_back(dirty[i]);
+    }
+    for (const ScreenRect &r : MergeTiles(std::move(matched))) d.copies.push_back(CopyRect{r, r.x - s.dx, r.y - s.dy});
+  };
+
+  for (const Shift &s : cands) {
+    if (static_cast<int>(tried.size()) >= opt.max_candidates) break;
+    claim(s);
+  }
+
+  // Window moves are searched only among tiles that scrolls could not explain.
+  std::vector<ScreenRect> rest;
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    if (!claimed[i]) rest.push_back(dirty[i]);
+  }
+  if (!rest.empty() && static_cast<int>(tried.size()) < opt.max_candidates) {
+    std::vector<Shift> moves;
+    MoveCandidates(prev, cur, rest, opt, moves);
+    for (const Shift &s : moves) {
+      if (static_cast<int>(tried.size()) >= opt.max_candidates) break;
+      claim(s);
+    }
+  }
+
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    if (!claimed[i]) d.dirty_tiles.push_back(dirty[i]);
+  }
+  return d;
+}
+
+void ApplyCopyRects(const std::vector<CopyRect> &copies, ImageRGBA &frame) {
+  if (copies.empty()) return;
+  const ImageRGBA prev = frame;  // sources refer to the unmodified previous frame
+  for (const CopyRect &c : copies) {
+    const ScreenRect bounds{0, 0, frame.width, frame.height};
+    const ScreenRect src{c.src_x, c.src_y, c.dst.w, c.dst.h};
+    if (!RectContains(bounds, c.dst) || !RectContains(bounds, src)) continue;
+    const size_t bytes = static_cast<size_t>(c.dst.w) * 4;
+    for (int y = 0; y < c.dst.h; ++y) {
+      std::memcpy(frame.pixels.data() + (static_cast<size_t>(c.dst.y + y) * frame.width + c.dst.x) * 4,
+                  PixelPtr(prev, src.x, src.y + y), bytes);
+    }
+  }
+}
+
+}  // namespace autoalg
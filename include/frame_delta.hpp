@@ -0,0 +1,59 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Frame-to-frame deltas: dirty tiles plus scroll / window-move detection.
+//
+// A plain tile diff reports the whole screen dirty when a document scrolls.
+// ComputeFrameDelta first looks for content that moved between the previous
+// and the current frame (row hashing for vertical scrolls, column hashing for
+// horizontal scrolls, anchor-segment search for window moves) and emits
+// "copy rect" hints; only the tiles that copies cannot reproduce are left in
+// dirty_tiles. A consumer replays copies first, then sends the residual tiles.
+
+#ifndef EASY_CONTROL_INCLUDE_FRAME_DELTA_HPP
+#define EASY_CONTROL_INCLUDE_FRAME_DELTA_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "system_output.hpp"
+
+namespace autoalg {
+
+// Copy prev[src_x.., src_y..] (size of dst) to cur[dst]. Sources always refer
+// to the previous frame as it was before any copy of the same delta.
+struct CopyRect {
+  ScreenRect dst;
+  int src_x = 0;
+  int src_y = 0;
+};
+
+struct FrameDelta {
+  std::vector<CopyRect> copies;         // apply first
+  std::vector<ScreenRect> dirty_tiles;  // residual, after copies
+  bool size_changed = false;            // frames differ in size: everything is dirty, no copies
+};
+
+struct MotionOptions {
+  int tile_size = 64;
+  int max_scroll = 1024;     // search range for pure vertical / horizontal scrolls (px)
+  int max_move = 256;        // search range per axis for window moves (px), 0 disables
+  int min_match_lines = 16;  // rows / columns that must agree on a scroll offset
+  int max_candidates = 4;    // distinct motions examined per frame
+};
+
+// Tiles (tile_size grid, clipped at the right/bottom edges) whose pixels differ.
+// Frames of different size report every tile of cur.
+std::vector<ScreenRect> DiffTiles(const ImageRGBA& prev, const ImageRGBA& cur, int tile_size);
+
+// Compute copies + residual dirty tiles that turn prev into cur.
+FrameDelta ComputeFrameDelta(const ImageRGBA& prev, const ImageRGBA& cur, const MotionOptions& options = {});
+
+// Apply delta.copies to frame in place (frame holds the previous image on entry).
+// Residual tiles must be written by the caller afterwards.
+void ApplyCopyRects(const std::vector<CopyRect>& copies, ImageRGBA& frame);
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_FRAME_DELTA_HPP
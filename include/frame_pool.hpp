@@ -0,0 +1,121 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Recycled capture frames.
+//
+// Acquire() hands out an ImageRGBA behind a shared_ptr. When the last
+// reference goes away the image returns to the pool with its pixel capacity
+// intact, so capturing into it again (every backend resizes or assigns in
+// place) does not allocate. Consumers that must hold a frame past the
+// capture call, such as a NumPy array viewing the pixels from Python, keep
+// the shared_ptr and share the pooled memory without a copy.
+//
+// Frames may outlive the pool; they are then simply freed. Thread-safe.
+// ObjectPool<T> is the same for other buffer types (e.g. NV12 frames).
+//
+// Usage:
+//   FramePool pool;
+//   FramePool::Frame frame = pool.Acquire();
+//   SystemOutput::CaptureScreenWithCursor(0, *frame);
+//   consume(frame);  // returns to the pool once the last copy is dropped
+
+#ifndef EASY_CONTROL_INCLUDE_FRAME_POOL_HPP
+#define EASY_CONTROL_INCLUDE_FRAME_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "macro.h"
+#include "system_output.hpp"
+
+namespace autoalg {
+
+template <class T>
+class ObjectPool {
+ public:
+  using Ptr = std::shared_ptr<T>;
+
+  struct Stats {
+    uint64_t acquired = 0;
+    uint64_t allocated = 0;  // acquisitions that had to create a new object
+    uint64_t recycled = 0;   // objects returned to the free list
+    size_t free = 0;         // objects currently waiting for reuse
+  };
+
+  // max_free bounds the idle objects kept (each may hold a full frame of pixels).
+  EC_INLINE explicit ObjectPool(size_t max_free = 4) : shared_(std::make_shared<Shared_>()) {
+    shared_->max_free = max_free;
+  }
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  // An object from the free list (previous contents still in place), or a
+  // new default-constructed one.
+  EC_INLINE Ptr Acquire() {
+    std::unique_ptr<T> object;
+    {
+      std::lock_guard<std::mutex> lk(shared_->mutex);
+      ++shared_->stats.acquired;
+      if (!shared_->free.empty()) {
+        object = std::move(shared_->free.back());
+        shared_->free.pop_back();
+      } else {
+        ++shared_->stats.allocated;
+      }
+    }
+    if (!object) object.reset(new T);
+    std::weak_ptr<Shared_> owner = shared_;
+    return Ptr(object.release(), [owner](T* p) { Release_(owner, p); });
+  }
+
+  // Free the idle objects (e.g. after the capture size shrank).
+  EC_INLINE void Trim() {
+    std::vector<std::unique_ptr<T>> drop;
+    std::lock_guard<std::mutex> lk(shared_->mutex);
+    drop.swap(shared_->free);
+  }
+
+  EC_INLINE Stats GetStats() const {
+    std::lock_guard<std::mutex> lk(shared_->mutex);
+    Stats s = shared_->stats;
+    s.free = shared_->free.size();
+    return s;
+  }
+
+ private:
+  struct Shared_ {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<T>> free;
+    size_t max_free = 4;
+    Stats stats;
+  };
+
+  EC_INLINE static void Release_(const std::weak_ptr<Shared_>& owner, T* p) {
+    std::unique_ptr<T> object(p);
+    if (const std::shared_ptr<Shared_> shared = owner.lock()) {
+      std::lock_guard<std::mutex> lk(shared->mutex);
+      if (shared->free.size() < shared->max_free) {
+        shared->free.push_back(std::move(object));
+        ++shared->stats.recycled;
+      }
+    }
+  }
+
+  std::shared_ptr<Shared_> shared_;
+};
+
+class FramePool : public ObjectPool<ImageRGBA> {
+ public:
+  using Frame = Ptr;
+
+  EC_INLINE explicit FramePool(size_t max_free = 4) : ObjectPool<ImageRGBA>(max_free) {}
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_FRAME_POOL_HPP
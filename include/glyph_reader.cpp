@@ -0,0 +1,298 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "glyph_reader.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+
+#include "image_util.hpp"
+
+namespace autoalg {
+
+namespace {
+
+EC_INLINE int Popcount64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(v);
+#else
+  return static_cast<int>(std::bitset<64>(v).count());
+#endif
+}
+
+EC_INLINE uint64_t Mix(uint64_t h, uint64_t v) {
+  h ^= v;
+  h *= 0x100000001B3ull;
+  return h ^ (h >> 29);
+}
+
+// Hash of the pixels of r (already clipped to image).
+uint64_t HashRegion(const ImageRGBA &image, const ScreenRect &r) {
+  uint64_t h = Mix(0xcbf29ce484222325ull, (static_cast<uint64_t>(r.w) << 32) | static_cast<uint32_t>(r.h));
+  const size_t stride = static_cast<size_t>(image.width) * 4;
+  const size_t row_bytes = static_cast<size_t>(r.w) * 4;
+  for (int y = 0; y < r.h; ++y) {
+    const uint8_t *p = image.pixels.data() + static_cast<size_t>(r.y + y) * stride + static_cast<size_t>(r.x) * 4;
+    size_t i = 0;
+    for (; i + 8 <= row_bytes; i += 8) {
+      uint64_t v;
+      std::memcpy(&v, p + i, 8);
+      h = Mix(h, v);
+    }
+    if (i < row_bytes) {
+      uint32_t v;
+      std::memcpy(&v, p + i, 4);
+      h = Mix(h, v);
+    }
+  }
+  return h;
+}
+
+// Bits [x0, x0 + w) of a mask row as one word (w <= 64).
+EC_INLINE uint64_t ExtractBits(const uint64_t *row, int words, int x0, int w) {
+  const int word = x0 >> 6;
+  const int off = x0 & 63;
+  uint64_t v = row[word] >> off;
+  if (off && word + 1 < words) v |= row[word + 1] << (64 - off);
+  return w >= 64 ? v : v & ((uint64_t{1} << w) - 1);
+}
+
+}  // namespace
+
+GlyphReader::GlyphReader() : GlyphReader(Options{}) {}
+
+GlyphReader::GlyphReader(const Options &options) : options_(options) {}
+
+void GlyphReader::Binarize_(const ImageRGBA &image, const ScreenRect &r, Mask &out) const {
+  out.width = r.w;
+  out.height = r.h;
+  out.words = (r.w + 63) / 64;
+  out.bits.assign(static_cast<size_t>(out.words) * r.h, 0);
+  const size_t stride = static_cast<size_t>(image.width) * 4;
+  const int thr = options_.threshold;
+  const bool bright = options_.polarity == Options::kBrightText;
+  const int tol = options_.tolerance;
+  const int cr = options_.color[0], cg = options_.color[1], cb = options_.color[2];
+  for (int y = 0; y < r.h; ++y) {
+    const uint8_t *p = image.pixels.data() + static_cast<size_t>(r.y + y) * stride + static_cast<size_t>(r.x) * 4;
+    uint64_t *row = out.bits.data() + static_cast<size_t>(y) * out.words;
+    for (int x = 0; x < r.w; ++x, p += 4) {
+      bool ink;
+      if (options_.polarity == Options::kColorText) {
+        ink = std::abs(p[0] - cr) <= tol && std::abs(p[1] - cg) <= tol && std::abs(p[2] - cb) <= tol;
+      } else {
+        const int luma = (p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8;
+        ink = bright ? luma >= thr : luma < thr;
+      }
+      row[x >> 6] |= static_cast<uint64_t>(ink) << (x & 63);
+    }
+  }
+}
+
+std::vector<GlyphReader::Segment> GlyphReader::Segments_(const Mask &m) {
+  std::vector<uint64_t> cols(m.words, 0);
+  for (int y = 0; y < m.height; ++y) {
+    const uint64_t *row = m.bits.data() + static_cast<size_t>(y) * m.words;
+    for (int w = 0; w < m.words; ++w) cols[w] |= row[w];
+  }
+  std::vector<Segment> segs;
+  int start = -1;
+  for (int x = 0; x <= m.width; ++x) {
+    const bool ink = x < m.width && ((cols[x >> 6] >> (x & 63)) & 1);
+    if (ink && start < 0) start = x;
+    if (!ink && start >= 0) {
+      segs.push_back({start, x});
+      start = -1;
+    }
+  }
+  return segs;
+}
+
+int GlyphReader::InkTop_(const Mask &m) {
+  for (int y = 0; y < m.height; ++y) {
+    const uint64_t *row = m.bits.data() + static_cast<size_t>(y) * m.words;
+    for (int w = 0; w < m.words; ++w)
+      if (row[w]) return y;
+  }
+  return 0;
+}
+
+bool GlyphReader::Cut_(const Mask &m, int x0, int w, Glyph &out) {
+  if (w <= 0 || w > 64 || x0 < 0 || x0 + w > m.width) return false;
+  int top = -1, bottom = -1;
+  out.rows.resize(m.height);
+  for (int y = 0; y < m.height; ++y) {
+    const uint64_t v = ExtractBits(m.bits.data() + static_cast<size_t>(y) * m.words, m.words, x0, w);
+    out.rows[y] = v;
+    if (v) {
+      if (top < 0) top = y;
+      bottom = y;
+    }
+  }
+  if (top < 0) return false;
+  out.rows.erase(out.rows.begin() + bottom + 1, out.rows.end());
+  out.rows.erase(out.rows.begin(), out.rows.begin() + top);
+  out.width = w;
+  out.height = bottom - top + 1;
+  out.top = top;
+  out.ink = 0;
+  for (uint64_t v : out.rows) out.ink += Popcount64(v);
+  return true;
+}
+
+// Mismatched pixels over total ink. Rows are aligned by their offset from the
+// text line top, so "-" and "_" differ; glyphs registered alone (top < 0)
+// align at the top of the ink boxes.
+double GlyphReader::Score_(const Glyph &g, const Glyph &window) const {
+  const int dy = g.top >= 0 ? window.top - g.top : 0;
+  const int y0 = std::min(0, dy);
+  const int y1 = std::max(g.height, dy + window.height);
+  int err = 0;
+  for (int y = y0; y < y1; ++y) {
+    const uint64_t a = y >= 0 && y < g.height ? g.rows[y] : 0;
+    const uint64_t b = y - dy >= 0 && y - dy < window.height ? window.rows[y - dy] : 0;
+    err += Popcount64(a ^ b);
+  }
+  return static_cast<double>(err) / std::max(1, g.ink + window.ink);
+}
+
+const GlyphReader::Glyph *GlyphReader::Best_(const Glyph &window, bool exact_width, double *error) const {
+  const Glyph *best = nullptr;
+  double best_err = 2.0;
+  for (const Glyph &g : glyphs_) {
+    if (exact_width && std::abs(g.width - window.width) > 1) continue;
+    const double e = Score_(g, window);
+    if (e < best_err) {
+      best_err = e;
+      best = &g;
+    }
+  }
+  *error = best_err;
+  return best;
+}
+
+std::string GlyphReader::Recognize_(const Mask &m) {
+  std::string out;
+  int prev_end = -1;
+  const int line_top = InkTop_(m);
+  Glyph window;
+  auto cut = [&](int x0, int w) {
+    if (!Cut_(m, x0, w, window)) return false;
+    window.top -= line_top;
+    return true;
+  };
+  for (const Segment &seg : Segments_(m)) {
+    if (options_.space_gap > 0 && prev_end >= 0 && seg.x0 - prev_end >= options_.space_gap) out += ' ';
+    prev_end = seg.x1;
+
+    double err;
+    if (seg.x1 - seg.x0 <= 64 && cut(seg.x0, seg.x1 - seg.x0)) {
+      const Glyph *g = Best_(window, true, &err);
+      if (g && err <= options_.max_error) {
+        out += g->text;
+        continue;
+      }
+    }
+    // Touching glyphs: consume the segment left to right, best glyph first.
+    int x = seg.x0;
+    while (x < seg.x1) {
+      const Glyph *best = nullptr;
+      double best_err = 2.0;
+      for (const Glyph &g : glyphs_) {
+        if (g.width > seg.x1 - x || !cut(x, g.width)) continue;
+        const double e = Score_(g, window);
+        // Prefer the wider glyph on near-ties so a stroke of "4" is not read as "1".
+        if (!best || e < best_err - 0.02 || (e <= best_err + 0.02 && g.width > best->width)) {
+          best_err = e;
+          best = &g;
+        }
+      }
+      if (!best || best_err > options_.max_error) {
+        out += options_.unknown;
+        ++stats_.unknown_glyphs;
+        break;
+      }
+      out += best->text;
+      x += best->width;
+      while (x < seg.x1 && !Cut_(m, x, 1, window)) ++x;  // skip empty columns
+    }
+  }
+  return out;
+}
+
+bool GlyphReader::AddGlyph(const std::string &text, const ImageRGBA &image, const ScreenRect &rect) {
+  const ScreenRect r = ClipRect(rect, image.width, image.height);
+  if (RectEmpty(r) || text.empty()) return false;
+  Mask m;
+  Binarize_(image, r, m);
+  const std::vector<Segment> segs = Segments_(m);
+  if (segs.empty()) return false;
+  Glyph g;
+  if (!Cut_(m, segs.front().x0, segs.back().x1 - segs.front().x0, g)) return false;
+  g.text = text;
+  g.top = -1;  // no text line to measure against
+  std::lock_guard<std::mutex> lk(mutex_);
+  glyphs_.push_back(std::move(g));
+  cache_.clear();
+  return true;
+}
+
+bool GlyphReader::AddGlyphStrip(const std::string &chars, const ImageRGBA &image, const ScreenRect &rect) {
+  const ScreenRect r = ClipRect(rect, image.width, image.height);
+  if (RectEmpty(r)) return false;
+  Mask m;
+  Binarize_(image, r, m);
+  const std::vector<Segment> segs = Segments_(m);
+  if (segs.size() != chars.size()) return false;
+  const int line_top = InkTop_(m);
+  std::vector<Glyph> added(segs.size());
+  for (size_t i = 0; i < segs.size(); ++i) {
+    if (!Cut_(m, segs[i].x0, segs[i].x1 - segs[i].x0, added[i])) return false;
+    added[i].text = std::string(1, chars[i]);
+    added[i].top -= line_top;
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (Glyph &g : added) glyphs_.push_back(std::move(g));
+  cache_.clear();
+  return true;
+}
+
+size_t GlyphReader::GlyphCount() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return glyphs_.size();
+}
+
+std::string GlyphReader::Read(const ImageRGBA &image, const ScreenRect &region) {
+  const ScreenRect r = ClipRect(region, image.width, image.height);
+  std::lock_guard<std::mutex> lk(mutex_);
+  ++stats_.reads;
+  if (RectEmpty(r) || image.pixels.size() < static_cast<size_t>(image.width) * image.height * 4) return {};
+
+  const uint64_t key = HashRegion(image, r);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    ++stats_.cache_hits;
+    return it->second;
+  }
+  Mask m;
+  Binarize_(image, r, m);
+  std::string text = Recognize_(m);
+  if (cache_.size() >= options_.cache_entries) cache_.clear();
+  cache_.emplace(key, text);
+  return text;
+}
+
+void GlyphReader::ClearCache() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  cache_.clear();
+}
+
+GlyphReader::Stats GlyphReader::GetStats() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return stats_;
+}
+
+}  // namespace autoalg
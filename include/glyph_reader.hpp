@@ -0,0 +1,113 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Glyph-cache text reader for fixed-font UI regions.
+//
+// HUD counters (resources, health, timers) use one bitmap font at one size,
+// so a general OCR engine is overkill. Register each glyph once from a
+// screenshot, then Read() a region: the region is binarized into 64-bit row
+// masks, split into glyphs at empty columns and every glyph is matched by
+// XOR + popcount over its rows (64 pixels per instruction). Results are
+// cached by a hash of the region's pixels, so an unchanged counter costs one
+// hash pass.
+//
+// Usage:
+//   GlyphReader reader;                              // bright text on dark HUD
+//   reader.AddGlyphStrip("0123456789", shot, digits_rect);
+//   std::string minerals = reader.Read(frame, minerals_rect);
+
+#ifndef EASY_CONTROL_INCLUDE_GLYPH_READER_HPP
+#define EASY_CONTROL_INCLUDE_GLYPH_READER_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "system_output.hpp"
+
+namespace autoalg {
+
+class GlyphReader {
+ public:
+  struct Options {
+    enum Polarity : int { kBrightText = 0, kDarkText, kColorText };
+    Polarity polarity = kBrightText;
+    int threshold = 128;                 // luminance threshold for kBrightText / kDarkText
+    uint8_t color[3] = {255, 255, 255};  // kColorText: text RGB
+    int tolerance = 48;                  // kColorText: max per-channel distance
+    double max_error = 0.2;              // mismatched / (glyph ink + window ink) to accept a match
+    int space_gap = 0;                   // empty columns that produce ' ' (0 = never)
+    char unknown = '?';                  // emitted for an unmatched glyph
+    size_t cache_entries = 4096;         // cleared when exceeded
+  };
+
+  struct Stats {
+    uint64_t reads = 0;
+    uint64_t cache_hits = 0;
+    uint64_t unknown_glyphs = 0;
+  };
+
+  GlyphReader();
+  explicit GlyphReader(const Options& options);
+
+  // Register one glyph from rect of image (trimmed to its ink). Glyphs wider
+  // than 64 px are rejected. Clears the result cache.
+  bool AddGlyph(const std::string& text, const ImageRGBA& image, const ScreenRect& rect);
+
+  // Register a strip of glyphs, e.g. "0123456789" rendered once: rect is
+  // segmented at empty columns and segment i gets the i-th character of chars.
+  // Returns false (and registers nothing) if the counts differ.
+  bool AddGlyphStrip(const std::string& chars, const ImageRGBA& image, const ScreenRect& rect);
+
+  size_t GlyphCount() const;
+
+  // Text in region (display-local coordinates of image). Empty if nothing is inked.
+  std::string Read(const ImageRGBA& image, const ScreenRect& region);
+
+  void ClearCache();
+  Stats GetStats() const;
+
+ private:
+  struct Glyph {
+    std::string text;
+    int width = 0;
+    int height = 0;
+    int ink = 0;
+    int top = 0;                 // ink box offset from the text line top (-1: unknown)
+    std::vector<uint64_t> rows;  // bit x = column x, trimmed to the ink box
+  };
+
+  // Binarized region: rows of `words` 64-bit masks.
+  struct Mask {
+    int width = 0;
+    int height = 0;
+    int words = 0;
+    std::vector<uint64_t> bits;
+  };
+
+  struct Segment {
+    int x0 = 0;
+    int x1 = 0;  // exclusive
+  };
+
+  void Binarize_(const ImageRGBA& image, const ScreenRect& r, Mask& out) const;
+  static std::vector<Segment> Segments_(const Mask& m);
+  static int InkTop_(const Mask& m);
+  static bool Cut_(const Mask& m, int x0, int w, Glyph& out);
+  double Score_(const Glyph& g, const Glyph& window) const;
+  const Glyph* Best_(const Glyph& window, bool exact_width, double* error) const;
+  std::string Recognize_(const Mask& m);
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::vector<Glyph> glyphs_;
+  std::unordered_map<uint64_t, std::string> cache_;
+  Stats stats_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_GLYPH_READER_HPP
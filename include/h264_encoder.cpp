@@ -0,0 +1,233 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "h264_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include "image_util.hpp"
+
+#if defined(AUTOALG_HAVE_X264)
+extern "C" {
+#include <x264.h>
+}
+#endif
+
+namespace autoalg {
+
+#if defined(AUTOALG_HAVE_X264)
+namespace {
+
+// One offset per 16x16 macroblock: static_qp_offset everywhere except under
+// the dirty rects and copy destinations. malloc'ed: x264 frees it through
+// quant_offsets_free once the frame left its lookahead.
+float *BuildQuantOffsets(const PipelineFrame &frame, int width, int height, const H264EncodeStage::Options &o) {
+  const int mb_w = (width + 15) / 16;
+  const int mb_h = (height + 15) / 16;
+  const size_t count = static_cast<size_t>(mb_w) * mb_h;
+  float *q = static_cast<float *>(std::malloc(count * sizeof(float)));
+  if (!q) return nullptr;
+  std::fill(q, q + count, o.static_qp_offset);
+  const auto mark = [&](const ScreenRect &r) {
+    const ScreenRect c = ClipRect(r, width, height);
+    if (RectEmpty(c)) return;
+    for (int my = c.y / 16; my <= (c.y + c.h - 1) / 16; ++my)
+      for (int mx = c.x / 16; mx <= (c.x + c.w - 1) / 16; ++mx) q[static_cast<size_t>(my) * mb_w + mx] = o.dirty_qp_offset;
+  };
+  for (const ScreenRect &r : frame.dirty) mark(r);
+  for (const CopyRect &c : frame.copies) mark(c.dst);
+  return q;
+}
+
+}  // namespace
+#endif
+
+struct H264EncodeStage::Impl {
+  mutable std::mutex stats_mutex;
+  Stats stats;
+
+  int width = 0;
+  int height = 0;
+  bool started = false;
+  uint64_t base_ns = 0;        // grab time of the first frame (pts 0)
+  int64_t last_pts = -1;       // microseconds, strictly increasing
+  uint64_t last_input_ns = 0;  // grab time of the last frame handed to x264
+  // Frames handed to x264 whose payload has not come out yet, by pts.
+  std::deque<std::pair<int64_t, PipelineFrame>> pending;
+
+#if defined(AUTOALG_HAVE_X264)
+  x264_t *enc = nullptr;
+
+  ~Impl() {
+    if (enc) x264_encoder_close(enc);
+  }
+
+  bool Open(const Options &o, int w, int h, bool bt709) {
+    if (enc && w == width && h == height) return true;
+    if (enc) {
+      x264_encoder_close(enc);
+      enc = nullptr;
+      pending.clear();
+      std::lock_guard<std::mutex> lk(stats_mutex);
+      ++stats.reopened;
+    }
+    x264_param_t param;
+    if (x264_param_default_preset(&param, o.preset.c_str(), o.tune.empty() ? nullptr : o.tune.c_str()) < 0)
+      return false;
+    param.i_log_level = X264_LOG_WARNING;
+    param.i_threads = o.threads;
+    param.i_width = w;
+    param.i_height = h;
+    param.i_csp = X264_CSP_NV12;
+    param.i_fps_num = static_cast<uint32_t>(std::lround((o.fps > 0 ? o.fps : 60.0) * 1000));
+    param.i_fps_den = 1000;
+    // Grab times in microseconds: skipped frames leave gaps instead of shifting the clock.
+    param.b_vfr_input = 1;
+    param.i_timebase_num = 1;
+    param.i_timebase_den = 1000000;
+    param.i_keyint_max = std::max(1, o.keyint);
+    param.b_repeat_headers = 1;  // SPS/PPS before every keyframe: a late joiner can start there
+    param.b_annexb = 1;
+    param.vui.b_fullrange = 0;
+    param.vui.i_colorprim = param.vui.i_transfer = param.vui.i_colmatrix = bt709 ? 1 : 6;  // BT.709 : SMPTE 170M
+    if (o.bitrate_kbps > 0) {
+      param.rc.i_rc_method = X264_RC_ABR;
+      param.rc.i_bitrate = o.bitrate_kbps;
+    } else {
+      param.rc.i_rc_method = X264_RC_CRF;
+      param.rc.f_rf_constant = o.crf;
+    }
+    if (o.vbv_max_kbps > 0) {
+      param.rc.i_vbv_max_bitrate = o.vbv_max_kbps;
+      param.rc.i_vbv_buffer_size = o.vbv_buffer_kb > 0 ? o.vbv_buffer_kb : o.vbv_max_kbps;
+    }
+    // x264 ignores quantizer offsets with adaptive quantization off (ultrafast).
+    if (o.use_dirty_hints && param.rc.i_aq_mode == X264_AQ_NONE) param.rc.i_aq_mode = X264_AQ_VARIANCE;
+    if (!o.profile.empty() && x264_param_apply_profile(&param, o.profile.c_str()) < 0) return false;
+    enc = x264_encoder_open(&param);
+    if (!enc) return false;
+    width = w;
+    height = h;
+    return true;
+  }
+
+  // Attach the payload of `out` to its pending frame and move that frame to dst.
+  bool Emit(const x264_picture_t &out, const x264_nal_t *nals, int bytes, PipelineFrame &dst) {
+    if (pending.empty()) return false;
+    auto it = std::find_if(pending.begin(), pending.end(),
+                           [&](const std::pair<int64_t, PipelineFrame> &p) { return p.first == out.i_pts; });
+    if (it == pending.end()) it = pending.begin();
+    dst = std::move(it->second);
+    pending.erase(it);
+    // x264 guarantees the NAL payloads of one frame are contiguous.
+    dst.payload = std::make_shared<std::vector<uint8_t>>(nals[0].p_payload, nals[0].p_payload + bytes);
+    dst.keyframe = out.b_keyframe != 0;
+    std::lock_guard<std::mutex> lk(stats_mutex);
+    ++stats.encoded;
+    stats.bytes += static_cast<uint64_t>(bytes);
+    if (dst.keyframe) ++stats.keyframes;
+    return true;
+  }
+#endif
+};
+
+H264EncodeStage::H264EncodeStage(const Options &options) : options_(options), impl_(new Impl) {}
+
+H264EncodeStage::~H264EncodeStage() = default;
+
+bool H264EncodeStage::Available() {
+#if defined(AUTOALG_HAVE_X264)
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool H264EncodeStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  if (!frame.nv12) return false;
+#if defined(AUTOALG_HAVE_X264)
+  Impl &s = *impl_;
+  const ImageNV12 &pic = *frame.nv12;
+  const uint64_t t = pic.grab_end_ns ? pic.grab_end_ns : NowSteadyNanos();
+  const bool unchanged = !frame.full_dirty && frame.dirty.empty() && frame.copies.empty();
+  const uint64_t keepalive_ns = static_cast<uint64_t>(std::max(0, options_.static_keepalive_ms)) * 1000000;
+  if (options_.skip_static && unchanged && !force_keyframe_.load() && s.enc && pic.width == s.width &&
+      pic.height == s.height && t - s.last_input_ns < keepalive_ns) {
+    std::lock_guard<std::mutex> lk(s.stats_mutex);
+    ++s.stats.skipped_static;
+    return false;
+  }
+  if (!s.Open(options_, pic.width, pic.height, pic.bt709)) return false;
+
+  if (!s.started) {
+    s.base_ns = t;
+    s.started = true;
+  }
+  int64_t pts = t > s.base_ns ? static_cast<int64_t>((t - s.base_ns) / 1000) : 0;
+  if (pts <= s.last_pts) pts = s.last_pts + 1;
+  s.last_pts = pts;
+  s.last_input_ns = t;
+
+  x264_picture_t in;
+  x264_picture_init(&in);
+  in.img.i_csp = X264_CSP_NV12;
+  in.img.i_plane = 2;
+  in.img.plane[0] = const_cast<uint8_t *>(pic.Y());
+  in.img.i_stride[0] = pic.width;
+  in.img.plane[1] = const_cast<uint8_t *>(pic.UV());
+  in.img.i_stride[1] = pic.width;
+  in.i_pts = pts;
+  in.i_type = force_keyframe_.exchange(false) ? X264_TYPE_IDR : X264_TYPE_AUTO;
+  if (options_.use_dirty_hints && !frame.full_dirty) {
+    in.prop.quant_offsets = BuildQuantOffsets(frame, pic.width, pic.height, options_);
+    in.prop.quant_offsets_free = [](void *p) { std::free(p); };
+    std::lock_guard<std::mutex> lk(s.stats_mutex);
+    ++s.stats.hinted;
+  }
+
+  s.pending.emplace_back(pts, std::move(frame));
+  x264_nal_t *nals = nullptr;
+  int nal_count = 0;
+  x264_picture_t out;
+  const int bytes = x264_encoder_encode(s.enc, &nals, &nal_count, &in, &out);
+  if (bytes < 0) s.pending.pop_back();
+  if (bytes <= 0) return false;
+  return s.Emit(out, nals, bytes, frame);
+#else
+  return false;
+#endif
+}
+
+void H264EncodeStage::Flush(PipelineContext &ctx, std::vector<PipelineFrame> &out) {
+  (void)ctx;
+#if defined(AUTOALG_HAVE_X264)
+  Impl &s = *impl_;
+  if (!s.enc) return;
+  while (x264_encoder_delayed_frames(s.enc) > 0) {
+    x264_nal_t *nals = nullptr;
+    int nal_count = 0;
+    x264_picture_t pic;
+    const int bytes = x264_encoder_encode(s.enc, &nals, &nal_count, nullptr, &pic);
+    if (bytes < 0) break;
+    PipelineFrame frame;
+    if (bytes > 0 && s.Emit(pic, nals, bytes, frame)) out.push_back(std::move(frame));
+  }
+  s.pending.clear();
+#else
+  (void)out;
+#endif
+}
+
+H264EncodeStage::Stats H264EncodeStage::GetStats() const {
+  std::lock_guard<std::mutex> lk(impl_->stats_mutex);
+  return impl_->stats;
+}
+
+}  // namespace autoalg
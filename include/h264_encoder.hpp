@@ -0,0 +1,116 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Software H.264 pipeline stage (libx264).
+//
+// H264EncodeStage encodes frame.nv12 (put there by an Nv12Stage fused with
+// the capture) into an Annex B payload: frame.payload, frame.keyframe. The
+// pooled NV12 planes are handed to x264 directly; the stage itself copies no
+// pixels. It asks for its own pipeline thread, so encoding never stalls the
+// capture.
+//
+// Screen content is mostly static, and the pipeline already knows what
+// changed:
+//   - Timestamps are the grab times (variable frame rate), so frames that
+//     never reach the encoder cost no bits and do not skew rate control.
+//   - A frame without any change (DiffStage with drop_static = false, or
+//     damage-driven capture) is not encoded at all, except once every
+//     static_keepalive_ms so a live decoder keeps advancing.
+//   - With dirty rects known, macroblocks outside them get static_qp_offset
+//     through x264's per-macroblock quantizer offsets: they become skips and
+//     the bits go to the regions that actually changed.
+//
+// Built with libx264 only when configured with -DAUTOALG_USE_X264=ON (x264
+// is GPL); otherwise Available() is false and every frame is dropped.
+// Everything runs offline: feed a FunctionSource and write the payloads to a
+// .h264 file (see demo/h264_encode_demo.cpp).
+//
+// Usage:
+//   int s = p.SetSource(std::make_unique<CaptureSource>(cap));
+//   DiffStage::Options diff;
+//   diff.drop_static = false;  // let the encoder see static frames (keepalive)
+//   s = p.Add(std::make_unique<DiffStage>(diff), s);
+//   s = p.Add(std::make_unique<Nv12Stage>(), s);
+//   s = p.Add(std::make_unique<H264EncodeStage>(), s);
+//   p.Add(std::make_unique<PublishStage>([&](const PipelineFrame& f) { send(*f.payload); }), s);
+
+#ifndef EASY_CONTROL_INCLUDE_H264_ENCODER_HPP
+#define EASY_CONTROL_INCLUDE_H264_ENCODER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pipeline.hpp"
+
+namespace autoalg {
+
+class H264EncodeStage : public PipelineStage {
+ public:
+  struct Options {
+    std::string preset = "veryfast";
+    std::string tune = "zerolatency";  // no frame delay; "" allows lookahead and B-frames
+    std::string profile = "high";
+    int bitrate_kbps = 0;   // 0: constant quality (crf)
+    float crf = 23.0f;
+    int vbv_max_kbps = 0;   // > 0: cap the bitrate over vbv_buffer_kb (streaming)
+    int vbv_buffer_kb = 0;  // 0: one second at vbv_max_kbps
+    int keyint = 300;       // max frames between keyframes
+    int threads = 0;        // x264 threads, 0 = auto
+    double fps = 60.0;      // nominal rate for x264's defaults; timestamps come from grab times
+
+    // Rate-control hints from dirty rects / static frames (see above).
+    bool use_dirty_hints = true;
+    float static_qp_offset = 10.0f;  // macroblocks outside the dirty rects
+    float dirty_qp_offset = 0.0f;    // macroblocks inside
+    bool skip_static = true;
+    int static_keepalive_ms = 1000;
+  };
+
+  struct Stats {
+    uint64_t encoded = 0;         // frames that produced a payload
+    uint64_t skipped_static = 0;  // unchanged frames not encoded
+    uint64_t hinted = 0;          // frames encoded with per-macroblock offsets
+    uint64_t keyframes = 0;
+    uint64_t bytes = 0;
+    uint64_t reopened = 0;        // encoder restarts after a size change
+  };
+
+  H264EncodeStage() : H264EncodeStage(Options{}) {}
+  explicit H264EncodeStage(const Options& options);
+  ~H264EncodeStage() override;
+
+  H264EncodeStage(const H264EncodeStage&) = delete;
+  H264EncodeStage& operator=(const H264EncodeStage&) = delete;
+
+  // False when built without libx264.
+  static bool Available();
+
+  const char* Kind() const override { return "h264"; }
+  // Returns false for frames that produced no payload yet: skipped static
+  // frames and, with lookahead, frames still inside the encoder (they come
+  // out with later calls or in Flush()). Frames held by the encoder when
+  // the size changes are dropped.
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+  void Flush(PipelineContext& ctx, std::vector<PipelineFrame>& out) override;
+  bool WantsOwnThread() const override { return true; }
+
+  // The next encoded frame is an IDR (e.g. a client joined). Any thread.
+  void ForceKeyframe() { force_keyframe_ = true; }
+
+  Stats GetStats() const;
+
+ private:
+  struct Impl;
+
+  Options options_;
+  std::unique_ptr<Impl> impl_;
+  std::atomic<bool> force_keyframe_{false};
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_H264_ENCODER_HPP
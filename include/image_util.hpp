@@ -0,0 +1,77 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Small header-only helpers for ScreenRect / ImageRGBA manipulation.
+
+#ifndef EASY_CONTROL_INCLUDE_IMAGE_UTIL_HPP
+#define EASY_CONTROL_INCLUDE_IMAGE_UTIL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "macro.h"
+#include "system_output.hpp"
+
+namespace autoalg {
+
+EC_INLINE bool RectEmpty(const ScreenRect &r) { return r.w <= 0 || r.h <= 0; }
+
+EC_INLINE int64_t RectArea(const ScreenRect &r) { return RectEmpty(r) ? 0 : static_cast<int64_t>(r.w) * r.h; }
+
+EC_INLINE ScreenRect IntersectRect(const ScreenRect &a, const ScreenRect &b) {
+  const int x0 = std::max(a.x, b.x);
+  const int y0 = std::max(a.y, b.y);
+  const int x1 = std::min(a.x + a.w, b.x + b.w);
+  const int y1 = std::min(a.y + a.h, b.y + b.h);
+  if (x1 <= x0 || y1 <= y0) return {};
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+// Bounding box of a and b (empty rects are ignored).
+EC_INLINE ScreenRect UnionRect(const ScreenRect &a, const ScreenRect &b) {
+  if (RectEmpty(a)) return b;
+  if (RectEmpty(b)) return a;
+  const int x0 = std::min(a.x, b.x);
+  const int y0 = std::min(a.y, b.y);
+  const int x1 = std::max(a.x + a.w, b.x + b.w);
+  const int y1 = std::max(a.y + a.h, b.y + b.h);
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+EC_INLINE bool RectContains(const ScreenRect &outer, const ScreenRect &inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+         inner.y + inner.h <= outer.y + outer.h;
+}
+
+// Clip r to [0, width) x [0, height).
+EC_INLINE ScreenRect ClipRect(const ScreenRect &r, int width, int height) {
+  return IntersectRect(r, ScreenRect{0, 0, width, height});
+}
+
+// Copy the pixels of r (clipped to src) into dst. Returns false if nothing remains.
+EC_INLINE bool CropImage(const ImageRGBA &src, const ScreenRect &r, ImageRGBA &dst) {
+  const ScreenRect c = ClipRect(r, src.width, src.height);
+  if (RectEmpty(c)) return false;
+  dst.width = c.w;
+  dst.height = c.h;
+  dst.input_seq = src.input_seq;
+  dst.grab_begin_ns = src.grab_begin_ns;
+  dst.grab_end_ns = src.grab_end_ns;
+  dst.pixels.resize(static_cast<size_t>(c.w) * c.h * 4);
+  const size_t src_stride = static_cast<size_t>(src.width) * 4;
+  const size_t row_bytes = static_cast<size_t>(c.w) * 4;
+  const uint8_t *sp = src.pixels.data() + static_cast<size_t>(c.y) * src_stride + static_cast<size_t>(c.x) * 4;
+  uint8_t *dp = dst.pixels.data();
+  for (int y = 0; y < c.h; ++y) {
+    std::memcpy(dp, sp, row_bytes);
+    sp += src_stride;
+    dp += row_bytes;
+  }
+  return true;
+}
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_IMAGE_UTIL_HPP
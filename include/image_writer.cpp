@@ -0,0 +1,536 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "image_writer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "deflate.hpp"
+
+#if defined(AUTOALG_HAVE_JPEG)
+extern "C" {
+#include <jpeglib.h>
+}
+#endif
+
+namespace autoalg {
+namespace {
+
+void PutBE32(std::vector<uint8_t> &out, uint32_t v) {
+  out.push_back(static_cast<uint8_t>(v >> 24));
+  out.push_back(static_cast<uint8_t>(v >> 16));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+bool ImageValid(const ImageRGBA &image) {
+  return image.width > 0 && image.height > 0 &&
+         image.pixels.size() >= static_cast<size_t>(image.width) * image.height * 4;
+}
+
+// ---------------------------------------------------------------------------
+// Checksums
+
+const std::array<uint32_t, 256> &CrcTable() {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Running CRC-32 (no final xor); start with 0xFFFFFFFF, finish with ~crc.
+uint32_t CrcUpdate(uint32_t crc, const uint8_t *data, size_t size) {
+  const std::array<uint32_t, 256> &t = CrcTable();
+  for (size_t i = 0; i < size; ++i) crc = t[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+constexpr uint32_t kAdlerBase = 65521;
+
+uint32_t Adler32(const uint8_t *data, size_t size) {
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    // 5552: the most bytes before b can overflow 32 bits.
+    const size_t n = std::min<size_t>(size, 5552);
+    for (size_t i = 0; i < n; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= kAdlerBase;
+    b %= kAdlerBase;
+    data += n;
+    size -= n;
+  }
+  return (b << 16) | a;
+}
+
+// Adler-32 of A followed by B, from adler(A), adler(B) and len(B) (zlib's adler32_combine).
+uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, uint64_t len2) {
+  const uint32_t rem = static_cast<uint32_t>(len2 % kAdlerBase);
+  uint32_t sum1 = adler1 & 0xFFFF;
+  uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % kAdlerBase);
+  sum1 += (adler2 & 0xFFFF) + kAdlerBase - 1;
+  sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + kAdlerBase - rem;
+  if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+  if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+  if (sum2 >= (kAdlerBase << 1)) sum2 -= (kAdlerBase << 1);
+  if (sum2 >= kAdlerBase) sum2 -= kAdlerBase;
+  return (sum2 << 16) | sum1;
+}
+
+// ---------------------------------------------------------------------------
+// PNG
+
+int Paeth(int a, int b, int c) {
+  const int p = a + b - c;
+  const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+void PackRow(const ImageRGBA &image, int y, int channels, uint8_t *dst) {
+  const uint8_t *src = &image.pixels[static_cast<size_t>(y) * image.width * 4];
+  if (channels == 4) {
+    std::memcpy(dst, src, static_cast<size_t>(image.width) * 4);
+    return;
+  }
+  for (int x = 0; x < image.width; ++x, src += 4, dst += 3) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    dst[2] = src[2];
+  }
+}
+
+template <int kFilter>
+uint64_t ApplyFilter(const uint8_t *cur, const uint8_t *up, size_t row_bytes, int bpp, uint8_t *dst) {
+  uint64_t cost = 0;
+  for (size_t i = 0; i < row_bytes; ++i) {
+    const bool has_left = i >= static_cast<size_t>(bpp);
+    int pred = 0;
+    if (kFilter == 1) pred = has_left ? cur[i - bpp] : 0;
+    if (kFilter == 2) pred = up[i];
+    if (kFilter == 3) pred = ((has_left ? cur[i - bpp] : 0) + up[i]) >> 1;
+    if (kFilter == 4) pred = Paeth(has_left ? cur[i - bpp] : 0, up[i], has_left ? up[i - bpp] : 0);
+    const uint8_t r = static_cast<uint8_t>(cur[i] - pred);
+    dst[i] = r;
+    cost += r < 128 ? r : 256 - r;
+  }
+  return cost;
+}
+
+// Filter one row with each of the five PNG filters and keep the one with the
+// smallest sum of absolute (signed) residuals, the usual heuristic.
+void FilterRow(const uint8_t *cur, const uint8_t *up, size_t row_bytes, int bpp, uint8_t *dst,
+               std::vector<uint8_t> &scratch) {
+  using Fn = uint64_t (*)(const uint8_t *, const uint8_t *, size_t, int, uint8_t *);
+  static const Fn kFilters[5] = {ApplyFilter<0>, ApplyFilter<1>, ApplyFilter<2>, ApplyFilter<3>, ApplyFilter<4>};
+  scratch.resize(row_bytes);
+  uint64_t best_cost = kFilters[0](cur, up, row_bytes, bpp, dst + 1);
+  dst[0] = 0;
+  for (int f = 1; f < 5 && best_cost > 0; ++f) {
+    const uint64_t cost = kFilters[f](cur, up, row_bytes, bpp, scratch.data());
+    if (cost < best_cost) {
+      best_cost = cost;
+      dst[0] = static_cast<uint8_t>(f);
+      std::memcpy(dst + 1, scratch.data(), row_bytes);
+    }
+  }
+}
+
+void PutChunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size) {
+  PutBE32(out, static_cast<uint32_t>(size));
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  if (size) out.insert(out.end(), data, data + size);
+  PutBE32(out, ~CrcUpdate(0xFFFFFFFFu, &out[start], out.size() - start));
+}
+
+// ---------------------------------------------------------------------------
+// QOI (qoiformat.org)
+
+struct QoiPixel {
+  uint8_t r, g, b, a;
+};
+
+int QoiHash(const QoiPixel &p) { return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) & 63; }
+
+// ---------------------------------------------------------------------------
+// JPEG
+
+#if defined(AUTOALG_HAVE_JPEG)
+struct JpegError {
+  jpeg_error_mgr pub;
+  std::jmp_buf jump;
+};
+
+// Destination manager appending to a std::vector (jpeg_mem_dest is not in every libjpeg).
+struct JpegSink {
+  jpeg_destination_mgr pub;
+  std::vector<uint8_t> *out;
+  uint8_t buffer[65536];
+};
+
+void JpegInitDest(j_compress_ptr cinfo) {
+  JpegSink *sink = reinterpret_cast<JpegSink *>(cinfo->dest);
+  sink->pub.next_output_byte = sink->buffer;
+  sink->pub.free_in_buffer = sizeof(sink->buffer);
+}
+
+boolean JpegEmptyBuffer(j_compress_ptr cinfo) {
+  JpegSink *sink = reinterpret_cast<JpegSink *>(cinfo->dest);
+  sink->out->insert(sink->out->end(), sink->buffer, sink->buffer + sizeof(sink->buffer));
+  sink->pub.next_output_byte = sink->buffer;
+  sink->pub.free_in_buffer = sizeof(sink->buffer);
+  return TRUE;
+}
+
+void JpegTermDest(j_compress_ptr cinfo) {
+  JpegSink *sink = reinterpret_cast<JpegSink *>(cinfo->dest);
+  sink->out->insert(sink->out->end(), sink->buffer, sink->buffer + (sizeof(sink->buffer) - sink->pub.free_in_buffer));
+}
+
+void JpegErrorExit(j_common_ptr cinfo) { std::longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1); }
+
+void JpegSilence(j_common_ptr) {}
+#endif
+
+}  // namespace
+
+bool EncodeQOI(const ImageRGBA &image, std::vector<uint8_t> &out, bool keep_alpha) {
+  out.clear();
+  if (!ImageValid(image)) return false;
+  const size_t count = static_cast<size_t>(image.width) * image.height;
+  out.reserve(14 + count + 8);  // usually far smaller than the worst case
+  out.insert(out.end(), {'q', 'o', 'i', 'f'});
+  PutBE32(out, static_cast<uint32_t>(image.width));
+  PutBE32(out, static_cast<uint32_t>(image.height));
+  out.push_back(keep_alpha ? 4 : 3);
+  out.push_back(0);  // sRGB with linear alpha
+
+  QoiPixel index[64] = {};
+  QoiPixel prev{0, 0, 0, 255};
+  int run = 0;
+  const uint8_t *p = image.pixels.data();
+  for (size_t i = 0; i < count; ++i, p += 4) {
+    const QoiPixel px{p[0], p[1], p[2], keep_alpha ? p[3] : uint8_t{255}};
+    if (std::memcmp(&px, &prev, sizeof(px)) == 0) {
+      if (++run == 62) {
+        out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+      run = 0;
+    }
+    const int h = QoiHash(px);
+    if (std::memcmp(&index[h], &px, sizeof(px)) == 0) {
+      out.push_back(static_cast<uint8_t>(h));
+    } else {
+      index[h] = px;
+      if (px.a == prev.a) {
+        const int dr = static_cast<int8_t>(px.r - prev.r);
+        const int dg = static_cast<int8_t>(px.g - prev.g);
+        const int db = static_cast<int8_t>(px.b - prev.b);
+        const int dr_dg = dr - dg, db_dg = db - dg;
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          out.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+          out.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+          out.push_back(static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8)));
+        } else {
+          out.insert(out.end(), {0xFE, px.r, px.g, px.b});
+        }
+      } else {
+        out.insert(out.end(), {0xFF, px.r, px.g, px.b, px.a});
+      }
+    }
+    prev = px;
+  }
+  if (run > 0) out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+  out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+  return true;
+}
+
+bool EncodePNG(const ImageRGBA &image, std::vector<uint8_t> &out, const ImageWriteOptions &options) {
+  out.clear();
+  if (!ImageValid(image)) return false;
+  const int channels = options.keep_alpha ? 4 : 3;
+  const size_t row_bytes = static_cast<size_t>(image.width) * channels;
+  // ~256 KB of filtered rows per block: enough for LZ77 to find its matches,
+  // small enough to keep every pool thread busy on a 1080p frame.
+  const int rows_per_block = static_cast<int>(std::max<size_t>(1, (256 * 1024) / (row_bytes + 1)));
+  const int blocks = (image.height + rows_per_block - 1) / rows_per_block;
+
+  struct Block {
+    std::vector<uint8_t> data;  // "IDAT" + deflate piece (zlib header first in block 0)
+    uint32_t adler = 1;
+    uint64_t raw_size = 0;
+    uint32_t crc = 0;  // running, over data
+  };
+  std::vector<Block> parts(blocks);
+  const auto encode_blocks = [&](int64_t b0, int64_t b1) {
+    std::vector<uint8_t> cur(row_bytes), up(row_bytes), filtered, scratch;
+    for (int64_t b = b0; b < b1; ++b) {
+      const int y0 = static_cast<int>(b) * rows_per_block;
+      const int y1 = std::min(image.height, y0 + rows_per_block);
+      filtered.resize(static_cast<size_t>(y1 - y0) * (row_bytes + 1));
+      if (y0 > 0) PackRow(image, y0 - 1, channels, up.data());
+      else std::fill(up.begin(), up.end(), 0);
+      for (int y = y0; y < y1; ++y) {
+        PackRow(image, y, channels, cur.data());
+        FilterRow(cur.data(), up.data(), row_bytes, channels, &filtered[(y - y0) * (row_bytes + 1)], scratch);
+        std::swap(cur, up);
+      }
+      Block &part = parts[b];
+      part.adler = Adler32(filtered.data(), filtered.size());
+      part.raw_size = filtered.size();
+      part.data.assign({'I', 'D', 'A', 'T'});
+      if (b == 0) part.data.insert(part.data.end(), {0x78, 0x9C});
+      DeflateRaw(filtered.data(), filtered.size(), options.png_level, b == blocks - 1, part.data);
+      part.crc = CrcUpdate(0xFFFFFFFFu, part.data.data(), part.data.size());
+    }
+  };
+  ThreadPool &pool = options.pool ? *options.pool : ThreadPool::Shared();
+  if (blocks > 1) pool.ParallelFor(0, blocks, 1, encode_blocks);
+  else encode_blocks(0, blocks);
+
+  uint32_t adler = parts[0].adler;
+  for (int b = 1; b < blocks; ++b) adler = Adler32Combine(adler, parts[b].adler, parts[b].raw_size);
+  Block &last = parts.back();
+  const size_t adler_at = last.data.size();
+  PutBE32(last.data, adler);
+  last.crc = CrcUpdate(last.crc, &last.data[adler_at], 4);
+
+  size_t total = 8 + 25 + 12;
+  for (const Block &part : parts) total += part.data.size() + 8;
+  out.reserve(total);
+  out.insert(out.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+  uint8_t ihdr[13];
+  ihdr[0] = static_cast<uint8_t>(image.width >> 24);
+  ihdr[1] = static_cast<uint8_t>(image.width >> 16);
+  ihdr[2] = static_cast<uint8_t>(image.width >> 8);
+  ihdr[3] = static_cast<uint8_t>(image.width);
+  ihdr[4] = static_cast<uint8_t>(image.height >> 24);
+  ihdr[5] = static_cast<uint8_t>(image.height >> 16);
+  ihdr[6] = static_cast<uint8_t>(image.height >> 8);
+  ihdr[7] = static_cast<uint8_t>(image.height);
+  ihdr[8] = 8;                        // bit depth
+  ihdr[9] = options.keep_alpha ? 6 : 2;  // RGBA : RGB
+  ihdr[10] = ihdr[11] = ihdr[12] = 0;    // deflate, adaptive filtering, no interlace
+  PutChunk(out, "IHDR", ihdr, sizeof(ihdr));
+  for (const Block &part : parts) {
+    PutBE32(out, static_cast<uint32_t>(part.data.size() - 4));
+    out.insert(out.end(), part.data.begin(), part.data.end());
+    PutBE32(out, ~part.crc);
+  }
+  PutChunk(out, "IEND", nullptr, 0);
+  return true;
+}
+
+bool EncodeJPEG(const ImageRGBA &image, std::vector<uint8_t> &out, int quality) {
+  out.clear();
+  if (!ImageValid(image)) return false;
+#if defined(AUTOALG_HAVE_JPEG)
+  jpeg_compress_struct cinfo;
+  JpegError err;
+  JpegSink sink;
+  std::vector<uint8_t> row;  // RGB row when libjpeg cannot read RGBA directly
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = JpegErrorExit;
+  err.pub.output_message = JpegSilence;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_compress(&cinfo);
+    out.clear();
+    return false;
+  }
+  jpeg_create_compress(&cinfo);
+  sink.out = &out;
+  sink.pub.init_destination = JpegInitDest;
+  sink.pub.empty_output_buffer = JpegEmptyBuffer;
+  sink.pub.term_destination = JpegTermDest;
+  cinfo.dest = &sink.pub;
+
+  cinfo.image_width = static_cast<JDIMENSION>(image.width);
+  cinfo.image_height = static_cast<JDIMENSION>(image.height);
+#if defined(JCS_EXTENSIONS)
+  cinfo.input_components = 4;
+  cinfo.in_color_space = JCS_EXT_RGBX;
+#else
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  row.resize(static_cast<size_t>(image.width) * 3);
+#endif
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, std::max(1, std::min(100, quality)), TRUE);
+  cinfo.dct_method = JDCT_ISLOW;
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t *src = &image.pixels[static_cast<size_t>(cinfo.next_scanline) * image.width * 4];
+    JSAMPROW line = const_cast<JSAMPROW>(src);
+    if (!row.empty()) {
+      PackRow(image, static_cast<int>(cinfo.next_scanline), 3, row.data());
+      line = row.data();
+    }
+    jpeg_write_scanlines(&cinfo, &line, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return true;
+#else
+  (void)quality;
+  return false;
+#endif
+}
+
+bool EncodeImage(const ImageRGBA &image, std::vector<uint8_t> &out, const ImageWriteOptions &options) {
+  switch (options.format) {
+    case ImageWriteOptions::kPNG:
+      return EncodePNG(image, out, options);
+    case ImageWriteOptions::kJPEG:
+      return EncodeJPEG(image, out, options.jpeg_quality);
+    case ImageWriteOptions::kQOI:
+    case ImageWriteOptions::kAuto:
+    default:
+      return EncodeQOI(image, out, options.keep_alpha);
+  }
+}
+
+ImageWriteOptions::Format ImageFormatForPath(const std::string &path) {
+  const size_t dot = path.find_last_of('.');
+  const size_t slash = path.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return ImageWriteOptions::kQOI;
+  std::string ext = path.substr(dot + 1);
+  for (char &c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  if (ext == "png") return ImageWriteOptions::kPNG;
+  if (ext == "jpg" || ext == "jpeg") return ImageWriteOptions::kJPEG;
+  return ImageWriteOptions::kQOI;
+}
+
+namespace {
+
+bool WriteFile(const std::string &path, const std::vector<uint8_t> &data) {
+  std::FILE *fp = std::fopen(path.c_str(), "wb");
+  if (!fp) return false;
+  const bool ok = std::fwrite(data.data(), 1, data.size(), fp) == data.size();
+  return std::fclose(fp) == 0 && ok;
+}
+
+bool EncodeForPath(const std::string &path, const ImageRGBA &image, ImageWriteOptions options,
+                   std::vector<uint8_t> &out) {
+  if (options.format == ImageWriteOptions::kAuto) options.format = ImageFormatForPath(path);
+  return EncodeImage(image, out, options);
+}
+
+}  // namespace
+
+bool WriteImage(const std::string &path, const ImageRGBA &image, const ImageWriteOptions &options) {
+  std::vector<uint8_t> data;
+  return EncodeForPath(path, image, options, data) && WriteFile(path, data);
+}
+
+// ---------------------------------------------------------------------------
+// AsyncImageWriter
+
+AsyncImageWriter::AsyncImageWriter() : AsyncImageWriter(Options{}) {}
+
+AsyncImageWriter::AsyncImageWriter(const Options &options) : options_(options) {
+  options_.max_pending = std::max<size_t>(1, options_.max_pending);
+  if (options_.thread.name.empty()) options_.thread.name = "ec-img-writer";
+  thread_ = std::thread(&AsyncImageWriter::Loop_, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  idle_cv_.notify_all();
+  thread_.join();
+}
+
+bool AsyncImageWriter::Save(std::string path, std::shared_ptr<const ImageRGBA> image) {
+  if (!image) return false;
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (queue_.size() >= options_.max_pending) {
+    if (options_.drop_when_full) {
+      ++stats_.dropped;
+      return false;
+    }
+    idle_cv_.wait(lk, [&] { return stop_ || queue_.size() < options_.max_pending; });
+    if (stop_) return false;
+  }
+  queue_.push_back(Job{std::move(path), std::move(image)});
+  ++stats_.queued;
+  lk.unlock();
+  cv_.notify_one();
+  return true;
+}
+
+bool AsyncImageWriter::Save(std::string path, const ImageRGBA &image) {
+  {
+    // Don't pay for the copy when it would be dropped anyway.
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (options_.drop_when_full && queue_.size() >= options_.max_pending) {
+      ++stats_.dropped;
+      return false;
+    }
+  }
+  return Save(std::move(path), std::make_shared<const ImageRGBA>(image));
+}
+
+void AsyncImageWriter::Flush() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  idle_cv_.wait(lk, [&] { return queue_.empty() && !busy_; });
+}
+
+AsyncImageWriter::Stats AsyncImageWriter::GetStats() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return stats_;
+}
+
+void AsyncImageWriter::Loop_() {
+  ApplyThreadConfig(options_.thread);
+  std::vector<uint8_t> data;  // reused across files
+  std::unique_lock<std::mutex> lk(mutex_);
+  for (;;) {
+    cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;  // stopping and drained
+    Job job = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    lk.unlock();
+    idle_cv_.notify_all();  // room for a blocked Save()
+
+    const bool ok = EncodeForPath(job.path, *job.image, options_.write, data) && WriteFile(job.path, data);
+    job.image.reset();  // back to its pool before reporting
+
+    lk.lock();
+    busy_ = false;
+    if (ok) {
+      ++stats_.written;
+      stats_.bytes += data.size();
+    } else {
+      ++stats_.failed;
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+}  // namespace autoalg
@@ -0,0 +1,120 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Backend-independent description of an input macro.
+//
+// Hotkey-heavy callers (RTS control groups, queued commands, ...) repeat the
+// same short key/mouse sequences many times. Describe a sequence once with
+// InputMacro, compile it with SystemInput::CompileMacro() into the backend's
+// native event buffer (XTest op list, uinput input_event array, Win32 INPUT
+// array) and replay it with SystemInput::ReplayMacro(), which submits the
+// whole buffer at once. Coordinates may be parameters that are patched in
+// at replay time.
+//
+// Usage:
+//   InputMacro m;
+//   m.KeyDown(shift).ClickAt(InputMacro::Param(0), InputMacro::Param(1), SystemInput::kRight).KeyUp(shift);
+//   auto compiled = input.CompileMacro(m);
+//   input.ReplayMacro(compiled, {x, y});
+
+#ifndef EASY_CONTROL_INCLUDE_INPUT_MACRO_HPP
+#define EASY_CONTROL_INCLUDE_INPUT_MACRO_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace autoalg {
+
+class InputMacro {
+ public:
+  // A coordinate: either a constant or the index of a replay parameter.
+  struct Coord {
+    int value = 0;
+    int param = -1;
+    Coord(int v = 0) : value(v) {}  // implicit: constants read naturally
+  };
+
+  static Coord Param(int index) {
+    Coord c;
+    c.param = index;
+    return c;
+  }
+
+  struct Op {
+    enum Kind : int { kMove = 0, kButton, kKey, kScroll, kDelay };
+    Kind kind = kMove;
+    Coord x, y;          // kMove: position; kScroll: (dx, dy) constants
+    int code = 0;        // kButton: SystemInput::MouseButton; kKey: platform key code
+    bool press = false;  // kButton / kKey
+    uint64_t mods = 0;   // kKey: SystemInput::Mod mask, pressed before / released after the key
+    int ms = 0;          // kDelay
+  };
+
+  InputMacro& MoveTo(Coord x, Coord y) {
+    Op op;
+    op.kind = Op::kMove;
+    op.x = x;
+    op.y = y;
+    return Push_(op);
+  }
+  InputMacro& ButtonDown(int button) { return Button_(button, true); }
+  InputMacro& ButtonUp(int button) { return Button_(button, false); }
+  InputMacro& Click(int button) { return ButtonDown(button).ButtonUp(button); }
+  InputMacro& ClickAt(Coord x, Coord y, int button) { return MoveTo(x, y).Click(button); }
+
+  InputMacro& KeyDown(int key, uint64_t mods = 0) { return Key_(key, true, mods); }
+  InputMacro& KeyUp(int key, uint64_t mods = 0) { return Key_(key, false, mods); }
+  InputMacro& KeyClick(int key, uint64_t mods = 0) { return KeyDown(key, mods).KeyUp(key, mods); }
+
+  InputMacro& Scroll(int dx, int dy) {
+    Op op;
+    op.kind = Op::kScroll;
+    op.x = dx;
+    op.y = dy;
+    return Push_(op);
+  }
+
+  InputMacro& Delay(int ms) {
+    Op op;
+    op.kind = Op::kDelay;
+    op.ms = std::max(0, ms);
+    return Push_(op);
+  }
+
+  const std::vector<Op>& Ops() const { return ops_; }
+  bool Empty() const { return ops_.empty(); }
+
+  // Number of replay parameters referenced (highest index + 1).
+  int ParamCount() const { return param_count_; }
+
+ private:
+  InputMacro& Button_(int button, bool press) {
+    Op op;
+    op.kind = Op::kButton;
+    op.code = button;
+    op.press = press;
+    return Push_(op);
+  }
+  InputMacro& Key_(int key, bool press, uint64_t mods) {
+    Op op;
+    op.kind = Op::kKey;
+    op.code = key;
+    op.press = press;
+    op.mods = mods;
+    return Push_(op);
+  }
+  InputMacro& Push_(const Op& op) {
+    param_count_ = std::max({param_count_, op.x.param + 1, op.y.param + 1});
+    ops_.push_back(op);
+    return *this;
+  }
+
+  std::vector<Op> ops_;
+  int param_count_ = 0;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_INPUT_MACRO_HPP
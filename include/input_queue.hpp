@@ -0,0 +1,410 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Thread-safe input command queue with coalescing, priority lanes and deadlines.
+//
+// Remote clients deliver mouse motion in bursts; replaying every sample
+// through SystemInput only adds latency once the injector falls behind.
+// Push() merges a command into the tail of the queue when that is lossless
+// for the final state:
+//   - consecutive absolute moves keep only the last position,
+//   - consecutive relative moves and scrolls sum their deltas.
+// Merging only ever touches the tail of a device lane, so a move is never
+// reordered across a button of the same pointer.
+//
+// Commands are kept in one FIFO per device (pointer, keyboard) and come out
+// in arrival order, except that a discrete command (click, key, text) skips
+// ahead of continuous motion (move, scroll) queued on another device, so a
+// key press does not wait behind a long drag. Motion pushed while a key or
+// button of the other device was held is never overtaken by that device:
+// KeyDown(Ctrl), Scroll, KeyUp(Ctrl) still scrolls with Ctrl held, and
+// Shift+move keeps Shift. Continuous commands may carry a deadline (or get
+// Options::motion_ttl); once stale they are dropped or folded when a later
+// command in the same lane reaches the same final state.
+//
+// Usage:
+//   InputQueue q;
+//   q.Push(InputCommand::MoveTo(100, 200));  // network thread
+//   InputCommand cmd;
+//   while (q.WaitPop(cmd, std::chrono::milliseconds(5))) ApplyInputCommand(input, cmd);  // injector thread
+
+#ifndef EASY_CONTROL_INCLUDE_INPUT_QUEUE_HPP
+#define EASY_CONTROL_INCLUDE_INPUT_QUEUE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "system_input.hpp"
+
+namespace autoalg {
+
+struct InputCommand {
+  // 注意：避免使用 KeyPress/KeyRelease，它们是 X11 的宏定义
+  enum Type : int {
+    kMouseMove = 0,      // absolute (x, y)
+    kMouseMoveRelative,  // (dx, dy)
+    kMouseDown,          // button at (x, y)
+    kMouseUp,            // button at (x, y)
+    kMouseClick,         // button at (x, y)
+    kMouseDrag,          // drag button from the current position to (x, y)
+    kKeyDown,            // key + mods
+    kKeyUp,              // key + mods
+    kScroll,             // (dx, dy) in lines
+    kText                // UTF-8 text
+  };
+
+  Type type = kMouseMove;
+  int x = 0, y = 0;
+  int dx = 0, dy = 0;
+  int button = SystemInput::kLeft;
+  int key = 0;
+  uint64_t mods = SystemInput::kNone;
+  std::string text;
+
+  // Continuous commands (moves, scrolls) still queued after this point are
+  // stale and may be dropped or folded; discrete commands never expire.
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+  bool IsContinuous() const { return type == kMouseMove || type == kMouseMoveRelative || type == kScroll; }
+
+  // Copy of this command that goes stale after ttl.
+  InputCommand WithTimeout(std::chrono::milliseconds ttl) const {
+    InputCommand c = *this;
+    c.deadline = std::chrono::steady_clock::now() + ttl;
+    return c;
+  }
+
+  static InputCommand MoveTo(int x, int y) {
+    InputCommand c;
+    c.type = kMouseMove;
+    c.x = x;
+    c.y = y;
+    return c;
+  }
+  static InputCommand MoveBy(int dx, int dy) {
+    InputCommand c;
+    c.type = kMouseMoveRelative;
+    c.dx = dx;
+    c.dy = dy;
+    return c;
+  }
+  static InputCommand Button(Type type, int x, int y, int button) {
+    InputCommand c;
+    c.type = type;
+    c.x = x;
+    c.y = y;
+    c.button = button;
+    return c;
+  }
+  static InputCommand Key(Type type, int key, uint64_t mods = SystemInput::kNone) {
+    InputCommand c;
+    c.type = type;
+    c.key = key;
+    c.mods = mods;
+    return c;
+  }
+  static InputCommand Scroll(int dx, int dy) {
+    InputCommand c;
+    c.type = kScroll;
+    c.dx = dx;
+    c.dy = dy;
+    return c;
+  }
+  static InputCommand Text(std::string utf8) {
+    InputCommand c;
+    c.type = kText;
+    c.text = std::move(utf8);
+    return c;
+  }
+};
+
+// Inject one command.
+EC_INLINE void ApplyInputCommand(SystemInput& input, const InputCommand& cmd) {
+  switch (cmd.type) {
+    case InputCommand::kMouseMove:
+      input.MouseMoveTo(cmd.x, cmd.y);
+      break;
+    case InputCommand::kMouseMoveRelative:
+      input.MouseMoveRelative(cmd.dx, cmd.dy);
+      break;
+    case InputCommand::kMouseDown:
+      input.MouseDownAt(cmd.x, cmd.y, cmd.button);
+      break;
+    case InputCommand::kMouseUp:
+      input.MouseUpAt(cmd.x, cmd.y, cmd.button);
+      break;
+    case InputCommand::kMouseClick:
+      input.MouseClickAt(cmd.x, cmd.y, cmd.button);
+      break;
+    case InputCommand::kMouseDrag:
+      input.MouseDragTo(cmd.x, cmd.y, cmd.button);
+      break;
+    case InputCommand::kKeyDown:
+      if (cmd.mods != SystemInput::kNone) {
+        input.KeyboardDownWithMods(cmd.key, cmd.mods);
+      } else {
+        input.KeyboardDown(cmd.key);
+      }
+      break;
+    case InputCommand::kKeyUp:
+      if (cmd.mods != SystemInput::kNone) {
+        input.KeyboardUpWithMods(cmd.key, cmd.mods);
+      } else {
+        input.KeyboardUp(cmd.key);
+      }
+      break;
+    case InputCommand::kScroll:
+      input.ScrollLines(cmd.dx, cmd.dy);
+      break;
+    case InputCommand::kText:
+      input.TypeUTF8(cmd.text);
+      break;
+  }
+}
+
+class InputQueue {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    // Deadline given to continuous commands pushed without one (0 = never stale).
+    std::chrono::milliseconds motion_ttl{0};
+  };
+
+  InputQueue() = default;
+  explicit InputQueue(const Options& options) : options_(options) {}
+  InputQueue(const InputQueue&) = delete;
+  InputQueue& operator=(const InputQueue&) = delete;
+
+  EC_INLINE void Push(InputCommand cmd) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++pushed_;
+      if (cmd.IsContinuous() && cmd.deadline == Clock::time_point::max() && options_.motion_ttl.count() > 0) {
+        cmd.deadline = Clock::now() + options_.motion_ttl;
+      }
+      const int l = LaneOf_(cmd.type);
+      std::deque<Entry>& lane = lanes_[l];
+      uint32_t held = 0;
+      if (cmd.IsContinuous()) {
+        for (int i = 0; i < kLaneCount; ++i) {
+          if (i != l && !held_[i].empty()) held |= 1u << i;
+        }
+      } else {
+        TrackHeld_(l, cmd);
+      }
+      if (!lane.empty() && lane.back().held_lanes == held && TryMerge_(lane.back().cmd, cmd)) {
+        ++coalesced_;
+        return;  // the consumer is already woken for the tail
+      }
+      lane.push_back(Entry{next_seq_++, held, std::move(cmd)});
+    }
+    cv_.notify_one();
+  }
+
+  EC_INLINE bool Pop(InputCommand& cmd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return PopLocked_(cmd, Clock::now());
+  }
+
+  // Wait up to timeout for a command. Returns false on timeout or after Close().
+  template <class Rep, class Period>
+  bool WaitPop(InputCommand& cmd, std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_for(lock, timeout, [&] { return !EmptyLocked_() || closed_; });
+    return PopLocked_(cmd, Clock::now());
+  }
+
+  // Wake every waiter; later WaitPop() calls return immediately when empty.
+  EC_INLINE void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  EC_INLINE void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& lane : lanes_) lane.clear();
+  }
+
+  EC_INLINE size_t Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& lane : lanes_) n += lane.size();
+    return n;
+  }
+
+  // Commands accepted by Push() / commands folded into another one / stale
+  // absolute moves dropped because a later pointer command superseded them.
+  EC_INLINE uint64_t PushedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pushed_;
+  }
+  EC_INLINE uint64_t CoalescedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return coalesced_;
+  }
+  EC_INLINE uint64_t DroppedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+  }
+
+ private:
+  // One FIFO per device; order inside a lane is never changed.
+  enum Lane : int { kPointerLane = 0, kKeyboardLane, kLaneCount };
+
+  struct Entry {
+    uint64_t seq = 0;         // arrival order across lanes
+    uint32_t held_lanes = 0;  // continuous: bit i set if lane i had a key / button down at push
+    InputCommand cmd;
+  };
+
+  EC_INLINE static int LaneOf_(InputCommand::Type type) {
+    switch (type) {
+      case InputCommand::kKeyDown:
+      case InputCommand::kKeyUp:
+      case InputCommand::kText:
+        return kKeyboardLane;
+      default:
+        return kPointerLane;
+    }
+  }
+
+  // Keys / buttons a lane's pushed commands leave held (in push order).
+  EC_INLINE void TrackHeld_(int lane, const InputCommand& cmd) {
+    std::vector<int>& held = held_[lane];
+    const bool down = cmd.type == InputCommand::kKeyDown || cmd.type == InputCommand::kMouseDown;
+    const bool up = cmd.type == InputCommand::kKeyUp || cmd.type == InputCommand::kMouseUp;
+    if (!down && !up) return;
+    const int id = lane == kKeyboardLane ? cmd.key : cmd.button;
+    auto it = std::find(held.begin(), held.end(), id);
+    if (down && it == held.end()) held.push_back(id);
+    if (up && it != held.end()) held.erase(it);
+  }
+
+  // Commands that place the pointer at absolute coordinates. Not kMouseDrag:
+  // a drag starts from the current pointer, so the move before it matters.
+  EC_INLINE static bool IsPositioned_(InputCommand::Type type) {
+    switch (type) {
+      case InputCommand::kMouseMove:
+      case InputCommand::kMouseDown:
+      case InputCommand::kMouseUp:
+      case InputCommand::kMouseClick:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  EC_INLINE static bool TryMerge_(InputCommand& tail, const InputCommand& cmd) {
+    if (tail.type != cmd.type) return false;
+    switch (cmd.type) {
+      case InputCommand::kMouseMove:
+        tail.x = cmd.x;
+        tail.y = cmd.y;
+        break;
+      case InputCommand::kMouseMoveRelative:
+      case InputCommand::kScroll:
+        tail.dx += cmd.dx;
+        tail.dy += cmd.dy;
+        break;
+      default:
+        return false;
+    }
+    tail.deadline = cmd.deadline;  // the merged command is as fresh as its newest sample
+    return true;
+  }
+
+  // Drop / fold stale motion at the head of a lane. Only continuous commands
+  // expire, and only when the rest of the lane still reaches the same state:
+  //   - an absolute move followed by another positioned command is dropped,
+  //   - a relative move / scroll is folded into the next one of its kind
+  //     pushed with the same keys held.
+  EC_INLINE void ExpireHead_(std::deque<Entry>& lane, Clock::time_point now) {
+    while (lane.size() >= 2) {
+      InputCommand& head = lane.front().cmd;
+      InputCommand& next = lane[1].cmd;
+      if (!head.IsContinuous() || now <= head.deadline) return;
+      if (head.type == InputCommand::kMouseMove && IsPositioned_(next.type)) {
+        ++dropped_;
+      } else if (head.type != InputCommand::kMouseMove && head.type == next.type &&
+                 lane.front().held_lanes == lane[1].held_lanes) {
+        next.dx += head.dx;
+        next.dy += head.dy;
+        ++coalesced_;
+      } else {
+        return;
+      }
+      lane.pop_front();
+    }
+  }
+
+  EC_INLINE static uint64_t FirstDiscreteSeq_(const std::deque<Entry>& lane) {
+    for (const Entry& e : lane) {
+      if (!e.cmd.IsContinuous()) return e.seq;
+    }
+    return UINT64_MAX;
+  }
+
+  // Whether lane b's head should be served before lane a's head. Lanes go in
+  // arrival order, except that a discrete head (click, key, text) overtakes
+  // continuous motion of another lane. It never overtakes an earlier discrete
+  // command, so e.g. Ctrl stays held until a Ctrl+drag releases its button,
+  // nor motion pushed while a key / button of its own lane was held, so a
+  // key-up can't pull the modifier out from under a scroll or move.
+  EC_INLINE bool ServeBefore_(int a, int b) const {
+    const Entry& ha = lanes_[a].front();
+    const Entry& hb = lanes_[b].front();
+    const bool a_jumps = !ha.cmd.IsContinuous() && hb.cmd.IsContinuous() && !(hb.held_lanes & (1u << a)) &&
+                         ha.seq < FirstDiscreteSeq_(lanes_[b]);
+    const bool b_jumps = !hb.cmd.IsContinuous() && ha.cmd.IsContinuous() && !(ha.held_lanes & (1u << b)) &&
+                         hb.seq < FirstDiscreteSeq_(lanes_[a]);
+    if (a_jumps != b_jumps) return b_jumps;
+    return hb.seq < ha.seq;
+  }
+
+  EC_INLINE bool PopLocked_(InputCommand& cmd, Clock::time_point now) {
+    int best = -1;
+    for (int i = 0; i < kLaneCount; ++i) {
+      ExpireHead_(lanes_[i], now);
+      if (lanes_[i].empty()) continue;
+      if (best < 0 || ServeBefore_(best, i)) best = i;
+    }
+    if (best < 0) return false;
+    cmd = std::move(lanes_[best].front().cmd);
+    lanes_[best].pop_front();
+    return true;
+  }
+
+  EC_INLINE bool EmptyLocked_() const {
+    for (const auto& lane : lanes_) {
+      if (!lane.empty()) return false;
+    }
+    return true;
+  }
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Entry> lanes_[kLaneCount];
+  std::vector<int> held_[kLaneCount];  // keys / buttons held after the commands pushed so far
+  uint64_t next_seq_{0};
+  uint64_t pushed_{0};
+  uint64_t coalesced_{0};
+  uint64_t dropped_{0};
+  bool closed_{false};
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_INPUT_QUEUE_HPP
@@ -0,0 +1,292 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Human input recorder (Linux evdev).
+//
+// Reads /dev/input/event* passively through one epoll thread and appends the
+// events to an InputTraceWriter. Devices are never grabbed, so the compositor
+// receives every event exactly as before and the user's input sees no added
+// latency; the recorder is just one more evdev client. Each device is switched
+// to CLOCK_MONOTONIC timestamps (EVIOCSCLOCKID), the clock steady_clock and
+// the capture backends use, and the kernel timestamp of each event is kept
+// rather than the time the recorder got to it.
+//
+// The capture side calls MarkFrame() with the grab timestamp of every frame,
+// so frame markers and events end up interleaved in one trace.
+//
+// Usage:
+//   InputTraceWriter trace;
+//   trace.Open("session.ecit");
+//   InputRecorder rec;
+//   rec.Start(trace);                           // needs read access to /dev/input
+//   ... capture loop: rec.MarkFrame(i, image.grab_end_ns);
+//   rec.Stop();
+
+#ifndef EASY_CONTROL_INCLUDE_INPUT_RECORDER_HPP
+#define EASY_CONTROL_INCLUDE_INPUT_RECORDER_HPP
+
+#if !defined(__linux__)
+#error "input_recorder.hpp requires Linux (evdev)."
+#endif
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "input_trace.hpp"
+
+namespace autoalg {
+
+class InputRecorder {
+ public:
+  struct Options {
+    // Device nodes to record. Empty: every /dev/input/event* that reports
+    // keys, relative or absolute axes.
+    std::vector<std::string> devices;
+    // Also keep EV_SYN / SYN_REPORT (device frame boundaries). SYN_DROPPED is
+    // always kept so a consumer knows the kernel buffer overflowed.
+    bool record_syn = false;
+    // Applied by the reader thread when it starts (name defaults to
+    // "ec-input-rec"). A real-time priority keeps reads prompt under load;
+    // the kernel timestamps are exact either way.
+    ThreadConfig thread;
+  };
+
+  struct Stats {
+    uint64_t devices = 0;
+    uint64_t events = 0;
+    uint64_t frames = 0;
+    uint64_t syn_dropped = 0;
+  };
+
+  InputRecorder() = default;
+  explicit InputRecorder(const Options& options) : options_(options) {}
+  InputRecorder(const InputRecorder&) = delete;
+  InputRecorder& operator=(const InputRecorder&) = delete;
+  EC_INLINE ~InputRecorder() { Stop(); }
+
+  // Open the devices and start the reader thread. `writer` must stay open
+  // until Stop(). Returns false if no device could be opened.
+  EC_INLINE bool Start(InputTraceWriter& writer) {
+    Stop();
+    {
+      std::lock_guard<std::mutex> lk(writer_mu_);
+      writer_ = &writer;
+    }
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+      CloseAll_();
+      return false;
+    }
+    epoll_event wev{};
+    wev.events = EPOLLIN;
+    wev.data.u32 = kWakeTag;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wev);
+
+    std::vector<std::string> paths = options_.devices;
+    if (paths.empty()) paths = ListEventDevices_();
+    for (const std::string& path : paths) OpenDevice_(path);
+    if (fds_.empty()) {
+      CloseAll_();
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lk(stats_mu_);
+      stats_ = Stats{};
+      stats_.devices = fds_.size();
+    }
+    running_.store(true);
+    thread_ = std::thread([this] { Loop_(); });
+    return true;
+  }
+
+  EC_INLINE void Stop() {
+    if (thread_.joinable()) {
+      running_.store(false);
+      const uint64_t one = 1;
+      (void)!write(wake_fd_, &one, sizeof(one));
+      thread_.join();
+    }
+    CloseAll_();
+    std::lock_guard<std::mutex> lk(writer_mu_);  // MarkFrame() may be running on the capture thread
+    if (writer_) writer_->Flush();
+    writer_ = nullptr;
+  }
+
+  EC_INLINE bool IsRunning() const { return running_.load(); }
+
+  // Insert a frame marker. Pass the frame's grab timestamp (ImageRGBA::grab_end_ns);
+  // 0 means now.
+  EC_INLINE void MarkFrame(uint64_t frame_index, uint64_t t_ns = 0, int display_index = 0) {
+    {
+      std::lock_guard<std::mutex> lk(writer_mu_);
+      if (!running_.load() || !writer_) return;
+      writer_->AppendFrame(t_ns ? t_ns : NowSteadyNanos(), static_cast<uint16_t>(display_index), frame_index);
+    }
+    std::lock_guard<std::mutex> lk(stats_mu_);
+    ++stats_.frames;
+  }
+
+  EC_INLINE Stats GetStats() const {
+    std::lock_guard<std::mutex> lk(stats_mu_);
+    return stats_;
+  }
+
+ private:
+  static constexpr uint32_t kWakeTag = 0xFFFFFFFFu;
+
+  EC_INLINE static std::vector<std::string> ListEventDevices_() {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev/input", ec)) {
+      const std::string name = entry.path().filename().string();
+      if (name.rfind("event", 0) == 0) out.push_back(entry.path().string());
+    }
+    // event2 before event10
+    std::sort(out.begin(), out.end(), [](const std::string& a, const std::string& b) {
+      return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    return out;
+  }
+
+  EC_INLINE void OpenDevice_(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return;
+    unsigned long evbits = 0;
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(evbits)), &evbits) < 0 ||
+        !(evbits & ((1UL << EV_KEY) | (1UL << EV_REL) | (1UL << EV_ABS)))) {
+      close(fd);
+      return;
+    }
+    int clk = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clk) < 0) {
+      close(fd);  // REALTIME stamps could not be merged with frame timestamps
+      return;
+    }
+    const uint32_t index = static_cast<uint32_t>(fds_.size());
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u32 = index;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      close(fd);
+      return;
+    }
+    char name[256] = {};
+    if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) < 0) name[0] = '\0';
+    fds_.push_back(fd);
+    writer_->AppendDevice(NowSteadyNanos(), static_cast<uint16_t>(index), path + "\t" + name);
+  }
+
+  EC_INLINE void Loop_() {
+    ThreadConfig thread = options_.thread;
+    if (thread.name.empty()) thread.name = "ec-input-rec";
+    ApplyThreadConfig(thread);
+    epoll_event ready[16];
+    input_event events[64];
+    std::vector<InputTraceRecord> batch;
+    batch.reserve(64);
+    while (running_.load()) {
+      const int n = epoll_wait(epoll_fd_, ready, 16, -1);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      for (int i = 0; i < n; ++i) {
+        const uint32_t index = ready[i].data.u32;
+        if (index == kWakeTag) continue;
+        const int fd = fds_[index];
+        if (fd < 0) continue;
+        for (;;) {
+          const ssize_t bytes = read(fd, events, sizeof(events));
+          if (bytes < 0 && errno == EINTR) continue;
+          if (bytes <= 0) {
+            if (bytes == 0 || errno != EAGAIN) DropDevice_(index);  // unplugged (ENODEV)
+            break;
+          }
+          batch.clear();
+          uint64_t dropped = 0;
+          const size_t count = static_cast<size_t>(bytes) / sizeof(input_event);
+          for (size_t k = 0; k < count; ++k) {
+            const input_event& e = events[k];
+            if (e.type == EV_SYN) {
+              if (e.code == SYN_DROPPED) {
+                ++dropped;
+              } else if (!options_.record_syn) {
+                continue;
+              }
+            }
+            InputTraceRecord rec;
+            rec.t_ns = EventNanos_(e);
+            rec.kind = InputTraceRecord::kEvent;
+            rec.device = static_cast<uint16_t>(index);
+            rec.type = e.type;
+            rec.code = e.code;
+            rec.value = e.value;
+            batch.push_back(rec);
+          }
+          if (!batch.empty()) writer_->Append(batch.data(), batch.size());
+          std::lock_guard<std::mutex> lk(stats_mu_);
+          stats_.events += batch.size();
+          stats_.syn_dropped += dropped;
+        }
+      }
+    }
+    running_.store(false);
+  }
+
+  EC_INLINE static uint64_t EventNanos_(const input_event& e) {
+#ifdef input_event_sec
+    return static_cast<uint64_t>(e.input_event_sec) * 1000000000ULL + static_cast<uint64_t>(e.input_event_usec) * 1000ULL;
+#else
+    return static_cast<uint64_t>(e.time.tv_sec) * 1000000000ULL + static_cast<uint64_t>(e.time.tv_usec) * 1000ULL;
+#endif
+  }
+
+  EC_INLINE void DropDevice_(uint32_t index) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fds_[index], nullptr);
+    close(fds_[index]);
+    fds_[index] = -1;
+  }
+
+  EC_INLINE void CloseAll_() {
+    for (int fd : fds_)
+      if (fd >= 0) close(fd);
+    fds_.clear();
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+    if (wake_fd_ >= 0) close(wake_fd_);
+    epoll_fd_ = wake_fd_ = -1;
+  }
+
+  Options options_;
+  std::mutex writer_mu_;  // writer_ against MarkFrame(); the reader thread only uses it while running
+  InputTraceWriter* writer_ = nullptr;
+  std::vector<int> fds_;  // index == device id in the trace; -1 once unplugged
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+
+  mutable std::mutex stats_mu_;
+  Stats stats_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_INPUT_RECORDER_HPP
@@ -0,0 +1,225 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Input trace file format ("ECIT").
+//
+// A trace is a flat stream of fixed 24-byte little-endian records on one
+// monotonic clock (NowSteadyNanos(), i.e. CLOCK_MONOTONIC on Linux, the same
+// clock ImageRGBA::grab_begin_ns / grab_end_ns use). Input events and frame
+// markers are interleaved in arrival order, so a training pipeline can
+// assign every event to the frame the user was looking at.
+//
+//   header : "ECIT" | u32 version | u32 record_size (24) | u32 reserved
+//   record : u64 t_ns | u16 kind | u16 device | u16 type | u16 code | i64 value
+//
+// kinds:
+//   kEvent  : one evdev event (type / code / value), device = recorder index
+//   kFrame  : frame marker, device = display index, value = frame index
+//   kDevice : device description, value = byte length of the UTF-8 name that
+//             follows the record, padded to a multiple of 8 bytes
+//
+// Usage:
+//   InputTraceWriter w;
+//   w.Open("session.ecit");
+//   w.AppendFrame(image.grab_end_ns, 0, frame_index);
+//   ...
+//   InputTraceReader r;
+//   r.Open("session.ecit");
+//   InputTraceRecord rec; std::string name;
+//   while (r.Next(rec, &name)) { ... }
+
+#ifndef EASY_CONTROL_INCLUDE_INPUT_TRACE_HPP
+#define EASY_CONTROL_INCLUDE_INPUT_TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "macro.h"
+
+namespace autoalg {
+
+#pragma pack(push, 1)
+struct InputTraceRecord {
+  enum Kind : uint16_t { kEvent = 1, kFrame = 2, kDevice = 3 };
+
+  uint64_t t_ns = 0;
+  uint16_t kind = 0;
+  uint16_t device = 0;
+  uint16_t type = 0;
+  uint16_t code = 0;
+  int64_t value = 0;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(InputTraceRecord) == 24, "InputTraceRecord layout");
+
+constexpr char kInputTraceMagic[4] = {'E', 'C', 'I', 'T'};
+constexpr uint32_t kInputTraceVersion = 1;
+
+// Buffered, thread-safe appender (the recorder thread writes events while the
+// capture thread writes frame markers).
+class InputTraceWriter {
+ public:
+  InputTraceWriter() = default;
+  InputTraceWriter(const InputTraceWriter&) = delete;
+  InputTraceWriter& operator=(const InputTraceWriter&) = delete;
+  EC_INLINE ~InputTraceWriter() { Close(); }
+
+  EC_INLINE bool Open(const std::string& path) {
+    std::lock_guard<std::mutex> lk(mu_);
+    CloseLocked_();
+    fp_ = std::fopen(path.c_str(), "wb");
+    if (!fp_) return false;
+    std::setvbuf(fp_, nullptr, _IOFBF, 1 << 16);
+    uint32_t header[4] = {0, kInputTraceVersion, static_cast<uint32_t>(sizeof(InputTraceRecord)), 0};
+    std::memcpy(header, kInputTraceMagic, 4);
+    ok_ = std::fwrite(header, sizeof(header), 1, fp_) == 1;
+    count_ = 0;
+    return ok_;
+  }
+
+  EC_INLINE void Close() {
+    std::lock_guard<std::mutex> lk(mu_);
+    CloseLocked_();
+  }
+
+  EC_INLINE bool IsOpen() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return fp_ != nullptr;
+  }
+
+  EC_INLINE bool Append(const InputTraceRecord& rec) {
+    std::lock_guard<std::mutex> lk(mu_);
+    return AppendLocked_(&rec, 1);
+  }
+
+  // Append many records under one lock (the recorder hands over whole read() batches).
+  EC_INLINE bool Append(const InputTraceRecord* recs, size_t count) {
+    std::lock_guard<std::mutex> lk(mu_);
+    return AppendLocked_(recs, count);
+  }
+
+  EC_INLINE bool AppendEvent(uint64_t t_ns, uint16_t device, uint16_t type, uint16_t code, int32_t value) {
+    InputTraceRecord rec;
+    rec.t_ns = t_ns;
+    rec.kind = InputTraceRecord::kEvent;
+    rec.device = device;
+    rec.type = type;
+    rec.code = code;
+    rec.value = value;
+    return Append(rec);
+  }
+
+  // t_ns should be the frame's grab timestamp (ImageRGBA::grab_end_ns).
+  EC_INLINE bool AppendFrame(uint64_t t_ns, uint16_t display_index, uint64_t frame_index) {
+    InputTraceRecord rec;
+    rec.t_ns = t_ns;
+    rec.kind = InputTraceRecord::kFrame;
+    rec.device = display_index;
+    rec.value = static_cast<int64_t>(frame_index);
+    return Append(rec);
+  }
+
+  EC_INLINE bool AppendDevice(uint64_t t_ns, uint16_t device, const std::string& name) {
+    InputTraceRecord rec;
+    rec.t_ns = t_ns;
+    rec.kind = InputTraceRecord::kDevice;
+    rec.device = device;
+    rec.value = static_cast<int64_t>(name.size());
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!AppendLocked_(&rec, 1)) return false;
+    static const char kPad[8] = {};
+    const size_t pad = (8 - name.size() % 8) % 8;
+    ok_ = ok_ && std::fwrite(name.data(), 1, name.size(), fp_) == name.size() &&
+          std::fwrite(kPad, 1, pad, fp_) == pad;
+    return ok_;
+  }
+
+  EC_INLINE bool Flush() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return fp_ && std::fflush(fp_) == 0 && ok_;
+  }
+
+  // Records appended since Open().
+  EC_INLINE uint64_t Count() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return count_;
+  }
+  // False once any write failed.
+  EC_INLINE bool Good() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return ok_;
+  }
+
+ private:
+  EC_INLINE bool AppendLocked_(const InputTraceRecord* recs, size_t count) {
+    if (!fp_ || !ok_) return false;
+    ok_ = std::fwrite(recs, sizeof(InputTraceRecord), count, fp_) == count;
+    if (ok_) count_ += count;
+    return ok_;
+  }
+
+  EC_INLINE void CloseLocked_() {
+    if (!fp_) return;
+    std::fclose(fp_);
+    fp_ = nullptr;
+  }
+
+  mutable std::mutex mu_;
+  std::FILE* fp_ = nullptr;
+  bool ok_ = false;
+  uint64_t count_ = 0;
+};
+
+class InputTraceReader {
+ public:
+  InputTraceReader() = default;
+  InputTraceReader(const InputTraceReader&) = delete;
+  InputTraceReader& operator=(const InputTraceReader&) = delete;
+  EC_INLINE ~InputTraceReader() { Close(); }
+
+  // Fails on a missing file, bad magic, or an unknown version / record size.
+  EC_INLINE bool Open(const std::string& path) {
+    Close();
+    fp_ = std::fopen(path.c_str(), "rb");
+    if (!fp_) return false;
+    uint32_t header[4] = {};
+    if (std::fread(header, sizeof(header), 1, fp_) != 1 || std::memcmp(header, kInputTraceMagic, 4) != 0 ||
+        header[1] != kInputTraceVersion || header[2] != sizeof(InputTraceRecord)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  EC_INLINE void Close() {
+    if (fp_) std::fclose(fp_);
+    fp_ = nullptr;
+  }
+
+  // Next record. For kDevice the name is stored in *device_name (if given).
+  EC_INLINE bool Next(InputTraceRecord& rec, std::string* device_name = nullptr) {
+    if (!fp_ || std::fread(&rec, sizeof(rec), 1, fp_) != 1) return false;
+    if (rec.kind == InputTraceRecord::kDevice) {
+      if (rec.value < 0 || rec.value > (1 << 16)) return false;
+      const size_t len = static_cast<size_t>(rec.value);
+      std::string name(len + (8 - len % 8) % 8, '\0');
+      if (!name.empty() && std::fread(&name[0], 1, name.size(), fp_) != name.size()) return false;
+      name.resize(len);
+      if (device_name) *device_name = std::move(name);
+    }
+    return true;
+  }
+
+ private:
+  std::FILE* fp_ = nullptr;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_INPUT_TRACE_HPP
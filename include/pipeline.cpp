@@ -0,0 +1,609 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "image_util.hpp"
+
+namespace autoalg {
+
+namespace {
+
+// Turn copy hints into plain dirty rects, for stages that change geometry.
+void FoldCopies(PipelineFrame &frame) {
+  for (const CopyRect &c : frame.copies) frame.dirty.push_back(c.dst);
+  frame.copies.clear();
+}
+
+// Source positions and 8-bit weights for one axis (half-pixel centers).
+struct AxisTaps {
+  std::vector<int> i0;
+  std::vector<int> i1;
+  std::vector<int> w1;  // weight of i1, 0..256
+};
+
+AxisTaps BuildAxisTaps(int dst, int src, bool nearest) {
+  AxisTaps t;
+  t.i0.resize(dst);
+  t.i1.resize(dst);
+  t.w1.resize(dst);
+  const double ratio = static_cast<double>(src) / dst;
+  for (int i = 0; i < dst; ++i) {
+    if (nearest) {
+      t.i0[i] = t.i1[i] = std::min(static_cast<int>((i + 0.5) * ratio), src - 1);
+      t.w1[i] = 0;
+      continue;
+    }
+    const double s = std::max(0.0, (i + 0.5) * ratio - 0.5);
+    const int s0 = std::min(static_cast<int>(s), src - 1);
+    t.i0[i] = s0;
+    t.i1[i] = std::min(s0 + 1, src - 1);
+    t.w1[i] = static_cast<int>((s - s0) * 256.0 + 0.5);
+  }
+  return t;
+}
+
+void ResizeRGBA(const ImageRGBA &src, int width, int height, bool nearest, ThreadPool &pool, ImageRGBA &dst) {
+  dst.width = width;
+  dst.height = height;
+  dst.input_seq = src.input_seq;
+  dst.grab_begin_ns = src.grab_begin_ns;
+  dst.grab_end_ns = src.grab_end_ns;
+  dst.pixels.resize(static_cast<size_t>(width) * height * 4);
+
+  const AxisTaps xt = BuildAxisTaps(width, src.width, nearest);
+  const AxisTaps yt = BuildAxisTaps(height, src.height, nearest);
+  const size_t stride = static_cast<size_t>(src.width) * 4;
+  pool.ParallelFor(0, height, 8, [&](int64_t y_begin, int64_t y_end) {
+    for (int64_t y = y_begin; y < y_end; ++y) {
+      const uint8_t *a = src.pixels.data() + static_cast<size_t>(yt.i0[y]) * stride;
+      const uint8_t *b = src.pixels.data() + static_cast<size_t>(yt.i1[y]) * stride;
+      const int wy = yt.w1[y];
+      uint8_t *o = dst.pixels.data() + static_cast<size_t>(y) * width * 4;
+      for (int x = 0; x < width; ++x) {
+        const int x0 = xt.i0[x] * 4;
+        const int x1 = xt.i1[x] * 4;
+        const int wx = xt.w1[x];
+        for (int c = 0; c < 4; ++c) {
+          const int top = a[x0 + c] * (256 - wx) + a[x1 + c] * wx;
+          const int bottom = b[x0 + c] * (256 - wx) + b[x1 + c] * wx;
+          o[x * 4 + c] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 32768) >> 16);
+        }
+      }
+    }
+  });
+}
+
+// RGBA -> NV12, limited range; Y = (a*R + b*G + c*B) / 256 + 16 and so on,
+// chroma from the mean of each 2x2 block. Coefficients are the usual 8-bit
+// fixed-point ones.
+struct YuvCoeffs {
+  int yr, yg, yb, ur, ug, ub, vr, vg, vb;
+};
+
+constexpr YuvCoeffs kBt601 = {66, 129, 25, -38, -74, 112, 112, -94, -18};
+constexpr YuvCoeffs kBt709 = {47, 157, 16, -26, -87, 112, 112, -102, -10};
+
+void RgbaToNv12(const ImageRGBA &src, bool bt709, ThreadPool &pool, ImageNV12 &dst) {
+  const int w = src.width & ~1;
+  const int h = src.height & ~1;
+  dst.width = w;
+  dst.height = h;
+  dst.bt709 = bt709;
+  dst.input_seq = src.input_seq;
+  dst.grab_begin_ns = src.grab_begin_ns;
+  dst.grab_end_ns = src.grab_end_ns;
+  dst.data.resize(static_cast<size_t>(w) * h * 3 / 2);
+  const YuvCoeffs k = bt709 ? kBt709 : kBt601;
+  const size_t stride = static_cast<size_t>(src.width) * 4;
+  uint8_t *y_plane = dst.data.data();
+  uint8_t *uv_plane = y_plane + static_cast<size_t>(w) * h;
+  // One task unit = one chroma row = two luma rows.
+  pool.ParallelFor(0, h / 2, 8, [&](int64_t r_begin, int64_t r_end) {
+    for (int64_t r = r_begin; r < r_end; ++r) {
+      const uint8_t *s0 = src.pixels.data() + static_cast<size_t>(2 * r) * stride;
+      const uint8_t *s1 = s0 + stride;
+      uint8_t *y0 = y_plane + static_cast<size_t>(2 * r) * w;
+      uint8_t *y1 = y0 + w;
+      uint8_t *uv = uv_plane + static_cast<size_t>(r) * w;
+      for (int x = 0; x < w; x += 2) {
+        const uint8_t *p[4] = {s0 + x * 4, s0 + x * 4 + 4, s1 + x * 4, s1 + x * 4 + 4};
+        uint8_t *py[4] = {y0 + x, y0 + x + 1, y1 + x, y1 + x + 1};
+        int rs = 0, gs = 0, bs = 0;
+        for (int i = 0; i < 4; ++i) {
+          *py[i] = static_cast<uint8_t>(((k.yr * p[i][0] + k.yg * p[i][1] + k.yb * p[i][2] + 128) >> 8) + 16);
+          rs += p[i][0];
+          gs += p[i][1];
+          bs += p[i][2];
+        }
+        // Sums of four pixels: scale by 1/1024 instead of 1/256; the bias keeps the shift operand positive.
+        uv[x] = static_cast<uint8_t>((k.ur * rs + k.ug * gs + k.ub * bs + (128 << 10) + 512) >> 10);
+        uv[x + 1] = static_cast<uint8_t>((k.vr * rs + k.vg * gs + k.vb * bs + (128 << 10) + 512) >> 10);
+      }
+    }
+  });
+}
+
+}  // namespace
+
+// =====================
+// Queue
+// =====================
+class Pipeline::Queue_ {
+ public:
+  Queue_(size_t capacity, StageOptions::Overflow overflow) : capacity_(std::max<size_t>(1, capacity)), overflow_(overflow) {}
+
+  // False once aborted.
+  bool Push(PipelineFrame frame, Metrics_ &metrics) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (items_.size() >= capacity_ && !aborted_) {
+      if (overflow_ == StageOptions::kDropOldest) {
+        items_.pop_front();
+        ++metrics.overflow_drops;
+      } else {
+        const uint64_t t0 = NowSteadyNanos();
+        not_full_.wait(lk, [&] { return items_.size() < capacity_ || aborted_; });
+        metrics.blocked_ns += NowSteadyNanos() - t0;
+      }
+    }
+    if (aborted_) return false;
+    items_.push_back(std::move(frame));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // False when closed and drained, or aborted.
+  bool Pop(PipelineFrame &frame) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    not_empty_.wait(lk, [&] { return !items_.empty() || closed_ || aborted_; });
+    if (aborted_ || items_.empty()) return false;
+    frame = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // End of stream: the consumer drains what is queued, then stops.
+  void Close() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+  void Abort() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    aborted_ = true;
+    items_.clear();
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  size_t Depth() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return items_.size();
+  }
+
+ private:
+  const size_t capacity_;
+  const StageOptions::Overflow overflow_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<PipelineFrame> items_;
+  bool closed_ = false;
+  bool aborted_ = false;
+};
+
+// =====================
+// Pipeline
+// =====================
+Pipeline::Pipeline() : Pipeline(Options{}) {}
+
+Pipeline::Pipeline(const Options &options)
+    : options_(options), frames_(options.max_free_frames), nv12_frames_(options.max_free_frames) {}
+
+Pipeline::~Pipeline() { Stop(); }
+
+int Pipeline::SetSource(std::unique_ptr<PipelineSource> source, std::string name) {
+  if (!source || running_.load()) return -1;
+  std::lock_guard<std::mutex> lk(mutex_);
+  nodes_.clear();
+  segments_.clear();
+  std::unique_ptr<Node_> node(new Node_);
+  node->name = name.empty() ? source->Kind() : std::move(name);
+  node->source = std::move(source);
+  nodes_.push_back(std::move(node));
+  return 0;
+}
+
+int Pipeline::Add(std::unique_ptr<PipelineStage> stage, int upstream) {
+  return Add(std::move(stage), upstream, StageOptions{});
+}
+
+int Pipeline::Add(std::unique_ptr<PipelineStage> stage, int upstream, const StageOptions &options, std::string name) {
+  if (!stage || running_.load()) return -1;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (upstream < 0 || static_cast<size_t>(upstream) >= nodes_.size()) return -1;
+  const int id = static_cast<int>(nodes_.size());
+  std::unique_ptr<Node_> node(new Node_);
+  node->name = name.empty() ? stage->Kind() : std::move(name);
+  node->stage = std::move(stage);
+  node->options = options;
+  node->upstream = upstream;
+  nodes_[upstream]->children.push_back(id);
+  nodes_.push_back(std::move(node));
+  return id;
+}
+
+bool Pipeline::Fusable_(int node) const {
+  const Node_ &n = *nodes_[node];
+  // A dropping edge needs a queue to drop from; a blocking one behaves the same inline.
+  return options_.fuse && n.options.fuse && n.options.overflow == StageOptions::kBlock && !n.stage->WantsOwnThread();
+}
+
+std::vector<Pipeline::SegmentPlan_> Pipeline::PlanSegments_() const {
+  std::vector<SegmentPlan_> plan;
+  if (nodes_.empty()) return plan;
+  // Depth-first from the source: extend the chain while the edge is 1:1 and fusable.
+  std::function<int(int)> build = [&](int first) -> int {
+    const int index = static_cast<int>(plan.size());
+    plan.emplace_back();
+    int n = first;
+    for (;;) {
+      plan[index].nodes.push_back(n);
+      const std::vector<int> &children = nodes_[n]->children;
+      if (children.size() != 1 || !Fusable_(children[0])) break;
+      n = children[0];
+    }
+    for (int child : nodes_[n]->children) {
+      const int fed = build(child);
+      plan[index].feeds.push_back(fed);
+    }
+    return index;
+  };
+  build(0);
+  return plan;
+}
+
+bool Pipeline::Start() {
+  std::lock_guard<std::mutex> control(control_mutex_);
+  if (running_.load()) return false;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (nodes_.empty()) return false;
+    segments_.clear();
+    for (SegmentPlan_ &plan : PlanSegments_()) {
+      std::unique_ptr<Segment_> seg(new Segment_);
+      const Node_ &head = *nodes_[plan.nodes[0]];
+      if (!head.source) seg->input.reset(new Queue_(head.options.queue_capacity, head.options.overflow));
+      seg->plan = std::move(plan);
+      segments_.push_back(std::move(seg));
+    }
+    active_segments_ = segments_.size();
+  }
+  stopping_ = false;
+  running_ = true;
+  for (size_t i = 0; i < segments_.size(); ++i) segments_[i]->thread = std::thread(&Pipeline::RunSegment_, this, i);
+  return true;
+}
+
+void Pipeline::Stop() {
+  // Serialized: a concurrent Stop() (e.g. from Wait()) returns once the first has joined.
+  std::lock_guard<std::mutex> control(control_mutex_);
+  if (!running_.load()) return;
+  stopping_ = true;
+  for (auto &seg : segments_)
+    if (seg->input) seg->input->Abort();
+  for (auto &seg : segments_)
+    if (seg->thread.joinable()) seg->thread.join();
+  running_ = false;
+}
+
+bool Pipeline::Wait(std::chrono::milliseconds timeout) {
+  if (!running_.load()) return true;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    const auto done = [&] { return active_segments_ == 0; };
+    if (timeout == std::chrono::milliseconds::max()) {
+      done_cv_.wait(lk, done);
+    } else if (!done_cv_.wait_for(lk, timeout, done)) {
+      return false;
+    }
+  }
+  Stop();  // every thread already finished; just join
+  return true;
+}
+
+void Pipeline::RunSegment_(size_t index) {
+  Segment_ &seg = *segments_[index];
+  ThreadConfig config = options_.thread;
+  config.name = (config.name.empty() ? std::string("ec-pipe") : config.name) + "-" + std::to_string(index);
+  ApplyThreadConfig(config);
+  PipelineContext ctx;
+  ctx.frames = &frames_;
+  ctx.nv12_frames = &nv12_frames_;
+  ctx.pool = options_.pool ? options_.pool : &ThreadPool::Shared();
+
+  if (seg.input) {
+    PipelineFrame frame;
+    while (seg.input->Pop(frame)) RunFrom_(seg, 0, frame, ctx);
+  } else {
+    Node_ &source = *nodes_[seg.plan.nodes[0]];
+    while (!stopping_.load()) {
+      PipelineFrame frame;
+      const uint64_t t0 = NowSteadyNanos();
+      const PipelineSource::Result r = source.source->Next(frame, ctx);
+      if (r == PipelineSource::kEnd) break;
+      if (r != PipelineSource::kFrame) continue;
+      frame.index = next_index_++;
+      Record_(source.metrics, t0, true, frame);
+      RunFrom_(seg, 1, frame, ctx);
+    }
+  }
+  Finish_(seg, ctx);
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  --active_segments_;
+  done_cv_.notify_all();
+}
+
+void Pipeline::RunFrom_(Segment_ &seg, size_t pos, PipelineFrame &frame, PipelineContext &ctx) {
+  for (size_t i = pos; i < seg.plan.nodes.size(); ++i) {
+    Node_ &node = *nodes_[seg.plan.nodes[i]];
+    const uint64_t t0 = NowSteadyNanos();
+    const bool passed = node.stage->Process(frame, ctx);
+    Record_(node.metrics, t0, passed, frame);
+    if (!passed) return;
+  }
+  // Fan out: every branch gets the frame (pixels are shared, not copied).
+  const std::vector<int> &feeds = seg.plan.feeds;
+  for (size_t k = 0; k < feeds.size(); ++k) {
+    Segment_ &next = *segments_[feeds[k]];
+    Metrics_ &m = nodes_[next.plan.nodes[0]]->metrics;
+    if (k + 1 == feeds.size()) {
+      next.input->Push(std::move(frame), m);
+    } else {
+      next.input->Push(frame, m);
+    }
+  }
+}
+
+void Pipeline::Finish_(Segment_ &seg, PipelineContext &ctx) {
+  if (!stopping_.load()) {
+    for (size_t i = 0; i < seg.plan.nodes.size(); ++i) {
+      Node_ &node = *nodes_[seg.plan.nodes[i]];
+      if (!node.stage) continue;
+      std::vector<PipelineFrame> held;
+      node.stage->Flush(ctx, held);
+      for (PipelineFrame &frame : held) RunFrom_(seg, i + 1, frame, ctx);
+    }
+  }
+  for (int fed : seg.plan.feeds) segments_[fed]->input->Close();
+}
+
+void Pipeline::Record_(Metrics_ &m, uint64_t begin_ns, bool passed, const PipelineFrame &frame) {
+  const uint64_t now = NowSteadyNanos();
+  const uint64_t dt = now - begin_ns;
+  ++m.frames_in;
+  m.busy_ns += dt;
+  uint64_t max = m.max_ns.load(std::memory_order_relaxed);
+  while (dt > max && !m.max_ns.compare_exchange_weak(max, dt, std::memory_order_relaxed)) {
+  }
+  if (!passed) {
+    ++m.filtered;
+    return;
+  }
+  ++m.frames_out;
+  if (frame.image && frame.image->grab_end_ns && now > frame.image->grab_end_ns) {
+    m.latency_ns += now - frame.image->grab_end_ns;
+    ++m.latency_frames;
+  }
+}
+
+std::vector<Pipeline::StageStats> Pipeline::GetStats() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  const std::vector<SegmentPlan_> plan = PlanSegments_();
+  std::vector<StageStats> out(nodes_.size());
+  for (size_t s = 0; s < plan.size(); ++s) {
+    for (size_t i = 0; i < plan[s].nodes.size(); ++i) {
+      const int id = plan[s].nodes[i];
+      const Node_ &node = *nodes_[id];
+      const Metrics_ &m = node.metrics;
+      StageStats &st = out[id];
+      st.id = id;
+      st.name = node.name;
+      st.kind = node.source ? node.source->Kind() : node.stage->Kind();
+      st.thread = static_cast<int>(s);
+      st.frames_in = m.frames_in.load();
+      st.frames_out = m.frames_out.load();
+      st.filtered = m.filtered.load();
+      st.overflow_drops = m.overflow_drops.load();
+      st.busy_ns = m.busy_ns.load();
+      st.max_ns = m.max_ns.load();
+      st.blocked_ns = m.blocked_ns.load();
+      const uint64_t lf = m.latency_frames.load();
+      st.latency_ns = lf ? m.latency_ns.load() / lf : 0;
+      if (i == 0 && running_.load() && s < segments_.size() && segments_[s]->input)
+        st.queue_depth = segments_[s]->input->Depth();
+    }
+  }
+  return out;
+}
+
+std::string Pipeline::Describe() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::string text;
+  const std::vector<SegmentPlan_> plan = PlanSegments_();
+  for (size_t s = 0; s < plan.size(); ++s) {
+    text += "thread " + std::to_string(s) + ":";
+    const Node_ &head = *nodes_[plan[s].nodes[0]];
+    if (!head.source) {
+      text += " [queue " + std::to_string(std::max<size_t>(1, head.options.queue_capacity)) +
+              (head.options.overflow == StageOptions::kDropOldest ? " drop-oldest]" : " block]");
+    }
+    for (size_t i = 0; i < plan[s].nodes.size(); ++i) text += (i ? " > " : " ") + nodes_[plan[s].nodes[i]]->name;
+    for (size_t k = 0; k < plan[s].feeds.size(); ++k)
+      text += (k ? ", " : " -> thread ") + std::to_string(plan[s].feeds[k]);
+    text += "\n";
+  }
+  return text;
+}
+
+// =====================
+// Sources
+// =====================
+CaptureSource::CaptureSource(const Options &options) : options_(options) {}
+
+CaptureSource::~CaptureSource() = default;
+
+PipelineSource::Result CaptureSource::Next(PipelineFrame &frame, PipelineContext &ctx) {
+  using Clock = std::chrono::steady_clock;
+  // Pace in short sleeps so the pipeline can stop in between.
+  const auto now = Clock::now();
+  if (next_due_ > now) {
+    std::this_thread::sleep_for(std::min<Clock::duration>(next_due_ - now, std::chrono::milliseconds(100)));
+    if (Clock::now() < next_due_) return kNone;
+  }
+  const auto period = options_.fps > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(1.0 / options_.fps))
+                                       : Clock::duration::zero();
+  // Behind by more than a period (slow consumer, blocked queue): restart the grid instead of bursting.
+  next_due_ = std::max(next_due_ + period, Clock::now());
+
+  FramePool::Frame image = ctx.frames->Acquire();
+  frame.display_index = options_.display_index;
+  if (options_.wait_for_damage && RectEmpty(options_.region)) {
+    if (!session_) session_.reset(new CaptureSession(options_.display_index));
+    if (!session_->IsOpen()) return kNone;
+    std::vector<ScreenRect> damage;
+    if (!session_->GrabChanged(*image, &damage, 100)) return kNone;
+    frame.full_dirty = damage.size() == 1 && damage[0].x == 0 && damage[0].y == 0 && damage[0].w == image->width &&
+                       damage[0].h == image->height;
+    if (!frame.full_dirty) frame.dirty = std::move(damage);
+  } else {
+    const bool ok = RectEmpty(options_.region)
+                        ? SystemOutput::CaptureScreenWithCursor(options_.display_index, *image)
+                        : SystemOutput::CaptureRegionWithCursor(options_.display_index, options_.region, *image);
+    if (!ok) return kNone;
+  }
+  frame.image = std::move(image);
+  return kFrame;
+}
+
+PipelineSource::Result FunctionSource::Next(PipelineFrame &frame, PipelineContext &ctx) {
+  FramePool::Frame image = ctx.frames->Acquire();
+  const Result r = fn_(*image);
+  if (r == kFrame) frame.image = std::move(image);
+  return r;
+}
+
+// =====================
+// Stages
+// =====================
+bool RoiStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  if (!frame.image) return false;
+  FramePool::Frame out = ctx.frames->Acquire();
+  if (!CropImage(*frame.image, roi_, *out)) return false;
+  const ScreenRect c = ClipRect(roi_, frame.image->width, frame.image->height);
+  FoldCopies(frame);
+  std::vector<ScreenRect> dirty;
+  for (const ScreenRect &r : frame.dirty) {
+    const ScreenRect i = IntersectRect(r, c);
+    if (!RectEmpty(i)) dirty.push_back({i.x - c.x, i.y - c.y, i.w, i.h});
+  }
+  frame.dirty.swap(dirty);
+  frame.image = std::move(out);
+  return true;
+}
+
+bool ScaleStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  if (!frame.image || width_ <= 0 || height_ <= 0) return false;
+  const ImageRGBA &src = *frame.image;
+  if (src.width <= 0 || src.height <= 0) return false;
+  if (src.width == width_ && src.height == height_) return true;
+  FramePool::Frame out = ctx.frames->Acquire();
+  ResizeRGBA(src, width_, height_, nearest_, *ctx.pool, *out);
+
+  const double sx = static_cast<double>(width_) / src.width;
+  const double sy = static_cast<double>(height_) / src.height;
+  const int pad = nearest_ ? 0 : 1;  // bilinear taps reach one source pixel further
+  FoldCopies(frame);
+  for (ScreenRect &r : frame.dirty) {
+    const int x0 = static_cast<int>(std::floor(r.x * sx)) - pad;
+    const int y0 = static_cast<int>(std::floor(r.y * sy)) - pad;
+    const int x1 = static_cast<int>(std::ceil((r.x + r.w) * sx)) + pad;
+    const int y1 = static_cast<int>(std::ceil((r.y + r.h) * sy)) + pad;
+    r = ClipRect({x0, y0, x1 - x0, y1 - y0}, width_, height_);
+  }
+  frame.image = std::move(out);
+  return true;
+}
+
+bool DiffStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  if (!frame.image) return false;
+  const ImageRGBA &cur = *frame.image;
+  frame.copies.clear();
+  frame.dirty.clear();
+  if (!prev_ || prev_->width != cur.width || prev_->height != cur.height) {
+    frame.full_dirty = true;
+  } else if (options_.detect_motion) {
+    FrameDelta delta = ComputeFrameDelta(*prev_, cur, options_.motion);
+    frame.copies = std::move(delta.copies);
+    frame.dirty = std::move(delta.dirty_tiles);
+    frame.full_dirty = delta.size_changed;
+  } else {
+    frame.dirty = DiffTiles(*prev_, cur, options_.motion.tile_size);
+    frame.full_dirty = false;
+  }
+  prev_ = frame.image;
+  return !(options_.drop_static && !frame.full_dirty && frame.dirty.empty() && frame.copies.empty());
+}
+
+bool Nv12Stage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  if (!frame.image || frame.image->width < 2 || frame.image->height < 2) return false;
+  ObjectPool<ImageNV12>::Ptr out = ctx.nv12_frames->Acquire();
+  RgbaToNv12(*frame.image, bt709_, *ctx.pool, *out);
+  if (!frame.full_dirty) {
+    for (ScreenRect &r : frame.dirty) r = ClipRect(r, out->width, out->height);
+  }
+  frame.nv12 = std::move(out);
+  return true;
+}
+
+bool ConvertStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  if (!frame.image) return false;
+  auto tensor = std::make_shared<std::vector<uint8_t>>(sink_.ItemBytes());
+  if (!sink_.Convert(*frame.image, tensor->data())) return false;
+  frame.tensor = std::move(tensor);
+  return true;
+}
+
+bool EncodeStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  auto payload = std::make_shared<std::vector<uint8_t>>();
+  if (!encoder_(frame, *payload)) return false;
+  frame.payload = std::move(payload);
+  return true;
+}
+
+bool PublishStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  callback_(frame);
+  return true;
+}
+
+bool RecordStage::Process(PipelineFrame &frame, PipelineContext &ctx) {
+  (void)ctx;
+  return replay_ && frame.image && replay_->Push(frame.image);  // shared, no copy
+}
+
+}  // namespace autoalg
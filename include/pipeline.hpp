@@ -0,0 +1,443 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Composable capture-processing pipeline.
+//
+// A Pipeline is a tree of stages rooted at one source: capture -> ROI ->
+// scale -> diff -> convert / encode -> publish / record, with branches where
+// one stage feeds several consumers. At Start() adjacent stages are fused:
+// a stage with a single upstream that has a single downstream runs inline on
+// its upstream's thread, with no queue and no hand-off in between. Every other
+// edge (fan-out, stages that asked for their own thread, dropping edges)
+// gets a bounded queue and a thread of its own. A full queue either blocks the
+// producer (backpressure reaches the capture, which then grabs less often) or
+// drops the oldest queued frame (live consumers that want the latest frame).
+// Data-parallel work inside a stage (scaling, tensor conversion) runs on the
+// shared ThreadPool.
+//
+// Frames carry pooled images behind shared_ptr. Stages treat the image as
+// immutable, since branches and DiffStage's reference frame may share it, and
+// replace it with a new frame from the pipeline's FramePool when they change
+// pixels. Fanning a frame out to several branches copies no pixels.
+//
+// Every stage keeps its own metrics (frames in / out / filtered, queue drops,
+// busy time, time its producer spent blocked on its queue, queue depth,
+// capture-to-stage latency); GetStats() snapshots them while running.
+//
+// Usage:
+//   Pipeline p;
+//   CaptureSource::Options cap;
+//   cap.fps = 60;
+//   int s = p.SetSource(std::make_unique<CaptureSource>(cap));
+//   s = p.Add(std::make_unique<RoiStage>(ScreenRect{0, 0, 1280, 720}), s);
+//   s = p.Add(std::make_unique<DiffStage>(), s);
+//   Pipeline::StageOptions live;
+//   live.overflow = Pipeline::StageOptions::kDropOldest;
+//   p.Add(std::make_unique<PublishStage>([](const PipelineFrame& f) { ... }), s, live);
+//   p.Add(std::make_unique<RecordStage>(&replay), s);
+//   p.Start();  ...  p.Stop();
+
+#ifndef EASY_CONTROL_INCLUDE_PIPELINE_HPP
+#define EASY_CONTROL_INCLUDE_PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "frame_delta.hpp"
+#include "frame_pool.hpp"
+#include "replay_buffer.hpp"
+#include "system_output.hpp"
+#include "tensor_sink.hpp"
+#include "thread_pool.hpp"
+
+namespace autoalg {
+
+// 4:2:0 frame for video encoders: Y plane (width x height) followed by the
+// interleaved UV plane (width x height / 2). Width and height are even.
+struct ImageNV12 {
+  int width = 0;
+  int height = 0;
+  bool bt709 = true;  // limited range, BT.709 (else BT.601) matrix
+  std::vector<uint8_t> data;
+  uint64_t input_seq = 0;
+  uint64_t grab_begin_ns = 0;
+  uint64_t grab_end_ns = 0;
+
+  const uint8_t* Y() const { return data.data(); }
+  const uint8_t* UV() const { return data.data() + static_cast<size_t>(width) * height; }
+};
+
+struct PipelineFrame {
+  uint64_t index = 0;  // assigned by the pipeline, in source order
+  int display_index = 0;
+  FramePool::Frame image;  // shared; replace, do not modify
+
+  // Changed regions in image coordinates. full_dirty: everything changed or
+  // nothing is known (first frame, capture without damage information).
+  std::vector<ScreenRect> dirty;
+  std::vector<CopyRect> copies;  // from DiffStage: apply before the dirty rects
+  bool full_dirty = true;
+
+  std::shared_ptr<const ImageNV12> nv12;                // Nv12Stage output (pooled)
+  std::shared_ptr<const std::vector<uint8_t>> tensor;   // ConvertStage output (TensorSink layout)
+  std::shared_ptr<const std::vector<uint8_t>> payload;  // EncodeStage output
+  bool keyframe = false;                                // payload decodes on its own
+};
+
+// What stages get besides the frame.
+struct PipelineContext {
+  FramePool* frames = nullptr;                 // for replacement images
+  ObjectPool<ImageNV12>* nv12_frames = nullptr;  // for Nv12Stage output
+  ThreadPool* pool = nullptr;                  // for data-parallel loops
+};
+
+class PipelineStage {
+ public:
+  virtual ~PipelineStage() = default;
+
+  // Short type name used in metrics and Describe() ("roi", "encode", ...).
+  virtual const char* Kind() const = 0;
+
+  // Transform the frame in place. Returning false drops it for this branch.
+  virtual bool Process(PipelineFrame& frame, PipelineContext& ctx) = 0;
+
+  // End of stream: append frames still held back (e.g. encoder delay); they
+  // continue downstream of this stage.
+  virtual void Flush(PipelineContext& ctx, std::vector<PipelineFrame>& out) {
+    (void)ctx;
+    (void)out;
+  }
+
+  // Slow or blocking stages (encoders, disk writers) ask not to be fused with
+  // their upstream, so they do not stall the capture thread.
+  virtual bool WantsOwnThread() const { return false; }
+};
+
+class PipelineSource {
+ public:
+  enum Result : int { kFrame = 0, kNone, kEnd };
+
+  virtual ~PipelineSource() = default;
+
+  virtual const char* Kind() const = 0;
+
+  // Produce the next frame (kFrame), nothing yet (kNone) or end of stream
+  // (kEnd). Sources pace themselves and should return within ~100 ms so
+  // Stop() stays prompt.
+  virtual Result Next(PipelineFrame& frame, PipelineContext& ctx) = 0;
+};
+
+class Pipeline {
+ public:
+  struct Options {
+    ThreadPool* pool = nullptr;  // nullptr: ThreadPool::Shared()
+    size_t max_free_frames = 8;  // FramePool (and NV12 pool) idle images
+    bool fuse = true;            // false: one thread per stage (profiling)
+    // Applied to every pipeline thread, named "<name>-<thread>" ("ec-pipe-<thread>").
+    ThreadConfig thread;
+  };
+
+  struct StageOptions {
+    enum Overflow : int { kBlock = 0, kDropOldest };
+
+    // Used when the stage does not share its upstream's thread. kDropOldest
+    // always gets a queue (and thus a thread); kBlock stages may be fused.
+    size_t queue_capacity = 4;
+    Overflow overflow = kBlock;
+    bool fuse = true;  // allow running on the upstream's thread
+  };
+
+  struct StageStats {
+    int id = 0;
+    std::string name;
+    std::string kind;
+    int thread = 0;               // stages with the same value are fused
+    uint64_t frames_in = 0;
+    uint64_t frames_out = 0;
+    uint64_t filtered = 0;        // Process() returned false
+    uint64_t overflow_drops = 0;  // kDropOldest evictions from this stage's queue
+    uint64_t busy_ns = 0;         // in Process() / Next() (a source's pacing waits included)
+    uint64_t max_ns = 0;          // slowest single call
+    uint64_t blocked_ns = 0;      // producer waiting on this stage's full queue (kBlock)
+    size_t queue_depth = 0;
+    uint64_t latency_ns = 0;      // mean grab end -> frame leaves this stage
+  };
+
+  Pipeline();
+  explicit Pipeline(const Options& options);
+  ~Pipeline();
+
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  // The graph can only be edited while stopped. Ids are >= 0; -1 on error
+  // (running, unknown upstream, no source yet, null stage).
+  int SetSource(std::unique_ptr<PipelineSource> source, std::string name = {});
+  int Add(std::unique_ptr<PipelineStage> stage, int upstream);
+  int Add(std::unique_ptr<PipelineStage> stage, int upstream, const StageOptions& options, std::string name = {});
+
+  // Fuses stages, creates the queues and starts one thread per fused group.
+  bool Start();
+  // Stops the source, discards queued frames and joins the threads. Safe to
+  // call from several threads at once.
+  void Stop();
+  // Blocks until every thread finished after the source reported kEnd (all
+  // queues drained, stages flushed) or until the timeout; true if finished.
+  bool Wait(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+  bool IsRunning() const { return running_.load(); }
+
+  std::vector<StageStats> GetStats() const;
+  // One line per thread: its stages and the threads it feeds.
+  std::string Describe() const;
+
+  FramePool& Frames() { return frames_; }
+
+ private:
+  struct Metrics_ {
+    std::atomic<uint64_t> frames_in{0};
+    std::atomic<uint64_t> frames_out{0};
+    std::atomic<uint64_t> filtered{0};
+    std::atomic<uint64_t> overflow_drops{0};
+    std::atomic<uint64_t> busy_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> blocked_ns{0};
+    std::atomic<uint64_t> latency_ns{0};
+    std::atomic<uint64_t> latency_frames{0};
+  };
+
+  class Queue_;
+
+  struct Node_ {
+    std::string name;
+    std::unique_ptr<PipelineSource> source;  // node 0 only
+    std::unique_ptr<PipelineStage> stage;
+    StageOptions options;
+    int upstream = -1;
+    std::vector<int> children;
+    Metrics_ metrics;
+  };
+
+  // A chain of fused stages run by one thread.
+  struct SegmentPlan_ {
+    std::vector<int> nodes;
+    std::vector<int> feeds;  // segments fed by the last node
+  };
+
+  struct Segment_ {
+    SegmentPlan_ plan;
+    std::unique_ptr<Queue_> input;  // null for the source segment
+    std::thread thread;
+  };
+
+  bool Fusable_(int node) const;
+  std::vector<SegmentPlan_> PlanSegments_() const;
+  void RunSegment_(size_t index);
+  // Run frame through segment nodes [pos, end), then hand it to the fed segments.
+  void RunFrom_(Segment_& seg, size_t pos, PipelineFrame& frame, PipelineContext& ctx);
+  void Finish_(Segment_& seg, PipelineContext& ctx);
+  static void Record_(Metrics_& m, uint64_t begin_ns, bool passed, const PipelineFrame& frame);
+
+  Options options_;
+  FramePool frames_;
+  ObjectPool<ImageNV12> nv12_frames_;
+  std::vector<std::unique_ptr<Node_>> nodes_;
+  std::vector<std::unique_ptr<Segment_>> segments_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint64_t> next_index_{0};
+  std::mutex control_mutex_;  // Start() / Stop(), taken before mutex_
+  mutable std::mutex mutex_;
+  std::condition_variable done_cv_;
+  size_t active_segments_ = 0;
+};
+
+// ---------- Sources ----------
+
+// Grabs a display (or a display-local region) at a fixed rate. With
+// wait_for_damage (whole display only) it uses a CaptureSession and emits a
+// frame only when the screen changed, with the damage rects as dirty regions.
+class CaptureSource : public PipelineSource {
+ public:
+  struct Options {
+    int display_index = 0;
+    ScreenRect region;  // empty: whole display
+    double fps = 30.0;
+    bool wait_for_damage = false;
+  };
+
+  CaptureSource() : CaptureSource(Options{}) {}
+  explicit CaptureSource(const Options& options);
+  ~CaptureSource() override;
+
+  const char* Kind() const override { return "capture"; }
+  Result Next(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  Options options_;
+  std::chrono::steady_clock::time_point next_due_{};
+  std::unique_ptr<CaptureSession> session_;  // opened on the pipeline thread
+};
+
+// Frames from a callback (files, replays, synthetic input). The callback fills
+// the image and returns kFrame, kNone or kEnd.
+class FunctionSource : public PipelineSource {
+ public:
+  using Fn = std::function<Result(ImageRGBA& image)>;
+
+  explicit FunctionSource(Fn fn) : fn_(std::move(fn)) {}
+
+  const char* Kind() const override { return "function"; }
+  Result Next(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  Fn fn_;
+};
+
+// ---------- Stages ----------
+
+// Crop to a rectangle (clipped to the frame); dirty rects follow.
+class RoiStage : public PipelineStage {
+ public:
+  explicit RoiStage(const ScreenRect& roi) : roi_(roi) {}
+
+  const char* Kind() const override { return "roi"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  ScreenRect roi_;
+};
+
+// Resize to width x height (bilinear or nearest); dirty rects are scaled and
+// grown by the filter footprint.
+class ScaleStage : public PipelineStage {
+ public:
+  ScaleStage(int width, int height, bool nearest = false) : width_(width), height_(height), nearest_(nearest) {}
+
+  const char* Kind() const override { return "scale"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  int width_;
+  int height_;
+  bool nearest_;
+};
+
+// Diff against the previous frame of this branch: fills dirty / copies (see
+// ComputeFrameDelta). drop_static drops frames with no change at all.
+class DiffStage : public PipelineStage {
+ public:
+  struct Options {
+    MotionOptions motion;
+    bool detect_motion = true;  // false: plain tile diff, no copy rects
+    bool drop_static = true;
+  };
+
+  DiffStage() : DiffStage(Options{}) {}
+  explicit DiffStage(const Options& options) : options_(options) {}
+
+  const char* Kind() const override { return "diff"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  Options options_;
+  FramePool::Frame prev_;  // shared with the frame that went downstream, not copied
+};
+
+// Video encoder input: frame.nv12 = image as NV12 in a pooled buffer (odd
+// right / bottom edges are cropped). Cheap enough to stay fused with the
+// capture, so the encoder thread receives ready-made planes.
+class Nv12Stage : public PipelineStage {
+ public:
+  explicit Nv12Stage(bool bt709 = true) : bt709_(bt709) {}
+
+  const char* Kind() const override { return "nv12"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  bool bt709_;
+};
+
+// Model input: frame.tensor = TensorSink::Convert(image).
+class ConvertStage : public PipelineStage {
+ public:
+  explicit ConvertStage(const TensorSpec& spec, ThreadPool* pool = nullptr) : sink_(spec, pool) {}
+
+  const char* Kind() const override { return "convert"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  TensorSink sink_;
+};
+
+// Encoder callback: fill out (and optionally frame.keyframe); false drops the
+// frame. Runs on its own thread unless fused explicitly.
+class EncodeStage : public PipelineStage {
+ public:
+  using Encoder = std::function<bool(PipelineFrame& frame, std::vector<uint8_t>& out)>;
+
+  explicit EncodeStage(Encoder encoder) : encoder_(std::move(encoder)) {}
+
+  const char* Kind() const override { return "encode"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+  bool WantsOwnThread() const override { return true; }
+
+ private:
+  Encoder encoder_;
+};
+
+// Hand frames to the application (network, model, UI); they pass through.
+class PublishStage : public PipelineStage {
+ public:
+  using Callback = std::function<void(const PipelineFrame& frame)>;
+
+  explicit PublishStage(Callback callback) : callback_(std::move(callback)) {}
+
+  const char* Kind() const override { return "publish"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+
+ private:
+  Callback callback_;
+};
+
+// Push frames into a ReplayBuffer (not owned).
+class RecordStage : public PipelineStage {
+ public:
+  explicit RecordStage(ReplayBuffer* replay) : replay_(replay) {}
+
+  const char* Kind() const override { return "record"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override;
+  bool WantsOwnThread() const override { return true; }
+
+ private:
+  ReplayBuffer* replay_;
+};
+
+// Arbitrary per-frame work (analysis, custom transforms).
+class FunctionStage : public PipelineStage {
+ public:
+  using Fn = std::function<bool(PipelineFrame& frame, PipelineContext& ctx)>;
+
+  FunctionStage(Fn fn, bool own_thread = false) : fn_(std::move(fn)), own_thread_(own_thread) {}
+
+  const char* Kind() const override { return "function"; }
+  bool Process(PipelineFrame& frame, PipelineContext& ctx) override { return fn_(frame, ctx); }
+  bool WantsOwnThread() const override { return own_thread_; }
+
+ private:
+  Fn fn_;
+  bool own_thread_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_PIPELINE_HPP
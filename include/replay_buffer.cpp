@@ -0,0 +1,613 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "replay_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "deflate.hpp"
+#include "image_util.hpp"
+#include "thread_pool.hpp"
+
+namespace autoalg {
+
+// EncodedFrame::data layout (little-endian):
+//   u32 copy_count, copy_count x { i32 dst_x, dst_y, w, h, src_x, src_y }
+//   u32 tile_count, tile_count x { i32 x, y, w, h, u32 mode, i32 dx, dy, u32 bytes, deflate bytes }
+// A tile is predicted byte by byte (RGBA interleaved) and the residuals
+// (pixel - prediction, mod 256) are deflated:
+//   kSpatial  : LOCO-I median predictor from the left / upper / upper-left
+//               pixels inside the tile (keyframes, new content); dx, dy = 0
+//   kTemporal : the reference pixel at (x + dx, y + dy), clamped to the frame,
+//               where the reference is the previous frame after the copies.
+//               Offsets are 0 or one of the frame's copy offsets, so tiles
+//               next to a scroll or pan (revealed edges, sprites moving over
+//               a panned background) still predict from the moved content.
+// Keyframes are full-width bands of tile_size rows, all spatial.
+
+namespace {
+
+constexpr char kDumpMagic[4] = {'E', 'C', 'R', 'B'};
+constexpr uint32_t kDumpVersion = 2;
+constexpr uint32_t kSpatial = 0;
+constexpr uint32_t kTemporal = 1;
+
+void PutU32(std::vector<uint8_t> &out, uint32_t v) {
+  uint8_t b[4];
+  std::memcpy(b, &v, 4);
+  out.insert(out.end(), b, b + 4);
+}
+
+class ByteReader {
+ public:
+  ByteReader(const uint8_t *p, size_t n) : p_(p), end_(p + n) {}
+
+  bool U32(uint32_t &v) {
+    if (end_ - p_ < 4) return false;
+    std::memcpy(&v, p_, 4);
+    p_ += 4;
+    return true;
+  }
+  bool I32(int32_t &v) {
+    uint32_t u;
+    if (!U32(u)) return false;
+    std::memcpy(&v, &u, 4);
+    return true;
+  }
+  bool Bytes(const uint8_t *&p, size_t n) {
+    if (static_cast<size_t>(end_ - p_) < n) return false;
+    p = p_;
+    p_ += n;
+    return true;
+  }
+
+ private:
+  const uint8_t *p_;
+  const uint8_t *end_;
+};
+
+uint8_t Median(int a, int b, int c) {
+  if (c >= std::max(a, b)) return static_cast<uint8_t>(std::min(a, b));
+  if (c <= std::min(a, b)) return static_cast<uint8_t>(std::max(a, b));
+  return static_cast<uint8_t>(a + b - c);
+}
+
+// Spatial residuals of tile r of img into res (w*h*4 bytes); returns the sum
+// of |residual| as a cost estimate.
+uint64_t SpatialResidual(const ImageRGBA &img, const ScreenRect &r, uint8_t *res) {
+  const size_t stride = static_cast<size_t>(img.width) * 4;
+  const size_t row = static_cast<size_t>(r.w) * 4;
+  uint64_t cost = 0;
+  for (int y = 0; y < r.h; ++y) {
+    const uint8_t *p = img.pixels.data() + static_cast<size_t>(r.y + y) * stride + static_cast<size_t>(r.x) * 4;
+    const uint8_t *up = y > 0 ? p - stride : nullptr;
+    uint8_t *o = res + static_cast<size_t>(y) * row;
+    for (size_t i = 0; i < row; ++i) {
+      const int a = i >= 4 ? p[i - 4] : 0;
+      const int b = up ? up[i] : 0;
+      const int c = up && i >= 4 ? up[i - 4] : 0;
+      const uint8_t d = static_cast<uint8_t>(p[i] - Median(a, b, c));
+      o[i] = d;
+      cost += d < 128 ? d : 256 - d;
+    }
+  }
+  return cost;
+}
+
+// Start of reference row y + dy, clamped to the frame.
+const uint8_t *ClampedRow(const ImageRGBA &ref, int y, int dy) {
+  const int sy = std::max(0, std::min(ref.height - 1, y + dy));
+  return ref.pixels.data() + static_cast<size_t>(sy) * ref.width * 4;
+}
+
+// Reference pixel at column x + dx of ref_row, clamped to the frame.
+inline const uint8_t *ClampedPixel(const uint8_t *ref_row, int width, int x, int dx) {
+  return ref_row + static_cast<size_t>(std::max(0, std::min(width - 1, x + dx))) * 4;
+}
+
+uint64_t TemporalResidual(const ImageRGBA &img, const ImageRGBA &ref, const ScreenRect &r, int dx, int dy,
+                          uint8_t *res) {
+  const size_t stride = static_cast<size_t>(img.width) * 4;
+  const size_t row = static_cast<size_t>(r.w) * 4;
+  uint64_t cost = 0;
+  for (int y = 0; y < r.h; ++y) {
+    const uint8_t *p = img.pixels.data() + static_cast<size_t>(r.y + y) * stride + static_cast<size_t>(r.x) * 4;
+    const uint8_t *q = ClampedRow(ref, r.y + y, dy);
+    uint8_t *o = res + static_cast<size_t>(y) * row;
+    for (int x = 0; x < r.w; ++x) {
+      const uint8_t *s = ClampedPixel(q, img.width, r.x + x, dx);
+      for (int c = 0; c < 4; ++c) {
+        const uint8_t d = static_cast<uint8_t>(p[x * 4 + c] - s[c]);
+        o[x * 4 + c] = d;
+        cost += d < 128 ? d : 256 - d;
+      }
+    }
+  }
+  return cost;
+}
+
+// Tile record for tile r of cur: temporal against ref at the cheapest of the
+// offsets when ref is given and that beats spatial, spatial otherwise.
+void EncodeTile(const ImageRGBA &cur, const ImageRGBA *ref, const std::vector<std::pair<int, int>> &offsets,
+                const ScreenRect &r, int level, std::vector<uint8_t> &scratch, std::vector<uint8_t> &out) {
+  const size_t n = static_cast<size_t>(r.w) * r.h * 4;
+  scratch.resize(2 * n);
+  uint8_t *best = scratch.data();
+  uint8_t *trial = scratch.data() + n;
+  uint32_t mode = kSpatial;
+  int best_dx = 0, best_dy = 0;
+  uint64_t best_cost = SpatialResidual(cur, r, best);
+  if (ref) {
+    for (const auto &o : offsets) {
+      const uint64_t cost = TemporalResidual(cur, *ref, r, o.first, o.second, trial);
+      if (cost > best_cost || (cost == best_cost && mode == kTemporal)) continue;
+      std::swap(best, trial);
+      best_cost = cost;
+      mode = kTemporal;
+      best_dx = o.first;
+      best_dy = o.second;
+      if (cost == 0) break;
+    }
+  }
+  PutU32(out, static_cast<uint32_t>(r.x));
+  PutU32(out, static_cast<uint32_t>(r.y));
+  PutU32(out, static_cast<uint32_t>(r.w));
+  PutU32(out, static_cast<uint32_t>(r.h));
+  PutU32(out, mode);
+  PutU32(out, static_cast<uint32_t>(best_dx));
+  PutU32(out, static_cast<uint32_t>(best_dy));
+  const uint8_t *res = best;
+  const size_t len_pos = out.size();
+  PutU32(out, 0);
+  DeflateRaw(res, n, level, true, out);
+  const uint32_t bytes = static_cast<uint32_t>(out.size() - len_pos - 4);
+  std::memcpy(out.data() + len_pos, &bytes, 4);
+}
+
+struct TileRecord {
+  ScreenRect r;
+  uint32_t mode = kSpatial;
+  int32_t dx = 0, dy = 0;
+  const uint8_t *z = nullptr;
+  uint32_t bytes = 0;
+};
+
+// Decode one frame into cur. cur must hold the previous frame for delta
+// frames; ref is scratch for the reference of shifted temporal tiles.
+bool DecodeFrame(bool key, int width, int height, const std::vector<uint8_t> &data, ImageRGBA &cur, ImageRGBA &ref,
+                 std::vector<uint8_t> &scratch) {
+  if (width <= 0 || height <= 0) return false;
+  if (key) {
+    cur.width = width;
+    cur.height = height;
+    cur.pixels.resize(static_cast<size_t>(width) * height * 4);
+  } else if (cur.width != width || cur.height != height) {
+    return false;  // delta without its keyframe
+  }
+  const ScreenRect bounds{0, 0, width, height};
+  ByteReader in(data.data(), data.size());
+
+  uint32_t copy_count;
+  if (!in.U32(copy_count) || copy_count > data.size() / 24) return false;
+  std::vector<CopyRect> copies(copy_count);
+  for (CopyRect &c : copies) {
+    if (!in.I32(c.dst.x) || !in.I32(c.dst.y) || !in.I32(c.dst.w) || !in.I32(c.dst.h) || !in.I32(c.src_x) ||
+        !in.I32(c.src_y))
+      return false;
+    if (!RectContains(bounds, c.dst) || !RectContains(bounds, ScreenRect{c.src_x, c.src_y, c.dst.w, c.dst.h}))
+      return false;
+  }
+  if (!copies.empty()) ApplyCopyRects(copies, cur);
+
+  uint32_t tile_count;
+  if (!in.U32(tile_count) || tile_count > data.size() / 32) return false;
+  std::vector<TileRecord> tiles(tile_count);
+  bool shifted = false;
+  for (TileRecord &t : tiles) {
+    ScreenRect &r = t.r;
+    if (!in.I32(r.x) || !in.I32(r.y) || !in.I32(r.w) || !in.I32(r.h) || !in.U32(t.mode) || !in.I32(t.dx) ||
+        !in.I32(t.dy) || !in.U32(t.bytes) || !in.Bytes(t.z, t.bytes))
+      return false;
+    if (RectEmpty(r) || !RectContains(bounds, r) || t.mode > kTemporal || (key && t.mode != kSpatial)) return false;
+    if (t.dx < -width || t.dx > width || t.dy < -height || t.dy > height) return false;
+    shifted |= t.dx != 0 || t.dy != 0;
+  }
+  // Shifted tiles may read pixels that other tiles overwrite: predict them
+  // from a snapshot taken before any tile is decoded.
+  if (shifted) {
+    ref.width = width;
+    ref.height = height;
+    ref.pixels.assign(cur.pixels.begin(), cur.pixels.end());
+  }
+
+  const size_t stride = static_cast<size_t>(width) * 4;
+  for (const TileRecord &t : tiles) {
+    const ScreenRect &r = t.r;
+    const size_t row = static_cast<size_t>(r.w) * 4;
+    scratch.resize(row * r.h);
+    if (!InflateRaw(t.z, t.bytes, scratch.data(), scratch.size())) return false;
+    for (int y = 0; y < r.h; ++y) {
+      uint8_t *p = cur.pixels.data() + static_cast<size_t>(r.y + y) * stride + static_cast<size_t>(r.x) * 4;
+      const uint8_t *d = scratch.data() + static_cast<size_t>(y) * row;
+      if (t.mode == kTemporal && (t.dx != 0 || t.dy != 0)) {
+        const uint8_t *q = ClampedRow(ref, r.y + y, t.dy);
+        for (int x = 0; x < r.w; ++x) {
+          const uint8_t *s = ClampedPixel(q, width, r.x + x, t.dx);
+          for (int c = 0; c < 4; ++c) p[x * 4 + c] = static_cast<uint8_t>(s[c] + d[x * 4 + c]);
+        }
+        continue;
+      }
+      if (t.mode == kTemporal) {
+        for (size_t i = 0; i < row; ++i) p[i] = static_cast<uint8_t>(p[i] + d[i]);
+        continue;
+      }
+      const uint8_t *up = y > 0 ? p - stride : nullptr;
+      for (size_t i = 0; i < row; ++i) {
+        const int a = i >= 4 ? p[i - 4] : 0;
+        const int b = up ? up[i] : 0;
+        const int c = up && i >= 4 ? up[i - 4] : 0;
+        p[i] = static_cast<uint8_t>(d[i] + Median(a, b, c));
+      }
+    }
+  }
+  return true;
+}
+
+bool FrameValid(const ImageRGBA &frame) {
+  return frame.width > 0 && frame.height > 0 &&
+         frame.pixels.size() >= static_cast<size_t>(frame.width) * frame.height * 4;
+}
+
+bool WriteAll(std::FILE *fp, const void *p, size_t n) { return n == 0 || std::fwrite(p, 1, n, fp) == n; }
+
+template <class T>
+bool WritePod(std::FILE *fp, const T &v) {
+  return WriteAll(fp, &v, sizeof(T));
+}
+
+template <class T>
+bool ReadPod(std::FILE *fp, T &v) {
+  return std::fread(&v, sizeof(T), 1, fp) == 1;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// ReplayBuffer
+// ---------------------------------------------------------------------------
+
+ReplayBuffer::ReplayBuffer() : ReplayBuffer(Options{}) {}
+
+ReplayBuffer::ReplayBuffer(const Options &options) : options_(options) {
+  options_.keyframe_interval = std::max(1, options_.keyframe_interval);
+  options_.tile_size = std::max(8, options_.tile_size);
+  options_.compression_level = std::max(1, std::min(9, options_.compression_level));
+  if (options_.max_pending > 0) {
+    if (options_.thread.name.empty()) options_.thread.name = "ec-replay";
+    thread_ = std::thread(&ReplayBuffer::Loop_, this);
+  }
+}
+
+ReplayBuffer::~ReplayBuffer() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  idle_cv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+bool ReplayBuffer::Push(std::shared_ptr<const ImageRGBA> frame) {
+  if (!frame || !FrameValid(*frame)) return false;
+  std::unique_lock<std::mutex> lk(mutex_);
+  ++counters_.pushed;
+  if (options_.max_pending == 0) {
+    const uint64_t epoch = epoch_;
+    lk.unlock();
+    std::lock_guard<std::mutex> enc(encode_mutex_);
+    Encode_(*frame, epoch);
+    return true;
+  }
+  if (queue_.size() >= options_.max_pending) {
+    ++counters_.dropped;
+    if (!options_.drop_oldest) return false;
+    queue_.pop_front();
+  }
+  queue_.push_back(std::move(frame));
+  lk.unlock();
+  cv_.notify_one();
+  return true;
+}
+
+bool ReplayBuffer::Push(const ImageRGBA &frame) {
+  if (!FrameValid(frame)) return false;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (options_.max_pending == 0) {
+      ++counters_.pushed;
+      const uint64_t epoch = epoch_;
+      lk.unlock();
+      std::lock_guard<std::mutex> enc(encode_mutex_);
+      Encode_(frame, epoch);
+      return true;
+    }
+    // Don't pay for the copy when it would be dropped anyway.
+    if (!options_.drop_oldest && queue_.size() >= options_.max_pending) {
+      ++counters_.pushed;
+      ++counters_.dropped;
+      return false;
+    }
+  }
+  return Push(std::make_shared<const ImageRGBA>(frame));
+}
+
+void ReplayBuffer::Flush() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  idle_cv_.wait(lk, [&] { return stop_ || (queue_.empty() && !busy_); });
+}
+
+void ReplayBuffer::Loop_() {
+  ApplyThreadConfig(options_.thread);
+  std::unique_lock<std::mutex> lk(mutex_);
+  for (;;) {
+    cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+    if (stop_) return;  // queued frames are discarded
+    std::shared_ptr<const ImageRGBA> frame = std::move(queue_.front());
+    queue_.pop_front();
+    const uint64_t epoch = epoch_;
+    busy_ = true;
+    lk.unlock();
+    {
+      std::lock_guard<std::mutex> enc(encode_mutex_);
+      Encode_(*frame, epoch);
+    }
+    frame.reset();  // back to its pool before reporting
+    lk.lock();
+    busy_ = false;
+    if (queue_.empty()) idle_cv_.notify_all();
+  }
+}
+
+void ReplayBuffer::Encode_(const ImageRGBA &frame, uint64_t epoch) {
+  bool key;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (epoch != epoch_) return;  // cleared since it was pushed
+    if (encoder_epoch_ != epoch_) {
+      encoder_epoch_ = epoch_;
+      prev_ = ImageRGBA{};
+    }
+    const bool same_size = prev_.width == frame.width && prev_.height == frame.height;
+    // The GOP being written can't be evicted, so cap it: past max_gop_bytes
+    // the next frame starts a new GOP and the old one becomes evictable.
+    const size_t gop_cap = options_.max_gop_bytes ? options_.max_gop_bytes : options_.memory_budget / 8;
+    key = gops_.empty() || !same_size ||
+          gops_.back().frames.size() >= static_cast<size_t>(options_.keyframe_interval) ||
+          gops_.back().bytes >= gop_cap;
+  }
+
+  FrameDelta delta;
+  if (!key) {
+    if (options_.detect_motion) {
+      MotionOptions mo;
+      mo.tile_size = options_.tile_size;
+      delta = ComputeFrameDelta(prev_, frame, mo);
+    } else {
+      delta.dirty_tiles = DiffTiles(prev_, frame, options_.tile_size);
+    }
+    int64_t dirty = 0;
+    for (const ScreenRect &r : delta.dirty_tiles) dirty += RectArea(r);
+    key = delta.size_changed ||
+          static_cast<double>(dirty) > options_.scene_cut_ratio * static_cast<double>(frame.width) * frame.height;
+  }
+
+  auto enc = std::make_shared<EncodedFrame>();
+  enc->key = key;
+  enc->width = frame.width;
+  enc->height = frame.height;
+  enc->input_seq = frame.input_seq;
+  enc->grab_begin_ns = frame.grab_begin_ns;
+  enc->grab_end_ns = frame.grab_end_ns;
+  std::vector<uint8_t> &out = enc->data;
+  std::vector<ScreenRect> tiles;
+  const ImageRGBA *ref = nullptr;
+  std::vector<std::pair<int, int>> offsets;  // temporal candidates: in place, then copy offsets by area
+  if (key) {
+    PutU32(out, 0);
+    for (int y = 0; y < frame.height; y += options_.tile_size)
+      tiles.push_back(ScreenRect{0, y, frame.width, std::min(options_.tile_size, frame.height - y)});
+  } else {
+    PutU32(out, static_cast<uint32_t>(delta.copies.size()));
+    for (const CopyRect &c : delta.copies) {
+      for (int v : {c.dst.x, c.dst.y, c.dst.w, c.dst.h, c.src_x, c.src_y}) PutU32(out, static_cast<uint32_t>(v));
+    }
+    ref = &prev_;
+    std::vector<std::pair<std::pair<int, int>, int64_t>> moved;
+    for (const CopyRect &c : delta.copies) {
+      const std::pair<int, int> o{c.src_x - c.dst.x, c.src_y - c.dst.y};
+      auto it = std::find_if(moved.begin(), moved.end(), [&](const auto &m) { return m.first == o; });
+      if (it == moved.end()) it = moved.insert(moved.end(), {o, 0});
+      it->second += RectArea(c.dst);
+    }
+    std::sort(moved.begin(), moved.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    offsets.emplace_back(0, 0);
+    for (size_t i = 0; i < moved.size() && i < 4; ++i) offsets.push_back(moved[i].first);
+    if (!delta.copies.empty()) {
+      ref_.width = prev_.width;
+      ref_.height = prev_.height;
+      ref_.pixels.assign(prev_.pixels.begin(), prev_.pixels.end());
+      ApplyCopyRects(delta.copies, ref_);
+      ref = &ref_;
+    }
+    tiles = std::move(delta.dirty_tiles);
+  }
+  // Tiles are independent deflate streams: compress them on the pool.
+  PutU32(out, static_cast<uint32_t>(tiles.size()));
+  std::vector<std::vector<uint8_t>> parts(tiles.size());
+  ThreadPool &pool = options_.pool ? *options_.pool : ThreadPool::Shared();
+  pool.ParallelFor(0, static_cast<int64_t>(tiles.size()), 1, [&](int64_t t0, int64_t t1) {
+    std::vector<uint8_t> scratch;
+    for (int64_t t = t0; t < t1; ++t) EncodeTile(frame, ref, offsets, tiles[t], options_.compression_level, scratch, parts[t]);
+  });
+  for (const std::vector<uint8_t> &part : parts) out.insert(out.end(), part.begin(), part.end());
+  out.shrink_to_fit();
+
+  prev_.width = frame.width;
+  prev_.height = frame.height;
+  prev_.pixels.assign(frame.pixels.begin(), frame.pixels.begin() + static_cast<size_t>(frame.width) * frame.height * 4);
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (epoch != epoch_) return;  // cleared while encoding; the next frame resets prev_
+  if (key) {
+    gops_.emplace_back();
+    ++counters_.keyframes;
+  }
+  gops_.back().bytes += out.size();
+  gops_.back().frames.push_back(std::move(enc));
+  bytes_ += out.size();
+  ++frames_;
+  Evict_();
+}
+
+void ReplayBuffer::Evict_() {
+  // Never evict the GOP being written: its frames depend on its keyframe.
+  while (gops_.size() > 1) {
+    bool drop = bytes_ > options_.memory_budget;
+    if (!drop && options_.max_seconds > 0) {
+      // Drop the oldest GOP if the rest alone still covers max_seconds.
+      const uint64_t newest = gops_.back().frames.back()->grab_end_ns;
+      const uint64_t next_start = gops_[1].frames.front()->grab_end_ns;
+      drop = next_start != 0 && newest >= next_start &&
+             static_cast<double>(newest - next_start) * 1e-9 >= options_.max_seconds;
+    }
+    if (!drop) break;
+    bytes_ -= gops_.front().bytes;
+    frames_ -= gops_.front().frames.size();
+    counters_.evicted_frames += gops_.front().frames.size();
+    gops_.pop_front();
+  }
+}
+
+void ReplayBuffer::Clear() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    queue_.clear();
+    gops_.clear();
+    bytes_ = 0;
+    frames_ = 0;
+    counters_ = Stats{};
+    ++epoch_;  // the encoder drops its reference frame and any frame in flight
+  }
+  idle_cv_.notify_all();
+}
+
+ReplayBuffer::Stats ReplayBuffer::GetStats() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  Stats s = counters_;
+  s.frames = frames_;
+  s.gops = gops_.size();
+  s.bytes = bytes_;
+  for (const Gop &g : gops_) {
+    for (const FramePtr &f : g.frames) s.raw_bytes += static_cast<size_t>(f->width) * f->height * 4;
+  }
+  if (!gops_.empty()) {
+    const uint64_t t0 = gops_.front().frames.front()->grab_end_ns;
+    const uint64_t t1 = gops_.back().frames.back()->grab_end_ns;
+    s.seconds = t1 > t0 ? static_cast<double>(t1 - t0) * 1e-9 : 0.0;
+  }
+  return s;
+}
+
+std::vector<ReplayBuffer::FramePtr> ReplayBuffer::Snapshot_() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::vector<FramePtr> out;
+  out.reserve(frames_);
+  for (const Gop &g : gops_) out.insert(out.end(), g.frames.begin(), g.frames.end());
+  return out;
+}
+
+size_t ReplayBuffer::ForEachFrame(const std::function<void(const ImageRGBA &)> &callback) const {
+  const std::vector<FramePtr> frames = Snapshot_();
+  ImageRGBA cur, ref;
+  std::vector<uint8_t> scratch;
+  size_t decoded = 0;
+  for (const FramePtr &f : frames) {
+    if (!DecodeFrame(f->key, f->width, f->height, f->data, cur, ref, scratch)) break;
+    cur.input_seq = f->input_seq;
+    cur.grab_begin_ns = f->grab_begin_ns;
+    cur.grab_end_ns = f->grab_end_ns;
+    callback(cur);
+    ++decoded;
+  }
+  return decoded;
+}
+
+bool ReplayBuffer::DumpTo(const std::string &path) const {
+  const std::vector<FramePtr> frames = Snapshot_();
+  std::FILE *fp = std::fopen(path.c_str(), "wb");
+  if (!fp) return false;
+  bool ok = WriteAll(fp, kDumpMagic, 4) && WritePod(fp, kDumpVersion) && WritePod(fp, uint64_t{frames.size()});
+  for (const FramePtr &f : frames) {
+    if (!ok) break;
+    const uint32_t flags = f->key ? 1u : 0u;
+    ok = WritePod(fp, flags) && WritePod(fp, static_cast<int32_t>(f->width)) &&
+         WritePod(fp, static_cast<int32_t>(f->height)) && WritePod(fp, f->input_seq) && WritePod(fp, f->grab_begin_ns) &&
+         WritePod(fp, f->grab_end_ns) && WritePod(fp, uint64_t{f->data.size()}) &&
+         WriteAll(fp, f->data.data(), f->data.size());
+  }
+  ok = std::fclose(fp) == 0 && ok;
+  return ok;
+}
+
+// ---------------------------------------------------------------------------
+// ReplayReader
+// ---------------------------------------------------------------------------
+
+ReplayReader::~ReplayReader() { Close(); }
+
+bool ReplayReader::Open(const std::string &path) {
+  Close();
+  fp_ = std::fopen(path.c_str(), "rb");
+  if (!fp_) return false;
+  char magic[4];
+  uint32_t version = 0;
+  if (std::fread(magic, 1, 4, fp_) != 4 || std::memcmp(magic, kDumpMagic, 4) != 0 || !ReadPod(fp_, version) ||
+      version != kDumpVersion || !ReadPod(fp_, frame_count_)) {
+    Close();
+    return false;
+  }
+  cur_ = ImageRGBA{};
+  return true;
+}
+
+void ReplayReader::Close() {
+  if (fp_) std::fclose(fp_);
+  fp_ = nullptr;
+  frame_count_ = 0;
+}
+
+bool ReplayReader::Next(ImageRGBA &out) {
+  if (!fp_) return false;
+  uint32_t flags = 0;
+  int32_t width = 0, height = 0;
+  uint64_t input_seq = 0, begin_ns = 0, end_ns = 0, size = 0;
+  if (!ReadPod(fp_, flags) || !ReadPod(fp_, width) || !ReadPod(fp_, height) || !ReadPod(fp_, input_seq) ||
+      !ReadPod(fp_, begin_ns) || !ReadPod(fp_, end_ns) || !ReadPod(fp_, size))
+    return false;
+  // Deflate never expands a frame much beyond its raw size.
+  if (width <= 0 || height <= 0 || size > static_cast<uint64_t>(width) * height * 8 + 4096) return false;
+  data_.resize(static_cast<size_t>(size));
+  if (size && std::fread(data_.data(), 1, data_.size(), fp_) != data_.size()) return false;
+  if (!DecodeFrame(flags & 1u, width, height, data_, cur_, ref_, scratch_)) return false;
+  cur_.input_seq = input_seq;
+  cur_.grab_begin_ns = begin_ns;
+  cur_.grab_end_ns = end_ns;
+  out = cur_;
+  return true;
+}
+
+}  // namespace autoalg
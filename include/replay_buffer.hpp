@@ -0,0 +1,193 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Instant-replay ring of compressed recent frames.
+//
+// Keeps the last N seconds of a capture stream in memory without storing raw
+// RGBA (1080p30 for 30 s is ~7.5 GB raw). Frames are stored as GOPs: a
+// keyframe followed by delta frames. A delta frame is the ComputeFrameDelta()
+// copy rects plus the residual dirty tiles. Every tile is predicted (from its
+// neighbours, or from the previous frame when that is cheaper, so unchanged
+// pixels cost almost nothing; tiles next to a scroll or pan predict from the
+// moved content) and the residuals are deflated; tiles are compressed in
+// parallel on the ThreadPool. Everything is lossless.
+//
+// Push() only queues the frame (shared, not copied, when it comes from a
+// FramePool); a worker thread encodes it. At level 1 a 1080p frame costs
+// about 20 ms of one core for a desktop, 90 ms for a panning game and 600 ms
+// for full-screen noise (replay_budget_demo), and tiles spread over the pool,
+// so real-time 1080p30 needs about 1 core for a desktop and 3-4 for a game.
+// When the encoder falls behind, the bounded queue drops frames
+// (Stats::dropped) instead of stalling the capture thread; the replay then
+// has gaps but every retained frame stays exact. max_pending = 0 encodes
+// inside Push().
+//
+// When the memory budget (or the age limit) is exceeded, whole GOPs are
+// evicted oldest first, so every retained frame stays decodable. The GOP
+// being written is capped at max_gop_bytes, so it alone can't blow the
+// budget. demo/replay_budget_demo.cpp measures how many seconds fit. DumpTo()
+// writes the retained frames to disk in the same compressed form; use
+// ReplayReader to decode a dump.
+//
+// Usage:
+//   ReplayBuffer::Options opt;
+//   opt.memory_budget = 256 << 20;
+//   ReplayBuffer replay(opt);
+//   capture loop: replay.Push(image);
+//   on failure:   replay.Flush(); replay.DumpTo("failure.ecrb");
+//   offline:      ReplayReader r; r.Open("failure.ecrb"); while (r.Next(img)) ...
+
+#ifndef EASY_CONTROL_INCLUDE_REPLAY_BUFFER_HPP
+#define EASY_CONTROL_INCLUDE_REPLAY_BUFFER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "frame_delta.hpp"
+#include "system_output.hpp"
+#include "thread_pool.hpp"
+
+namespace autoalg {
+
+class ReplayBuffer {
+ public:
+  struct Options {
+    size_t memory_budget = size_t{256} << 20;  // bytes of compressed data retained
+    double max_seconds = 30.0;                 // drop GOPs older than this (by grab time), 0 = budget only
+    int keyframe_interval = 60;                // frames per GOP at most
+    double scene_cut_ratio = 0.5;              // dirty area above this fraction forces a keyframe
+    int tile_size = 64;
+    bool detect_motion = true;                 // use ComputeFrameDelta copy rects (scrolls, window moves)
+    int compression_level = 1;                 // deflate effort 1 (fast) .. 9 (small)
+    size_t max_gop_bytes = 0;                  // start a new GOP beyond this; 0 = memory_budget / 8
+    ThreadPool* pool = nullptr;                // tile compression; nullptr = ThreadPool::Shared()
+    size_t max_pending = 2;                    // frames queued for the encoder; 0 = encode inside Push()
+    bool drop_oldest = true;                   // queue full: drop the oldest queued frame, else the new one
+    ThreadConfig thread;                       // encoder thread; name defaults to "ec-replay"
+  };
+
+  struct Stats {
+    uint64_t pushed = 0;
+    uint64_t keyframes = 0;
+    uint64_t evicted_frames = 0;
+    uint64_t dropped = 0;   // never encoded: the encoder queue was full
+    size_t frames = 0;      // retained
+    size_t gops = 0;        // retained
+    size_t bytes = 0;       // retained compressed bytes
+    size_t raw_bytes = 0;   // what the retained frames would take as RGBA
+    double seconds = 0.0;   // span of the retained frames
+  };
+
+  ReplayBuffer();
+  explicit ReplayBuffer(const Options& options);
+  // Frames still queued are discarded.
+  ~ReplayBuffer();
+
+  ReplayBuffer(const ReplayBuffer&) = delete;
+  ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+  // Queue one frame for encoding (frames may change size; that starts a new
+  // GOP). The shared overload keeps a reference instead of copying; the frame
+  // must not be modified until encoded. False if invalid or dropped.
+  bool Push(std::shared_ptr<const ImageRGBA> frame);
+  bool Push(const ImageRGBA& frame);
+
+  // Block until every queued frame is encoded.
+  void Flush();
+
+  // Drop retained and queued frames and reset the stats.
+  void Clear();
+  Stats GetStats() const;
+
+  // Decode every retained frame, oldest first (frames still queued are not
+  // included; Flush() first). Returns the number decoded.
+  size_t ForEachFrame(const std::function<void(const ImageRGBA&)>& callback) const;
+
+  // Write the retained frames to `path` (compressed). Safe to call while
+  // another thread keeps pushing; only a pointer snapshot is taken under the lock.
+  bool DumpTo(const std::string& path) const;
+
+  // Encoded frame, immutable once pushed.
+  struct EncodedFrame {
+    bool key = false;
+    int width = 0;
+    int height = 0;
+    uint64_t input_seq = 0;
+    uint64_t grab_begin_ns = 0;
+    uint64_t grab_end_ns = 0;
+    std::vector<uint8_t> data;  // copies + tiles, see replay_buffer.cpp
+  };
+
+ private:
+  using FramePtr = std::shared_ptr<const EncodedFrame>;
+  struct Gop {
+    std::vector<FramePtr> frames;
+    size_t bytes = 0;
+  };
+
+  std::vector<FramePtr> Snapshot_() const;
+  // Encode and append a frame pushed in `epoch`; the caller holds encode_mutex_.
+  void Encode_(const ImageRGBA& frame, uint64_t epoch);
+  void Evict_();
+  void Loop_();
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;       // work available / stopping
+  std::condition_variable idle_cv_;  // queue drained
+  std::deque<std::shared_ptr<const ImageRGBA>> queue_;
+  bool busy_ = false;
+  bool stop_ = false;
+  std::deque<Gop> gops_;
+  size_t bytes_ = 0;
+  size_t frames_ = 0;
+  Stats counters_;      // pushed / keyframes / evicted_frames / dropped
+  uint64_t epoch_ = 0;  // bumped by Clear(): frames pushed before it are not appended
+
+  // Encoder state, under encode_mutex_ (taken before mutex_).
+  std::mutex encode_mutex_;
+  uint64_t encoder_epoch_ = 0;  // epoch prev_ belongs to
+  ImageRGBA prev_;
+  ImageRGBA ref_;  // prev_ with copy rects applied (scratch)
+  std::thread thread_;
+};
+
+// Decodes a file written by ReplayBuffer::DumpTo().
+class ReplayReader {
+ public:
+  ReplayReader() = default;
+  ~ReplayReader();
+  ReplayReader(const ReplayReader&) = delete;
+  ReplayReader& operator=(const ReplayReader&) = delete;
+
+  bool Open(const std::string& path);
+  void Close();
+
+  // Next decoded frame (pixels and timestamps). False at end of file or on a corrupt record.
+  bool Next(ImageRGBA& out);
+
+  // Frames in the file (from the header).
+  uint64_t FrameCount() const { return frame_count_; }
+
+ private:
+  std::FILE* fp_ = nullptr;
+  uint64_t frame_count_ = 0;
+  ImageRGBA cur_;
+  ImageRGBA ref_;
+  std::vector<uint8_t> data_;
+  std::vector<uint8_t> scratch_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_REPLAY_BUFFER_HPP
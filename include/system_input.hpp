@@ -46,9 +46,25 @@
 #include <wayland-client.h>
 #include <zwlr-virtual-pointer-unstable-v1-client-protocol.h>
 #include <zwp-virtual-keyboard-unstable-v1-client-protocol.h>
+// Optional: clipboard for PasteText (generated from wlr-data-control-unstable-v1.xml)
+#if __has_include(<zwlr-data-control-unstable-v1-client-protocol.h>)
+#include <zwlr-data-control-unstable-v1-client-protocol.h>
+#define INPUT_HAVE_WLR_DATA_CONTROL 1
+#endif
+#endif
+#if defined(INPUT_BACKEND_X11) || defined(INPUT_HAVE_WLR_DATA_CONTROL)
+#include <poll.h>
+#endif
+#ifdef INPUT_HAVE_WLR_DATA_CONTROL
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
 #endif
 #ifdef INPUT_BACKEND_X11
 #include <X11/XKBlib.h>
+#include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/XTest.h>
@@ -66,6 +82,7 @@
 #endif
 
 #include "common.hpp"
+#include "input_macro.hpp"
 
 namespace autoalg {
 
@@ -183,6 +200,9 @@ class SystemInput {
     }
     if (wl_seat_) wl_seat_destroy(wl_seat_);
     if (vkbd_mgr_) zwp_virtual_keyboard_manager_v1_destroy(vkbd_mgr_);
+#ifdef INPUT_HAVE_WLR_DATA_CONTROL
+    if (dc_mgr_) zwlr_data_control_manager_v1_destroy(dc_mgr_);
+#endif
     if (vp_mgr_) zwlr_virtual_pointer_manager_v1_destroy(vp_mgr_);
     if (wl_registry_) wl_registry_destroy(wl_registry_);
     if (wl_display_) {
@@ -213,6 +233,26 @@ class SystemInput {
   EC_INLINE int CursorX() const { return cur_x_; }
   EC_INLINE int CursorY() const { return cur_y_; }
 
+  // Sequence number (see NextInputSeq() in common.hpp) of the last event this
+  // instance injected; 0 before the first one. Compare with ImageRGBA::input_seq
+  // to tell whether a captured frame was grabbed after that input.
+  EC_INLINE uint64_t LastSeq() const { return last_seq_; }
+
+  // Server-side timing (X11 only): drag paths and macro Delay()s are sent in
+  // one flush with XTest per-event delays, and the X server spaces the events
+  // itself instead of client sleeps. Calls return once the events are queued,
+  // so LastSeq() / input_seq then mark queued rather than applied input.
+  // Returns false (mode unchanged) on backends without server-side delays.
+  EC_INLINE bool SetServerSideTiming(bool enable) {
+#ifdef INPUT_BACKEND_X11
+    server_timing_ = enable;
+    return true;
+#else
+    return !enable;
+#endif
+  }
+  EC_INLINE bool ServerSideTiming() const { return server_timing_; }
+
   EC_INLINE void SyncCursorFromSystem() {
 #ifdef __APPLE__
     CGEventRef ev = CGEventCreate(nullptr);
@@ -289,6 +329,7 @@ class SystemInput {
 #endif
     cur_x_ = x;
     cur_y_ = y;
+    MarkInjected_();
   }
 
   EC_INLINE void MouseMoveRelative(int dx, int dy) { MouseMoveTo(cur_x_ + dx, cur_y_ + dy); }
@@ -320,6 +361,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void MouseUp(int button) {
@@ -349,6 +391,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void MouseClick(int button) {
@@ -421,6 +464,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
     EmitDragPath_(sx, sy, x, y, button);
 #ifdef __APPLE__
     {
@@ -460,6 +504,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
   EC_INLINE void MouseDragBy(int dx, int dy, int button) { MouseDragTo(cur_x_ + dx, cur_y_ + dy, button); }
 
@@ -522,6 +567,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void ScrollPixels(int dx, int dy) {
@@ -551,6 +597,9 @@ class SystemInput {
         SendInput(1, &in, sizeof(in));
       }
     }
+#endif
+#if defined(__APPLE__) || defined(_WIN32)
+    MarkInjected_();
 #elif defined(__linux__)
 #ifdef INPUT_BACKEND_WAYLAND_WLR
     ScrollLines(dx, dy);
@@ -593,6 +642,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void KeyboardUp(int key) {
@@ -622,6 +672,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void KeyboardClick(int key) {
@@ -666,6 +717,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void KeyboardUpWithMods(int key, uint64_t mods) {
@@ -705,6 +757,7 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
   }
 
   EC_INLINE void KeyboardClickWithMods(int key, uint64_t mods) {
@@ -718,6 +771,7 @@ class SystemInput {
     if (mods & kOption) keybd_event(VK_MENU, 0, KEYEVENTF_KEYUP, 0);
     if (mods & kControl) keybd_event(VK_CONTROL, 0, KEYEVENTF_KEYUP, 0);
     if (mods & kShift) keybd_event(VK_SHIFT, 0, KEYEVENTF_KEYUP, 0);
+    MarkInjected_();
 #else
     KeyboardDownWithMods(key, mods);
     KeyboardUpWithMods(key, mods);
@@ -838,6 +892,345 @@ class SystemInput {
     }
 #endif
 #endif
+    MarkInjected_();
+  }
+
+  // Insert text through the clipboard: put utf8_text on the system clipboard
+  // (X11 CLIPBOARD, Wayland wlr data-control, Win32, macOS pasteboard) and
+  // send a single paste chord, V with chord_mods (default: Cmd on macOS,
+  // Ctrl elsewhere; pass kControl | kShift for terminals). Much faster than
+  // TypeUTF8 for long text and not limited to ASCII. The previous clipboard
+  // content is replaced.
+  // Falls back to TypeUTF8 and returns false when the clipboard cannot be set.
+  // Also returns false (X11 / Wayland) when nobody fetches the data after the
+  // chord; the chord is out by then, so the text is not typed as well.
+  EC_INLINE bool PasteText(const std::string& utf8_text, uint64_t chord_mods = kNone) {
+    if (utf8_text.empty()) return true;
+#ifdef __APPLE__
+    if (chord_mods == kNone) chord_mods = kCommand;
+#else
+    if (chord_mods == kNone) chord_mods = kControl;
+#endif
+    bool pasted = false;
+    bool chord_sent = false;  // a late paste may still land: don't type a second copy
+#ifdef __APPLE__
+    pasted = PasteMac_(utf8_text, chord_mods);
+#elif defined(_WIN32)
+    pasted = PasteWin_(utf8_text, chord_mods);
+#elif defined(__linux__)
+#if defined(INPUT_BACKEND_X11)
+    pasted = dpy_ && PasteX11_(utf8_text, chord_mods, chord_sent);
+#elif defined(INPUT_HAVE_WLR_DATA_CONTROL)
+    pasted = PasteWayland_(utf8_text, chord_mods, chord_sent);
+#endif
+#endif
+    if (!pasted && !chord_sent) TypeUTF8(utf8_text);
+    return pasted;
+  }
+
+  // ---------- Macros ----------
+  // Backend-native event buffer compiled from an InputMacro (see input_macro.hpp).
+  struct CompiledMacro {
+#if defined(_WIN32)
+    using Event = INPUT;
+#elif defined(INPUT_BACKEND_UINPUT)
+    using Event = input_event;
+#elif defined(INPUT_BACKEND_X11)
+    struct Event {
+      enum Kind : uint8_t { kMotion = 0, kButton, kKey };
+      Kind kind = kMotion;
+      Bool press = False;
+      unsigned int detail = 0;  // X button / keycode
+    };
+#else
+    using Event = InputMacro::Op;  // no batch submit: replayed through the primitives
+#endif
+    // Pointer position of events[index] (uinput: REL_X at index, REL_Y at index + 1),
+    // resolved against the replay parameters.
+    struct Move {
+      size_t index = 0;
+      InputMacro::Coord x, y;
+    };
+    // Sleep before events[index] is submitted.
+    struct Pause {
+      size_t index = 0;
+      int ms = 0;
+    };
+
+    std::vector<Event> events;
+    std::vector<Move> moves;
+    std::vector<Pause> pauses;
+    int param_count = 0;
+  };
+
+  EC_INLINE CompiledMacro CompileMacro(const InputMacro& macro) {
+    CompiledMacro out;
+    out.param_count = macro.ParamCount();
+    auto& ev = out.events;
+#if defined(_WIN32)
+    auto key = [&](WORD vk, bool press) {
+      INPUT in{};
+      in.type = INPUT_KEYBOARD;
+      in.ki.wVk = vk;
+      in.ki.dwFlags = press ? 0 : KEYEVENTF_KEYUP;
+      ev.push_back(in);
+    };
+    auto mods = [&](uint64_t m, bool press) {
+      if (press) {
+        if (m & kShift) key(VK_SHIFT, true);
+        if (m & kControl) key(VK_CONTROL, true);
+        if (m & kOption) key(VK_MENU, true);
+        if (m & kCommand) key(VK_LWIN, true);
+      } else {
+        if (m & kCommand) key(VK_LWIN, false);
+        if (m & kOption) key(VK_MENU, false);
+        if (m & kControl) key(VK_CONTROL, false);
+        if (m & kShift) key(VK_SHIFT, false);
+      }
+    };
+    for (const auto& op : macro.Ops()) {
+      INPUT in{};
+      in.type = INPUT_MOUSE;
+      switch (op.kind) {
+        case InputMacro::Op::kMove:
+          out.moves.push_back({ev.size(), op.x, op.y});
+          in.mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE;
+          ev.push_back(in);
+          break;
+        case InputMacro::Op::kButton:
+          in.mi.dwFlags = op.press ? WinButtonDownFlag_(op.code) : WinButtonUpFlag_(op.code);
+          ev.push_back(in);
+          break;
+        case InputMacro::Op::kKey:
+          if (op.press) mods(op.mods, true);
+          key((WORD)op.code, op.press);
+          if (!op.press) mods(op.mods, false);
+          break;
+        case InputMacro::Op::kScroll:
+          if (op.y.value) {
+            in.mi.dwFlags = MOUSEEVENTF_WHEEL;
+            in.mi.mouseData = (DWORD)op.y.value * WHEEL_DELTA;
+            ev.push_back(in);
+          }
+          if (op.x.value) {
+            in.mi.dwFlags = MOUSEEVENTF_HWHEEL;
+            in.mi.mouseData = (DWORD)op.x.value * WHEEL_DELTA;
+            ev.push_back(in);
+          }
+          break;
+        case InputMacro::Op::kDelay:
+          out.pauses.push_back({ev.size(), op.ms});
+          break;
+      }
+    }
+#elif defined(INPUT_BACKEND_UINPUT)
+    auto emit = [&](uint16_t type, uint16_t code, int value) {
+      input_event e{};
+      e.type = type;
+      e.code = code;
+      e.value = value;
+      ev.push_back(e);
+    };
+    auto mods = [&](uint64_t m, bool press) {
+      if (press) {
+        if (m & kShift) emit(EV_KEY, LinuxKeyShift_(), 1);
+        if (m & kControl) emit(EV_KEY, LinuxKeyCtrl_(), 1);
+        if (m & kOption) emit(EV_KEY, LinuxKeyAlt_(), 1);
+        if (m & kCommand) emit(EV_KEY, LinuxKeySuper_(), 1);
+      } else {
+        if (m & kCommand) emit(EV_KEY, LinuxKeySuper_(), 0);
+        if (m & kOption) emit(EV_KEY, LinuxKeyAlt_(), 0);
+        if (m & kControl) emit(EV_KEY, LinuxKeyCtrl_(), 0);
+        if (m & kShift) emit(EV_KEY, LinuxKeyShift_(), 0);
+      }
+    };
+    for (const auto& op : macro.Ops()) {
+      switch (op.kind) {
+        case InputMacro::Op::kMove:
+          out.moves.push_back({ev.size(), op.x, op.y});
+          emit(EV_REL, REL_X, 0);
+          emit(EV_REL, REL_Y, 0);
+          break;
+        case InputMacro::Op::kButton:
+          emit(EV_KEY, LinuxBtnCode_(op.code), op.press ? 1 : 0);
+          break;
+        case InputMacro::Op::kKey:
+          if (op.press) mods(op.mods, true);
+          emit(EV_KEY, op.code, op.press ? 1 : 0);
+          if (!op.press) mods(op.mods, false);
+          break;
+        case InputMacro::Op::kScroll:
+          if (op.y.value) emit(EV_REL, REL_WHEEL, op.y.value);
+          if (op.x.value) emit(EV_REL, REL_HWHEEL, op.x.value);
+          break;
+        case InputMacro::Op::kDelay:
+          out.pauses.push_back({ev.size(), op.ms});
+          continue;
+      }
+      emit(EV_SYN, SYN_REPORT, 0);
+    }
+#elif defined(INPUT_BACKEND_X11)
+    if (!dpy_) return out;
+    using E = CompiledMacro::Event;
+    auto key = [&](KeySym sym, bool press) {
+      const KeyCode kc = XKeysymToKeycode(dpy_, sym);
+      if (kc) ev.push_back({E::kKey, press ? True : False, kc});
+    };
+    auto mods = [&](uint64_t m, bool press) {
+      if (m & kShift) key(XK_Shift_L, press);
+      if (m & kControl) key(XK_Control_L, press);
+      if (m & kOption) key(XK_Alt_L, press);
+      if (m & kCommand) key(XK_Super_L, press);
+    };
+    for (const auto& op : macro.Ops()) {
+      switch (op.kind) {
+        case InputMacro::Op::kMove:
+          out.moves.push_back({ev.size(), op.x, op.y});
+          ev.push_back({E::kMotion, False, 0});
+          break;
+        case InputMacro::Op::kButton:
+          ev.push_back({E::kButton, op.press ? True : False, (unsigned)XButtonFromGeneric_(op.code)});
+          break;
+        case InputMacro::Op::kKey:
+          if (op.press) mods(op.mods, true);
+          ev.push_back({E::kKey, op.press ? True : False, (unsigned)op.code});
+          if (!op.press) mods(op.mods, false);
+          break;
+        case InputMacro::Op::kScroll: {
+          auto clicks = [&](unsigned btn, int n) {
+            for (int i = 0; i < n; ++i) {
+              ev.push_back({E::kButton, True, btn});
+              ev.push_back({E::kButton, False, btn});
+            }
+          };
+          clicks(op.y.value > 0 ? 4 : 5, std::abs(op.y.value));
+          clicks(op.x.value > 0 ? 6 : 7, std::abs(op.x.value));
+          break;
+        }
+        case InputMacro::Op::kDelay:
+          out.pauses.push_back({ev.size(), op.ms});
+          break;
+      }
+    }
+#else
+    ev = macro.Ops();
+#endif
+    return out;
+  }
+
+  // Submit a compiled macro: one SendInput / write() / XFlush per segment
+  // between Delay()s. params fill the InputMacro::Param() coordinates; returns
+  // false (and injects nothing) if fewer than param_count are given.
+  EC_INLINE bool ReplayMacro(const CompiledMacro& macro, std::initializer_list<int> params = {}) {
+    return ReplayMacro(macro, params.begin(), params.size());
+  }
+  EC_INLINE bool ReplayMacro(const CompiledMacro& macro, const int* params, size_t param_count) {
+    if (param_count < static_cast<size_t>(macro.param_count)) return false;
+    auto resolve = [&](const InputMacro::Coord& c) { return c.param >= 0 ? params[c.param] : c.value; };
+    auto clamp_x = [&](int x) { return std::max(0, std::min<int>(x, static_cast<int>(display_x_))); };
+    auto clamp_y = [&](int y) { return std::max(0, std::min<int>(y, static_cast<int>(display_y_))); };
+    // Walk events[begin, end) segments separated by pauses; submit(begin, end) injects one segment.
+    auto run_segments = [&](size_t n, auto&& submit) {
+      size_t begin = 0;
+      for (const auto& pause : macro.pauses) {
+        if (pause.index > begin) submit(begin, pause.index);
+        begin = std::max(begin, pause.index);
+        if (pause.ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(pause.ms));
+      }
+      if (n > begin) submit(begin, n);
+    };
+#if defined(_WIN32)
+    std::vector<INPUT> ev(macro.events);
+    for (const auto& mv : macro.moves) {
+      cur_x_ = clamp_x(resolve(mv.x));
+      cur_y_ = clamp_y(resolve(mv.y));
+      ev[mv.index].mi.dx = static_cast<LONG>((cur_x_ * 65535LL) / std::max<std::size_t>(1, display_x_ - 1));
+      ev[mv.index].mi.dy = static_cast<LONG>((cur_y_ * 65535LL) / std::max<std::size_t>(1, display_y_ - 1));
+    }
+    run_segments(ev.size(), [&](size_t b, size_t e) {
+      SendInput(static_cast<UINT>(e - b), ev.data() + b, sizeof(INPUT));
+      MarkInjected_();
+    });
+#elif defined(INPUT_BACKEND_UINPUT)
+    if (uinp_fd_ < 0) return false;
+    std::vector<input_event> ev(macro.events);
+    for (const auto& mv : macro.moves) {
+      const int x = clamp_x(resolve(mv.x)), y = clamp_y(resolve(mv.y));
+      ev[mv.index].value = x - cur_x_;
+      ev[mv.index + 1].value = y - cur_y_;
+      cur_x_ = x;
+      cur_y_ = y;
+    }
+    run_segments(ev.size(), [&](size_t b, size_t e) {
+      write(uinp_fd_, ev.data() + b, (e - b) * sizeof(input_event));
+      MarkInjected_();
+    });
+#elif defined(INPUT_BACKEND_X11)
+    if (!dpy_) return false;
+    std::vector<std::pair<int, int>> pos(macro.events.size());
+    for (const auto& mv : macro.moves) {
+      cur_x_ = clamp_x(resolve(mv.x));
+      cur_y_ = clamp_y(resolve(mv.y));
+      pos[mv.index] = {cur_x_, cur_y_};
+    }
+    using E = CompiledMacro::Event;
+    auto send = [&](size_t i, unsigned long delay_ms) {
+      const E& x = macro.events[i];
+      if (x.kind == E::kMotion) {
+        XTestFakeMotionEvent(dpy_, screen_, pos[i].first, pos[i].second, delay_ms);
+      } else if (x.kind == E::kButton) {
+        XTestFakeButtonEvent(dpy_, x.detail, x.press, delay_ms);
+      } else {
+        XTestFakeKeyEvent(dpy_, x.detail, x.press, delay_ms);
+      }
+    };
+    if (server_timing_) {
+      // Delays ride on the next event; only a trailing Delay() is slept client-side.
+      std::vector<unsigned long> delay(macro.events.size(), CurrentTime);
+      int trailing_ms = 0;
+      for (const auto& pause : macro.pauses) {
+        if (pause.index < delay.size()) {
+          delay[pause.index] += static_cast<unsigned long>(pause.ms);
+        } else {
+          trailing_ms += pause.ms;
+        }
+      }
+      for (size_t i = 0; i < macro.events.size(); ++i) send(i, delay[i]);
+      XFlush(dpy_);
+      MarkInjected_();
+      if (trailing_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(trailing_ms));
+      return true;
+    }
+    run_segments(macro.events.size(), [&](size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) send(i, CurrentTime);
+      XFlush(dpy_);
+      MarkInjected_();
+    });
+#else
+    run_segments(macro.events.size(), [&](size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        const InputMacro::Op& op = macro.events[i];
+        switch (op.kind) {
+          case InputMacro::Op::kMove:
+            MouseMoveTo(resolve(op.x), resolve(op.y));
+            break;
+          case InputMacro::Op::kButton:
+            op.press ? MouseDown(op.code) : MouseUp(op.code);
+            break;
+          case InputMacro::Op::kKey:
+            op.press ? KeyboardDownWithMods(op.code, op.mods) : KeyboardUpWithMods(op.code, op.mods);
+            break;
+          case InputMacro::Op::kScroll:
+            ScrollLines(op.x.value, op.y.value);
+            break;
+          case InputMacro::Op::kDelay:
+            if (op.ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(op.ms));
+            break;
+        }
+      }
+    });
+#endif
+    return true;
   }
 
   EC_INLINE int CharToKeyCode(char key_char) {
@@ -964,6 +1357,11 @@ class SystemInput {
   int mon_origin_logical_y_{0};
   int mon_width_px_{0};  // 显示器像素宽高（可用于裁剪）
   int mon_height_px_{0};
+  uint64_t last_seq_{0};
+  bool server_timing_{false};
+
+  // Called after an event has been handed to the OS / server.
+  EC_INLINE void MarkInjected_() { last_seq_ = NextInputSeq(); }
 
   EC_INLINE void EmitDragPath_(int start_x, int start_y, int end_x, int end_y, [[maybe_unused]] int button) {
     const int dx = end_x - start_x, dy = end_y - start_y;
@@ -972,6 +1370,11 @@ class SystemInput {
     int steps = std::max(8, dist / kStepPx);
     steps = std::min(steps, 240);
     auto lerp = [](int a, int b, double t) -> int { return (int)(a + (b - a) * t + (t < 1.0 ? 0.5 : 0.0)); };
+    const int kStepMs = 2;
+    bool server_paced = false;  // whole path in one flush, spaced by XTest delays
+#ifdef INPUT_BACKEND_X11
+    server_paced = server_timing_ && dpy_;
+#endif
     for (int i = 1; i <= steps; ++i) {
       const double t = (double)i / steps;
       const int ix = lerp(start_x, end_x, t);
@@ -1015,18 +1418,43 @@ class SystemInput {
       SendUinputSync_();
 #else
       if (dpy_) {
-        XTestFakeMotionEvent(dpy_, screen_, ix, iy, CurrentTime);
-        XFlush(dpy_);
+        XTestFakeMotionEvent(dpy_, screen_, ix, iy, server_paced ? kStepMs : CurrentTime);
+        if (!server_paced) XFlush(dpy_);
       }
 #endif
 #endif
       cur_x_ = ix;
       cur_y_ = iy;
-      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      if (server_paced) continue;
+      MarkInjected_();
+      std::this_thread::sleep_for(std::chrono::milliseconds(kStepMs));
     }
+#ifdef INPUT_BACKEND_X11
+    if (server_paced) {
+      XFlush(dpy_);
+      MarkInjected_();
+    }
+#endif
   }
 
 #ifdef __APPLE__
+  EC_INLINE bool PasteMac_(const std::string& text, uint64_t mods) {
+    PasteboardRef pb = nullptr;
+    if (PasteboardCreate(kPasteboardClipboard, &pb) != noErr || !pb) return false;
+    PasteboardClear(pb);
+    CFDataRef data =
+        CFDataCreate(kCFAllocatorDefault, reinterpret_cast<const UInt8*>(text.data()), static_cast<CFIndex>(text.size()));
+    OSStatus st = -1;
+    if (data) {
+      st = PasteboardPutItemFlavor(pb, (PasteboardItemID)1, CFSTR("public.utf8-plain-text"), data, kPasteboardFlavorNoFlags);
+      CFRelease(data);
+    }
+    CFRelease(pb);
+    if (st != noErr) return false;
+    KeyboardClickWithMods(kVK_ANSI_V, mods);
+    return true;
+  }
+
   EC_INLINE CGEventFlags BuildFlagsMac_(uint64_t mods) {
     CGEventFlags f = 0;
     if (mods & kShift) f |= kCGEventFlagMaskShift;
@@ -1053,6 +1481,50 @@ class SystemInput {
   EC_INLINE WORD WinButtonUpFlag_(int b) {
     return b == kRight ? MOUSEEVENTF_RIGHTUP : (b == kMiddle ? MOUSEEVENTF_MIDDLEUP : MOUSEEVENTF_LEFTUP);
   }
+  EC_INLINE bool PasteWin_(const std::string& text, uint64_t mods) {
+    const int n = MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), nullptr, 0);
+    if (n <= 0) return false;
+    HGLOBAL h = GlobalAlloc(GMEM_MOVEABLE, (static_cast<SIZE_T>(n) + 1) * sizeof(wchar_t));
+    if (!h) return false;
+    wchar_t* w = static_cast<wchar_t*>(GlobalLock(h));
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), (int)text.size(), w, n);
+    w[n] = 0;
+    GlobalUnlock(h);
+    if (!OpenClipboard(nullptr)) {
+      GlobalFree(h);
+      return false;
+    }
+    EmptyClipboard();
+    if (!SetClipboardData(CF_UNICODETEXT, h)) {  // on success the clipboard owns h
+      CloseClipboard();
+      GlobalFree(h);
+      return false;
+    }
+    CloseClipboard();
+    KeyboardClickWithMods('V', mods);
+    return true;
+  }
+#endif
+
+#if defined(INPUT_BACKEND_X11) || defined(INPUT_HAVE_WLR_DATA_CONTROL)
+  // UTF-8 to ISO 8859-1, the encoding of the X11 STRING target (also offered
+  // on Wayland for Xwayland clients). False if the text has characters
+  // outside Latin-1 or is not valid UTF-8; STRING is then not offered.
+  static bool Utf8ToLatin1_(const std::string& utf8, std::string& out) {
+    out.clear();
+    out.reserve(utf8.size());
+    for (size_t i = 0; i < utf8.size(); ++i) {
+      const unsigned char c = static_cast<unsigned char>(utf8[i]);
+      if (c < 0x80) {
+        out.push_back(static_cast<char>(c));
+      } else if ((c == 0xC2 || c == 0xC3) && i + 1 < utf8.size() && (utf8[i + 1] & 0xC0) == 0x80) {
+        out.push_back(static_cast<char>(((c & 0x1F) << 6) | (utf8[++i] & 0x3F)));
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
 #endif
 
 #ifdef __linux__
@@ -1070,6 +1542,157 @@ class SystemInput {
     if (mods & kOption) act(XK_Alt_L);
     if (mods & kCommand) act(XK_Super_L);
   }
+
+
+  // Own CLIPBOARD from a hidden window, send the paste chord and serve
+  // SelectionRequests (TARGETS, UTF8_STRING, TEXT, text/plain, and STRING
+  // when the text fits Latin-1) until the data has been fetched. Payloads
+  // above one request use INCR. chord_sent is set once the chord is out.
+  // Requests made before the chord (e.g. a clipboard manager reacting to the
+  // owner change) are answered but don't count as the paste being fetched.
+  EC_INLINE bool PasteX11_(const std::string& text, uint64_t mods, bool& chord_sent) {
+    const KeyCode kc_v = XKeysymToKeycode(dpy_, XK_v);
+    if (!kc_v) return false;
+    Window win = XCreateSimpleWindow(dpy_, RootWindow(dpy_, screen_), 0, 0, 1, 1, 0, 0, 0);
+    XSelectInput(dpy_, win, PropertyChangeMask);
+    const Atom clipboard = XInternAtom(dpy_, "CLIPBOARD", False);
+    const Atom targets = XInternAtom(dpy_, "TARGETS", False);
+    const Atom utf8 = XInternAtom(dpy_, "UTF8_STRING", False);
+    const Atom text_atom = XInternAtom(dpy_, "TEXT", False);
+    const Atom mime = XInternAtom(dpy_, "text/plain;charset=utf-8", False);
+    const Atom incr = XInternAtom(dpy_, "INCR", False);
+    std::string latin1;
+    const bool has_latin1 = Utf8ToLatin1_(text, latin1);
+
+    // ICCCM: acquire the selection with a real server timestamp, not CurrentTime.
+    const Atom stamp = XInternAtom(dpy_, "EC_PASTE_STAMP", False);
+    XEvent ev;
+    auto server_time = [&] {
+      XChangeProperty(dpy_, win, stamp, XA_STRING, 8, PropModeAppend, nullptr, 0);
+      XWindowEvent(dpy_, win, PropertyChangeMask, &ev);
+      return ev.xproperty.time;
+    };
+    XSetSelectionOwner(dpy_, clipboard, win, server_time());
+    if (XGetSelectionOwner(dpy_, clipboard) != win) {
+      XDestroyWindow(dpy_, win);
+      return false;
+    }
+
+    long units = XExtendedMaxRequestSize(dpy_);
+    if (units <= 0) units = XMaxRequestSize(dpy_);
+    const size_t chunk = static_cast<size_t>(std::max(4096L, std::min(units * 4 - 1024, 1L << 20)));
+
+    struct Incr {
+      Window requestor;
+      Atom property;
+      Atom type;
+      const std::string* data;
+      size_t offset;
+      bool counts;
+    };
+    std::vector<Incr> transfers;
+    bool served = false;  // some client received the text after the chord
+    bool lost = false;
+    bool chord_out = false;
+    Time chord_time = 0;
+
+    auto put = [&](Window w, Atom prop, Atom type, const std::string& data, size_t off, size_t len) {
+      XChangeProperty(dpy_, w, prop, type, 8, PropModeReplace,
+                      reinterpret_cast<const unsigned char*>(data.data()) + off, static_cast<int>(len));
+    };
+    auto handle = [&](XEvent& e) {
+      if (e.type == SelectionClear) {
+        lost = true;
+      } else if (e.type == SelectionRequest) {
+        const XSelectionRequestEvent& req = e.xselectionrequest;
+        XSelectionEvent reply{};
+        reply.type = SelectionNotify;
+        reply.display = req.display;
+        reply.requestor = req.requestor;
+        reply.selection = req.selection;
+        reply.target = req.target;
+        reply.time = req.time;
+        reply.property = None;
+        const Atom prop = req.property != None ? req.property : req.target;  // obsolete clients
+        // Server time wraps at 32 bits; CurrentTime can't be placed, so trust it once the chord is out.
+        const bool counts = chord_out && (req.time == CurrentTime ||
+                                          static_cast<int32_t>(static_cast<uint32_t>(req.time - chord_time)) >= 0);
+        if (req.selection == clipboard && req.target == targets) {
+          const Atom list[] = {targets, utf8, mime, text_atom, XA_STRING};
+          XChangeProperty(dpy_, req.requestor, prop, XA_ATOM, 32, PropModeReplace,
+                          reinterpret_cast<const unsigned char*>(list), has_latin1 ? 5 : 4);
+          reply.property = prop;
+        } else if (req.selection == clipboard && (req.target == utf8 || req.target == mime || req.target == text_atom ||
+                                                  (req.target == XA_STRING && has_latin1))) {
+          const Atom type = req.target == text_atom ? utf8 : req.target;
+          const std::string& data = req.target == XA_STRING ? latin1 : text;
+          if (data.size() <= chunk) {
+            put(req.requestor, prop, type, data, 0, data.size());
+            served = served || counts;
+          } else {
+            XSelectInput(dpy_, req.requestor, PropertyChangeMask);
+            const long total = static_cast<long>(data.size());
+            XChangeProperty(dpy_, req.requestor, prop, incr, 32, PropModeReplace,
+                            reinterpret_cast<const unsigned char*>(&total), 1);
+            transfers.push_back(Incr{req.requestor, prop, type, &data, 0, counts});
+          }
+          reply.property = prop;
+        }
+        XSendEvent(dpy_, req.requestor, False, NoEventMask, reinterpret_cast<XEvent*>(&reply));
+      } else if (e.type == PropertyNotify && e.xproperty.state == PropertyDelete) {
+        // INCR: the requestor consumed the previous chunk; a zero-length chunk ends the transfer.
+        for (size_t i = 0; i < transfers.size(); ++i) {
+          Incr& tr = transfers[i];
+          if (tr.requestor != e.xproperty.window || tr.property != e.xproperty.atom) continue;
+          const size_t len = std::min(chunk, tr.data->size() - tr.offset);
+          put(tr.requestor, tr.property, tr.type, *tr.data, tr.offset, len);
+          tr.offset += len;
+          if (len == 0) {
+            XSelectInput(dpy_, tr.requestor, NoEventMask);
+            served = served || tr.counts;
+            transfers.erase(transfers.begin() + static_cast<std::ptrdiff_t>(i));
+          }
+          break;
+        }
+      }
+      XFlush(dpy_);
+    };
+
+    // Answer what is already queued (uncounted), then stamp the chord so
+    // requests still in flight from before it are told apart by their time.
+    XSync(dpy_, False);
+    while (XPending(dpy_) > 0) {
+      XNextEvent(dpy_, &ev);
+      handle(ev);
+    }
+    chord_time = server_time();
+    chord_out = true;
+    KeyboardDownWithMods(kc_v, mods);
+    KeyboardUpWithMods(kc_v, mods);
+    chord_sent = true;
+
+    // Wait for the target to fetch; allow a short grace period for a
+    // follow-up request once served, and give up after a quiet second.
+    using Clock = std::chrono::steady_clock;
+    const auto kIdleTimeout = std::chrono::milliseconds(1000);
+    const auto kGrace = std::chrono::milliseconds(100);
+    auto last_activity = Clock::now();
+    for (;;) {
+      while (XPending(dpy_) > 0) {
+        XNextEvent(dpy_, &ev);
+        handle(ev);
+        last_activity = Clock::now();
+      }
+      const auto idle = Clock::now() - last_activity;
+      if (transfers.empty() && (served ? idle >= kGrace : (lost || idle >= kIdleTimeout))) break;
+      if (idle >= kIdleTimeout) break;  // stalled INCR requestor
+      pollfd pfd{ConnectionNumber(dpy_), POLLIN, 0};
+      poll(&pfd, 1, 10);
+    }
+    XDestroyWindow(dpy_, win);  // releases the selection
+    XFlush(dpy_);
+    return served;
+  }
 #endif
 
 #ifdef INPUT_BACKEND_UINPUT
@@ -1151,6 +1774,9 @@ class SystemInput {
   zwp_virtual_keyboard_manager_v1* vkbd_mgr_{nullptr};
   zwlr_virtual_pointer_v1* vp_dev_{nullptr};
   zwp_virtual_keyboard_v1* vkb_dev_{nullptr};
+#ifdef INPUT_HAVE_WLR_DATA_CONTROL
+  zwlr_data_control_manager_v1* dc_mgr_{nullptr};
+#endif
 
   static void RegistryGlobal_(void* data, wl_registry* reg, uint32_t name, const char* interface, uint32_t version) {
     auto* self = static_cast<SystemInput*>(data);
@@ -1162,6 +1788,11 @@ class SystemInput {
     else if (strcmp(interface, zwp_virtual_keyboard_manager_v1_interface.name) == 0)
       self->vkbd_mgr_ =
           (zwp_virtual_keyboard_manager_v1*)wl_registry_bind(reg, name, &zwp_virtual_keyboard_manager_v1_interface, 1);
+#ifdef INPUT_HAVE_WLR_DATA_CONTROL
+    else if (strcmp(interface, zwlr_data_control_manager_v1_interface.name) == 0)
+      self->dc_mgr_ =
+          (zwlr_data_control_manager_v1*)wl_registry_bind(reg, name, &zwlr_data_control_manager_v1_interface, 1);
+#endif
   }
   static void RegistryGlobalRemove_(void*, wl_registry*, uint32_t) {}
   EC_INLINE const wl_registry_listener& RegistryListener() const {
@@ -1169,6 +1800,124 @@ class SystemInput {
     return k;
   }
 
+#ifdef INPUT_HAVE_WLR_DATA_CONTROL
+  struct PasteSource_ {
+    const std::string* text = nullptr;
+    std::string latin1;  // for "STRING"
+    bool chord_sent = false;
+    int sends = 0;  // after the chord; clipboard managers fetch as soon as the selection is set
+    bool cancelled = false;
+    std::vector<zwlr_data_control_offer_v1*> offers;  // announced by the device, destroyed at the end
+  };
+
+  // Write the whole payload to the receiver's pipe. SIGPIPE is blocked for
+  // this thread only, so a receiver closing early just ends the write.
+  static void WritePasteFd_(int fd, const std::string& text) {
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    size_t off = 0;
+    bool broken = false;
+    while (off < text.size()) {
+      const ssize_t n = write(fd, text.data() + off, text.size() - off);
+      if (n > 0) {
+        off += static_cast<size_t>(n);
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else if (n < 0 && errno == EAGAIN) {
+        pollfd pfd{fd, POLLOUT, 0};
+        if (poll(&pfd, 1, 1000) <= 0) break;
+      } else {
+        broken = n < 0 && errno == EPIPE;
+        break;
+      }
+    }
+    if (broken) {
+      const timespec zero{0, 0};
+      sigtimedwait(&block, nullptr, &zero);  // consume the pending SIGPIPE
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    close(fd);
+  }
+
+  static void PasteSend_(void* data, zwlr_data_control_source_v1*, const char* mime, int32_t fd) {
+    auto* src = static_cast<PasteSource_*>(data);
+    WritePasteFd_(fd, mime && strcmp(mime, "STRING") == 0 ? src->latin1 : *src->text);
+    if (src->chord_sent) ++src->sends;
+  }
+  static void PasteCancelled_(void* data, zwlr_data_control_source_v1*) {
+    static_cast<PasteSource_*>(data)->cancelled = true;
+  }
+  // The device announces the current selection (ours, or the previous one)
+  // as new offer objects; they are only collected so they can be destroyed.
+  static void PasteDataOffer_(void* data, zwlr_data_control_device_v1*, zwlr_data_control_offer_v1* offer) {
+    static_cast<PasteSource_*>(data)->offers.push_back(offer);
+  }
+  static void PasteSelection_(void*, zwlr_data_control_device_v1*, zwlr_data_control_offer_v1*) {}
+  static void PasteFinished_(void*, zwlr_data_control_device_v1*) {}
+
+  // chord_sent is set once the chord is out.
+  EC_INLINE bool PasteWayland_(const std::string& text, uint64_t mods, bool& chord_sent) {
+    if (!dc_mgr_ || !wl_seat_ || !vkb_dev_) return false;
+    static const zwlr_data_control_source_v1_listener kListener = {PasteSend_, PasteCancelled_};
+    // Assigned member by member: primary_selection exists only in newer protocol headers (bound as v1 here).
+    static const zwlr_data_control_device_v1_listener kDeviceListener = [] {
+      zwlr_data_control_device_v1_listener l{};
+      l.data_offer = PasteDataOffer_;
+      l.selection = PasteSelection_;
+      l.finished = PasteFinished_;
+      return l;
+    }();
+    PasteSource_ state;
+    state.text = &text;
+    zwlr_data_control_device_v1* dev = zwlr_data_control_manager_v1_get_data_device(dc_mgr_, wl_seat_);
+    zwlr_data_control_device_v1_add_listener(dev, &kDeviceListener, &state);
+    zwlr_data_control_source_v1* src = zwlr_data_control_manager_v1_create_data_source(dc_mgr_);
+    zwlr_data_control_source_v1_add_listener(src, &kListener, &state);
+    for (const char* m : {"text/plain;charset=utf-8", "text/plain", "UTF8_STRING", "TEXT"}) {
+      zwlr_data_control_source_v1_offer(src, m);
+    }
+    if (Utf8ToLatin1_(text, state.latin1)) zwlr_data_control_source_v1_offer(src, "STRING");
+    zwlr_data_control_device_v1_set_selection(dev, src);
+    wl_display_roundtrip(wl_display_);
+
+    const int key_v = LinuxAsciiToKeyCode_('v');
+    state.chord_sent = true;
+    KeyboardDownWithMods(key_v, mods);
+    KeyboardUpWithMods(key_v, mods);
+    chord_sent = true;
+
+    using Clock = std::chrono::steady_clock;
+    const auto kIdleTimeout = std::chrono::milliseconds(1000);
+    const auto kGrace = std::chrono::milliseconds(100);
+    auto last_activity = Clock::now();
+    int seen_sends = 0;
+    while (!state.cancelled) {
+      while (wl_display_prepare_read(wl_display_) != 0) wl_display_dispatch_pending(wl_display_);
+      wl_display_flush(wl_display_);
+      pollfd pfd{wl_display_get_fd(wl_display_), POLLIN, 0};
+      if (poll(&pfd, 1, 10) > 0) {
+        wl_display_read_events(wl_display_);
+      } else {
+        wl_display_cancel_read(wl_display_);
+      }
+      wl_display_dispatch_pending(wl_display_);
+      if (state.sends != seen_sends) {
+        seen_sends = state.sends;
+        last_activity = Clock::now();
+      }
+      const auto idle = Clock::now() - last_activity;
+      if (state.sends > 0 ? idle >= kGrace : idle >= kIdleTimeout) break;
+    }
+    zwlr_data_control_source_v1_destroy(src);
+    for (zwlr_data_control_offer_v1* offer : state.offers) zwlr_data_control_offer_v1_destroy(offer);
+    zwlr_data_control_device_v1_destroy(dev);
+    wl_display_flush(wl_display_);
+    return state.sends > 0;
+  }
+#endif
+
   EC_INLINE uint32_t LinuxBtnCode_(int b) const { return b == kRight ? BTN_RIGHT : (b == kMiddle ? BTN_MIDDLE : BTN_LEFT); }
   EC_INLINE int LinuxKeyShift_() const { return KEY_LEFTSHIFT; }
   EC_INLINE int LinuxKeyCtrl_() const { return KEY_LEFTCTRL; }
@@ -6,6 +6,8 @@
 #define EASY_CONTROL_INCLUDE_SYSTEM_OUTPUT_HPP
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,6 +19,33 @@ struct ImageRGBA {
   int width = 0;
   int height = 0;
   std::vector<uint8_t> pixels;  // RGBA8, size = w*h*4
+
+  // Frame/input correlation (see NextInputSeq() in common.hpp):
+  // last input sequence number injected before the grab began, and the
+  // steady-clock span of the grab in nanoseconds (NowSteadyNanos()).
+  uint64_t input_seq = 0;
+  uint64_t grab_begin_ns = 0;
+  uint64_t grab_end_ns = 0;
+};
+
+// Pixel rectangle. For capture APIs it is expressed in display-local coordinates.
+struct ScreenRect {
+  int x = 0;
+  int y = 0;
+  int w = 0;
+  int h = 0;
+};
+
+// One display as the backend sees it.
+struct DisplayInfo {
+  int index = 0;          // capture index, [0, GetDisplayCount())
+  std::string id;         // stable across hotplug and reordering (connector / device name, vendor-model-serial)
+  std::string name;       // human-readable
+  ScreenRect bounds;      // desktop coordinates (points on macOS, pixels elsewhere)
+  double refresh_hz = 0;  // 0 if unknown
+  double scale = 1.0;     // physical pixels per desktop unit
+  int rotation = 0;       // degrees clockwise: 0, 90, 180 or 270
+  bool primary = false;
 };
 
 class SystemOutput {
@@ -25,11 +54,68 @@ class SystemOutput {
   // displayIndex in [0, GetDisplayCount()).
   static bool CaptureScreenWithCursor(int display_index, ImageRGBA& out_image);
 
+  // Capture a sub-rectangle of a display with cursor blended.
+  // region is display-local and clipped to the display bounds; fails if nothing remains.
+  static bool CaptureRegionWithCursor(int display_index, const ScreenRect& region, ImageRGBA& out_image);
+
   // Number of displays.
   static int GetDisplayCount();
 
   // Human-readable display info.
   static std::string GetDisplayInfo(int display_index);
+
+  // All displays. Served from a cache that the backend invalidates on
+  // configuration changes (RandR, CGDisplay reconfiguration, WM_DISPLAYCHANGE,
+  // wl_output); backends that cannot watch refresh it at most once per second.
+  static std::vector<DisplayInfo> GetDisplays();
+  static bool GetDisplay(int display_index, DisplayInfo& out);
+
+  // Called with the new list after displays are added, removed or
+  // reconfigured, from a backend thread (on macOS: the main run loop). A
+  // callback may run once more after removal if a change is being delivered.
+  using DisplayChangeCallback = std::function<void(const std::vector<DisplayInfo>&)>;
+  static int AddDisplayChangeCallback(DisplayChangeCallback callback);
+  static void RemoveDisplayChangeCallback(int id);
+};
+
+// Repeated capture of one display. Keeps backend state between grabs (server
+// connection, shared-memory buffers) and, where the backend can tell, reports
+// which regions changed. Each backend implements it next to SystemOutput.
+class CaptureSession {
+ public:
+  explicit CaptureSession(int display_index);
+  ~CaptureSession();
+
+  CaptureSession(const CaptureSession&) = delete;
+  CaptureSession& operator=(const CaptureSession&) = delete;
+
+  // False if the display could not be opened.
+  bool IsOpen() const;
+  int DisplayIndex() const { return display_index_; }
+
+  // Grab the whole display now (cursor blended). Fails instead of blocking
+  // if the display server does not deliver the frame within about a second.
+  //
+  // out_image is normally overwritten with a full copy of the frame. With
+  // patch_out the caller promises that out_image is the very image this
+  // session filled on its previous call and that nobody modified its pixels
+  // since; backends that track changes (X11) then only rewrite the changed
+  // rectangles. Don't set it for pooled or shared frames.
+  bool Grab(ImageRGBA& out_image, bool patch_out = false);
+
+  // Wait up to timeout_ms (< 0: forever) for the display to change, then grab
+  // it; damage (if given) receives the changed display-local regions. The
+  // first call reports the whole frame. Backends without damage tracking
+  // (SupportsDamage() == false) return at once with the whole frame as damage.
+  // Returns false on timeout or error. patch_out as for Grab().
+  bool GrabChanged(ImageRGBA& out_image, std::vector<ScreenRect>* damage, int timeout_ms, bool patch_out = false);
+
+  bool SupportsDamage() const;
+
+ private:
+  struct Impl;
+  int display_index_;
+  std::unique_ptr<Impl> impl_;
 };
 
 }  // namespace autoalg
@@ -6,9 +6,13 @@
 #include <gio/gio.h>
 
 #include <cstdlib>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "common.hpp"
+#include "display_cache.hpp"
+#include "image_util.hpp"
 #include "system_output.hpp"
 
 // Detect if WAYLAND is active
@@ -154,8 +158,11 @@ bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA& out) {
   (void)displayIndex;
   if (!is_wayland()) return false;
 
+  const uint64_t seq = CurrentInputSeq();
+  const uint64_t begin_ns = NowSteadyNanos();
   std::vector<unsigned char> png;
   if (!portal_screenshot_png(png)) return false;
+  const uint64_t end_ns = NowSteadyNanos();
 
   int w = 0, h = 0, n = 0;
   unsigned char* data = stbi_load_from_memory(png.data(), (int)png.size(), &w, &h, &n, 4);
@@ -164,19 +171,58 @@ bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA& out) {
   out.width = w;
   out.height = h;
   out.pixels.assign(data, data + (size_t)w * h * 4);
+  out.input_seq = seq;
+  out.grab_begin_ns = begin_ns;
+  out.grab_end_ns = end_ns;
   stbi_image_free(data);
   return true;
 }
 
-int SystemOutput::GetDisplayCount() {
-  if (is_wayland()) return 1;  // portal abstracts monitors
-  return 0;
+// The portal only returns full screenshots; crop afterwards.
+bool SystemOutput::CaptureRegionWithCursor(int displayIndex, const ScreenRect& region, ImageRGBA& out) {
+  ImageRGBA full;
+  if (!CaptureScreenWithCursor(displayIndex, full)) return false;
+  return CropImage(full, region, out);
 }
 
-std::string SystemOutput::GetDisplayInfo(int index) {
-  (void)index;
-  return "Linux Wayland (xdg-desktop-portal)";
+namespace detail {
+// The portal abstracts monitors into one screenshot of unknown geometry.
+std::vector<DisplayInfo> QueryDisplays() {
+  if (!is_wayland()) return {};
+  DisplayInfo d;
+  d.id = "portal";
+  d.name = "Linux Wayland (xdg-desktop-portal)";
+  d.primary = true;
+  return {d};
 }
 
+bool StartDisplayWatch(std::function<void()> on_change) {
+  (void)on_change;
+  return false;
+}
+}  // namespace detail
+
+// The portal hands out one-shot screenshots; a session re-grabs the whole display.
+struct CaptureSession::Impl {};
+
+CaptureSession::CaptureSession(int display_index) : display_index_(display_index) {}
+
+CaptureSession::~CaptureSession() = default;
+
+bool CaptureSession::IsOpen() const { return display_index_ >= 0 && display_index_ < SystemOutput::GetDisplayCount(); }
+
+bool CaptureSession::Grab(ImageRGBA& out_image, bool /*patch_out*/) {
+  return SystemOutput::CaptureScreenWithCursor(display_index_, out_image);
+}
+
+bool CaptureSession::GrabChanged(ImageRGBA& out_image, std::vector<ScreenRect>* damage, int timeout_ms, bool /*patch_out*/) {
+  (void)timeout_ms;
+  if (!Grab(out_image)) return false;
+  if (damage) damage->assign(1, ScreenRect{0, 0, out_image.width, out_image.height});
+  return true;
+}
+
+bool CaptureSession::SupportsDamage() const { return false; }
+
 }  // namespace autoalg
 #endif
\ No newline at end of file
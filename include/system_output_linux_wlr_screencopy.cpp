@@ -0,0 +1,541 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Screen capture on wlroots compositors (sway, Hyprland, river, ...) through
+// zwlr_screencopy_manager_v1. Each CaptureSession owns a Wayland connection
+// and one wl_shm buffer that is reused for every frame while the output's
+// format and size stay the same, so steady-state grabs do no allocation and
+// no portal round trip. GrabChanged() uses copy_with_damage: the compositor
+// answers only once the output changed and reports the damaged rectangles.
+
+#if defined(__linux__) && defined(AUTOALG_USE_WLR_SCREENCOPY) && !defined(AUTOALG_USE_WAYLAND_PORTAL)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <zwlr-screencopy-unstable-v1-client-protocol.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "display_cache.hpp"
+#include "image_util.hpp"
+#include "system_output.hpp"
+
+namespace {
+struct Connection;
+
+// Grab() copies the current contents, so the compositor answers within a
+// frame or two; a compositor that never does must not hang the caller.
+constexpr int kGrabTimeoutMs = 1000;
+
+struct Output {
+  Connection *conn = nullptr;
+  wl_output *output = nullptr;
+  uint32_t global = 0;        // registry name
+  int x = 0, y = 0;           // compositor-space position
+  int width = 0, height = 0;  // current mode in pixels
+  int refresh_mhz = 0;
+  int scale = 1;
+  int transform = 0;          // wl_output_transform
+  std::string name;           // connector, wl_output v4
+  std::string make, model;
+};
+
+// A Wayland connection with the globals screencopy needs. changed is set when
+// outputs come, go or finish an update (the display watch polls it).
+struct Connection {
+  wl_display *display = nullptr;
+  wl_registry *registry = nullptr;
+  wl_shm *shm = nullptr;
+  zwlr_screencopy_manager_v1 *manager = nullptr;
+  uint32_t manager_version = 0;
+  std::vector<std::unique_ptr<Output>> outputs;  // registry order; stable addresses for listeners
+  bool changed = false;
+
+  static void OutputGeometry(void *data, wl_output *, int32_t x, int32_t y, int32_t, int32_t, int32_t,
+                             const char *make, const char *model, int32_t transform) {
+    auto *o = static_cast<Output *>(data);
+    o->x = x;
+    o->y = y;
+    o->make = make ? make : "";
+    o->model = model ? model : "";
+    o->transform = transform;
+  }
+
+  static void OutputMode(void *data, wl_output *, uint32_t flags, int32_t width, int32_t height, int32_t refresh) {
+    if (!(flags & WL_OUTPUT_MODE_CURRENT)) return;
+    auto *o = static_cast<Output *>(data);
+    o->width = width;
+    o->height = height;
+    o->refresh_mhz = refresh;
+  }
+
+  static void OutputDone(void *data, wl_output *) { static_cast<Output *>(data)->conn->changed = true; }
+
+  static void OutputScale(void *data, wl_output *, int32_t factor) {
+    static_cast<Output *>(data)->scale = factor > 0 ? factor : 1;
+  }
+
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+  static void OutputName(void *data, wl_output *, const char *name) {
+    static_cast<Output *>(data)->name = name ? name : "";
+  }
+  static void OutputDescription(void *, wl_output *, const char *) {}
+  static constexpr uint32_t kOutputVersion = 4;
+#else
+  static constexpr uint32_t kOutputVersion = 2;
+#endif
+
+  // Assigned member by member: the listener grows with the libwayland version.
+  static const wl_output_listener &OutputListener() {
+    static const wl_output_listener k = [] {
+      wl_output_listener l{};
+      l.geometry = OutputGeometry;
+      l.mode = OutputMode;
+      l.done = OutputDone;
+      l.scale = OutputScale;
+#ifdef WL_OUTPUT_NAME_SINCE_VERSION
+      l.name = OutputName;
+      l.description = OutputDescription;
+#endif
+      return l;
+    }();
+    return k;
+  }
+
+  static void Global(void *data, wl_registry *reg, uint32_t name, const char *interface, uint32_t version) {
+    auto *self = static_cast<Connection *>(data);
+    if (std::strcmp(interface, wl_shm_interface.name) == 0) {
+      self->shm = (wl_shm *)wl_registry_bind(reg, name, &wl_shm_interface, 1);
+    } else if (std::strcmp(interface, zwlr_screencopy_manager_v1_interface.name) == 0) {
+      self->manager_version = std::min<uint32_t>(version, 3);
+      self->manager = (zwlr_screencopy_manager_v1 *)wl_registry_bind(reg, name, &zwlr_screencopy_manager_v1_interface,
+                                                                     self->manager_version);
+    } else if (std::strcmp(interface, wl_output_interface.name) == 0) {
+      std::unique_ptr<Output> o(new Output);
+      o->conn = self;
+      o->global = name;
+      o->output = (wl_output *)wl_registry_bind(reg, name, &wl_output_interface, std::min(version, kOutputVersion));
+      wl_output_add_listener(o->output, &OutputListener(), o.get());
+      self->outputs.push_back(std::move(o));
+    }
+  }
+
+  static void GlobalRemove(void *data, wl_registry *, uint32_t name) {
+    auto *self = static_cast<Connection *>(data);
+    auto &outs = self->outputs;
+    auto it = std::find_if(outs.begin(), outs.end(), [&](const std::unique_ptr<Output> &o) { return o->global == name; });
+    if (it == outs.end()) return;
+    wl_output_destroy((*it)->output);
+    outs.erase(it);
+    self->changed = true;
+  }
+
+  bool Open() {
+    display = wl_display_connect(nullptr);
+    if (!display) return false;
+    static const wl_registry_listener k = {Global, GlobalRemove};
+    registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &k, this);
+    wl_display_roundtrip(display);  // globals
+    wl_display_roundtrip(display);  // output geometry / mode
+    changed = false;
+    return shm && manager;
+  }
+
+  ~Connection() {
+    for (auto &o : outputs) wl_output_destroy(o->output);
+    if (manager) zwlr_screencopy_manager_v1_destroy(manager);
+    if (shm) wl_shm_destroy(shm);
+    if (registry) wl_registry_destroy(registry);
+    if (display) wl_display_disconnect(display);
+  }
+};
+
+// Output hotplug and mode changes seen on a private connection.
+class OutputWatch {
+ public:
+  ~OutputWatch() {
+    if (thread_.joinable()) {
+      const char c = 1;
+      (void)!write(wake_[1], &c, 1);
+      thread_.join();
+    }
+    if (wake_[0] >= 0) close(wake_[0]);
+    if (wake_[1] >= 0) close(wake_[1]);
+  }
+
+  bool Start(std::function<void()> on_change) {
+    if (!conn_.Open() || pipe2(wake_, O_CLOEXEC) != 0) return false;
+    on_change_ = std::move(on_change);
+    thread_ = std::thread([this] { Run_(); });
+    return true;
+  }
+
+ private:
+  void Run_() {
+    wl_display *d = conn_.display;
+    for (;;) {
+      while (wl_display_prepare_read(d) != 0) {
+        if (wl_display_dispatch_pending(d) < 0) return;
+      }
+      wl_display_flush(d);
+      pollfd fds[2] = {{wl_display_get_fd(d), POLLIN, 0}, {wake_[0], POLLIN, 0}};
+      const int n = poll(fds, 2, -1);
+      if (n < 0 && errno == EINTR) {
+        wl_display_cancel_read(d);
+        continue;
+      }
+      if (n < 0 || fds[1].revents) {
+        wl_display_cancel_read(d);
+        return;
+      }
+      if (wl_display_read_events(d) < 0 || wl_display_dispatch_pending(d) < 0) return;
+      if (conn_.changed) {
+        conn_.changed = false;
+        on_change_();
+      }
+    }
+  }
+
+  Connection conn_;
+  int wake_[2] = {-1, -1};
+  std::function<void()> on_change_;
+  std::thread thread_;
+};
+
+// Persistent shm buffer, recreated only when the compositor asks for a
+// different format or size.
+struct ShmBuffer {
+  wl_buffer *buffer = nullptr;
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  uint32_t format = 0;
+  int width = 0, height = 0, stride = 0;
+
+  bool Matches(uint32_t f, int w, int h, int s) const {
+    return buffer && format == f && width == w && height == h && stride == s;
+  }
+
+  bool Create(wl_shm *shm, uint32_t f, int w, int h, int s) {
+    Release();
+    const size_t bytes = static_cast<size_t>(s) * h;
+    const int fd = memfd_create("autoalg-screencopy", MFD_CLOEXEC);
+    if (fd < 0) return false;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    wl_shm_pool *pool = wl_shm_create_pool(shm, fd, static_cast<int32_t>(bytes));
+    buffer = wl_shm_pool_create_buffer(pool, 0, w, h, s, f);
+    wl_shm_pool_destroy(pool);  // the buffer keeps the memory alive
+    close(fd);
+    data = static_cast<uint8_t *>(p);
+    size = bytes;
+    format = f;
+    width = w;
+    height = h;
+    stride = s;
+    return buffer != nullptr;
+  }
+
+  void Release() {
+    if (buffer) wl_buffer_destroy(buffer);
+    if (data) munmap(data, size);
+    buffer = nullptr;
+    data = nullptr;
+    size = 0;
+  }
+
+  ~ShmBuffer() { Release(); }
+};
+
+EC_INLINE bool FormatSupported(uint32_t f) {
+  return f == WL_SHM_FORMAT_XRGB8888 || f == WL_SHM_FORMAT_ARGB8888 || f == WL_SHM_FORMAT_XBGR8888 ||
+         f == WL_SHM_FORMAT_ABGR8888;
+}
+
+// shm pixels -> RGBA8 (alpha forced opaque), flipping rows if y_invert.
+void ConvertShm(const ShmBuffer &b, bool y_invert, autoalg::ImageRGBA &out) {
+  out.width = b.width;
+  out.height = b.height;
+  out.pixels.resize(static_cast<size_t>(b.width) * b.height * 4);
+  // Little-endian XRGB/ARGB is B,G,R,X in memory; XBGR/ABGR is R,G,B,X.
+  const bool bgr = b.format == WL_SHM_FORMAT_XRGB8888 || b.format == WL_SHM_FORMAT_ARGB8888;
+  for (int y = 0; y < b.height; ++y) {
+    const uint8_t *s = b.data + static_cast<size_t>(y_invert ? b.height - 1 - y : y) * b.stride;
+    uint8_t *d = out.pixels.data() + static_cast<size_t>(y) * b.width * 4;
+    if (bgr) {
+      for (int x = 0; x < b.width; ++x, s += 4, d += 4) {
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = s[0];
+        d[3] = 255;
+      }
+    } else {
+      for (int x = 0; x < b.width; ++x, s += 4, d += 4) {
+        d[0] = s[0];
+        d[1] = s[1];
+        d[2] = s[2];
+        d[3] = 255;
+      }
+    }
+  }
+}
+}  // namespace
+
+namespace autoalg {
+
+struct CaptureSession::Impl {
+  Connection conn;
+  Output *output = nullptr;
+  ShmBuffer buf;
+  bool first = true;
+
+  // State of the frame in flight.
+  struct Frame {
+    Impl *self = nullptr;
+    zwlr_screencopy_frame_v1 *frame = nullptr;
+    bool with_damage = false;
+    bool have_shm = false;
+    uint32_t format = 0;
+    int width = 0, height = 0, stride = 0;
+    bool copying = false;
+    bool ready = false;
+    bool failed = false;
+    bool y_invert = false;
+    std::vector<ScreenRect> damage;
+  };
+
+  static void StartCopy(Frame *f) {
+    if (f->copying) return;
+    f->copying = true;
+    Impl *self = f->self;
+    if (!f->have_shm || (!self->buf.Matches(f->format, f->width, f->height, f->stride) &&
+                         !self->buf.Create(self->conn.shm, f->format, f->width, f->height, f->stride))) {
+      f->failed = true;
+      return;
+    }
+    if (f->with_damage && self->conn.manager_version >= 2) {
+      zwlr_screencopy_frame_v1_copy_with_damage(f->frame, self->buf.buffer);
+    } else {
+      zwlr_screencopy_frame_v1_copy(f->frame, self->buf.buffer);
+    }
+  }
+
+  static void OnBuffer(void *data, zwlr_screencopy_frame_v1 *, uint32_t format, uint32_t width, uint32_t height,
+                       uint32_t stride) {
+    auto *f = static_cast<Frame *>(data);
+    if (f->have_shm) return;
+    if (!FormatSupported(format)) {
+      // Before v3 this is the only offer and no buffer_done follows.
+      if (f->self->conn.manager_version < 3) f->failed = true;
+      return;
+    }
+    f->have_shm = true;
+    f->format = format;
+    f->width = static_cast<int>(width);
+    f->height = static_cast<int>(height);
+    f->stride = static_cast<int>(stride);
+    // Before v3 there is no buffer_done; the shm offer is the only one.
+    if (f->self->conn.manager_version < 3) StartCopy(f);
+  }
+
+  static void OnFlags(void *data, zwlr_screencopy_frame_v1 *, uint32_t flags) {
+    static_cast<Frame *>(data)->y_invert = (flags & ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT) != 0;
+  }
+
+  static void OnReady(void *data, zwlr_screencopy_frame_v1 *, uint32_t, uint32_t, uint32_t) {
+    static_cast<Frame *>(data)->ready = true;
+  }
+
+  static void OnFailed(void *data, zwlr_screencopy_frame_v1 *) { static_cast<Frame *>(data)->failed = true; }
+
+  static void OnDamage(void *data, zwlr_screencopy_frame_v1 *, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    static_cast<Frame *>(data)->damage.push_back(
+        ScreenRect{static_cast<int>(x), static_cast<int>(y), static_cast<int>(w), static_cast<int>(h)});
+  }
+
+  static void OnDmabuf(void *, zwlr_screencopy_frame_v1 *, uint32_t, uint32_t, uint32_t) {}
+
+  static void OnBufferDone(void *data, zwlr_screencopy_frame_v1 *) {
+    auto *f = static_cast<Frame *>(data);
+    if (!f->have_shm) f->failed = true;  // only dmabuf offered
+    StartCopy(f);
+  }
+
+  static const zwlr_screencopy_frame_v1_listener &FrameListener() {
+    static const zwlr_screencopy_frame_v1_listener k = [] {
+      zwlr_screencopy_frame_v1_listener l{};
+      l.buffer = OnBuffer;
+      l.flags = OnFlags;
+      l.ready = OnReady;
+      l.failed = OnFailed;
+      l.damage = OnDamage;
+      l.linux_dmabuf = OnDmabuf;
+      l.buffer_done = OnBufferDone;
+      return l;
+    }();
+    return k;
+  }
+
+  // Dispatch until the frame settles or timeout_ms (< 0: forever) elapses.
+  bool Wait(Frame &f, int timeout_ms) {
+    wl_display *d = conn.display;
+    const uint64_t deadline = timeout_ms < 0 ? 0 : NowSteadyNanos() + static_cast<uint64_t>(timeout_ms) * 1000000ull;
+    while (!f.ready && !f.failed) {
+      while (wl_display_prepare_read(d) != 0) {
+        if (wl_display_dispatch_pending(d) < 0) return false;
+      }
+      if (f.ready || f.failed) {
+        wl_display_cancel_read(d);
+        break;
+      }
+      wl_display_flush(d);
+      int wait_ms = -1;
+      if (timeout_ms >= 0) {
+        const uint64_t now = NowSteadyNanos();
+        wait_ms = now >= deadline ? 0 : static_cast<int>((deadline - now + 999999) / 1000000);
+      }
+      pollfd pfd{wl_display_get_fd(d), POLLIN, 0};
+      const int n = poll(&pfd, 1, wait_ms);
+      if (n <= 0) {
+        wl_display_cancel_read(d);
+        if (n < 0 && errno == EINTR) continue;
+        return false;  // timeout or poll error
+      }
+      if (wl_display_read_events(d) < 0) return false;
+      if (wl_display_dispatch_pending(d) < 0) return false;
+    }
+    return f.ready;
+  }
+
+  bool Capture(bool with_damage, int timeout_ms, ImageRGBA &out, std::vector<ScreenRect> *damage) {
+    if (!output) return false;
+    Frame f;
+    f.self = this;
+    f.with_damage = with_damage;
+    const uint64_t seq = CurrentInputSeq();
+    const uint64_t begin_ns = NowSteadyNanos();
+    f.frame = zwlr_screencopy_manager_v1_capture_output(conn.manager, 1, output->output);  // 1 = overlay cursor
+    zwlr_screencopy_frame_v1_add_listener(f.frame, &FrameListener(), &f);
+    const bool ok = Wait(f, timeout_ms);
+    zwlr_screencopy_frame_v1_destroy(f.frame);
+    if (!ok) return false;
+
+    ConvertShm(buf, f.y_invert, out);
+    out.input_seq = seq;
+    out.grab_begin_ns = begin_ns;
+    out.grab_end_ns = NowSteadyNanos();
+    if (damage) {
+      damage->clear();
+      if (first || !with_damage || conn.manager_version < 2) {
+        damage->push_back(ScreenRect{0, 0, out.width, out.height});
+      } else {
+        for (ScreenRect r : f.damage) {
+          if (f.y_invert) r.y = out.height - r.y - r.h;
+          r = ClipRect(r, out.width, out.height);
+          if (!RectEmpty(r)) damage->push_back(r);
+        }
+      }
+    }
+    first = false;
+    return true;
+  }
+};
+
+CaptureSession::CaptureSession(int display_index) : display_index_(display_index), impl_(new Impl) {
+  if (!impl_->conn.Open()) return;
+  if (display_index >= 0 && display_index < (int)impl_->conn.outputs.size()) {
+    impl_->output = impl_->conn.outputs[(size_t)display_index].get();
+  }
+}
+
+CaptureSession::~CaptureSession() = default;
+
+bool CaptureSession::IsOpen() const { return impl_->output != nullptr; }
+
+bool CaptureSession::Grab(ImageRGBA &out_image, bool /*patch_out*/) {
+  return impl_->Capture(false, kGrabTimeoutMs, out_image, nullptr);
+}
+
+bool CaptureSession::GrabChanged(ImageRGBA &out_image, std::vector<ScreenRect> *damage, int timeout_ms, bool /*patch_out*/) {
+  return impl_->Capture(true, timeout_ms, out_image, damage);
+}
+
+bool CaptureSession::SupportsDamage() const { return impl_->conn.manager_version >= 2; }
+
+namespace {
+// One cached session per display for the static API; dropped after a failure
+// so the next call reconnects (compositor restart, output unplugged).
+std::mutex g_sessions_mutex;
+std::map<int, std::unique_ptr<CaptureSession>> g_sessions;
+}  // namespace
+
+bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA &out) {
+  std::lock_guard<std::mutex> lk(g_sessions_mutex);
+  std::unique_ptr<CaptureSession> &s = g_sessions[displayIndex];
+  if (!s) s.reset(new CaptureSession(displayIndex));
+  if (s->IsOpen() && s->Grab(out)) return true;
+  s.reset();
+  return false;
+}
+
+// screencopy can copy a region (capture_output_region), but that would need a
+// second buffer per size; crop from the persistent full-output buffer instead.
+bool SystemOutput::CaptureRegionWithCursor(int displayIndex, const ScreenRect &region, ImageRGBA &out) {
+  ImageRGBA full;
+  if (!CaptureScreenWithCursor(displayIndex, full)) return false;
+  return CropImage(full, region, out);
+}
+
+namespace detail {
+// Registry order, the same order CaptureSession indexes.
+std::vector<DisplayInfo> QueryDisplays() {
+  Connection c;
+  if (!c.Open()) return {};
+  std::vector<DisplayInfo> out;
+  for (const auto &o : c.outputs) {
+    DisplayInfo d;
+    d.index = (int)out.size();
+    d.id = !o->name.empty() ? o->name : o->make + " " + o->model;
+    d.name = "Linux Wayland (wlr-screencopy) " + (o->name.empty() ? d.id : o->name + " " + o->make + " " + o->model);
+    // wl_output transforms are counter-clockwise; 4..7 are the flipped variants.
+    d.rotation = (360 - (o->transform & 3) * 90) % 360;
+    // Size in pixels like the other backends (the mode, rotated); the
+    // position is the compositor-space one wl_output reports.
+    const bool swap = d.rotation == 90 || d.rotation == 270;
+    d.bounds = {o->x, o->y, swap ? o->height : o->width, swap ? o->width : o->height};
+    d.refresh_hz = o->refresh_mhz / 1000.0;
+    d.scale = o->scale;
+    d.primary = out.empty();  // Wayland has no primary output; the first one stands in
+    out.push_back(d);
+  }
+  return out;
+}
+
+bool StartDisplayWatch(std::function<void()> on_change) {
+  static OutputWatch watch;
+  return watch.Start(std::move(on_change));
+}
+}  // namespace detail
+
+}  // namespace autoalg
+#endif
@@ -2,15 +2,30 @@
 // Author: Chunzhi Qu.
 // SPDX-License-Identifier: MIT.
 
-#if defined(__linux__) && !defined(AUTOALG_USE_WAYLAND_PORTAL)
+#if defined(__linux__) && !defined(AUTOALG_USE_WAYLAND_PORTAL) && !defined(AUTOALG_USE_WLR_SCREENCOPY)
 #include <X11/Xlib.h>
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/Xrandr.h>
+#if defined(AUTOALG_HAVE_XDAMAGE)
+#include <X11/extensions/Xdamage.h>
+#endif
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "common.hpp"
+#include "display_cache.hpp"
+#include "image_util.hpp"
 #include "system_output.hpp"
 
 namespace {
@@ -50,96 +65,533 @@ EC_INLINE void alpha_blend(uint8_t *dst, const uint8_t src[4]) {
   dst[3] = 255;
 }
 
-std::vector<Monitor> get_monitors(Display *dpy, Window root) {
-  std::vector<Monitor> out;
+double mode_refresh(const XRRScreenResources *res, RRMode id) {
+  for (int i = 0; i < res->nmode; ++i) {
+    const XRRModeInfo &mi = res->modes[i];
+    if (mi.id != id) continue;
+    double v = mi.vTotal;
+    if (mi.modeFlags & RR_DoubleScan) v *= 2;
+    if (mi.modeFlags & RR_Interlace) v /= 2;
+    return (mi.hTotal && v > 0) ? mi.dotClock / (mi.hTotal * v) : 0.0;
+  }
+  return 0.0;
+}
+
+// RandR rotations are counter-clockwise.
+EC_INLINE int rotation_degrees(Rotation r) {
+  if (r & RR_Rotate_90) return 270;
+  if (r & RR_Rotate_180) return 180;
+  if (r & RR_Rotate_270) return 90;
+  return 0;
+}
+
+// X11 has no per-monitor scale; desktops publish one through Xft.dpi.
+double xft_scale(Display *dpy) {
+  const char *rm = XResourceManagerString(dpy);
+  const char *p = rm ? std::strstr(rm, "Xft.dpi:") : nullptr;
+  const double dpi = p ? std::atof(p + 8) : 0.0;
+  return dpi > 0 ? dpi / 96.0 : 1.0;
+}
+
+// One entry per active CRTC, in CRTC order (the capture index).
+std::vector<autoalg::DisplayInfo> query_displays(Display *dpy, Window root) {
+  std::vector<autoalg::DisplayInfo> out;
+  const double scale = xft_scale(dpy);
   XRRScreenResources *res = XRRGetScreenResourcesCurrent(dpy, root);
-  if (!res) return out;
-  for (int i = 0; i < res->ncrtc; ++i) {
-    XRRCrtcInfo *ci = XRRGetCrtcInfo(dpy, res, res->crtcs[i]);
-    if (ci && ci->noutput > 0 && ci->mode != None && ci->width > 0 && ci->height > 0) {
-      out.push_back({(int)ci->x, (int)ci->y, (int)ci->width, (int)ci->height});
+  if (res) {
+    const RROutput primary = XRRGetOutputPrimary(dpy, root);
+    for (int i = 0; i < res->ncrtc; ++i) {
+      XRRCrtcInfo *ci = XRRGetCrtcInfo(dpy, res, res->crtcs[i]);
+      if (ci && ci->noutput > 0 && ci->mode != None && ci->width > 0 && ci->height > 0) {
+        autoalg::DisplayInfo d;
+        d.index = (int)out.size();
+        d.bounds = {(int)ci->x, (int)ci->y, (int)ci->width, (int)ci->height};
+        d.refresh_hz = mode_refresh(res, ci->mode);
+        d.scale = scale;
+        d.rotation = rotation_degrees(ci->rotation);
+        for (int k = 0; k < ci->noutput; ++k) d.primary = d.primary || ci->outputs[k] == primary;
+        if (XRROutputInfo *oi = XRRGetOutputInfo(dpy, res, ci->outputs[0])) {
+          d.id.assign(oi->name, (size_t)oi->nameLen);  // connector, e.g. "DP-1"
+          XRRFreeOutputInfo(oi);
+        }
+        if (d.id.empty()) d.id = "crtc-" + std::to_string(res->crtcs[i]);
+        d.name = "Linux X11 " + d.id;
+        out.push_back(d);
+      }
+      if (ci) XRRFreeCrtcInfo(ci);
     }
-    if (ci) XRRFreeCrtcInfo(ci);
+    XRRFreeScreenResources(res);
   }
-  XRRFreeScreenResources(res);
   if (out.empty()) {
     Screen *s = DefaultScreenOfDisplay(dpy);
-    out.push_back({0, 0, s->width, s->height});
+    autoalg::DisplayInfo d;
+    d.id = "screen-" + std::to_string(DefaultScreen(dpy));
+    d.name = "Linux X11 Screen";
+    d.bounds = {0, 0, s->width, s->height};
+    d.scale = scale;
+    d.primary = true;
+    out.push_back(d);
   }
   return out;
 }
+
+// Monitor of a capture index, from the cached display list.
+bool monitor_at(int index, Monitor &m) {
+  autoalg::DisplayInfo d;
+  if (!autoalg::SystemOutput::GetDisplay(index, d) || RectEmpty(d.bounds)) return false;
+  m = {d.bounds.x, d.bounds.y, d.bounds.w, d.bounds.h};
+  return true;
+}
+
+// RandR notifications on a private connection; a burst of events (one mode
+// switch emits several) is reported once.
+class RandrWatch {
+ public:
+  ~RandrWatch() {
+    if (thread_.joinable()) {
+      const char c = 1;
+      (void)!write(wake_[1], &c, 1);
+      thread_.join();
+    }
+    if (wake_[0] >= 0) close(wake_[0]);
+    if (wake_[1] >= 0) close(wake_[1]);
+    if (dpy_) XCloseDisplay(dpy_);
+  }
+
+  bool Start(std::function<void()> on_change) {
+    dpy_ = XOpenDisplay(nullptr);
+    if (!dpy_) return false;
+    int error_base = 0;
+    if (!XRRQueryExtension(dpy_, &event_base_, &error_base) || pipe2(wake_, O_CLOEXEC) != 0) return false;
+    XRRSelectInput(dpy_, RootWindow(dpy_, DefaultScreen(dpy_)),
+                   RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    XFlush(dpy_);
+    on_change_ = std::move(on_change);
+    thread_ = std::thread([this] { Run_(); });
+    return true;
+  }
+
+ private:
+  // Drain queued events; true if any was a RandR change.
+  bool Drain_() {
+    bool changed = false;
+    while (XPending(dpy_)) {
+      XEvent ev;
+      XNextEvent(dpy_, &ev);
+      const int type = ev.type - event_base_;
+      if (type == RRScreenChangeNotify || type == RRNotify) {
+        XRRUpdateConfiguration(&ev);
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  void Run_() {
+    pollfd fds[2] = {{ConnectionNumber(dpy_), POLLIN, 0}, {wake_[0], POLLIN, 0}};
+    for (;;) {
+      const int n = poll(fds, 2, -1);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 || fds[1].revents) return;
+      if (!Drain_()) continue;
+      // Let the rest of the burst arrive before re-querying.
+      while (poll(fds, 2, 100) > 0 && !fds[1].revents) Drain_();
+      if (fds[1].revents) return;
+      on_change_();
+    }
+  }
+
+  Display *dpy_ = nullptr;
+  int event_base_ = 0;
+  int wake_[2] = {-1, -1};
+  std::function<void()> on_change_;
+  std::thread thread_;
+};
+
+// Read root pixels [x, x + w) x [y, y + h) as RGBA into dst (rows of dst_stride bytes).
+bool read_rect(Display *dpy, Window root, int x, int y, int w, int h, uint8_t *dst, size_t dst_stride) {
+  XImage *img = XGetImage(dpy, root, x, y, (unsigned)w, (unsigned)h, AllPlanes, ZPixmap);
+  if (!img) return false;
+  const bool bgrx = img->bits_per_pixel == 32 && img->byte_order == LSBFirst && img->red_mask == 0xFF0000 &&
+                    img->green_mask == 0xFF00 && img->blue_mask == 0xFF;
+  for (int j = 0; j < h; ++j) {
+    uint8_t *d = dst + (size_t)j * dst_stride;
+    if (bgrx) {  // the common depth-24/32 layout: swizzle without XGetPixel
+      const uint8_t *sp = reinterpret_cast<const uint8_t *>(img->data) + (size_t)j * img->bytes_per_line;
+      for (int i = 0; i < w; ++i, sp += 4, d += 4) {
+        d[0] = sp[2];
+        d[1] = sp[1];
+        d[2] = sp[0];
+        d[3] = 255;
+      }
+      continue;
+    }
+    for (int i = 0; i < w; ++i, d += 4) {
+      unsigned long px = XGetPixel(img, i, j);
+      d[0] = extract_chan(px, img->red_mask);
+      d[1] = extract_chan(px, img->green_mask);
+      d[2] = extract_chan(px, img->blue_mask);
+      d[3] = 255;
+    }
+  }
+  XDestroyImage(img);
+  return true;
+}
+
+struct CursorImage {
+  int width = 0, height = 0;
+  int xhot = 0, yhot = 0;
+  unsigned long serial = 0;
+  std::vector<uint32_t> argb;
+};
+
+// Current cursor image and hotspot position (root coordinates).
+bool fetch_cursor(Display *dpy, CursorImage &c, int &x, int &y) {
+  XFixesCursorImage *cur = XFixesGetCursorImage(dpy);
+  if (!cur) return false;
+  c.width = cur->width;
+  c.height = cur->height;
+  c.xhot = cur->xhot;
+  c.yhot = cur->yhot;
+  c.serial = cur->cursor_serial;
+  c.argb.resize((size_t)c.width * c.height);
+  for (size_t i = 0; i < c.argb.size(); ++i) c.argb[i] = (uint32_t)cur->pixels[i];
+  x = cur->x;
+  y = cur->y;
+  XFree(cur);
+  return true;
+}
+
+// Image rect covered by cursor c with its hotspot at (hx, hy), clipped to img.
+autoalg::ScreenRect cursor_rect(const CursorImage &c, int hx, int hy, const autoalg::ImageRGBA &img) {
+  return autoalg::ClipRect(autoalg::ScreenRect{hx - c.xhot, hy - c.yhot, c.width, c.height}, img.width, img.height);
+}
+
+// Blend cursor c with its hotspot at (hx, hy) in image coordinates.
+void blend_cursor(const CursorImage &c, int hx, int hy, autoalg::ImageRGBA &img) {
+  const int cx = hx - c.xhot, cy = hy - c.yhot;
+  for (int j = 0; j < c.height; ++j) {
+    int py = cy + j;
+    if (py < 0 || py >= img.height) continue;
+    for (int i = 0; i < c.width; ++i) {
+      int px = cx + i;
+      if (px < 0 || px >= img.width) continue;
+      uint32_t argb = c.argb[(size_t)j * c.width + i];
+      uint8_t a = (argb >> 24) & 0xFF;
+      if (!a) continue;
+      uint8_t src[4] = {(uint8_t)((argb >> 16) & 0xFF), (uint8_t)((argb >> 8) & 0xFF), (uint8_t)((argb >> 0) & 0xFF), a};
+      alpha_blend(&img.pixels[((size_t)py * img.width + px) * 4], src);
+    }
+  }
+}
+
+// Grab r (display-local, already clipped) of monitor m and blend the cursor on top.
+bool capture_rect(Display *dpy, Window root, const Monitor &m, const autoalg::ScreenRect &r, autoalg::ImageRGBA &out) {
+  out.width = r.w;
+  out.height = r.h;
+  out.pixels.resize((size_t)r.w * r.h * 4);
+  if (!read_rect(dpy, root, m.x + r.x, m.y + r.y, r.w, r.h, out.pixels.data(), (size_t)r.w * 4)) return false;
+  CursorImage c;
+  int x = 0, y = 0;
+  if (fetch_cursor(dpy, c, x, y)) blend_cursor(c, x - m.x - r.x, y - m.y - r.y, out);
+  return true;
+}
+
+// Copy rect r between same-sized RGBA images.
+void copy_rect(const autoalg::ImageRGBA &src, const autoalg::ScreenRect &r, autoalg::ImageRGBA &dst) {
+  const size_t stride = (size_t)src.width * 4;
+  for (int y = r.y; y < r.y + r.h; ++y) {
+    const size_t off = (size_t)y * stride + (size_t)r.x * 4;
+    std::memcpy(dst.pixels.data() + off, src.pixels.data() + off, (size_t)r.w * 4);
+  }
+}
 }  // namespace
 
 namespace autoalg {
 bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA &out) {
+  return CaptureRegionWithCursor(displayIndex, ScreenRect{0, 0, INT_MAX, INT_MAX}, out);
+}
+
+bool SystemOutput::CaptureRegionWithCursor(int displayIndex, const ScreenRect &region, ImageRGBA &out) {
+  Monitor m{};
+  if (!monitor_at(displayIndex, m)) return false;
+  const ScreenRect r = ClipRect(region, m.w, m.h);
+  if (RectEmpty(r)) return false;
+
   Display *dpy = XOpenDisplay(nullptr);
   if (!dpy) return false;
-  int scrIdx = DefaultScreen(dpy);
-  Window root = RootWindow(dpy, scrIdx);
+  Window root = RootWindow(dpy, DefaultScreen(dpy));
+  const uint64_t seq = CurrentInputSeq();
+  const uint64_t begin_ns = NowSteadyNanos();
+  const bool ok = capture_rect(dpy, root, m, r, out);
+  if (ok) {
+    out.input_seq = seq;
+    out.grab_begin_ns = begin_ns;
+    out.grab_end_ns = NowSteadyNanos();
+  }
+  XCloseDisplay(dpy);
+  return ok;
+}
+
+namespace detail {
+std::vector<DisplayInfo> QueryDisplays() {
+  Display *dpy = XOpenDisplay(nullptr);
+  if (!dpy) return {};
+  auto displays = query_displays(dpy, RootWindow(dpy, DefaultScreen(dpy)));
+  XCloseDisplay(dpy);
+  return displays;
+}
 
-  auto mons = get_monitors(dpy, root);
-  if (displayIndex < 0 || displayIndex >= (int)mons.size()) {
-    XCloseDisplay(dpy);
+bool StartDisplayWatch(std::function<void()> on_change) {
+  static RandrWatch watch;
+  return watch.Start(std::move(on_change));
+}
+}  // namespace detail
+
+// One X connection per session; the monitor layout comes from the display
+// cache. The session keeps the last composed frame and the pixels under its
+// cursor. With XDamage it re-reads only damaged rectangles, and when nothing
+// but the pointer changed it just moves the cursor: restore the old patch,
+// blend at the new position. Without XDamage every grab reads the whole
+// monitor.
+struct CaptureSession::Impl {
+  Display *dpy = nullptr;
+  Window root = 0;
+  int fixes_event = 0;
+#if defined(AUTOALG_HAVE_XDAMAGE)
+  int damage_event = 0;
+  Damage damage = 0;
+  XserverRegion region = 0;
+#endif
+
+  Monitor mon{};
+  bool have_frame = false;
+  autoalg::ImageRGBA frame;    // last composed frame (cursor blended)
+  std::vector<uint8_t> under;  // frame pixels under the cursor before blending
+  ScreenRect under_rect;       // where `under` came from
+  CursorImage cursor;
+  bool cursor_dirty = true;  // image changed (XFixes cursor notify); refetch
+  int cursor_x = 0, cursor_y = 0;  // hotspot at the last blend, root coordinates
+
+  // Out image of the previous call: with patch_out, only that one (same
+  // object and buffer) is patched in place.
+  const ImageRGBA *last_out = nullptr;
+  const uint8_t *last_out_data = nullptr;
+
+  bool HasDamage() const {
+#if defined(AUTOALG_HAVE_XDAMAGE)
+    return damage != 0;
+#else
     return false;
+#endif
   }
-  auto m = mons[(size_t)displayIndex];
 
-  XImage *img = XGetImage(dpy, root, m.x, m.y, (unsigned)m.w, (unsigned)m.h, AllPlanes, ZPixmap);
-  if (!img) {
-    XCloseDisplay(dpy);
-    return false;
+  void DrainEvents() {
+    while (XPending(dpy)) {
+      XEvent ev;
+      XNextEvent(dpy, &ev);
+      if (ev.type == fixes_event + XFixesCursorNotify) cursor_dirty = true;
+      // Damage notifies only wake GrabChanged(); the region is fetched below.
+    }
   }
 
-  out.width = m.w;
-  out.height = m.h;
-  out.pixels.assign((size_t)m.w * m.h * 4, 255);
+  // Damaged rectangles since the last call, monitor-local and clipped.
+  std::vector<ScreenRect> FetchDamage() {
+    std::vector<ScreenRect> out;
+#if defined(AUTOALG_HAVE_XDAMAGE)
+    XDamageSubtract(dpy, damage, None, region);
+    int n = 0;
+    XRectangle *rects = XFixesFetchRegion(dpy, region, &n);
+    for (int i = 0; i < n; ++i) {
+      const ScreenRect r = ClipRect(ScreenRect{rects[i].x - mon.x, rects[i].y - mon.y, rects[i].width, rects[i].height},
+                                    mon.w, mon.h);
+      if (!RectEmpty(r)) out.push_back(r);
+    }
+    if (rects) XFree(rects);
+#endif
+    return out;
+  }
 
-  for (int y = 0; y < m.h; ++y) {
-    for (int x = 0; x < m.w; ++x) {
-      unsigned long px = XGetPixel(img, x, y);
-      size_t di = ((size_t)y * m.w + x) * 4;
-      out.pixels[di + 0] = extract_chan(px, img->red_mask);
-      out.pixels[di + 1] = extract_chan(px, img->green_mask);
-      out.pixels[di + 2] = extract_chan(px, img->blue_mask);
-      out.pixels[di + 3] = 255;
+  void SaveUnder(const ScreenRect &r) {
+    under_rect = r;
+    under.resize((size_t)r.w * r.h * 4);
+    for (int y = 0; y < r.h; ++y) {
+      std::memcpy(under.data() + (size_t)y * r.w * 4, frame.pixels.data() + ((size_t)(r.y + y) * frame.width + r.x) * 4,
+                  (size_t)r.w * 4);
     }
   }
 
-  XFixesCursorImage *cur = XFixesGetCursorImage(dpy);
-  if (cur) {
-    int cx = cur->x - cur->xhot - m.x;
-    int cy = cur->y - cur->yhot - m.y;
-    for (int j = 0; j < (int)cur->height; ++j) {
-      int py = cy + j;
-      if (py < 0 || py >= m.h) continue;
-      for (int i = 0; i < (int)cur->width; ++i) {
-        int px = cx + i;
-        if (px < 0 || px >= m.w) continue;
-        uint32_t argb = cur->pixels[j * cur->width + i];
-        uint8_t a = (argb >> 24) & 0xFF;
-        if (!a) continue;
-        uint8_t src[4] = {(uint8_t)((argb >> 16) & 0xFF), (uint8_t)((argb >> 8) & 0xFF), (uint8_t)((argb >> 0) & 0xFF), a};
-        size_t di = ((size_t)py * m.w + px) * 4;
-        alpha_blend(&out.pixels[di], src);
+  void RestoreUnder() {
+    const ScreenRect &r = under_rect;
+    for (int y = 0; y < r.h; ++y) {
+      std::memcpy(frame.pixels.data() + ((size_t)(r.y + y) * frame.width + r.x) * 4, under.data() + (size_t)y * r.w * 4,
+                  (size_t)r.w * 4);
+    }
+  }
+
+  // Bring frame up to date. changed receives the rectangles that differ from
+  // the previous frame (whole frame on the first call or a layout change).
+  bool Update(int display_index, std::vector<ScreenRect> &changed) {
+    changed.clear();
+    Monitor m{};
+    if (!dpy || !monitor_at(display_index, m)) return false;
+    DrainEvents();
+    const bool full = !have_frame || !HasDamage() || m.x != mon.x || m.y != mon.y || m.w != mon.w || m.h != mon.h;
+    mon = m;
+    const ScreenRect whole{0, 0, m.w, m.h};
+
+    std::vector<ScreenRect> damaged = full ? std::vector<ScreenRect>{} : FetchDamage();
+    int px = cursor_x, py = cursor_y;
+    if (!cursor_dirty) {
+      Window r, w;
+      int wx, wy;
+      unsigned int mask;
+      if (!XQueryPointer(dpy, root, &r, &w, &px, &py, &wx, &wy, &mask)) cursor_dirty = true;
+    }
+    const bool cursor_moved = cursor_dirty || px != cursor_x || py != cursor_y;
+    if (!full && damaged.empty() && !cursor_moved) return true;  // nothing new
+
+    if (full) {
+      frame.width = m.w;
+      frame.height = m.h;
+      frame.pixels.resize((size_t)m.w * m.h * 4);
+    } else {
+      RestoreUnder();  // frame is now cursor-free
+    }
+    int64_t area = 0;
+    for (const ScreenRect &r : damaged) area += RectArea(r);
+    if (full || area * 2 > RectArea(whole)) {  // one big read beats many small ones
+      if (!read_rect(dpy, root, m.x, m.y, m.w, m.h, frame.pixels.data(), (size_t)m.w * 4)) {
+        have_frame = false;
+        return false;
+      }
+      damaged.assign(1, whole);
+    } else {
+      for (const ScreenRect &r : damaged) {
+        uint8_t *dst = frame.pixels.data() + ((size_t)r.y * m.w + r.x) * 4;
+        if (!read_rect(dpy, root, m.x + r.x, m.y + r.y, r.w, r.h, dst, (size_t)m.w * 4)) {
+          have_frame = false;
+          return false;
+        }
       }
     }
-    XFree(cur);
+
+    const ScreenRect old_cursor = have_frame ? under_rect : ScreenRect{};
+    if (cursor_dirty) {
+      if (fetch_cursor(dpy, cursor, px, py)) {
+        cursor_dirty = false;
+      } else {
+        cursor = CursorImage{};
+      }
+    }
+    cursor_x = px;
+    cursor_y = py;
+    const ScreenRect now = cursor_rect(cursor, px - m.x, py - m.y, frame);
+    SaveUnder(now);
+    blend_cursor(cursor, px - m.x, py - m.y, frame);
+    have_frame = true;
+
+    changed = damaged;
+    if (!(damaged.size() == 1 && RectArea(damaged[0]) == RectArea(whole))) {
+      if (!RectEmpty(old_cursor)) changed.push_back(old_cursor);
+      if (!RectEmpty(now)) changed.push_back(now);
+    }
+    return true;
   }
 
-  XDestroyImage(img);
-  XCloseDisplay(dpy);
+  // Hand the frame out. With patch_out the caller vouches that out is still
+  // our previous, unmodified frame; if it also is the same object and
+  // buffer, only the changed rectangles are copied. Anything else gets a
+  // full copy, since pooled or shared frames may have been drawn on.
+  void CopyOut(ImageRGBA &out, const std::vector<ScreenRect> &changed, bool patch_out) {
+    const bool patch = patch_out && &out == last_out && out.pixels.data() == last_out_data &&
+                       out.width == frame.width && out.height == frame.height &&
+                       out.pixels.size() == frame.pixels.size();
+    if (patch) {
+      for (const ScreenRect &r : changed) copy_rect(frame, r, out);
+    } else {
+      out.width = frame.width;
+      out.height = frame.height;
+      out.pixels = frame.pixels;
+    }
+    last_out = &out;
+    last_out_data = out.pixels.data();
+  }
+};
+
+CaptureSession::CaptureSession(int display_index) : display_index_(display_index), impl_(new Impl) {
+  Impl &s = *impl_;
+  s.dpy = XOpenDisplay(nullptr);
+  if (!s.dpy) return;
+  s.root = RootWindow(s.dpy, DefaultScreen(s.dpy));
+  int error_base = 0;
+  if (XFixesQueryExtension(s.dpy, &s.fixes_event, &error_base)) {
+    XFixesSelectCursorInput(s.dpy, s.root, XFixesDisplayCursorNotifyMask);
+  }
+#if defined(AUTOALG_HAVE_XDAMAGE)
+  if (XDamageQueryExtension(s.dpy, &s.damage_event, &error_base)) {
+    s.damage = XDamageCreate(s.dpy, s.root, XDamageReportNonEmpty);
+    s.region = XFixesCreateRegion(s.dpy, nullptr, 0);
+  }
+#endif
+}
+
+CaptureSession::~CaptureSession() {
+  Impl &s = *impl_;
+  if (!s.dpy) return;
+#if defined(AUTOALG_HAVE_XDAMAGE)
+  if (s.region) XFixesDestroyRegion(s.dpy, s.region);
+  if (s.damage) XDamageDestroy(s.dpy, s.damage);
+#endif
+  XCloseDisplay(s.dpy);
+}
+
+bool CaptureSession::IsOpen() const { return impl_->dpy != nullptr; }
+
+bool CaptureSession::Grab(ImageRGBA &out_image, bool patch_out) {
+  const uint64_t seq = CurrentInputSeq();
+  const uint64_t begin_ns = NowSteadyNanos();
+  std::vector<ScreenRect> changed;
+  if (!impl_->Update(display_index_, changed)) return false;
+  impl_->CopyOut(out_image, changed, patch_out);
+  out_image.input_seq = seq;
+  out_image.grab_begin_ns = begin_ns;
+  out_image.grab_end_ns = NowSteadyNanos();
   return true;
 }
 
-int SystemOutput::GetDisplayCount() {
-  Display *dpy = XOpenDisplay(nullptr);
-  if (!dpy) return 0;
-  Window root = RootWindow(dpy, DefaultScreen(dpy));
-  auto mons = get_monitors(dpy, root);
-  XCloseDisplay(dpy);
-  return (int)mons.size();
+// Waits on damage / cursor-change events; pointer motion has no event without
+// XInput2, so the pointer is polled every 8 ms while waiting.
+bool CaptureSession::GrabChanged(ImageRGBA &out_image, std::vector<ScreenRect> *damage, int timeout_ms,
+                                 bool patch_out) {
+  Impl &s = *impl_;
+  const uint64_t deadline = timeout_ms < 0 ? 0 : NowSteadyNanos() + static_cast<uint64_t>(timeout_ms) * 1000000ull;
+  std::vector<ScreenRect> changed;
+  for (;;) {
+    const uint64_t seq = CurrentInputSeq();
+    const uint64_t begin_ns = NowSteadyNanos();
+    const bool first = !s.have_frame;
+    if (!s.Update(display_index_, changed)) return false;
+    if (!changed.empty() || first || !s.HasDamage()) {
+      s.CopyOut(out_image, changed, patch_out);
+      out_image.input_seq = seq;
+      out_image.grab_begin_ns = begin_ns;
+      out_image.grab_end_ns = NowSteadyNanos();
+      if (damage) *damage = changed;
+      return true;
+    }
+    int wait_ms = 8;
+    if (timeout_ms >= 0) {
+      const uint64_t now = NowSteadyNanos();
+      if (now >= deadline) return false;
+      wait_ms = std::min<int>(wait_ms, static_cast<int>((deadline - now + 999999) / 1000000));
+    }
+    pollfd pfd{ConnectionNumber(s.dpy), POLLIN, 0};
+    if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) return false;
+  }
 }
 
-std::string SystemOutput::GetDisplayInfo(int index) { return "Linux X11 Monitor " + std::to_string(index); }
+bool CaptureSession::SupportsDamage() const { return impl_->HasDamage(); }
+
 }  // namespace autoalg
 #endif
@@ -5,14 +5,43 @@
 #ifdef __APPLE__
 
 #include <CoreGraphics/CoreGraphics.h>
+
+#include <cstdio>
+#include <functional>
 #include <string>
+#include <vector>
 
+#include "common.hpp"
+#include "display_cache.hpp"
+#include "image_util.hpp"
 #include "system_output.hpp"
 
+namespace {
+// CoreGraphics calls this on the main run loop; the "begin" half of each
+// reconfiguration is skipped.
+void ReconfigurationCallback(CGDirectDisplayID, CGDisplayChangeSummaryFlags flags, void *user) {
+  if (flags & kCGDisplayBeginConfigurationFlag) return;
+  (*static_cast<std::function<void()> *>(user))();
+}
+
+struct ReconfigurationWatch {
+  std::function<void()> on_change;
+  bool registered = false;
+  ~ReconfigurationWatch() {
+    if (registered) CGDisplayRemoveReconfigurationCallback(ReconfigurationCallback, &on_change);
+  }
+};
+}  // namespace
+
 namespace autoalg {
 bool SystemOutput::CaptureScreenWithCursor(int display_index, ImageRGBA &out_image) {
+  const uint64_t seq = CurrentInputSeq();
+  const uint64_t begin_ns = NowSteadyNanos();
   MacImage m{};
   if (!MacCaptureScreenWithCursor(display_index, &m)) return false;
+  out_image.input_seq = seq;
+  out_image.grab_begin_ns = begin_ns;
+  out_image.grab_end_ns = NowSteadyNanos();
   out_image.width = m.width;
   out_image.height = m.height;
   out_image.pixels.assign(m.pixels, m.pixels + static_cast<size_t>(m.width) * m.height * 4);
@@ -20,14 +49,75 @@ bool SystemOutput::CaptureScreenWithCursor(int display_index, ImageRGBA &out_ima
   return true;
 }
 
-int SystemOutput::GetDisplayCount() {
+// ScreenCaptureKit path grabs whole displays; crop afterwards.
+bool SystemOutput::CaptureRegionWithCursor(int display_index, const ScreenRect &region, ImageRGBA &out_image) {
+  ImageRGBA full;
+  if (!CaptureScreenWithCursor(display_index, full)) return false;
+  return CropImage(full, region, out_image);
+}
+
+namespace detail {
+// Same order as the ScreenCaptureKit display list used for capture.
+std::vector<DisplayInfo> QueryDisplays() {
+  std::vector<DisplayInfo> out;
   uint32_t count = 0;
-  if (CGGetActiveDisplayList(0, nullptr, &count) == kCGErrorSuccess && count > 0) {
-    return static_cast<int>(count);
+  if (CGGetActiveDisplayList(0, nullptr, &count) != kCGErrorSuccess || count == 0) count = 0;
+  std::vector<CGDirectDisplayID> ids(count);
+  if (count && CGGetActiveDisplayList(count, ids.data(), &count) != kCGErrorSuccess) count = 0;
+  ids.resize(count);
+  if (ids.empty()) ids.push_back(CGMainDisplayID());  // keep one display when the query fails
+  for (CGDirectDisplayID id : ids) {
+    DisplayInfo d;
+    d.index = (int)out.size();
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%08x-%08x-%08x", CGDisplayVendorNumber(id), CGDisplayModelNumber(id),
+                  CGDisplaySerialNumber(id));
+    d.id = buf;
+    d.name = (CGDisplayIsBuiltin(id) ? "macOS Built-in Display " : "macOS Display ") + std::to_string(id);
+    const CGRect b = CGDisplayBounds(id);
+    d.bounds = {(int)b.origin.x, (int)b.origin.y, (int)b.size.width, (int)b.size.height};
+    if (CGDisplayModeRef mode = CGDisplayCopyDisplayMode(id)) {
+      d.refresh_hz = CGDisplayModeGetRefreshRate(mode);  // 0 on many built-in panels
+      const size_t points = CGDisplayModeGetWidth(mode);
+      if (points) d.scale = (double)CGDisplayModeGetPixelWidth(mode) / (double)points;
+      CGDisplayModeRelease(mode);
+    }
+    d.rotation = ((int)CGDisplayRotation(id) % 360 + 360) % 360;
+    d.primary = CGDisplayIsMain(id) != 0;
+    out.push_back(d);
   }
-  return 1;  // Fallback to 1 if query fails
+  return out;
 }
 
-std::string SystemOutput::GetDisplayInfo(const int display_index) { return "macOS Display " + std::to_string(display_index); }
+bool StartDisplayWatch(std::function<void()> on_change) {
+  static ReconfigurationWatch watch;
+  watch.on_change = std::move(on_change);
+  watch.registered = CGDisplayRegisterReconfigurationCallback(ReconfigurationCallback, &watch.on_change) == kCGErrorSuccess;
+  return watch.registered;
+}
+}  // namespace detail
+
+// No change notifications from this backend; a session re-grabs the whole display.
+struct CaptureSession::Impl {};
+
+CaptureSession::CaptureSession(int display_index) : display_index_(display_index) {}
+
+CaptureSession::~CaptureSession() = default;
+
+bool CaptureSession::IsOpen() const { return display_index_ >= 0 && display_index_ < SystemOutput::GetDisplayCount(); }
+
+bool CaptureSession::Grab(ImageRGBA &out_image, bool /*patch_out*/) {
+  return SystemOutput::CaptureScreenWithCursor(display_index_, out_image);
+}
+
+bool CaptureSession::GrabChanged(ImageRGBA &out_image, std::vector<ScreenRect> *damage, int timeout_ms, bool /*patch_out*/) {
+  (void)timeout_ms;
+  if (!Grab(out_image)) return false;
+  if (damage) damage->assign(1, ScreenRect{0, 0, out_image.width, out_image.height});
+  return true;
+}
+
+bool CaptureSession::SupportsDamage() const { return false; }
+
 }  // namespace autoalg
 #endif
@@ -6,9 +6,15 @@
 #include <windows.h>
 
 #include <algorithm>
+#include <climits>
+#include <functional>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "common.hpp"
+#include "display_cache.hpp"
+#include "image_util.hpp"
 #include "system_output.hpp"
 
 namespace {
@@ -26,6 +32,64 @@ BOOL CALLBACK EnumMonProc(HMONITOR hMon, HDC, LPRECT r, LPARAM p) {
   return TRUE;
 }
 
+// WM_DISPLAYCHANGE is only broadcast to top-level windows, so the watcher owns
+// a hidden (never shown) one on its own thread.
+class DisplayChangeWatch {
+ public:
+  ~DisplayChangeWatch() {
+    if (thread_.joinable()) {
+      if (hwnd_) PostMessageW(hwnd_, WM_CLOSE, 0, 0);
+      thread_.join();
+    }
+  }
+
+  bool Start(std::function<void()> on_change) {
+    on_change_ = std::move(on_change);
+    HANDLE ready = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!ready) return false;
+    thread_ = std::thread([this, ready] { Run_(ready); });
+    WaitForSingleObject(ready, INFINITE);
+    CloseHandle(ready);
+    return hwnd_ != nullptr;
+  }
+
+ private:
+  static LRESULT CALLBACK WndProc_(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
+    auto *self = reinterpret_cast<DisplayChangeWatch *>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    switch (msg) {
+      case WM_DISPLAYCHANGE:
+      case WM_DPICHANGED:
+        if (self) self->on_change_();
+        return 0;
+      case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+      default:
+        return DefWindowProcW(hwnd, msg, wp, lp);
+    }
+  }
+
+  void Run_(HANDLE ready) {
+    WNDCLASSW wc{};
+    wc.lpfnWndProc = WndProc_;
+    wc.hInstance = GetModuleHandleW(nullptr);
+    wc.lpszClassName = L"AutoAlgDisplayChangeWatch";
+    RegisterClassW(&wc);
+    HWND hwnd = CreateWindowExW(0, wc.lpszClassName, L"", WS_OVERLAPPED, 0, 0, 0, 0, nullptr, nullptr, wc.hInstance,
+                                nullptr);
+    if (hwnd) SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+    hwnd_ = hwnd;
+    SetEvent(ready);
+    if (!hwnd) return;
+    MSG msg;
+    while (GetMessageW(&msg, nullptr, 0, 0) > 0) DispatchMessageW(&msg);
+  }
+
+  std::function<void()> on_change_;
+  std::thread thread_;
+  HWND hwnd_ = nullptr;
+};
+
 bool CaptureRectToBitmapWithCursor(const RECT &rc, HBITMAP &outHbmp, int &w, int &h) {
   HDC hscr = GetDC(nullptr);
   if (!hscr) return false;
@@ -73,13 +137,22 @@ bool CaptureRectToBitmapWithCursor(const RECT &rc, HBITMAP &outHbmp, int &w, int
 
 namespace autoalg {
 bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA &out) {
+  return CaptureRegionWithCursor(displayIndex, ScreenRect{0, 0, INT_MAX, INT_MAX}, out);
+}
+
+bool SystemOutput::CaptureRegionWithCursor(int displayIndex, const ScreenRect &region, ImageRGBA &out) {
   std::vector<MonInfo> mons;
   EnumDisplayMonitors(nullptr, nullptr, EnumMonProc, reinterpret_cast<LPARAM>(&mons));
   if (mons.empty()) return false;
   if (displayIndex < 0 || displayIndex >= (int)mons.size()) return false;
 
-  const RECT rc = mons[(size_t)displayIndex].rect;
+  const RECT mrc = mons[(size_t)displayIndex].rect;
+  const ScreenRect r = ClipRect(region, mrc.right - mrc.left, mrc.bottom - mrc.top);
+  if (RectEmpty(r)) return false;
+  const RECT rc{mrc.left + r.x, mrc.top + r.y, mrc.left + r.x + r.w, mrc.top + r.y + r.h};
 
+  const uint64_t seq = CurrentInputSeq();
+  const uint64_t begin_ns = NowSteadyNanos();
   HBITMAP hbmp = nullptr;
   int w = 0, h = 0;
   if (!CaptureRectToBitmapWithCursor(rc, hbmp, w, h)) return false;
@@ -105,18 +178,76 @@ bool SystemOutput::CaptureScreenWithCursor(int displayIndex, ImageRGBA &out) {
   }
   // BGRA->RGBA
   for (size_t i = 0, n = out.pixels.size(); i < n; i += 4) std::swap(out.pixels[i], out.pixels[i + 2]);
+  out.input_seq = seq;
+  out.grab_begin_ns = begin_ns;
+  out.grab_end_ns = NowSteadyNanos();
 
   DeleteObject(hbmp);
   ReleaseDC(nullptr, hscr);
   return true;
 }
 
-int SystemOutput::GetDisplayCount() {
+namespace detail {
+// Same order as EnumDisplayMonitors in the capture path.
+std::vector<DisplayInfo> QueryDisplays() {
   std::vector<MonInfo> mons;
   EnumDisplayMonitors(nullptr, nullptr, EnumMonProc, reinterpret_cast<LPARAM>(&mons));
-  return (int)mons.size();
+  std::vector<DisplayInfo> out;
+  for (const MonInfo &m : mons) {
+    DisplayInfo d;
+    d.index = (int)out.size();
+    d.bounds = {m.rect.left, m.rect.top, m.rect.right - m.rect.left, m.rect.bottom - m.rect.top};
+    MONITORINFOEXW mi{};
+    mi.cbSize = sizeof(mi);
+    if (GetMonitorInfoW(m.hmon, &mi)) {
+      d.id = WToUtf8(mi.szDevice);  // e.g. \\.\DISPLAY1
+      d.primary = (mi.dwFlags & MONITORINFOF_PRIMARY) != 0;
+      DEVMODEW dm{};
+      dm.dmSize = sizeof(dm);
+      if (EnumDisplaySettingsW(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm)) {
+        if (dm.dmDisplayFrequency > 1) d.refresh_hz = dm.dmDisplayFrequency;  // 0/1 = hardware default
+        d.rotation = static_cast<int>(dm.dmDisplayOrientation) * 90;       // DMDO_* are clockwise steps
+        // Virtualized monitor rect vs real mode: > 1 for DPI-unaware callers on scaled displays.
+        if (d.bounds.w > 0) d.scale = static_cast<double>(dm.dmPelsWidth) / d.bounds.w;
+      }
+      DISPLAY_DEVICEW dd{};
+      dd.cb = sizeof(dd);
+      if (EnumDisplayDevicesW(mi.szDevice, 0, &dd, 0)) d.name = WToUtf8(dd.DeviceString);
+    }
+    if (d.id.empty()) d.id = "monitor-" + std::to_string(d.index);
+    if (d.name.empty()) d.name = "Windows Monitor " + std::to_string(d.index);
+    out.push_back(d);
+  }
+  return out;
 }
 
-std::string SystemOutput::GetDisplayInfo(int index) { return "Windows Monitor " + std::to_string(index); }
+bool StartDisplayWatch(std::function<void()> on_change) {
+  static DisplayChangeWatch watch;
+  return watch.Start(std::move(on_change));
+}
+}  // namespace detail
+
+// GDI has no change notifications; a session re-grabs the whole display.
+struct CaptureSession::Impl {};
+
+CaptureSession::CaptureSession(int display_index) : display_index_(display_index) {}
+
+CaptureSession::~CaptureSession() = default;
+
+bool CaptureSession::IsOpen() const { return display_index_ >= 0 && display_index_ < SystemOutput::GetDisplayCount(); }
+
+bool CaptureSession::Grab(ImageRGBA &out_image, bool /*patch_out*/) {
+  return SystemOutput::CaptureScreenWithCursor(display_index_, out_image);
+}
+
+bool CaptureSession::GrabChanged(ImageRGBA &out_image, std::vector<ScreenRect> *damage, int timeout_ms, bool /*patch_out*/) {
+  (void)timeout_ms;
+  if (!Grab(out_image)) return false;
+  if (damage) damage->assign(1, ScreenRect{0, 0, out_image.width, out_image.height});
+  return true;
+}
+
+bool CaptureSession::SupportsDamage() const { return false; }
+
 }  // namespace autoalg
 #endif
@@ -0,0 +1,170 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "tensor_sink.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "image_util.hpp"
+
+namespace autoalg {
+
+namespace {
+
+// Source sample positions for one axis (half-pixel centers, as OpenCV INTER_LINEAR
+// and PyTorch align_corners=false).
+struct AxisMap {
+  std::vector<int> i0;
+  std::vector<int> i1;
+  std::vector<float> f;  // weight of i1
+};
+
+AxisMap BuildAxisMap(int dst, int src, bool nearest) {
+  AxisMap m;
+  m.i0.resize(dst);
+  m.i1.resize(dst);
+  m.f.resize(dst);
+  const double ratio = static_cast<double>(src) / dst;
+  for (int i = 0; i < dst; ++i) {
+    if (nearest) {
+      const int s = std::min(static_cast<int>((i + 0.5) * ratio), src - 1);
+      m.i0[i] = m.i1[i] = s;
+      m.f[i] = 0.0f;
+      continue;
+    }
+    const double s = std::max(0.0, (i + 0.5) * ratio - 0.5);
+    const int s0 = std::min(static_cast<int>(s), src - 1);
+    m.i0[i] = s0;
+    m.i1[i] = std::min(s0 + 1, src - 1);
+    m.f[i] = static_cast<float>(s - s0);
+  }
+  return m;
+}
+
+// Horizontal pass of one source row into three planar float rows (output channel order).
+void ResampleRow(const uint8_t *row, const int *x0, const int *x1, const float *fx, const int *ch, int w, float *out) {
+  for (int c = 0; c < 3; ++c) {
+    const uint8_t *p = row + ch[c];
+    float *o = out + static_cast<size_t>(c) * w;
+    for (int x = 0; x < w; ++x) {
+      const float a = p[x0[x]];
+      const float b = p[x1[x]];
+      o[x] = a + (b - a) * fx[x];
+    }
+  }
+}
+
+EC_INLINE uint8_t SaturateU8(float v) { return static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, v + 0.5f))); }
+
+}  // namespace
+
+TensorSink::TensorSink(const TensorSpec &spec, ThreadPool *pool)
+    : spec_(spec), pool_(pool ? pool : &ThreadPool::Shared()) {
+  spec_.width = std::max(1, spec_.width);
+  spec_.height = std::max(1, spec_.height);
+}
+
+size_t TensorSink::ItemElements() const { return static_cast<size_t>(3) * spec_.width * spec_.height; }
+
+size_t TensorSink::ItemBytes() const {
+  return ItemElements() * (spec_.dtype == TensorSpec::kFloat32 ? sizeof(float) : sizeof(uint8_t));
+}
+
+bool TensorSink::Convert(const ImageRGBA &src, void *dst) const {
+  if (!dst || src.width <= 0 || src.height <= 0 ||
+      src.pixels.size() < static_cast<size_t>(src.width) * src.height * 4)
+    return false;
+  const ScreenRect roi =
+      RectEmpty(spec_.roi) ? ScreenRect{0, 0, src.width, src.height} : ClipRect(spec_.roi, src.width, src.height);
+  if (RectEmpty(roi)) return false;
+
+  const int W = spec_.width;
+  const int H = spec_.height;
+  const bool nearest = spec_.resize == TensorSpec::kNearest;
+  AxisMap xm = BuildAxisMap(W, roi.w, nearest);
+  const AxisMap ym = BuildAxisMap(H, roi.h, nearest);
+  // Column indices -> byte offsets inside a source row.
+  for (int x = 0; x < W; ++x) {
+    xm.i0[x] = (roi.x + xm.i0[x]) * 4;
+    xm.i1[x] = (roi.x + xm.i1[x]) * 4;
+  }
+
+  const int ch[3] = {spec_.order == TensorSpec::kBGR ? 2 : 0, 1, spec_.order == TensorSpec::kBGR ? 0 : 2};
+  float mul[3], add[3];
+  for (int c = 0; c < 3; ++c) {
+    const float sd = spec_.stddev[c] != 0.0f ? spec_.stddev[c] : 1.0f;
+    mul[c] = spec_.scale / sd;
+    add[c] = -spec_.mean[c] / sd;
+  }
+  const bool f32 = spec_.dtype == TensorSpec::kFloat32;
+  const bool nchw = spec_.layout == TensorSpec::kNCHW;
+  const size_t plane = static_cast<size_t>(W) * H;
+  const size_t stride = static_cast<size_t>(src.width) * 4;
+  const uint8_t *base = src.pixels.data();
+
+  pool_->ParallelFor(0, H, 4, [&](int64_t y_begin, int64_t y_end) {
+    // rows[0] / rows[1]: resampled source rows (3 planes each), v: blended row.
+    std::vector<float> buf(static_cast<size_t>(W) * 9);
+    float *rows[2] = {buf.data(), buf.data() + static_cast<size_t>(W) * 3};
+    float *v = buf.data() + static_cast<size_t>(W) * 6;
+    int cached[2] = {-1, -1};
+    auto row = [&](int sy) -> const float * {
+      if (cached[0] == sy) return rows[0];
+      if (cached[1] == sy) return rows[1];
+      // Evict the slot not holding the other row we are about to need (rows ascend).
+      const int slot = cached[0] < cached[1] ? 0 : 1;
+      ResampleRow(base + static_cast<size_t>(roi.y + sy) * stride, xm.i0.data(), xm.i1.data(), xm.f.data(), ch, W,
+                  rows[slot]);
+      cached[slot] = sy;
+      return rows[slot];
+    };
+
+    for (int y = static_cast<int>(y_begin); y < static_cast<int>(y_end); ++y) {
+      const float *a = row(ym.i0[y]);
+      const float *b = ym.i1[y] != ym.i0[y] ? row(ym.i1[y]) : a;
+      const float fy = ym.f[y];
+      for (int c = 0; c < 3; ++c) {
+        const float *pa = a + static_cast<size_t>(c) * W;
+        const float *pb = b + static_cast<size_t>(c) * W;
+        float *pv = v + static_cast<size_t>(c) * W;
+        const float m = f32 ? mul[c] : 1.0f;
+        const float k = f32 ? add[c] : 0.0f;
+        for (int x = 0; x < W; ++x) pv[x] = (pa[x] + (pb[x] - pa[x]) * fy) * m + k;
+      }
+
+      const size_t row_off = static_cast<size_t>(y) * W;
+      if (nchw) {
+        for (int c = 0; c < 3; ++c) {
+          const float *pv = v + static_cast<size_t>(c) * W;
+          if (f32) {
+            std::memcpy(static_cast<float *>(dst) + c * plane + row_off, pv, static_cast<size_t>(W) * sizeof(float));
+          } else {
+            uint8_t *o = static_cast<uint8_t *>(dst) + c * plane + row_off;
+            for (int x = 0; x < W; ++x) o[x] = SaturateU8(pv[x]);
+          }
+        }
+      } else if (f32) {
+        float *o = static_cast<float *>(dst) + row_off * 3;
+        for (int x = 0; x < W; ++x) {
+          o[x * 3 + 0] = v[x];
+          o[x * 3 + 1] = v[W + x];
+          o[x * 3 + 2] = v[2 * W + x];
+        }
+      } else {
+        uint8_t *o = static_cast<uint8_t *>(dst) + row_off * 3;
+        for (int x = 0; x < W; ++x) {
+          o[x * 3 + 0] = SaturateU8(v[x]);
+          o[x * 3 + 1] = SaturateU8(v[W + x]);
+          o[x * 3 + 2] = SaturateU8(v[2 * W + x]);
+        }
+      }
+    }
+  });
+  return true;
+}
+
+}  // namespace autoalg
@@ -0,0 +1,83 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Model-ready tensors from captured frames.
+//
+// TensorSink turns an RGBA ImageRGBA into a float32 or uint8 tensor in one
+// pass: ROI crop, resize (nearest / bilinear), channel order, mean/std
+// normalization and NCHW / NHWC layout are fused per output row, so there is
+// no full-size intermediate image. Rows are spread over a ThreadPool and the
+// inner loops are written over planar row buffers so the compiler can
+// vectorize them. The output goes straight into caller memory, e.g. slot i
+// of a batch buffer handed to the inference runtime.
+//
+// Usage:
+//   TensorSpec spec;
+//   spec.width = 224; spec.height = 224;
+//   spec.mean[0] = 0.485f; ... spec.stddev[0] = 0.229f; ...
+//   TensorSink sink(spec);
+//   std::vector<float> batch(sink.ItemElements() * n);
+//   sink.ConvertInto(frame, batch.data(), i);
+
+#ifndef EASY_CONTROL_INCLUDE_TENSOR_SINK_HPP
+#define EASY_CONTROL_INCLUDE_TENSOR_SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "system_output.hpp"
+#include "thread_pool.hpp"
+
+namespace autoalg {
+
+struct TensorSpec {
+  enum Layout : int { kNCHW = 0, kNHWC };
+  enum DType : int { kFloat32 = 0, kUint8 };
+  enum ChannelOrder : int { kRGB = 0, kBGR };
+  enum Resize : int { kBilinear = 0, kNearest };
+
+  ScreenRect roi;  // source region; empty = whole frame (clipped to the frame)
+  int width = 224;
+  int height = 224;
+  Layout layout = kNCHW;
+  DType dtype = kFloat32;
+  ChannelOrder order = kRGB;
+  Resize resize = kBilinear;
+
+  // float32: out = (pixel * scale - mean[c]) / stddev[c], c in output channel order.
+  // uint8: pixels are resized and reordered only.
+  float scale = 1.0f / 255.0f;
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  float stddev[3] = {1.0f, 1.0f, 1.0f};
+};
+
+class TensorSink {
+ public:
+  // pool == nullptr uses ThreadPool::Shared().
+  explicit TensorSink(const TensorSpec& spec, ThreadPool* pool = nullptr);
+
+  const TensorSpec& Spec() const { return spec_; }
+
+  // 3 * width * height
+  size_t ItemElements() const;
+  // ItemElements() * sizeof(element)
+  size_t ItemBytes() const;
+
+  // Write one tensor (ItemBytes() bytes) to dst. Returns false if the frame is
+  // empty or the ROI does not intersect it.
+  bool Convert(const ImageRGBA& src, void* dst) const;
+
+  // Write into slot `index` of a contiguous batch buffer.
+  bool ConvertInto(const ImageRGBA& src, void* batch, size_t index) const {
+    return Convert(src, static_cast<uint8_t*>(batch) + index * ItemBytes());
+  }
+
+ private:
+  TensorSpec spec_;
+  ThreadPool* pool_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_TENSOR_SINK_HPP
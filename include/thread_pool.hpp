@@ -0,0 +1,195 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Fixed-size worker pool for data-parallel loops.
+//
+// ParallelFor splits [begin, end) into chunks that the workers and the
+// calling thread pull from a shared counter; it returns when every chunk is
+// done. One loop runs at a time per pool: a nested or concurrent call simply
+// runs inline on its caller, so it can never deadlock.
+//
+// Usage:
+//   ThreadPool& pool = ThreadPool::Shared();
+//   pool.ParallelFor(0, height, 16, [&](int64_t y0, int64_t y1) { ... rows [y0, y1) ... });
+
+#ifndef EASY_CONTROL_INCLUDE_THREAD_POOL_HPP
+#define EASY_CONTROL_INCLUDE_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+namespace autoalg {
+
+class ThreadPool {
+ public:
+  using RangeFn = std::function<void(int64_t begin, int64_t end)>;
+
+  // threads = worker count; 0 means NumHWThreads() - 1 (the caller also works).
+  // Every worker applies `config` first, named "<name>-<i>" ("ec-pool-<i>" if
+  // no name is given); e.g. keep the workers off the capture thread's CPUs.
+  EC_INLINE explicit ThreadPool(unsigned threads = 0, const ThreadConfig& config = {}) {
+    if (threads == 0) threads = NumHWThreads() > 1 ? NumHWThreads() - 1 : 0;
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+      ThreadConfig worker = config;
+      worker.name = (config.name.empty() ? std::string("ec-pool") : config.name) + "-" + std::to_string(i);
+      workers_.emplace_back([this, worker] {
+        ApplyThreadConfig(worker);
+        WorkerLoop_();
+      });
+    }
+  }
+
+  EC_INLINE ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool, created on first use.
+  EC_INLINE static ThreadPool& Shared() {
+    static ThreadPool pool(0, TakeSharedConfig_());
+    return pool;
+  }
+
+  // Thread settings for Shared()'s workers. Only takes effect before the
+  // first Shared() call; returns false once the pool exists.
+  EC_INLINE static bool ConfigureShared(const ThreadConfig& config) {
+    SharedConfig& shared = SharedConfig_();
+    std::lock_guard<std::mutex> lk(shared.mutex);
+    if (shared.taken) return false;
+    shared.config = config;
+    return true;
+  }
+
+  // Threads that execute a ParallelFor (workers + caller).
+  EC_INLINE size_t Concurrency() const { return workers_.size() + 1; }
+
+  // Run fn over [begin, end) in chunks of at least `grain` items.
+  EC_INLINE void ParallelFor(int64_t begin, int64_t end, int64_t grain, const RangeFn& fn) {
+    if (end <= begin) return;
+    grain = std::max<int64_t>(1, grain);
+    const int64_t total = end - begin;
+    // ~4 chunks per thread balances uneven rows without much counter traffic.
+    const int64_t target = static_cast<int64_t>(Concurrency()) * 4;
+    const int64_t chunk = std::max(grain, (total + target - 1) / target);
+    const int64_t chunks = (total + chunk - 1) / chunk;
+
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+    if (workers_.empty() || chunks == 1 || !run_lock.owns_lock()) {
+      fn(begin, end);
+      return;
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.begin = begin;
+    job.end = end;
+    job.chunk = chunk;
+    job.chunks = chunks;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      job_ = &job;
+      ++generation_;
+    }
+    cv_.notify_all();
+    RunChunks_(job);
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      done_cv_.wait(lk, [&] { return job.finished == job.chunks && active_ == 0; });
+      job_ = nullptr;
+    }
+  }
+
+ private:
+  struct Job {
+    const RangeFn* fn = nullptr;
+    int64_t begin = 0;
+    int64_t end = 0;
+    int64_t chunk = 1;
+    int64_t chunks = 0;
+    std::atomic<int64_t> next{0};
+    int64_t finished = 0;  // guarded by mutex_
+  };
+
+  struct SharedConfig {
+    std::mutex mutex;
+    ThreadConfig config;
+    bool taken = false;
+  };
+
+  EC_INLINE static SharedConfig& SharedConfig_() {
+    static SharedConfig shared;
+    return shared;
+  }
+
+  EC_INLINE static ThreadConfig TakeSharedConfig_() {
+    SharedConfig& shared = SharedConfig_();
+    std::lock_guard<std::mutex> lk(shared.mutex);
+    shared.taken = true;
+    return shared.config;
+  }
+
+  EC_INLINE void RunChunks_(Job& job) {
+    int64_t done = 0;
+    for (;;) {
+      const int64_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= job.chunks) break;
+      const int64_t lo = job.begin + i * job.chunk;
+      (*job.fn)(lo, std::min(job.end, lo + job.chunk));
+      ++done;
+    }
+    if (done == 0) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    job.finished += done;
+    if (job.finished == job.chunks) done_cv_.notify_all();
+  }
+
+  EC_INLINE void WorkerLoop_() {
+    uint64_t seen = 0;
+    for (;;) {
+      Job* job = nullptr;
+      {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cv_.wait(lk, [&] { return stop_ || (job_ && generation_ != seen); });
+        if (stop_) return;
+        seen = generation_;
+        job = job_;
+        ++active_;
+      }
+      RunChunks_(*job);
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (--active_ == 0) done_cv_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;  // one ParallelFor at a time
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  Job* job_ = nullptr;
+  uint64_t generation_ = 0;
+  int active_ = 0;  // workers currently holding job_
+  bool stop_ = false;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_THREAD_POOL_HPP
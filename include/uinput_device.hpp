@@ -0,0 +1,174 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Minimal Linux uinput device with batched frames.
+//
+// Events are staged in memory and Flush() appends SYN_REPORT and hands the
+// whole frame to the kernel with a single write(). Used by VirtualGamepad
+// and VirtualTouch; needs write access to /dev/uinput, no extra libs.
+
+#ifndef EASY_CONTROL_INCLUDE_UINPUT_DEVICE_HPP
+#define EASY_CONTROL_INCLUDE_UINPUT_DEVICE_HPP
+
+#if !defined(__linux__)
+#error "uinput_device.hpp requires Linux (/dev/uinput)."
+#endif
+
+#include <fcntl.h>
+#include <linux/input-event-codes.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "macro.h"
+
+namespace autoalg {
+
+class UinputDevice {
+ public:
+  struct AbsAxis {
+    uint16_t code = 0;  // ABS_*
+    int32_t minimum = 0;
+    int32_t maximum = 0;
+    int32_t fuzz = 0;
+    int32_t flat = 0;
+    int32_t resolution = 0;
+  };
+
+  struct Setup {
+    std::string name = "autoalg-uinput-device";
+    uint16_t bustype = BUS_USB;
+    uint16_t vendor = 0x1234;
+    uint16_t product = 0x5678;
+    uint16_t version = 1;
+    std::vector<uint16_t> keys;   // EV_KEY codes (KEY_* / BTN_*)
+    std::vector<AbsAxis> abs;     // EV_ABS axes
+    std::vector<uint16_t> rel;    // EV_REL codes
+    std::vector<uint16_t> props;  // INPUT_PROP_*
+  };
+
+  UinputDevice() = default;
+  UinputDevice(const UinputDevice&) = delete;
+  UinputDevice& operator=(const UinputDevice&) = delete;
+  EC_INLINE UinputDevice(UinputDevice&& o) noexcept : fd_(o.fd_), frame_(std::move(o.frame_)) { o.fd_ = -1; }
+  EC_INLINE UinputDevice& operator=(UinputDevice&& o) noexcept {
+    if (this != &o) {
+      Close();
+      fd_ = o.fd_;
+      frame_ = std::move(o.frame_);
+      o.fd_ = -1;
+    }
+    return *this;
+  }
+  EC_INLINE ~UinputDevice() { Close(); }
+
+  // Create the device. Returns false if /dev/uinput is not writable or the
+  // kernel rejects the setup (needs UI_DEV_SETUP / UI_ABS_SETUP, Linux 4.5+).
+  EC_INLINE bool Open(const Setup& setup) {
+    Close();
+    fd_ = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) return false;
+    bool ok = ioctl(fd_, UI_SET_EVBIT, EV_SYN) == 0;
+    if (!setup.keys.empty()) {
+      ok = ok && ioctl(fd_, UI_SET_EVBIT, EV_KEY) == 0;
+      for (uint16_t k : setup.keys) ok = ok && ioctl(fd_, UI_SET_KEYBIT, k) == 0;
+    }
+    if (!setup.rel.empty()) {
+      ok = ok && ioctl(fd_, UI_SET_EVBIT, EV_REL) == 0;
+      for (uint16_t r : setup.rel) ok = ok && ioctl(fd_, UI_SET_RELBIT, r) == 0;
+    }
+    if (!setup.abs.empty()) {
+      ok = ok && ioctl(fd_, UI_SET_EVBIT, EV_ABS) == 0;
+      for (const AbsAxis& a : setup.abs) {
+        ok = ok && ioctl(fd_, UI_SET_ABSBIT, a.code) == 0;
+        uinput_abs_setup abs{};
+        abs.code = a.code;
+        abs.absinfo.minimum = a.minimum;
+        abs.absinfo.maximum = a.maximum;
+        abs.absinfo.fuzz = a.fuzz;
+        abs.absinfo.flat = a.flat;
+        abs.absinfo.resolution = a.resolution;
+        ok = ok && ioctl(fd_, UI_ABS_SETUP, &abs) == 0;
+      }
+    }
+    for (uint16_t p : setup.props) ok = ok && ioctl(fd_, UI_SET_PROPBIT, p) == 0;
+
+    uinput_setup usetup{};
+    usetup.id.bustype = setup.bustype;
+    usetup.id.vendor = setup.vendor;
+    usetup.id.product = setup.product;
+    usetup.id.version = setup.version;
+    std::strncpy(usetup.name, setup.name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+    ok = ok && ioctl(fd_, UI_DEV_SETUP, &usetup) == 0 && ioctl(fd_, UI_DEV_CREATE) == 0;
+    if (!ok) {
+      close(fd_);
+      fd_ = -1;
+    }
+    return ok;
+  }
+
+  EC_INLINE void Close() {
+    if (fd_ < 0) return;
+    ioctl(fd_, UI_DEV_DESTROY);
+    close(fd_);
+    fd_ = -1;
+    frame_.clear();
+  }
+
+  EC_INLINE bool IsOpen() const { return fd_ >= 0; }
+  EC_INLINE int Fd() const { return fd_; }
+
+  // Queue one event for the current frame.
+  EC_INLINE void Stage(uint16_t type, uint16_t code, int32_t value) {
+    input_event ev{};
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    frame_.push_back(ev);
+  }
+
+  EC_INLINE size_t Pending() const { return frame_.size(); }
+
+  // Terminate the staged frame with SYN_REPORT and submit it in one write().
+  // Does nothing (returns true) if no event is staged.
+  EC_INLINE bool Flush() {
+    if (frame_.empty()) return true;
+    Stage(EV_SYN, SYN_REPORT, 0);
+    const bool ok = WriteAll_(frame_.data(), frame_.size() * sizeof(input_event));
+    frame_.clear();
+    return ok;
+  }
+
+  // Write pre-built events as they are (caller adds SYN_REPORTs).
+  EC_INLINE bool WriteRaw(const input_event* events, size_t count) {
+    return WriteAll_(events, count * sizeof(input_event));
+  }
+
+ private:
+  EC_INLINE bool WriteAll_(const void* data, size_t bytes) {
+    if (fd_ < 0) return false;
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+      const ssize_t n = write(fd_, p, bytes);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p += n;
+      bytes -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  int fd_{-1};
+  std::vector<input_event> frame_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_UINPUT_DEVICE_HPP
@@ -0,0 +1,156 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+
+#include "vblank_clock.hpp"
+
+#include <chrono>
+#include <thread>
+
+#include "common.hpp"
+#include "system_output.hpp"
+
+#if defined(AUTOALG_HAVE_XPRESENT)
+#include <X11/Xlib.h>
+#include <X11/extensions/Xpresent.h>
+#include <poll.h>
+
+#include <cerrno>
+#endif
+
+namespace autoalg {
+
+#if defined(AUTOALG_HAVE_XPRESENT)
+// Present MSC notifications on a private connection. The server picks the
+// CRTC a window is on from its position, so a 1x1 window (never mapped) sits
+// at the display's origin.
+struct VblankClock::Present {
+  Display *dpy = nullptr;
+  Window win = 0;
+  XPresentEventID eid = 0;
+  int opcode = 0;
+  uint32_t serial = 0;
+  int failures = 0;
+
+  ~Present() {
+    if (!dpy) return;
+    if (eid) XPresentFreeInput(dpy, win, eid);
+    if (win) XDestroyWindow(dpy, win);
+    XCloseDisplay(dpy);
+  }
+
+  bool Open(const ScreenRect &bounds) {
+    dpy = XOpenDisplay(nullptr);
+    if (!dpy) return false;
+    int event_base = 0, error_base = 0;
+    if (!XPresentQueryExtension(dpy, &opcode, &event_base, &error_base)) return false;
+    XSetWindowAttributes attrs{};
+    attrs.override_redirect = True;
+    win = XCreateWindow(dpy, RootWindow(dpy, DefaultScreen(dpy)), bounds.x, bounds.y, 1, 1, 0, CopyFromParent,
+                        InputOutput, CopyFromParent, CWOverrideRedirect, &attrs);
+    if (!win) return false;
+    eid = XPresentSelectInput(dpy, win, PresentCompleteNotifyMask);
+    XFlush(dpy);
+    return true;
+  }
+
+  // 1: refresh seen, 0: timeout, -1: connection error.
+  int Wait(uint64_t &msc, uint64_t &ust_ns, int timeout_ms) {
+    // target 0, divisor 1, remainder 0: the first MSC after the current one.
+    const uint32_t want = ++serial;
+    XPresentNotifyMSC(dpy, win, want, 0, 1, 0);
+    XFlush(dpy);
+    const uint64_t deadline = timeout_ms < 0 ? 0 : NowSteadyNanos() + static_cast<uint64_t>(timeout_ms) * 1000000ull;
+    for (;;) {
+      while (XPending(dpy)) {
+        XEvent ev;
+        XNextEvent(dpy, &ev);
+        if (ev.type != GenericEvent || ev.xcookie.extension != opcode || !XGetEventData(dpy, &ev.xcookie)) continue;
+        bool hit = false;
+        if (ev.xcookie.evtype == PresentCompleteNotify) {
+          const auto *ce = static_cast<const XPresentCompleteNotifyEvent *>(ev.xcookie.data);
+          // Stale answers to requests that timed out carry older serials.
+          if (ce->kind == PresentCompleteKindNotifyMSC && ce->serial_number == want) {
+            msc = ce->msc;
+            ust_ns = ce->ust * 1000;  // CLOCK_MONOTONIC microseconds, the steady_clock base on Linux
+            hit = true;
+          }
+        }
+        XFreeEventData(dpy, &ev.xcookie);
+        if (hit) return 1;
+      }
+      int wait_ms = -1;
+      if (timeout_ms >= 0) {
+        const uint64_t now = NowSteadyNanos();
+        if (now >= deadline) return 0;
+        wait_ms = static_cast<int>((deadline - now + 999999) / 1000000);
+      }
+      pollfd pfd{ConnectionNumber(dpy), POLLIN, 0};
+      const int n = poll(&pfd, 1, wait_ms);
+      if (n == 0) return 0;
+      if (n < 0 && errno != EINTR) return -1;
+    }
+  }
+};
+#else
+struct VblankClock::Present {};
+#endif
+
+VblankClock::VblankClock(int display_index) {
+  DisplayInfo d;
+  const bool known = SystemOutput::GetDisplay(display_index, d);
+  if (known && d.refresh_hz > 0) refresh_hz_ = d.refresh_hz;
+  period_ns_ = static_cast<uint64_t>(1e9 / refresh_hz_);
+  base_ns_ = NowSteadyNanos();
+#if defined(AUTOALG_HAVE_XPRESENT)
+  std::unique_ptr<Present> p(new Present);
+  if (known && p->Open(d.bounds)) present_ = std::move(p);
+#endif
+}
+
+VblankClock::~VblankClock() = default;
+
+bool VblankClock::IsHardware() const { return present_ != nullptr; }
+
+bool VblankClock::WaitNext(Tick &tick, int timeout_ms) {
+#if defined(AUTOALG_HAVE_XPRESENT)
+  if (present_) {
+    uint64_t msc = 0, ust_ns = 0;
+    const int r = present_->Wait(msc, ust_ns, timeout_ms);
+    if (r > 0) {
+      present_->failures = 0;
+      tick.msc = msc;
+      tick.vblank_ns = ust_ns ? ust_ns : NowSteadyNanos();
+      last_msc_ = msc;
+      return true;
+    }
+    // No CRTC under the window (output off, DPMS) or a dead connection.
+    if (r < 0 || ++present_->failures >= 3) {
+      present_.reset();
+      base_ns_ = NowSteadyNanos();
+      last_msc_ = 0;
+    }
+    return false;
+  }
+#endif
+  return WaitTimer_(tick, timeout_ms);
+}
+
+bool VblankClock::WaitTimer_(Tick &tick, int timeout_ms) {
+  const uint64_t now = NowSteadyNanos();
+  uint64_t n = (now - base_ns_) / period_ns_ + 1;
+  if (n <= last_msc_) n = last_msc_ + 1;
+  const uint64_t at = base_ns_ + n * period_ns_;
+  using namespace std::chrono;
+  if (timeout_ms >= 0 && at > now + static_cast<uint64_t>(timeout_ms) * 1000000ull) {
+    std::this_thread::sleep_for(milliseconds(timeout_ms));
+    return false;
+  }
+  std::this_thread::sleep_until(steady_clock::time_point(duration_cast<steady_clock::duration>(nanoseconds(at))));
+  tick.msc = n;
+  tick.vblank_ns = at;
+  last_msc_ = n;
+  return true;
+}
+
+}  // namespace autoalg
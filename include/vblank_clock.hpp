@@ -0,0 +1,64 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Refresh-synchronized ticks for capture pacing.
+//
+// A fixed-interval capture loop drifts against the display refresh: some
+// grabs land mid-update, others read the same frame twice. VblankClock wakes
+// once per refresh of one display instead. On X11 built with libXpresent
+// (AUTOALG_HAVE_XPRESENT) every tick is a Present MSC notification with the
+// kernel's vblank timestamp; elsewhere it falls back to a steady timer at the
+// display's refresh rate (DisplayInfo::refresh_hz, 60 Hz if unknown), which
+// has the right rate but not the right phase.
+//
+// Usage:
+//   VblankClock vsync(0);
+//   VblankClock::Tick tick;
+//   while (vsync.WaitNext(tick, 100)) { /* sleep a little past tick.vblank_ns, grab */ }
+
+#ifndef EASY_CONTROL_INCLUDE_VBLANK_CLOCK_HPP
+#define EASY_CONTROL_INCLUDE_VBLANK_CLOCK_HPP
+
+#include <cstdint>
+#include <memory>
+
+namespace autoalg {
+
+class VblankClock {
+ public:
+  struct Tick {
+    uint64_t msc = 0;        // refresh counter (Present MSC, or timer periods since the timer started)
+    uint64_t vblank_ns = 0;  // when the refresh happened, NowSteadyNanos() time base
+  };
+
+  explicit VblankClock(int display_index);
+  ~VblankClock();
+
+  VblankClock(const VblankClock&) = delete;
+  VblankClock& operator=(const VblankClock&) = delete;
+
+  // True if ticks come from the display (Present), false for the timer fallback.
+  bool IsHardware() const;
+  double RefreshHz() const { return refresh_hz_; }
+
+  // Block until the next refresh (strictly after the previous tick). Ticks
+  // missed while the caller was busy are skipped, not replayed. Returns false
+  // on timeout (timeout_ms < 0: forever); the hardware path drops to the
+  // timer after repeated failures.
+  bool WaitNext(Tick& tick, int timeout_ms);
+
+ private:
+  struct Present;
+  bool WaitTimer_(Tick& tick, int timeout_ms);
+
+  double refresh_hz_ = 60.0;
+  uint64_t period_ns_ = 0;
+  uint64_t base_ns_ = 0;
+  uint64_t last_msc_ = 0;
+  std::unique_ptr<Present> present_;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_VBLANK_CLOCK_HPP
@@ -0,0 +1,165 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Virtual gamepad (Xbox 360 layout) on Linux uinput.
+//
+// Two sticks, two analog triggers, a D-pad hat and eleven buttons. Setters
+// only stage changes (unchanged values are skipped); Commit() sends all of
+// them as one SYN_REPORT frame with a single write(), so a bot can update
+// every axis at 1 kHz without one syscall per axis.
+//
+// Usage:
+//   VirtualGamepad pad;
+//   if (!pad.Open()) return;           // needs write access to /dev/uinput
+//   pad.SetStick(VirtualGamepad::kLeftStick, 0.5f, -1.0f);
+//   pad.SetTrigger(VirtualGamepad::kRightTrigger, 1.0f);
+//   pad.SetButton(VirtualGamepad::kA, true);
+//   pad.Commit();
+
+#ifndef EASY_CONTROL_INCLUDE_VIRTUAL_GAMEPAD_HPP
+#define EASY_CONTROL_INCLUDE_VIRTUAL_GAMEPAD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "uinput_device.hpp"
+
+namespace autoalg {
+
+class VirtualGamepad {
+ public:
+  enum Axis : int { kLeftX = 0, kLeftY, kRightX, kRightY, kLeftTrigger, kRightTrigger, kAxisCount };
+  enum Stick : int { kLeftStick = 0, kRightStick };
+  enum Button : int {
+    kA = 0,
+    kB,
+    kX,
+    kY,
+    kLeftBumper,
+    kRightBumper,
+    kBack,
+    kStart,
+    kGuide,
+    kLeftThumb,
+    kRightThumb,
+    kButtonCount
+  };
+
+  static constexpr int32_t kStickMin = -32768;
+  static constexpr int32_t kStickMax = 32767;
+  static constexpr int32_t kTriggerMax = 255;
+
+  // Vendor/product default to the Xbox 360 pad so SDL / Steam / browsers map
+  // it without a custom mapping.
+  EC_INLINE bool Open(const std::string& name = "autoalg-virtual-gamepad", uint16_t vendor = 0x045e,
+                      uint16_t product = 0x028e) {
+    UinputDevice::Setup setup;
+    setup.name = name;
+    setup.vendor = vendor;
+    setup.product = product;
+    for (int b = 0; b < kButtonCount; ++b) setup.keys.push_back(ButtonCode_(static_cast<Button>(b)));
+    for (int a = 0; a < kAxisCount; ++a) {
+      const bool trigger = a == kLeftTrigger || a == kRightTrigger;
+      UinputDevice::AbsAxis abs;
+      abs.code = AxisCode_(static_cast<Axis>(a));
+      abs.minimum = trigger ? 0 : kStickMin;
+      abs.maximum = trigger ? kTriggerMax : kStickMax;
+      abs.fuzz = trigger ? 0 : 16;
+      abs.flat = trigger ? 0 : 128;
+      setup.abs.push_back(abs);
+    }
+    for (uint16_t code : {ABS_HAT0X, ABS_HAT0Y}) {
+      UinputDevice::AbsAxis hat;
+      hat.code = code;
+      hat.minimum = -1;
+      hat.maximum = 1;
+      setup.abs.push_back(hat);
+    }
+    if (!dev_.Open(setup)) return false;
+    std::fill(axes_, axes_ + kAxisCount, 0);
+    std::fill(buttons_, buttons_ + kButtonCount, false);
+    hat_x_ = hat_y_ = 0;
+    return true;
+  }
+
+  EC_INLINE void Close() { dev_.Close(); }
+  EC_INLINE bool IsOpen() const { return dev_.IsOpen(); }
+
+  // Raw axis value: sticks in [kStickMin, kStickMax], triggers in [0, kTriggerMax].
+  EC_INLINE void SetAxisRaw(Axis axis, int32_t value) {
+    const bool trigger = axis == kLeftTrigger || axis == kRightTrigger;
+    value = trigger ? std::clamp(value, 0, kTriggerMax) : std::clamp(value, kStickMin, kStickMax);
+    if (axes_[axis] == value) return;
+    axes_[axis] = value;
+    dev_.Stage(EV_ABS, AxisCode_(axis), value);
+  }
+
+  // Stick deflection in [-1, 1] per axis (y grows downwards, as evdev reports it).
+  EC_INLINE void SetStick(Stick stick, float x, float y) {
+    SetAxisRaw(stick == kLeftStick ? kLeftX : kRightX, StickValue_(x));
+    SetAxisRaw(stick == kLeftStick ? kLeftY : kRightY, StickValue_(y));
+  }
+
+  // Trigger pressure in [0, 1]; pass kLeftTrigger / kRightTrigger.
+  EC_INLINE void SetTrigger(Axis trigger, float pressure) {
+    SetAxisRaw(trigger, static_cast<int32_t>(std::lround(std::clamp(pressure, 0.0f, 1.0f) * kTriggerMax)));
+  }
+
+  EC_INLINE void SetButton(Button button, bool pressed) {
+    if (buttons_[button] == pressed) return;
+    buttons_[button] = pressed;
+    dev_.Stage(EV_KEY, ButtonCode_(button), pressed ? 1 : 0);
+  }
+
+  // D-pad: x, y in {-1, 0, 1} (-1 = left / up).
+  EC_INLINE void SetHat(int x, int y) {
+    x = std::clamp(x, -1, 1);
+    y = std::clamp(y, -1, 1);
+    if (x != hat_x_) dev_.Stage(EV_ABS, ABS_HAT0X, hat_x_ = x);
+    if (y != hat_y_) dev_.Stage(EV_ABS, ABS_HAT0Y, hat_y_ = y);
+  }
+
+  // Center sticks, release triggers, buttons and hat (staged).
+  EC_INLINE void Reset() {
+    for (int a = 0; a < kAxisCount; ++a) SetAxisRaw(static_cast<Axis>(a), 0);
+    for (int b = 0; b < kButtonCount; ++b) SetButton(static_cast<Button>(b), false);
+    SetHat(0, 0);
+  }
+
+  // Send every staged change as one frame. Returns true if nothing was pending.
+  EC_INLINE bool Commit() { return dev_.Flush(); }
+
+  // Events staged since the last Commit().
+  EC_INLINE size_t Pending() const { return dev_.Pending(); }
+
+  EC_INLINE int32_t AxisValue(Axis axis) const { return axes_[axis]; }
+  EC_INLINE bool ButtonState(Button button) const { return buttons_[button]; }
+
+ private:
+  EC_INLINE static uint16_t AxisCode_(Axis axis) {
+    static const uint16_t kCodes[kAxisCount] = {ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ};
+    return kCodes[axis];
+  }
+  EC_INLINE static uint16_t ButtonCode_(Button button) {
+    static const uint16_t kCodes[kButtonCount] = {BTN_A,      BTN_B,      BTN_X,      BTN_Y,     BTN_TL,    BTN_TR,
+                                                  BTN_SELECT, BTN_START,  BTN_MODE,   BTN_THUMBL, BTN_THUMBR};
+    return kCodes[button];
+  }
+  EC_INLINE static int32_t StickValue_(float v) {
+    v = std::clamp(v, -1.0f, 1.0f);
+    return static_cast<int32_t>(std::lround(v < 0 ? v * -static_cast<float>(kStickMin) : v * kStickMax));
+  }
+
+  UinputDevice dev_;
+  int32_t axes_[kAxisCount] = {};
+  bool buttons_[kButtonCount] = {};
+  int hat_x_ = 0;
+  int hat_y_ = 0;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_VIRTUAL_GAMEPAD_HPP
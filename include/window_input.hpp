@@ -0,0 +1,648 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Window-targeted background input (X11).
+//
+// SystemInput drives the real pointer and the focused window through XTest,
+// so one automated app at a time, and every action waits for focus changes.
+// WindowInput instead sends synthetic key / button / motion events
+// (XSendEvent) straight to a window, with window-relative coordinates. The
+// real cursor, keyboard focus and modifier state never change, so several
+// background windows on one display can be driven in parallel.
+//
+// Each instance owns its own X connection; use one WindowInput per driving
+// thread. The client list (_NET_CLIENT_LIST) and the subwindow tree of every
+// targeted window are cached. Structure and property notifications mark them
+// stale, so a click normally costs no round trip: the receiving subwindow is
+// hit-tested locally. Errors for windows that vanished are swallowed for this
+// instance's connection only; the call then returns false.
+//
+// Synthetic events carry send_event = True. Most toolkits accept them; some
+// programs ignore them on purpose (xterm without allowSendEvents, games that
+// read XInput2 raw events), and those still need SystemInput.
+//
+// Usage:
+//   WindowInput wi;
+//   const uint64_t win = wi.FindWindow("Mousepad");     // title or WM_CLASS substring
+//   wi.MouseClick(win, 120, 80, WindowInput::kLeft);    // window-relative
+//   wi.TypeText(win, "hello\n");
+
+#ifndef EASY_CONTROL_INCLUDE_WINDOW_INPUT_HPP
+#define EASY_CONTROL_INCLUDE_WINDOW_INPUT_HPP
+
+#if !defined(__linux__)
+#error "window_input.hpp requires Linux (X11)."
+#endif
+
+#include <X11/XKBlib.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common.hpp"
+
+namespace autoalg {
+
+namespace detail {
+// Xlib has one process-wide error handler. This one ignores errors on the
+// connections WindowInput registered (a target window can disappear at any
+// time) and forwards everything else to the handler it replaced.
+struct WindowInputErrors {
+  std::mutex mutex;
+  std::vector<Display*> displays;
+  XErrorHandler previous = nullptr;
+  bool installed = false;
+
+  EC_INLINE static WindowInputErrors& Get() {
+    static WindowInputErrors errors;
+    return errors;
+  }
+
+  EC_INLINE static int Handler(Display* dpy, XErrorEvent* err) {
+    WindowInputErrors& self = Get();
+    XErrorHandler previous = nullptr;
+    {
+      std::lock_guard<std::mutex> lk(self.mutex);
+      if (std::find(self.displays.begin(), self.displays.end(), dpy) != self.displays.end()) return 0;
+      previous = self.previous;
+    }
+    return previous ? previous(dpy, err) : 0;
+  }
+
+  EC_INLINE void Add(Display* dpy) {
+    std::lock_guard<std::mutex> lk(mutex);
+    if (!installed) {
+      previous = XSetErrorHandler(&WindowInputErrors::Handler);
+      installed = true;
+    }
+    displays.push_back(dpy);
+  }
+
+  EC_INLINE void Remove(Display* dpy) {
+    std::lock_guard<std::mutex> lk(mutex);
+    displays.erase(std::remove(displays.begin(), displays.end(), dpy), displays.end());
+  }
+};
+}  // namespace detail
+
+class WindowInput {
+ public:
+  // Same values as SystemInput::MouseButton and SystemInput::Mod.
+  enum MouseButton : int { kLeft = 0, kRight = 1, kMiddle = 2 };
+
+  enum Mod : uint64_t {
+    kNone = 0,
+    kShift = 1ull << 0,
+    kControl = 1ull << 1,
+    kOption = 1ull << 2,  // Alt
+    kCommand = 1ull << 3  // Super
+  };
+
+  struct WindowInfo {
+    uint64_t id = 0;       // client window (not the window manager's frame)
+    std::string title;     // _NET_WM_NAME, else WM_NAME
+    std::string wm_class;  // class part of WM_CLASS
+    uint32_t pid = 0;      // _NET_WM_PID; 0 if not set
+    int x = 0;             // root coordinates of the client area
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool viewable = false;  // mapped and not iconified
+  };
+
+  EC_INLINE WindowInput() {
+    dpy_ = XOpenDisplay(nullptr);
+    if (!dpy_) return;
+    detail::WindowInputErrors::Get().Add(dpy_);
+    root_ = DefaultRootWindow(dpy_);
+    net_client_list_ = XInternAtom(dpy_, "_NET_CLIENT_LIST", False);
+    net_wm_name_ = XInternAtom(dpy_, "_NET_WM_NAME", False);
+    net_wm_pid_ = XInternAtom(dpy_, "_NET_WM_PID", False);
+    utf8_string_ = XInternAtom(dpy_, "UTF8_STRING", False);
+    XSelectInput(dpy_, root_, PropertyChangeMask);
+    XFlush(dpy_);
+  }
+
+  EC_INLINE ~WindowInput() {
+    if (!dpy_) return;
+    XCloseDisplay(dpy_);
+    detail::WindowInputErrors::Get().Remove(dpy_);
+    dpy_ = nullptr;
+  }
+
+  WindowInput(const WindowInput&) = delete;
+  WindowInput& operator=(const WindowInput&) = delete;
+
+  EC_INLINE bool IsOpen() const { return dpy_ != nullptr; }
+
+  // Sequence number (see NextInputSeq() in common.hpp) of the last event this
+  // instance sent; 0 before the first one.
+  EC_INLINE uint64_t LastSeq() const { return last_seq_; }
+
+  // ---------- Windows ----------
+  // Managed top-level windows in the window manager's order (root children
+  // that are mapped when no EWMH client list exists).
+  EC_INLINE std::vector<WindowInfo> ListWindows() {
+    RefreshList_();
+    return windows_;
+  }
+
+  // First window whose title or WM_CLASS contains `text`; 0 if none.
+  EC_INLINE uint64_t FindWindow(const std::string& text) {
+    RefreshList_();
+    for (const WindowInfo& w : windows_)
+      if (w.title.find(text) != std::string::npos || w.wm_class.find(text) != std::string::npos) return w.id;
+    return 0;
+  }
+
+  EC_INLINE bool GetWindow(uint64_t window, WindowInfo& out) {
+    RefreshList_();
+    for (const WindowInfo& w : windows_) {
+      if (w.id == window) {
+        out = w;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Drop every cached tree and the window list (they are rebuilt on demand).
+  EC_INLINE void Invalidate() {
+    trees_.clear();
+    owner_.clear();
+    list_dirty_ = true;
+  }
+
+  // Wait until the server has processed everything sent so far.
+  EC_INLINE void Sync() {
+    if (dpy_) XSync(dpy_, False);
+  }
+
+  // ---------- Pointer (x, y relative to the window's client area) ----------
+  EC_INLINE bool MouseMove(uint64_t window, int x, int y) {
+    return SendPointer_(window, MotionNotify, x, y, 0, HeldState_(window));
+  }
+
+  EC_INLINE bool MouseDown(uint64_t window, int x, int y, int button) {
+    const unsigned state = HeldState_(window);
+    if (!SendPointer_(window, ButtonPress, x, y, XButton_(button), state)) return false;
+    held_[window] = state | ButtonMask_(XButton_(button));
+    return true;
+  }
+
+  EC_INLINE bool MouseUp(uint64_t window, int x, int y, int button) {
+    const unsigned state = HeldState_(window);
+    if (!SendPointer_(window, ButtonRelease, x, y, XButton_(button), state)) return false;
+    held_[window] = state & ~ButtonMask_(XButton_(button));
+    return true;
+  }
+
+  EC_INLINE bool MouseClick(uint64_t window, int x, int y, int button) {
+    return MouseMove(window, x, y) && MouseDown(window, x, y, button) && MouseUp(window, x, y, button);
+  }
+
+  // Press, move along a straight line in `steps` motion events, release.
+  EC_INLINE bool MouseDrag(uint64_t window, int x0, int y0, int x1, int y1, int button, int steps = 16) {
+    if (!MouseMove(window, x0, y0) || !MouseDown(window, x0, y0, button)) return false;
+    steps = std::max(1, steps);
+    for (int i = 1; i <= steps; ++i)
+      MouseMove(window, x0 + (x1 - x0) * i / steps, y0 + (y1 - y0) * i / steps);
+    return MouseUp(window, x1, y1, button);
+  }
+
+  // Wheel notches at (x, y); dy > 0 scrolls up, dx > 0 scrolls left (buttons
+  // 4/5 and 6/7, as SystemInput::ScrollLines).
+  EC_INLINE bool Scroll(uint64_t window, int x, int y, int dy, int dx = 0) {
+    const unsigned state = HeldState_(window);
+    auto notches = [&](unsigned button, int count) {
+      for (int i = 0; i < count; ++i) {
+        if (!SendPointer_(window, ButtonPress, x, y, button, state)) return false;
+        if (!SendPointer_(window, ButtonRelease, x, y, button, state | ButtonMask_(button))) return false;
+      }
+      return true;
+    };
+    bool ok = true;
+    if (dy) ok = notches(dy > 0 ? 4 : 5, std::abs(dy)) && ok;
+    if (dx) ok = notches(dx > 0 ? 6 : 7, std::abs(dx)) && ok;
+    return ok;
+  }
+
+  // ---------- Keyboard ----------
+  // key is an X keycode (as SystemInput on X11, see KeyCodeFor). Modifiers go
+  // into the event state only: no modifier key is pressed, so parallel
+  // targets never see each other's modifiers.
+  EC_INLINE bool KeyDown(uint64_t window, int key, uint64_t mods = kNone) {
+    return SendKey_(window, KeyPress, static_cast<unsigned>(key), ModState_(mods));
+  }
+
+  EC_INLINE bool KeyUp(uint64_t window, int key, uint64_t mods = kNone) {
+    return SendKey_(window, KeyRelease, static_cast<unsigned>(key), ModState_(mods));
+  }
+
+  EC_INLINE bool KeyClick(uint64_t window, int key, uint64_t mods = kNone) {
+    return KeyDown(window, key, mods) && KeyUp(window, key, mods);
+  }
+
+  // X keycode for a printable ASCII character, '\n' or '\t'; -1 if unmapped.
+  EC_INLINE int KeyCodeFor(char c) {
+    bool shift = false;
+    return KeyFor_(static_cast<unsigned char>(c), shift);
+  }
+
+  // Type ASCII text (Shift added where the layout needs it). Characters the
+  // layout cannot produce are skipped and make the call return false.
+  EC_INLINE bool TypeText(uint64_t window, const std::string& text) {
+    bool ok = true;
+    for (unsigned char c : text) {
+      bool shift = false;
+      const int kc = KeyFor_(c, shift);
+      if (kc < 0) {
+        ok = false;
+        continue;
+      }
+      const unsigned state = shift ? ShiftMask : 0;
+      if (!SendKey_(window, KeyPress, static_cast<unsigned>(kc), state) ||
+          !SendKey_(window, KeyRelease, static_cast<unsigned>(kc), state))
+        return false;
+    }
+    return ok;
+  }
+
+ private:
+  // Every window we watch gets the same mask (one selection per connection).
+  static constexpr long kWatchMask = StructureNotifyMask | SubstructureNotifyMask | PropertyChangeMask;
+  static constexpr size_t kMaxTreeNodes = 4096;
+
+  struct Node_ {
+    Window id = 0;
+    int x = 0;  // client-area origin relative to the tree's top window
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool mapped = false;
+    std::vector<int> children;  // bottom-to-top stacking order
+  };
+
+  struct Tree_ {
+    std::vector<Node_> nodes;  // nodes[0] is the targeted window
+    int root_x = 0;
+    int root_y = 0;
+    bool dirty = true;
+  };
+
+  EC_INLINE static unsigned XButton_(int button) { return button == kRight ? 3u : (button == kMiddle ? 2u : 1u); }
+
+  EC_INLINE static unsigned ButtonMask_(unsigned xbutton) {
+    return xbutton >= 1 && xbutton <= 5 ? Button1Mask << (xbutton - 1) : 0u;
+  }
+
+  EC_INLINE static unsigned ModState_(uint64_t mods) {
+    unsigned s = 0;
+    if (mods & kShift) s |= ShiftMask;
+    if (mods & kControl) s |= ControlMask;
+    if (mods & kOption) s |= Mod1Mask;
+    if (mods & kCommand) s |= Mod4Mask;
+    return s;
+  }
+
+  EC_INLINE unsigned HeldState_(uint64_t window) const {
+    const auto it = held_.find(window);
+    return it == held_.end() ? 0u : it->second;
+  }
+
+  EC_INLINE int KeyFor_(unsigned char c, bool& shift) {
+    shift = false;
+    if (!dpy_) return -1;
+    KeySym sym = NoSymbol;
+    if (c >= 32 && c < 127)
+      sym = (KeySym)c;
+    else if (c == '\n' || c == '\r')
+      sym = XK_Return;
+    else if (c == '\t')
+      sym = XK_Tab;
+    if (sym == NoSymbol) return -1;
+    const KeyCode kc = XKeysymToKeycode(dpy_, sym);
+    if (!kc) return -1;
+    shift = XkbKeycodeToKeysym(dpy_, kc, 0, 0) != sym && XkbKeycodeToKeysym(dpy_, kc, 0, 1) == sym;
+    return kc;
+  }
+
+  // ----- event intake: mark caches stale -----
+  EC_INLINE void Poll_() {
+    while (XPending(dpy_)) {
+      XEvent ev;
+      XNextEvent(dpy_, &ev);
+      switch (ev.type) {
+        case PropertyNotify:
+          if (ev.xproperty.window == root_) {
+            if (ev.xproperty.atom == net_client_list_) list_dirty_ = true;
+          } else if (ev.xproperty.atom == net_wm_name_ || ev.xproperty.atom == XA_WM_NAME ||
+                     ev.xproperty.atom == XA_WM_CLASS) {
+            if (listed_.count(ev.xproperty.window)) list_dirty_ = true;
+          }
+          break;
+        case ConfigureNotify:
+        case MapNotify:
+        case UnmapNotify:
+        case CreateNotify:
+        case DestroyNotify:
+        case ReparentNotify:
+        case GravityNotify:
+        case CirculateNotify:
+          // xany.window is the window whose selection reported the event.
+          if (listed_.count(ev.xany.window)) list_dirty_ = true;
+          if (const auto it = owner_.find(ev.xany.window); it != owner_.end()) {
+            if (const auto t = trees_.find(it->second); t != trees_.end()) t->second.dirty = true;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  // ----- window list -----
+  EC_INLINE void RefreshList_() {
+    if (!dpy_) return;
+    Poll_();
+    if (!list_dirty_) return;
+    list_dirty_ = false;
+    windows_.clear();
+    listed_.clear();
+
+    std::vector<Window> ids = WindowListProperty_(root_, net_client_list_);
+    if (ids.empty()) {
+      Window r = 0, p = 0, *kids = nullptr;
+      unsigned n = 0;
+      if (XQueryTree(dpy_, root_, &r, &p, &kids, &n)) {
+        for (unsigned i = 0; i < n; ++i) {
+          XWindowAttributes a;
+          if (XGetWindowAttributes(dpy_, kids[i], &a) && a.map_state == IsViewable && !a.override_redirect)
+            ids.push_back(kids[i]);
+        }
+        if (kids) XFree(kids);
+      }
+    }
+    for (Window id : ids) {
+      WindowInfo info;
+      if (!QueryInfo_(id, info)) continue;
+      XSelectInput(dpy_, id, kWatchMask);
+      listed_.insert(id);
+      windows_.push_back(std::move(info));
+    }
+    XFlush(dpy_);
+  }
+
+  EC_INLINE std::vector<Window> WindowListProperty_(Window w, Atom prop) {
+    std::vector<Window> out;
+    Atom type = None;
+    int format = 0;
+    unsigned long count = 0, after = 0;
+    unsigned char* data = nullptr;
+    if (XGetWindowProperty(dpy_, w, prop, 0, 1 << 16, False, XA_WINDOW, &type, &format, &count, &after, &data) ==
+            Success &&
+        data) {
+      // Format-32 data comes back as an array of long.
+      if (type == XA_WINDOW && format == 32) {
+        const auto* ids = reinterpret_cast<const unsigned long*>(data);
+        out.assign(ids, ids + count);
+      }
+      XFree(data);
+    }
+    return out;
+  }
+
+  EC_INLINE bool QueryInfo_(Window id, WindowInfo& info) {
+    XWindowAttributes a;
+    if (!XGetWindowAttributes(dpy_, id, &a)) return false;
+    Window child = 0;
+    int rx = 0, ry = 0;
+    if (!XTranslateCoordinates(dpy_, id, root_, 0, 0, &rx, &ry, &child)) return false;
+    info.id = id;
+    info.x = rx;
+    info.y = ry;
+    info.width = a.width;
+    info.height = a.height;
+    info.viewable = a.map_state == IsViewable;
+
+    Atom type = None;
+    int format = 0;
+    unsigned long count = 0, after = 0;
+    unsigned char* data = nullptr;
+    if (XGetWindowProperty(dpy_, id, net_wm_name_, 0, 1024, False, utf8_string_, &type, &format, &count, &after, &data) ==
+            Success &&
+        data) {
+      if (type == utf8_string_ && format == 8) info.title.assign(reinterpret_cast<const char*>(data), count);
+      XFree(data);
+    }
+    if (info.title.empty()) {
+      char* name = nullptr;
+      if (XFetchName(dpy_, id, &name) && name) {
+        info.title = name;
+        XFree(name);
+      }
+    }
+    XClassHint hint{nullptr, nullptr};
+    if (XGetClassHint(dpy_, id, &hint)) {
+      if (hint.res_class) info.wm_class = hint.res_class;
+      if (hint.res_name) XFree(hint.res_name);
+      if (hint.res_class) XFree(hint.res_class);
+    }
+    data = nullptr;
+    if (XGetWindowProperty(dpy_, id, net_wm_pid_, 0, 1, False, XA_CARDINAL, &type, &format, &count, &after, &data) ==
+            Success &&
+        data) {
+      if (type == XA_CARDINAL && format == 32 && count == 1)
+        info.pid = static_cast<uint32_t>(*reinterpret_cast<const unsigned long*>(data));
+      XFree(data);
+    }
+    return true;
+  }
+
+  // ----- subwindow trees -----
+  EC_INLINE Tree_* TreeFor_(uint64_t window) {
+    if (!dpy_ || !window) return nullptr;
+    Poll_();
+    Tree_& tree = trees_[window];
+    if (tree.dirty) {
+      for (const Node_& n : tree.nodes) owner_.erase(n.id);
+      if (!BuildTree_(static_cast<Window>(window), tree)) {
+        for (const Node_& n : tree.nodes) owner_.erase(n.id);
+        trees_.erase(window);
+        held_.erase(window);
+        return nullptr;
+      }
+      for (const Node_& n : tree.nodes) owner_[n.id] = window;
+      tree.dirty = false;
+    }
+    return &tree;
+  }
+
+  EC_INLINE bool BuildTree_(Window top, Tree_& tree) {
+    tree.nodes.clear();
+    XWindowAttributes a;
+    if (!XGetWindowAttributes(dpy_, top, &a)) return false;
+    Window child = 0;
+    if (!XTranslateCoordinates(dpy_, top, root_, 0, 0, &tree.root_x, &tree.root_y, &child)) return false;
+    Node_ node;
+    node.id = top;
+    node.width = a.width;
+    node.height = a.height;
+    node.mapped = true;
+    tree.nodes.push_back(node);
+    XSelectInput(dpy_, top, kWatchMask);
+    AddChildren_(tree, 0, 0);
+    XFlush(dpy_);
+    return true;
+  }
+
+  EC_INLINE void AddChildren_(Tree_& tree, int index, int depth) {
+    if (depth >= 32) return;
+    Window r = 0, p = 0, *kids = nullptr;
+    unsigned n = 0;
+    if (!XQueryTree(dpy_, tree.nodes[(size_t)index].id, &r, &p, &kids, &n)) return;
+    for (unsigned i = 0; i < n && tree.nodes.size() < kMaxTreeNodes; ++i) {
+      XWindowAttributes a;
+      if (!XGetWindowAttributes(dpy_, kids[i], &a)) continue;  // destroyed meanwhile
+      Node_ node;
+      node.id = kids[i];
+      // a.x / a.y locate the border's outer corner inside the parent.
+      node.x = tree.nodes[(size_t)index].x + a.x + a.border_width;
+      node.y = tree.nodes[(size_t)index].y + a.y + a.border_width;
+      node.width = a.width;
+      node.height = a.height;
+      node.mapped = a.map_state != IsUnmapped;
+      const int child = static_cast<int>(tree.nodes.size());
+      tree.nodes.push_back(node);
+      tree.nodes[(size_t)index].children.push_back(child);
+      XSelectInput(dpy_, kids[i], kWatchMask);
+      AddChildren_(tree, child, depth + 1);
+    }
+    if (kids) XFree(kids);
+  }
+
+  // Deepest mapped subwindow containing (x, y) (top-window coordinates);
+  // x / y become relative to it.
+  EC_INLINE static Window HitTest_(const Tree_& tree, int& x, int& y) {
+    int index = 0;
+    for (bool descended = true; descended;) {
+      descended = false;
+      const std::vector<int>& kids = tree.nodes[(size_t)index].children;
+      for (auto it = kids.rbegin(); it != kids.rend(); ++it) {
+        const Node_& n = tree.nodes[(size_t)*it];
+        if (n.mapped && x >= n.x && y >= n.y && x < n.x + n.width && y < n.y + n.height) {
+          index = *it;
+          descended = true;
+          break;
+        }
+      }
+    }
+    const Node_& hit = tree.nodes[(size_t)index];
+    x -= hit.x;
+    y -= hit.y;
+    return hit.id;
+  }
+
+  // ----- sending -----
+  EC_INLINE bool SendPointer_(uint64_t window, int type, int x, int y, unsigned button, unsigned state) {
+    Tree_* tree = TreeFor_(window);
+    if (!tree) return false;
+    int lx = x, ly = y;
+    const Window target = HitTest_(*tree, lx, ly);
+    XEvent ev;
+    std::memset(&ev, 0, sizeof(ev));
+    long mask = 0;
+    if (type == MotionNotify) {
+      XMotionEvent& m = ev.xmotion;
+      m.type = MotionNotify;
+      m.display = dpy_;
+      m.window = target;
+      m.root = root_;
+      m.time = CurrentTime;
+      m.x = lx;
+      m.y = ly;
+      m.x_root = tree->root_x + x;
+      m.y_root = tree->root_y + y;
+      m.state = state;
+      m.is_hint = NotifyNormal;
+      m.same_screen = True;
+      mask = PointerMotionMask | ((state & (Button1Mask | Button2Mask | Button3Mask)) ? ButtonMotionMask : 0);
+    } else {
+      XButtonEvent& b = ev.xbutton;
+      b.type = type;
+      b.display = dpy_;
+      b.window = target;
+      b.root = root_;
+      b.time = CurrentTime;
+      b.x = lx;
+      b.y = ly;
+      b.x_root = tree->root_x + x;
+      b.y_root = tree->root_y + y;
+      b.state = state;
+      b.button = button;
+      b.same_screen = True;
+      mask = type == ButtonPress ? ButtonPressMask : ButtonReleaseMask;
+    }
+    // propagate = True: delivered to the nearest ancestor that selected the event.
+    const bool ok = XSendEvent(dpy_, target, True, mask, &ev) != 0;
+    XFlush(dpy_);
+    last_seq_ = NextInputSeq();
+    return ok;
+  }
+
+  EC_INLINE bool SendKey_(uint64_t window, int type, unsigned keycode, unsigned state) {
+    Tree_* tree = TreeFor_(window);
+    if (!tree) return false;
+    XEvent ev;
+    std::memset(&ev, 0, sizeof(ev));
+    XKeyEvent& k = ev.xkey;
+    k.type = type;
+    k.display = dpy_;
+    k.window = static_cast<Window>(window);
+    k.root = root_;
+    k.time = CurrentTime;
+    k.x = k.y = 1;
+    k.x_root = tree->root_x + 1;
+    k.y_root = tree->root_y + 1;
+    k.state = state;
+    k.keycode = keycode;
+    k.same_screen = True;
+    const bool ok =
+        XSendEvent(dpy_, static_cast<Window>(window), True, type == KeyPress ? KeyPressMask : KeyReleaseMask, &ev) != 0;
+    XFlush(dpy_);
+    last_seq_ = NextInputSeq();
+    return ok;
+  }
+
+  Display* dpy_ = nullptr;
+  Window root_ = 0;
+  Atom net_client_list_ = None;
+  Atom net_wm_name_ = None;
+  Atom net_wm_pid_ = None;
+  Atom utf8_string_ = None;
+
+  std::vector<WindowInfo> windows_;
+  std::unordered_set<Window> listed_;
+  bool list_dirty_ = true;
+
+  std::unordered_map<uint64_t, Tree_> trees_;
+  std::unordered_map<Window, uint64_t> owner_;  // cached subwindow -> its tree
+  std::unordered_map<uint64_t, unsigned> held_;  // buttons held per target, as an X state mask
+  uint64_t last_seq_ = 0;
+};
+
+}  // namespace autoalg
+
+#endif  // EASY_CONTROL_INCLUDE_WINDOW_INPUT_HPP
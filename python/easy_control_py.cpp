@@ -0,0 +1,403 @@
+// (c) 2025 AutoAlg (autoalg.com).
+// Author: Chunzhi Qu.
+// SPDX-License-Identifier: MIT.
+//
+// Python bindings (pybind11), module `easy_control`.
+//
+// Frames come from a FramePool and are exported through the buffer protocol:
+// numpy.asarray(frame) is an (height, width, 4) uint8 view of the pooled
+// pixels, not a copy, and keeps the frame alive; the frame goes back to the
+// pool once the last view is gone. TensorSink and BatchCapture write straight
+// into a caller-provided writable buffer (a NumPy array, a pinned torch
+// tensor, ...), so between the capture backend and the model input there is
+// no other copy of the pixels.
+//
+// Every call that grabs, converts, waits or injects input releases the GIL.
+// Scheduler callbacks run on the scheduler thread and take the GIL only for
+// the Python call itself.
+//
+// Usage (Python):
+//   import numpy as np, easy_control as ec
+//   frame = ec.capture(0)
+//   pixels = np.asarray(frame)                      # shares the pooled memory
+//   sink = ec.TensorSink(ec.TensorSpec())
+//   batch = np.empty((1, 3, 224, 224), np.float32)
+//   sink.convert_into(frame, batch, 0)
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "batch_capture.hpp"
+#include "capture_scheduler.hpp"
+#include "common.hpp"
+#include "frame_pool.hpp"
+#include "input_queue.hpp"
+#include "system_input.hpp"
+#include "system_output.hpp"
+#include "tensor_sink.hpp"
+
+namespace py = pybind11;
+using namespace autoalg;
+
+namespace {
+
+using Frame = FramePool::Frame;
+
+FramePool &Pool() {
+  static FramePool pool(8);
+  return pool;
+}
+
+// Writable, C-contiguous buffer with at least `bytes` bytes of `itemsize`
+// elements. The returned info holds the buffer export, so the memory stays
+// put while the GIL is released.
+py::buffer_info RequestOutput(const py::buffer &out, size_t bytes, py::ssize_t itemsize) {
+  py::buffer_info info = out.request(true);
+  if (info.itemsize != itemsize)
+    throw py::value_error("output element size is " + std::to_string(info.itemsize) + " bytes, expected " +
+                          std::to_string(itemsize));
+  py::ssize_t expect = info.itemsize;
+  for (py::ssize_t d = info.ndim - 1; d >= 0; --d) {
+    if (info.shape[(size_t)d] > 1 && info.strides[(size_t)d] != expect)
+      throw py::value_error("output buffer must be C-contiguous");
+    expect *= info.shape[(size_t)d];
+  }
+  if (static_cast<size_t>(info.size * info.itemsize) < bytes)
+    throw py::value_error("output buffer holds " + std::to_string(info.size * info.itemsize) + " bytes, needs " +
+                          std::to_string(bytes));
+  return info;
+}
+
+py::ssize_t TensorItemSize(const TensorSpec &spec) { return spec.dtype == TensorSpec::kFloat32 ? 4 : 1; }
+
+// Owns a CaptureScheduler whose callbacks need the GIL: stopping it or
+// unsubscribing (which waits for a running callback) must not hold the GIL,
+// or a callback waiting for it would never finish.
+struct PyScheduler {
+  std::unique_ptr<CaptureScheduler> impl;
+
+  explicit PyScheduler(const CaptureScheduler::Options &options) : impl(new CaptureScheduler(options)) {}
+
+  ~PyScheduler() {
+    py::gil_scoped_release nogil;
+    impl.reset();
+  }
+};
+
+}  // namespace
+
+PYBIND11_MODULE(easy_control, m) {
+  m.doc() = "easy_control: screen capture and input injection";
+
+  // ---------- Geometry / displays ----------
+  py::class_<ScreenRect>(m, "ScreenRect")
+      .def(py::init<>())
+      .def(py::init([](int x, int y, int w, int h) { return ScreenRect{x, y, w, h}; }), py::arg("x"), py::arg("y"),
+           py::arg("w"), py::arg("h"))
+      .def_readwrite("x", &ScreenRect::x)
+      .def_readwrite("y", &ScreenRect::y)
+      .def_readwrite("w", &ScreenRect::w)
+      .def_readwrite("h", &ScreenRect::h)
+      .def("__repr__", [](const ScreenRect &r) {
+        return "ScreenRect(" + std::to_string(r.x) + ", " + std::to_string(r.y) + ", " + std::to_string(r.w) + ", " +
+               std::to_string(r.h) + ")";
+      });
+
+  py::class_<DisplayInfo>(m, "DisplayInfo")
+      .def_readonly("index", &DisplayInfo::index)
+      .def_readonly("id", &DisplayInfo::id)
+      .def_readonly("name", &DisplayInfo::name)
+      .def_readonly("bounds", &DisplayInfo::bounds)
+      .def_readonly("refresh_hz", &DisplayInfo::refresh_hz)
+      .def_readonly("scale", &DisplayInfo::scale)
+      .def_readonly("rotation", &DisplayInfo::rotation)
+      .def_readonly("primary", &DisplayInfo::primary);
+
+  m.def("display_count", &SystemOutput::GetDisplayCount, py::call_guard<py::gil_scoped_release>());
+  m.def("displays", &SystemOutput::GetDisplays, py::call_guard<py::gil_scoped_release>());
+
+  // ---------- Frames ----------
+  py::class_<ImageRGBA, std::shared_ptr<ImageRGBA>>(m, "Frame", py::buffer_protocol())
+      .def_buffer([](ImageRGBA &f) {
+        return py::buffer_info(f.pixels.data(), 1, py::format_descriptor<uint8_t>::format(), 3,
+                               std::vector<py::ssize_t>{f.height, f.width, 4},
+                               std::vector<py::ssize_t>{static_cast<py::ssize_t>(f.width) * 4, 4, 1});
+      })
+      .def_readonly("width", &ImageRGBA::width)
+      .def_readonly("height", &ImageRGBA::height)
+      .def_readonly("input_seq", &ImageRGBA::input_seq)
+      .def_readonly("grab_begin_ns", &ImageRGBA::grab_begin_ns)
+      .def_readonly("grab_end_ns", &ImageRGBA::grab_end_ns)
+      .def("__repr__", [](const ImageRGBA &f) {
+        return "Frame(" + std::to_string(f.width) + "x" + std::to_string(f.height) + ", input_seq=" +
+               std::to_string(f.input_seq) + ")";
+      });
+
+  m.def(
+      "capture",
+      [](int display, std::optional<ScreenRect> region) -> py::object {
+        Frame frame = Pool().Acquire();
+        bool ok = false;
+        {
+          py::gil_scoped_release nogil;
+          ok = region ? SystemOutput::CaptureRegionWithCursor(display, *region, *frame)
+                      : SystemOutput::CaptureScreenWithCursor(display, *frame);
+        }
+        if (!ok) return py::none();
+        return py::cast(std::move(frame));
+      },
+      py::arg("display") = 0, py::arg("region") = py::none(),
+      "Grab a display (or a display-local region) into a pooled Frame; None on failure.");
+
+  m.def("frame_pool_stats", [] {
+    const FramePool::Stats s = Pool().GetStats();
+    py::dict d;
+    d["acquired"] = s.acquired;
+    d["allocated"] = s.allocated;
+    d["recycled"] = s.recycled;
+    d["free"] = s.free;
+    return d;
+  });
+
+  py::class_<CaptureSession>(m, "CaptureSession")
+      .def(py::init<int>(), py::arg("display") = 0)
+      .def_property_readonly("is_open", &CaptureSession::IsOpen)
+      .def_property_readonly("supports_damage", &CaptureSession::SupportsDamage)
+      .def("grab",
+           [](CaptureSession &s) -> py::object {
+             Frame frame = Pool().Acquire();
+             bool ok = false;
+             {
+               py::gil_scoped_release nogil;
+               ok = s.Grab(*frame);
+             }
+             if (!ok) return py::none();
+             return py::cast(std::move(frame));
+           })
+      .def(
+          "grab_changed",
+          [](CaptureSession &s, int timeout_ms) -> py::object {
+            Frame frame = Pool().Acquire();
+            std::vector<ScreenRect> damage;
+            bool ok = false;
+            {
+              py::gil_scoped_release nogil;
+              ok = s.GrabChanged(*frame, &damage, timeout_ms);
+            }
+            if (!ok) return py::none();
+            return py::make_tuple(std::move(frame), std::move(damage));
+          },
+          py::arg("timeout_ms") = -1, "(Frame, [ScreenRect damage]) once the display changed; None on timeout.");
+
+  // ---------- Tensors ----------
+  py::class_<TensorSpec> spec(m, "TensorSpec");
+  py::enum_<TensorSpec::Layout>(spec, "Layout").value("NCHW", TensorSpec::kNCHW).value("NHWC", TensorSpec::kNHWC);
+  py::enum_<TensorSpec::DType>(spec, "DType").value("FLOAT32", TensorSpec::kFloat32).value("UINT8", TensorSpec::kUint8);
+  py::enum_<TensorSpec::ChannelOrder>(spec, "ChannelOrder").value("RGB", TensorSpec::kRGB).value("BGR", TensorSpec::kBGR);
+  py::enum_<TensorSpec::Resize>(spec, "Resize")
+      .value("BILINEAR", TensorSpec::kBilinear)
+      .value("NEAREST", TensorSpec::kNearest);
+  spec.def(py::init<>())
+      .def_readwrite("roi", &TensorSpec::roi)
+      .def_readwrite("width", &TensorSpec::width)
+      .def_readwrite("height", &TensorSpec::height)
+      .def_readwrite("layout", &TensorSpec::layout)
+      .def_readwrite("dtype", &TensorSpec::dtype)
+      .def_readwrite("order", &TensorSpec::order)
+      .def_readwrite("resize", &TensorSpec::resize)
+      .def_readwrite("scale", &TensorSpec::scale)
+      .def_property(
+          "mean", [](const TensorSpec &s) { return std::array<float, 3>{s.mean[0], s.mean[1], s.mean[2]}; },
+          [](TensorSpec &s, const std::array<float, 3> &v) { std::copy(v.begin(), v.end(), s.mean); })
+      .def_property(
+          "stddev", [](const TensorSpec &s) { return std::array<float, 3>{s.stddev[0], s.stddev[1], s.stddev[2]}; },
+          [](TensorSpec &s, const std::array<float, 3> &v) { std::copy(v.begin(), v.end(), s.stddev); });
+
+  py::class_<TensorSink>(m, "TensorSink")
+      .def(py::init([](const TensorSpec &spec) { return new TensorSink(spec); }), py::arg("spec"))
+      .def_property_readonly("spec", &TensorSink::Spec)
+      .def_property_readonly("item_elements", &TensorSink::ItemElements)
+      .def_property_readonly("item_bytes", &TensorSink::ItemBytes)
+      .def(
+          "convert_into",
+          [](const TensorSink &sink, const ImageRGBA &frame, const py::buffer &out, size_t index) {
+            const py::buffer_info info =
+                RequestOutput(out, (index + 1) * sink.ItemBytes(), TensorItemSize(sink.Spec()));
+            py::gil_scoped_release nogil;
+            return sink.ConvertInto(frame, info.ptr, index);
+          },
+          py::arg("frame"), py::arg("out"), py::arg("index") = 0,
+          "Write one tensor into slot `index` of a C-contiguous output buffer (float32 or uint8 per spec.dtype).");
+
+  // ---------- Batched capture ----------
+  py::class_<BatchCapture::ItemStatus>(m, "BatchItemStatus")
+      .def_readonly("ok", &BatchCapture::ItemStatus::ok)
+      .def_readonly("width", &BatchCapture::ItemStatus::width)
+      .def_readonly("height", &BatchCapture::ItemStatus::height)
+      .def_readonly("input_seq", &BatchCapture::ItemStatus::input_seq)
+      .def_readonly("grab_begin_ns", &BatchCapture::ItemStatus::grab_begin_ns)
+      .def_readonly("grab_end_ns", &BatchCapture::ItemStatus::grab_end_ns);
+
+  py::class_<BatchCapture>(m, "BatchCapture")
+      .def(py::init([](const std::vector<std::pair<int, std::optional<ScreenRect>>> &items) {
+             std::vector<BatchCapture::Item> list;
+             for (const auto &it : items) list.push_back({it.first, it.second.value_or(ScreenRect{})});
+             return new BatchCapture(std::move(list));
+           }),
+           py::arg("items"), "items: [(display, ScreenRect or None)]")
+      .def("__len__", &BatchCapture::Size)
+      .def(
+          "capture_rgba",
+          [](BatchCapture &b, const py::buffer &out, int slot_width, int slot_height) {
+            const size_t bytes = b.Size() * static_cast<size_t>(slot_width) * slot_height * 4;
+            const py::buffer_info info = RequestOutput(out, bytes, 1);
+            std::vector<BatchCapture::ItemStatus> status;
+            {
+              py::gil_scoped_release nogil;
+              b.CaptureRGBA(static_cast<uint8_t *>(info.ptr), slot_width, slot_height, status);
+            }
+            return status;
+          },
+          py::arg("out"), py::arg("slot_width"), py::arg("slot_height"))
+      .def(
+          "capture_tensors",
+          [](BatchCapture &b, const TensorSink &sink, const py::buffer &out) {
+            const py::buffer_info info = RequestOutput(out, b.Size() * sink.ItemBytes(), TensorItemSize(sink.Spec()));
+            std::vector<BatchCapture::ItemStatus> status;
+            {
+              py::gil_scoped_release nogil;
+              b.CaptureTensors(sink, info.ptr, status);
+            }
+            return status;
+          },
+          py::arg("sink"), py::arg("out"));
+
+  // ---------- Threads ----------
+  py::class_<ThreadConfig>(m, "ThreadConfig")
+      .def(py::init<>())
+      .def_readwrite("name", &ThreadConfig::name)
+      .def_readwrite("cpus", &ThreadConfig::cpus)
+      .def_readwrite("realtime_priority", &ThreadConfig::realtime_priority)
+      .def_readwrite("nice", &ThreadConfig::nice)
+      .def_readwrite("numa_node", &ThreadConfig::numa_node);
+  m.def("apply_thread_config", &ApplyThreadConfig, py::arg("config"), "Apply to the calling thread.");
+
+  // ---------- Streaming ----------
+  py::class_<CaptureScheduler::Options>(m, "SchedulerOptions")
+      .def(py::init<>())
+      .def_property(
+          "coalesce_window_us", [](const CaptureScheduler::Options &o) { return o.coalesce_window.count(); },
+          [](CaptureScheduler::Options &o, int64_t us) { o.coalesce_window = std::chrono::microseconds(us); })
+      .def_readwrite("merge_slack_px", &CaptureScheduler::Options::merge_slack_px)
+      .def_readwrite("vsync_display", &CaptureScheduler::Options::vsync_display)
+      .def_property(
+          "vsync_offset_us", [](const CaptureScheduler::Options &o) { return o.vsync_offset.count(); },
+          [](CaptureScheduler::Options &o, int64_t us) { o.vsync_offset = std::chrono::microseconds(us); })
+      .def_readwrite("thread", &CaptureScheduler::Options::thread);
+
+  py::class_<PyScheduler>(m, "CaptureScheduler")
+      .def(py::init<const CaptureScheduler::Options &>(), py::arg("options") = CaptureScheduler::Options())
+      .def(
+          "subscribe",
+          [](PyScheduler &s, int display, std::optional<ScreenRect> region, double hz, py::function callback) {
+            // The last copy of the callback may die on the scheduler thread.
+            std::shared_ptr<py::function> fn(new py::function(std::move(callback)), [](py::function *f) {
+              py::gil_scoped_acquire gil;
+              delete f;
+            });
+            // The scheduler grabs (or crops) straight into a pooled frame that
+            // Python may keep; no extra copy.
+            return s.impl->Subscribe(display, region.value_or(ScreenRect{}), hz, Pool(),
+                                     [fn](int id, Frame frame) {
+                                       py::gil_scoped_acquire gil;
+                                       try {
+                                         (*fn)(id, std::move(frame));
+                                       } catch (py::error_already_set &e) {
+                                         e.discard_as_unraisable("easy_control.CaptureScheduler callback");
+                                       }
+                                     });
+          },
+          py::arg("display"), py::arg("region"), py::arg("hz"), py::arg("callback"),
+          "callback(subscription_id, Frame) runs on the scheduler thread. Returns the subscription id.")
+      .def("unsubscribe", [](PyScheduler &s, int id) { return s.impl->Unsubscribe(id); },
+           py::call_guard<py::gil_scoped_release>())
+      .def("start", [](PyScheduler &s) { s.impl->Start(); }, py::call_guard<py::gil_scoped_release>())
+      .def("stop", [](PyScheduler &s) { s.impl->Stop(); }, py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("is_running", [](const PyScheduler &s) { return s.impl->IsRunning(); })
+      .def("stats", [](const PyScheduler &s) {
+        const CaptureScheduler::Stats st = s.impl->GetStats();
+        py::dict d;
+        d["ticks"] = st.ticks;
+        d["server_reads"] = st.server_reads;
+        d["deliveries"] = st.deliveries;
+        d["failed_reads"] = st.failed_reads;
+        d["vsync_ticks"] = st.vsync_ticks;
+        return d;
+      });
+
+  // ---------- Input ----------
+  py::class_<InputCommand> cmd(m, "InputCommand");
+  py::enum_<InputCommand::Type>(cmd, "Type")
+      .value("MOUSE_MOVE", InputCommand::kMouseMove)
+      .value("MOUSE_MOVE_RELATIVE", InputCommand::kMouseMoveRelative)
+      .value("MOUSE_DOWN", InputCommand::kMouseDown)
+      .value("MOUSE_UP", InputCommand::kMouseUp)
+      .value("MOUSE_CLICK", InputCommand::kMouseClick)
+      .value("MOUSE_DRAG", InputCommand::kMouseDrag)
+      .value("KEY_DOWN", InputCommand::kKeyDown)
+      .value("KEY_UP", InputCommand::kKeyUp)
+      .value("SCROLL", InputCommand::kScroll)
+      .value("TEXT", InputCommand::kText);
+  cmd.def(py::init<>())
+      .def_readwrite("type", &InputCommand::type)
+      .def_readwrite("x", &InputCommand::x)
+      .def_readwrite("y", &InputCommand::y)
+      .def_readwrite("dx", &InputCommand::dx)
+      .def_readwrite("dy", &InputCommand::dy)
+      .def_readwrite("button", &InputCommand::button)
+      .def_readwrite("key", &InputCommand::key)
+      .def_readwrite("mods", &InputCommand::mods)
+      .def_readwrite("text", &InputCommand::text)
+      .def_static("move_to", &InputCommand::MoveTo, py::arg("x"), py::arg("y"))
+      .def_static("move_by", &InputCommand::MoveBy, py::arg("dx"), py::arg("dy"))
+      .def_static("mouse", &InputCommand::Button, py::arg("type"), py::arg("x"), py::arg("y"), py::arg("button"))
+      .def_static("key_event", &InputCommand::Key, py::arg("type"), py::arg("key"), py::arg("mods") = 0)
+      .def_static("scroll_by", &InputCommand::Scroll, py::arg("dx"), py::arg("dy"))
+      .def_static("typed", &InputCommand::Text, py::arg("utf8"));
+
+  py::class_<SystemInput> input(m, "SystemInput");
+  input.attr("LEFT") = static_cast<int>(SystemInput::kLeft);
+  input.attr("RIGHT") = static_cast<int>(SystemInput::kRight);
+  input.attr("MIDDLE") = static_cast<int>(SystemInput::kMiddle);
+  input.attr("SHIFT") = static_cast<uint64_t>(SystemInput::kShift);
+  input.attr("CONTROL") = static_cast<uint64_t>(SystemInput::kControl);
+  input.attr("OPTION") = static_cast<uint64_t>(SystemInput::kOption);
+  input.attr("COMMAND") = static_cast<uint64_t>(SystemInput::kCommand);
+  input.def(py::init<>())
+      .def_property_readonly("last_seq", &SystemInput::LastSeq)
+      .def("char_to_key_code", &SystemInput::CharToKeyCode, py::arg("c"))
+      .def("apply", &ApplyInputCommand, py::arg("command"), py::call_guard<py::gil_scoped_release>())
+      .def(
+          "submit",
+          [](SystemInput &input, const std::vector<InputCommand> &commands) {
+            // Converted under the GIL above; injected without it.
+            py::gil_scoped_release nogil;
+            for (const InputCommand &c : commands) ApplyInputCommand(input, c);
+            return input.LastSeq();
+          },
+          py::arg("commands"), "Inject a batch in order; returns the sequence number of the last event.")
+      .def("mouse_move_to", &SystemInput::MouseMoveTo, py::call_guard<py::gil_scoped_release>())
+      .def("mouse_click_at", &SystemInput::MouseClickAt, py::call_guard<py::gil_scoped_release>())
+      .def("key_click", &SystemInput::KeyboardClick, py::call_guard<py::gil_scoped_release>())
+      .def("type_text", &SystemInput::TypeUTF8, py::call_guard<py::gil_scoped_release>());
+}